@@ -124,18 +124,26 @@ fn addCoreSources(
         "src/olaf_ep_extractor.c",
         "src/olaf_fp_db_writer.c",
         "src/olaf_fp_db_writer_cache.c",
+        "src/olaf_fp_db_writer_queue.c",
         "src/olaf_fp_file_writer.c",
         "src/olaf_fp_extractor.c",
         "src/olaf_fp_matcher.c",
+        "src/olaf_audio_buffer.c",
         "src/olaf_reader_stream.c",
         "src/olaf_runner.c",
         "src/olaf_stream_processor.c",
+        "src/olaf_chunked_extractor.c",
+        "src/olaf_stream_pipeline.c",
+        "src/olaf_spsc_queue.c",
     };
 
-    // LMDB sources (only for native builds)
+    // LMDB sources, the shards, the connections to shard workers and the flat index (only for native builds)
     const lmdb_sources = [_][]const u8{
         "src/mdb.c",
         "src/midl.c",
+        "src/olaf_db_remote.c",
+        "src/olaf_db_shards.c",
+        "src/olaf_db_flat.c",
     };
 
     // Database implementation sources
@@ -1,10 +1,12 @@
 const std = @import("std");
+const builtin = @import("builtin");
 const fs = std.fs;
 const process = std.process;
 
 const types = @import("olaf_cli_types.zig");
 const olaf_cli_config = @import("olaf_cli_config.zig");
 const olaf_cli_util = @import("olaf_cli_util.zig");
+const olaf_cli_bridge = @import("olaf_cli_bridge.zig");
 
 // Import command modules
 const cmd_query = @import("olaf_cli_commands/olaf_cli_cmd_query.zig");
@@ -18,6 +20,10 @@ const cmd_delete = @import("olaf_cli_commands/olaf_cli_cmd_delete.zig");
 const cmd_cache = @import("olaf_cli_commands/olaf_cli_cmd_cache.zig");
 const cmd_store_cached = @import("olaf_cli_commands/olaf_cli_cmd_store_cached.zig");
 const cmd_dedup = @import("olaf_cli_commands/olaf_cli_cmd_dedup.zig");
+const cmd_serve = @import("olaf_cli_commands/olaf_cli_cmd_serve.zig");
+const cmd_serve_shard = @import("olaf_cli_commands/olaf_cli_cmd_serve_shard.zig");
+const cmd_compact_export = @import("olaf_cli_commands/olaf_cli_cmd_compact_export.zig");
+const cmd_merge_blocks = @import("olaf_cli_commands/olaf_cli_cmd_merge_blocks.zig");
 
 const debug = std.log.scoped(.olaf_cli).debug;
 
@@ -119,6 +125,38 @@ const commands = [_]Command{
         .needs_audio_files = cmd_dedup.CommandInfo.needs_audio_files,
         .func = cmd_dedup.execute,
     },
+    .{
+        .name = cmd_serve.CommandInfo.name,
+        .description = cmd_serve.CommandInfo.description,
+        .help = cmd_serve.CommandInfo.help,
+        .needs_audio_files = cmd_serve.CommandInfo.needs_audio_files,
+        .func = cmd_serve.execute,
+    },
+    .{
+        .name = cmd_compact_export.CommandInfo.name,
+        .description = cmd_compact_export.CommandInfo.description,
+        .help = cmd_compact_export.CommandInfo.help,
+        .needs_audio_files = cmd_compact_export.CommandInfo.needs_audio_files,
+        .func = cmd_compact_export.execute,
+    },
+    .{
+        .name = cmd_merge_blocks.CommandInfo.name,
+        .description = cmd_merge_blocks.CommandInfo.description,
+        .help = cmd_merge_blocks.CommandInfo.help,
+        .needs_audio_files = cmd_merge_blocks.CommandInfo.needs_audio_files,
+        .func = cmd_merge_blocks.execute,
+    },
+} ++ shard_worker_commands;
+
+// Shard workers listen on POSIX sockets, they are not available on Windows
+const shard_worker_commands = if (builtin.os.tag == .windows) [_]Command{} else [_]Command{
+    .{
+        .name = cmd_serve_shard.CommandInfo.name,
+        .description = cmd_serve_shard.CommandInfo.description,
+        .help = cmd_serve_shard.CommandInfo.help,
+        .needs_audio_files = cmd_serve_shard.CommandInfo.needs_audio_files,
+        .func = cmd_serve_shard.execute,
+    },
 };
 
 fn printCommandList() void {
@@ -180,6 +218,18 @@ pub fn main() !void {
         if (errr != error.PathAlreadyExists) return errr;
     };
 
+    // Divide the index over shards before the database is opened
+    if (config.db_shards.len > 0) {
+        for (config.db_shards) |shard_path| {
+            // a shard served by a worker process has an address instead of a folder
+            if (std.mem.startsWith(u8, shard_path, "unix:") or std.mem.startsWith(u8, shard_path, "tcp:")) continue;
+            fs.cwd().makePath(shard_path) catch |errr| {
+                if (errr != error.PathAlreadyExists) return errr;
+            };
+        }
+        try olaf_cli_bridge.olaf_create_shards(allocator, &config);
+    }
+
     const cache_path = try olaf_cli_util.expandPath(allocator, config.cache_folder);
     defer allocator.free(cache_path);
     debug("Cache path: {s}", .{cache_path});
@@ -242,11 +292,24 @@ pub fn main() !void {
                 print("Expected an argument for '--format': 'olaf query --format json file.mp3'\n", .{});
                 return;
             }
+        } else if (std.mem.eql(u8, arg, "--socket")) {
+            if (i + 1 < args_list.len) {
+                args.socket_path = args_list[i + 1];
+                i += 1;
+            } else {
+                print("Expected a path for '--socket': 'olaf serve --socket /tmp/olaf.sock'\n", .{});
+                return;
+            }
         } else if (std.mem.eql(u8, arg, "-f")) {
             args.force = true;
         } else {
             // It's an unrecognized argument, a file?
-            if (args.use_audio_ids) {
+            if (std.mem.eql(u8, command_name, cmd_delete.CommandInfo.name) and !olaf_cli_util.pathExists(allocator, arg)) {
+                // Moved or removed audio can still be deleted with the resource index
+                const identifier: ?[]const u8 = if (args.use_audio_ids) args_list[i + 1] else null;
+                try olaf_cli_util.audioFileReference(allocator, arg, identifier, &args.audio_files);
+                if (args.use_audio_ids) i += 1;
+            } else if (args.use_audio_ids) {
                 try olaf_cli_util.audioFileListWithId(allocator, arg, args_list[i + 1], &args.audio_files, config.allowed_audio_file_extensions);
                 i += 1; // Skip the next argument as it is the audio identifier
             } else {
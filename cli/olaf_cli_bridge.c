@@ -85,6 +85,18 @@
 #include <string.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <errno.h>
+
+//The query server listens on a Unix socket, it is not available on Windows
+#if !defined(_WIN32)
+	#include <pthread.h>
+	#include <signal.h>
+	#include <unistd.h>
+	#include <sys/socket.h>
+	#include <sys/un.h>
+#else
+	#include <io.h>
+#endif
 
 #include "olaf_cli_bridge.h"
 
@@ -92,6 +104,7 @@
 #include "olaf_runner.h"
 #include "olaf_config.h"
 #include "olaf_db.h"
+#include "olaf_db_remote.h"
 #include "olaf_fp_db_writer_cache.h"
 #include "olaf_fp_matcher.h"
 
@@ -151,12 +164,25 @@ int olaf_store_cached(int argc, const char* argv[]){
 	Olaf_Config* config = olaf_config_default();
 	Olaf_DB* db = olaf_db_new(config->dbFolder,false);
 
-	for(int arg_index = 2 ; arg_index < argc ; arg_index++){
-		const char* csv_filename = argv[arg_index];
-		Olaf_FP_DB_Writer_Cache * cache_writer  = olaf_fp_db_writer_cache_new(db,config,csv_filename);
-		olaf_fp_db_writer_cache_store(cache_writer);
-		olaf_fp_db_writer_cache_destroy(cache_writer);
+	//A fresh index is built in key order when the database is closed
+	olaf_db_start_bulk_load(db);
+
+	if(config->resourceIndex){
+		olaf_db_enable_resource_index(db);
+	}
+
+	//the cache files are read by several threads, the database is written here
+	size_t files = argc > 2 ? (size_t) (argc - 2) : 0;
+	Olaf_FP_DB_Writer_Cache ** cache_writers = (Olaf_FP_DB_Writer_Cache **) malloc((files + 1) * sizeof(Olaf_FP_DB_Writer_Cache *));
+	for(size_t i = 0 ; i < files ; i++){
+		const char* csv_filename = argv[i + 2];
+		cache_writers[i] = olaf_fp_db_writer_cache_new(db,config,csv_filename);
+	}
+	olaf_fp_db_writer_cache_store_all(cache_writers,files,(size_t) config->extractionThreads);
+	for(size_t i = 0 ; i < files ; i++){
+		olaf_fp_db_writer_cache_destroy(cache_writers[i]);
 	}
+	free(cache_writers);
 	olaf_db_destroy(db);
 	olaf_config_destroy(config);
 	exit(0);
@@ -170,6 +196,7 @@ typedef struct {
     const char *query_path;
 	float q_offset;
 	uint32_t exclude_identifier; // when non-zero, drop matches with this id
+	FILE *out; // where result lines go, stdout unless a query server is running
 } Olaf_Query_Print_Context;
 
 static _Thread_local Olaf_Query_Print_Context olaf_query_print_context = {0};
@@ -291,7 +318,8 @@ static void olaf_cli_print_match(int matchCount,
 
 	// query info
 	// "#{index} , #{total} , #{query} , #{query_offset} ,
-    printf("%d ,%d ,%s, %.3f, ",
+	FILE *out = olaf_query_print_context.out;
+    fprintf(out, "%d ,%d ,%s, %.3f, ",
 			(uint32_t)(olaf_query_print_context.q_index + 1),
 			(uint32_t) olaf_query_print_context.q_total,
 			olaf_query_print_context.query_path,
@@ -299,12 +327,12 @@ static void olaf_cli_print_match(int matchCount,
 
 	// match info
 	// #{match_count} , #{query_start} , #{query_stop},
-	printf("%d ,%.3f ,%.3f, ",
+	fprintf(out, "%d ,%.3f ,%.3f, ",
 		   matchCount,
 		   queryStart,
 		   queryStop);
 
-	printf("%s, %u, %.3f, %.3f\n",
+	fprintf(out, "%s, %u, %.3f, %.3f\n",
 		   path,
 		   matchIdentifier,
 		   referenceStart,
@@ -312,7 +340,30 @@ static void olaf_cli_print_match(int matchCount,
 }
 
 
-void olaf_query(Olaf_Config* config, size_t q_index, size_t q_total, const char * query_path, const char* raw_audio_path, const char* audio_identifier, uint32_t exclude_identifier){
+Olaf_Stream_Processor * olaf_raw_audio_processor_new(Olaf_Runner * runner, const char* raw_audio_path, int raw_audio_fd, const char* audio_identifier){
+	if(raw_audio_fd < 0){
+		return olaf_stream_processor_new(runner,raw_audio_path,audio_identifier);
+	}
+
+	FILE * audio_file = fdopen(raw_audio_fd,"rb");
+	if(audio_file == NULL){
+		fprintf(stderr,"Could not read raw audio from file descriptor %d: %s\n",raw_audio_fd,strerror(errno));
+		close(raw_audio_fd);
+		return NULL;
+	}
+
+	//Wait for the first sample: a decoder which fails writes nothing at all
+	int first = fgetc(audio_file);
+	if(first == EOF){
+		fclose(audio_file);
+		return NULL;
+	}
+	ungetc(first,audio_file);
+
+	return olaf_stream_processor_new_file(runner,audio_file,audio_identifier);
+}
+
+int olaf_query(Olaf_Config* config, size_t q_index, size_t q_total, const char * query_path, const char* raw_audio_path, int raw_audio_fd, const char* audio_identifier, uint32_t exclude_identifier){
 	//store the fingerprints in the database
 	Olaf_DB* db = olaf_db_new(config->dbFolder,false);
 	if(db == NULL){
@@ -320,7 +371,7 @@ void olaf_query(Olaf_Config* config, size_t q_index, size_t q_total, const char
 		exit(-1);
 		//close the database
 		olaf_db_destroy(db);
-		return;
+		return -1;
 	}
 	//close the database
 	olaf_db_destroy(db);
@@ -328,49 +379,80 @@ void olaf_query(Olaf_Config* config, size_t q_index, size_t q_total, const char
 	//create a new runner
 	Olaf_Runner * runner = olaf_runner_new(OLAF_RUNNER_MODE_QUERY, config, NULL,NULL);
 
-	//create a new stream processor; NULL means the raw audio file could not be opened
-	Olaf_Stream_Processor* processor = olaf_stream_processor_new(runner,raw_audio_path,audio_identifier);
-	if(processor == NULL){
-		olaf_runner_destroy(runner);
-		return;
-	}
+	int status = olaf_query_with_runner(runner, q_index, q_total, query_path, raw_audio_path, raw_audio_fd, audio_identifier, exclude_identifier, false);
 
-	olaf_query_print_context.q_index = q_index;
-    olaf_query_print_context.q_total = q_total;
-    olaf_query_print_context.query_path = query_path;
-	olaf_query_print_context.q_offset = 0.0f;
-	olaf_query_print_context.exclude_identifier = exclude_identifier;
-
-	Olaf_FP_Matcher_Result_Callback result_callback = olaf_cli_print_match;
-	olaf_stream_processor_set_result_callback(processor, result_callback);
-	olaf_stream_processor_set_result_header(processor, "query_index, total_queries, query_path, query_offset, match_count, query_start, query_stop, path, match_identifier, reference_start, reference_stop\n");
+	//destroy the runner
+	olaf_runner_destroy(runner);
 
+	return status;
+}
 
-	//process the audio file
-	olaf_stream_processor_process(processor);
+/** Write the JSON object for a processed query and clear the collected matches. */
+static void olaf_query_json_write(FILE *out, Olaf_Stream_Processor *processor, size_t q_index, size_t q_total, const char *query_path, float q_offset){
+	double audio_duration = olaf_stream_processor_audio_duration(processor);
+	double cpu_time_used = olaf_stream_processor_cpu_time(processor);
+	size_t total_fp = olaf_stream_processor_total_fingerprints(processor);
+	double fp_per_second = audio_duration > 0.0 ? (double) total_fp / audio_duration : 0.0;
+	double realtime_factor = cpu_time_used > 0.0 ? audio_duration / cpu_time_used : 0.0;
 
-	//destroy the stream processor
-	olaf_stream_processor_destroy(processor);
+	// Emit the JSON object. One object per query, no trailing newline so
+	// callers that concatenate multiple queries see a stream of objects
+	// they can pretty-print themselves.
+	fprintf(out, "{\n");
+	fprintf(out, "  \"query_index\": %zu,\n", q_index + 1);
+	fprintf(out, "  \"total_queries\": %zu,\n", q_total);
+	fprintf(out, "  \"query_path\": ");
+	json_print_escaped(out, query_path);
+	fprintf(out, ",\n");
+	fprintf(out, "  \"query_offset\": %.3f,\n", q_offset);
+	fprintf(out, "  \"fingerprints_matched\": %zu,\n", total_fp);
+	fprintf(out, "  \"query_duration_seconds\": %.3f,\n", audio_duration);
+	fprintf(out, "  \"fingerprints_per_second\": %.3f,\n", fp_per_second);
+	fprintf(out, "  \"search_time_seconds\": %.3f,\n", cpu_time_used);
+	fprintf(out, "  \"realtime_factor\": %.3f,\n", realtime_factor);
+	fprintf(out, "  \"matches\": [");
+	for(size_t i = 0; i < olaf_json_matches.len; i++){
+		Olaf_JSON_Match *m = &olaf_json_matches.items[i];
+		fprintf(out, "%s\n    {\n", i == 0 ? "" : ",");
+		fprintf(out, "      \"match_count\": %d,\n", m->matchCount);
+		fprintf(out, "      \"query_start\": %.3f,\n", m->queryStart);
+		fprintf(out, "      \"query_stop\": %.3f,\n", m->queryStop);
+		fprintf(out, "      \"path\": ");
+		json_print_escaped(out, m->path);
+		fprintf(out, ",\n");
+		fprintf(out, "      \"match_identifier\": %u,\n", m->matchIdentifier);
+		fprintf(out, "      \"reference_start\": %.3f,\n", m->referenceStart);
+		fprintf(out, "      \"reference_stop\": %.3f\n", m->referenceStop);
+		fprintf(out, "    }");
+	}
+	if(olaf_json_matches.len > 0) fprintf(out, "\n  ");
+	fprintf(out, "]\n}\n");
 
-	//destroy the runner
-	olaf_runner_destroy(runner);
+	olaf_json_match_list_reset(&olaf_json_matches);
 }
 
-void olaf_query_json(Olaf_Config* config, size_t q_index, size_t q_total, const char * query_path, const char* raw_audio_path, const char* audio_identifier, uint32_t exclude_identifier){
+int olaf_query_json(Olaf_Config* config, size_t q_index, size_t q_total, const char * query_path, const char* raw_audio_path, int raw_audio_fd, const char* audio_identifier, uint32_t exclude_identifier){
 	Olaf_DB* db = olaf_db_new(config->dbFolder,false);
 	if(db == NULL){
 		fprintf(stderr,"Error: Could not open database %s.\n",config->dbFolder);
 		exit(-1);
 		olaf_db_destroy(db);
-		return;
+		return -1;
 	}
 	olaf_db_destroy(db);
 
 	Olaf_Runner * runner = olaf_runner_new(OLAF_RUNNER_MODE_QUERY, config, NULL,NULL);
-	Olaf_Stream_Processor* processor = olaf_stream_processor_new(runner,raw_audio_path,audio_identifier);
+	int status = olaf_query_with_runner(runner, q_index, q_total, query_path, raw_audio_path, raw_audio_fd, audio_identifier, exclude_identifier, true);
+	olaf_runner_destroy(runner);
+
+	return status;
+}
+
+int olaf_query_with_runner(Olaf_Runner * runner, size_t q_index, size_t q_total, const char * query_path, const char* raw_audio_path, int raw_audio_fd, const char* audio_identifier, uint32_t exclude_identifier, bool json){
+	//create a new stream processor; NULL means the raw audio file could not be opened
+	Olaf_Stream_Processor* processor = olaf_raw_audio_processor_new(runner,raw_audio_path,raw_audio_fd,audio_identifier);
 	if(processor == NULL){
-		olaf_runner_destroy(runner);
-		return;
+		return -1;
 	}
 
 	olaf_query_print_context.q_index = q_index;
@@ -378,63 +460,405 @@ void olaf_query_json(Olaf_Config* config, size_t q_index, size_t q_total, const
 	olaf_query_print_context.query_path = query_path;
 	olaf_query_print_context.q_offset = 0.0f;
 	olaf_query_print_context.exclude_identifier = exclude_identifier;
+	olaf_query_print_context.out = stdout;
 
-	// Reset & install the collector callback. Suppress the human-readable
-	// summary line so the JSON document is the only thing on stdout/stderr
-	// that downstream parsers need to handle.
-	olaf_json_match_list_reset(&olaf_json_matches);
-	olaf_stream_processor_set_result_callback(processor, olaf_cli_collect_match);
-	olaf_stream_processor_set_result_header(processor, NULL);
-	olaf_stream_processor_set_suppress_summary(processor, true);
+	if(json){
+		// Reset & install the collector callback. Suppress the human-readable
+		// summary line so the JSON document is the only thing on stdout/stderr
+		// that downstream parsers need to handle.
+		olaf_json_match_list_reset(&olaf_json_matches);
+		olaf_stream_processor_set_result_callback(processor, olaf_cli_collect_match);
+		olaf_stream_processor_set_result_header(processor, NULL);
+		olaf_stream_processor_set_suppress_summary(processor, true);
 
-	olaf_stream_processor_process(processor);
+		olaf_stream_processor_process(processor);
 
-	double audio_duration = olaf_stream_processor_audio_duration(processor);
-	double cpu_time_used = olaf_stream_processor_cpu_time(processor);
-	size_t total_fp = olaf_stream_processor_total_fingerprints(processor);
-	double fp_per_second = audio_duration > 0.0 ? (double) total_fp / audio_duration : 0.0;
-	double realtime_factor = cpu_time_used > 0.0 ? audio_duration / cpu_time_used : 0.0;
+		olaf_query_json_write(stdout, processor, q_index, q_total, query_path, 0.0f);
+	}else{
+		olaf_stream_processor_set_result_callback(processor, olaf_cli_print_match);
+		olaf_stream_processor_set_result_header(processor, "query_index, total_queries, query_path, query_offset, match_count, query_start, query_stop, path, match_identifier, reference_start, reference_stop\n");
 
-	// Emit the JSON object. One object per query, no trailing newline so
-	// callers that concatenate multiple queries see a stream of objects
-	// they can pretty-print themselves.
-	printf("{\n");
-	printf("  \"query_index\": %zu,\n", q_index + 1);
-	printf("  \"total_queries\": %zu,\n", q_total);
-	printf("  \"query_path\": ");
-	json_print_escaped(stdout, query_path);
-	printf(",\n");
-	printf("  \"query_offset\": %.3f,\n", 0.0);
-	printf("  \"fingerprints_matched\": %zu,\n", total_fp);
-	printf("  \"query_duration_seconds\": %.3f,\n", audio_duration);
-	printf("  \"fingerprints_per_second\": %.3f,\n", fp_per_second);
-	printf("  \"search_time_seconds\": %.3f,\n", cpu_time_used);
-	printf("  \"realtime_factor\": %.3f,\n", realtime_factor);
-	printf("  \"matches\": [");
-	for(size_t i = 0; i < olaf_json_matches.len; i++){
-		Olaf_JSON_Match *m = &olaf_json_matches.items[i];
-		printf("%s\n    {\n", i == 0 ? "" : ",");
-		printf("      \"match_count\": %d,\n", m->matchCount);
-		printf("      \"query_start\": %.3f,\n", m->queryStart);
-		printf("      \"query_stop\": %.3f,\n", m->queryStop);
-		printf("      \"path\": ");
-		json_print_escaped(stdout, m->path);
-		printf(",\n");
-		printf("      \"match_identifier\": %u,\n", m->matchIdentifier);
-		printf("      \"reference_start\": %.3f,\n", m->referenceStart);
-		printf("      \"reference_stop\": %.3f\n", m->referenceStop);
-		printf("    }");
-	}
-	if(olaf_json_matches.len > 0) printf("\n  ");
-	printf("]\n}\n");
+		//process the audio file
+		olaf_stream_processor_process(processor);
+	}
 
-	olaf_json_match_list_reset(&olaf_json_matches);
+	//destroy the stream processor, the runner is kept
+	olaf_stream_processor_destroy(processor);
+
+	return 0;
+}
+
+//Memory streams are POSIX, on Windows the samples and results go through temporary files
+#if !defined(_WIN32)
+
+static FILE * olaf_query_output_open(char ** output, size_t * output_size){
+	return open_memstream(output, output_size);
+}
+
+//Close the output stream, the output is then complete
+static char * olaf_query_output_close(FILE * out, char * output, size_t * output_size){
+	(void)(output_size);
+	fclose(out);
+	return output;
+}
+
+static FILE * olaf_query_input_open(const void * raw_audio, size_t raw_audio_size){
+	//the samples are only read, fmemopen wants a non const buffer
+	return fmemopen((void *) raw_audio, raw_audio_size, "rb");
+}
+
+#else
+
+static FILE * olaf_query_output_open(char ** output, size_t * output_size){
+	(void)(output);
+	(void)(output_size);
+	return tmpfile();
+}
+
+//Read the output back from the temporary file and close it
+static char * olaf_query_output_close(FILE * out, char * output, size_t * output_size){
+	(void)(output);
+	long size = ftell(out);
+	char * text = size >= 0 ? (char *) malloc((size_t) size + 1) : NULL;
+	*output_size = 0;
+	if(text != NULL){
+		rewind(out);
+		*output_size = fread(text, 1, (size_t) size, out);
+		text[*output_size] = '\0';
+	}
+	fclose(out);
+	return text;
+}
+
+static FILE * olaf_query_input_open(const void * raw_audio, size_t raw_audio_size){
+	FILE * audio_file = tmpfile();
+	if(audio_file == NULL) return NULL;
+	if(fwrite(raw_audio, 1, raw_audio_size, audio_file) != raw_audio_size){
+		fclose(audio_file);
+		return NULL;
+	}
+	rewind(audio_file);
+	return audio_file;
+}
+
+#endif
+
+char * olaf_query_samples(Olaf_Config* config, size_t q_index, size_t q_total, const char * query_path, float q_offset, const void * raw_audio, size_t raw_audio_size, const char* audio_identifier, uint32_t exclude_identifier, bool json, size_t * output_size){
+	char * output = NULL;
+	*output_size = 0;
+	if(raw_audio_size == 0) return NULL;
+
+	FILE * out = olaf_query_output_open(&output, output_size);
+	if(out == NULL){
+		fprintf(stderr,"Error: %s\n",strerror(errno));
+		return NULL;
+	}
+
+	FILE * audio_file = olaf_query_input_open(raw_audio, raw_audio_size);
+	if(audio_file == NULL){
+		fprintf(stderr,"Error: %s\n",strerror(errno));
+		free(olaf_query_output_close(out, output, output_size));
+		return NULL;
+	}
+
+	Olaf_Runner * runner = olaf_runner_new(OLAF_RUNNER_MODE_QUERY, config, NULL,NULL);
+	Olaf_Stream_Processor * processor = olaf_stream_processor_new_file(runner,audio_file,audio_identifier);
+
+	olaf_query_print_context.q_index = q_index;
+	olaf_query_print_context.q_total = q_total;
+	olaf_query_print_context.query_path = query_path;
+	olaf_query_print_context.q_offset = q_offset;
+	olaf_query_print_context.exclude_identifier = exclude_identifier;
+	olaf_query_print_context.out = out;
+
+	//the matcher prints its result header to stdout, so the header is written here
+	if(json){
+		olaf_json_match_list_reset(&olaf_json_matches);
+		olaf_stream_processor_set_result_callback(processor, olaf_cli_collect_match);
+		olaf_stream_processor_set_suppress_summary(processor, true);
+		olaf_stream_processor_process(processor);
+		olaf_query_json_write(out, processor, q_index, q_total, query_path, q_offset);
+	}else{
+		fputs("query_index, total_queries, query_path, query_offset, match_count, query_start, query_stop, path, match_identifier, reference_start, reference_stop\n", out);
+		olaf_stream_processor_set_result_callback(processor, olaf_cli_print_match);
+		olaf_stream_processor_process(processor);
+	}
+
+	olaf_stream_processor_destroy(processor);
+	olaf_runner_destroy(runner);
+
+	return olaf_query_output_close(out, output, output_size);
+}
+
+void olaf_query_output_print(char * output, size_t output_size){
+	fwrite(output,1,output_size,stdout);
+	fflush(stdout);
+	free(output);
+}
+
+#if !defined(_WIN32)
+
+//The maximum length of a request line of the query server
+#define OLAF_SERVE_MAX_LINE 4096
+
+//The maximum size of raw audio sent in a single pcm request: one hour of audio
+#define OLAF_SERVE_MAX_PCM_BYTES ((size_t) 3600 * 16000 * sizeof(float))
 
+/** State of a query server worker thread. */
+typedef struct {
+	Olaf_Config *config; // shared, read only
+	Olaf_DB *db; // a reader handle of this worker
+	int server_fd; // the listening socket, shared by all workers
+} Olaf_Serve_Worker;
+
+//Run a single query and write the results followed by an empty line
+static void olaf_serve_query(Olaf_Runner *runner, Olaf_Stream_Processor *processor, FILE *out, bool json, const char *query_path){
+	//see fingerprints stored after the server was started
+	olaf_db_renew(runner->db);
+
+	olaf_query_print_context.q_index = 0;
+	olaf_query_print_context.q_total = 1;
+	olaf_query_print_context.query_path = query_path;
+	olaf_query_print_context.q_offset = 0.0f;
+	olaf_query_print_context.exclude_identifier = 0;
+	olaf_query_print_context.out = out;
+
+	olaf_stream_processor_set_suppress_summary(processor, true);
+	if(json){
+		olaf_json_match_list_reset(&olaf_json_matches);
+		olaf_stream_processor_set_result_callback(processor, olaf_cli_collect_match);
+		olaf_stream_processor_process(processor);
+		olaf_query_json_write(out, processor, 0, 1, query_path, 0.0f);
+	}else{
+		fputs("query_index, total_queries, query_path, query_offset, match_count, query_start, query_stop, path, match_identifier, reference_start, reference_stop\n", out);
+		olaf_stream_processor_set_result_callback(processor, olaf_cli_print_match);
+		olaf_stream_processor_process(processor);
+	}
 	olaf_stream_processor_destroy(processor);
+}
+
+//Handle requests on a connection until the client closes it
+static void olaf_serve_connection(Olaf_Runner *runner, int connection){
+	FILE *in = fdopen(connection, "rb");
+	FILE *out = fdopen(dup(connection), "wb");
+	if(in == NULL || out == NULL){
+		fprintf(stderr, "Could not open the connection: %s\n", strerror(errno));
+		if(in != NULL) fclose(in); else close(connection);
+		if(out != NULL) fclose(out);
+		return;
+	}
+
+	char line[OLAF_SERVE_MAX_LINE];
+	while(fgets(line, sizeof(line), in) != NULL){
+		line[strcspn(line, "\r\n")] = '\0';
+
+		// <query|pcm> <csv|json> <argument>
+		char *command = strtok(line, " ");
+		char *format = strtok(NULL, " ");
+		char *argument = strtok(NULL, "");
+		if(command == NULL || format == NULL || argument == NULL || (strcmp(format, "csv") != 0 && strcmp(format, "json") != 0)){
+			fprintf(out, "Error: expected 'query <csv|json> raw_audio_path' or 'pcm <csv|json> bytes [name]'\n\n");
+			fflush(out);
+			continue;
+		}
+		bool json = strcmp(format, "json") == 0;
+
+		if(strcmp(command, "query") == 0){
+			Olaf_Stream_Processor *processor = olaf_stream_processor_new(runner, argument, argument);
+			if(processor == NULL){
+				fprintf(out, "Error: audio file %s not found or unreadable\n", argument);
+			}else{
+				olaf_serve_query(runner, processor, out, json, argument);
+			}
+		}else if(strcmp(command, "pcm") == 0){
+			// the number of bytes of raw audio which follow the line, optionally a name
+			char *name = NULL;
+			size_t bytes = strtoull(argument, &name, 10);
+			while(*name == ' ') name++;
+			if(*name == '\0') name = "pcm";
+
+			if(bytes == 0 || bytes > OLAF_SERVE_MAX_PCM_BYTES){
+				fprintf(out, "Error: pcm requests need between 1 and %zu bytes of audio\n\n", OLAF_SERVE_MAX_PCM_BYTES);
+				fflush(out);
+				//the connection can not be resynchronized
+				break;
+			}
+			char *samples = (char *) malloc(bytes);
+			if(samples == NULL || fread(samples, 1, bytes, in) != bytes){
+				free(samples);
+				break;
+			}
+			//the reader closes the memory stream before the samples are freed
+			FILE *audio_file = fmemopen(samples, bytes, "rb");
+			if(audio_file == NULL){
+				fprintf(out, "Error: %s\n", strerror(errno));
+			}else{
+				olaf_serve_query(runner, olaf_stream_processor_new_file(runner, audio_file, name), out, json, name);
+			}
+			free(samples);
+		}else{
+			fprintf(out, "Error: unknown request '%s'\n", command);
+		}
+		fputc('\n', out);
+		fflush(out);
+	}
+
+	fclose(out);
+	fclose(in);
+}
+
+static void * olaf_serve_worker(void *arg){
+	Olaf_Serve_Worker *worker = (Olaf_Serve_Worker *) arg;
+
+	//the FFT setup and database snapshot are reused for every query of this thread
+	Olaf_Runner *runner = olaf_runner_new_shared(OLAF_RUNNER_MODE_QUERY, worker->config, worker->db);
+
+	while(true){
+		int connection = accept(worker->server_fd, NULL, NULL);
+		if(connection < 0){
+			if(errno == EINTR || errno == ECONNABORTED) continue;
+			fprintf(stderr, "Query server stopped accepting connections: %s\n", strerror(errno));
+			break;
+		}
+		olaf_serve_connection(runner, connection);
+	}
+
 	olaf_runner_destroy(runner);
+	return NULL;
+}
+
+int olaf_serve(Olaf_Config* config, const char* socket_path, size_t threads){
+	struct sockaddr_un address;
+	if(strlen(socket_path) >= sizeof(address.sun_path)){
+		fprintf(stderr, "Error: socket path '%s' is too long.\n", socket_path);
+		return -1;
+	}
+	if(threads == 0) threads = 1;
+
+	//a client which disconnects early should not stop the server
+	signal(SIGPIPE, SIG_IGN);
+
+	//keeps the database open read only, audio stored while serving becomes visible
+	Olaf_DB *db = olaf_db_new_live(config->dbFolder);
+
+	int server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(server_fd < 0){
+		fprintf(stderr, "Error: could not create a socket: %s\n", strerror(errno));
+		olaf_db_destroy(db);
+		return -1;
+	}
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, socket_path);
+
+	//a stale socket of a previous server
+	unlink(socket_path);
+	if(bind(server_fd, (struct sockaddr *) &address, sizeof(address)) != 0 || listen(server_fd, 64) != 0){
+		fprintf(stderr, "Error: could not listen on '%s': %s\n", socket_path, strerror(errno));
+		close(server_fd);
+		olaf_db_destroy(db);
+		return -1;
+	}
+
+	Olaf_Serve_Worker *workers = (Olaf_Serve_Worker *) calloc(threads, sizeof(Olaf_Serve_Worker));
+	pthread_t *worker_threads = (pthread_t *) calloc(threads, sizeof(pthread_t));
+	for(size_t i = 0 ; i < threads ; i++){
+		workers[i].config = config;
+		workers[i].db = olaf_db_new_reader(db);
+		workers[i].server_fd = server_fd;
+		//without a free reader slot the server runs with fewer threads
+		if(workers[i].db == NULL){
+			threads = i;
+			break;
+		}
+	}
+	for(size_t i = 0 ; i < threads ; i++){
+		pthread_create(&worker_threads[i], NULL, olaf_serve_worker, &workers[i]);
+	}
+	fprintf(stderr, "Listening for queries on '%s' with %zu threads.\n", socket_path, threads);
+
+	for(size_t i = 0 ; i < threads ; i++){
+		pthread_join(worker_threads[i], NULL);
+		olaf_db_destroy(workers[i].db);
+	}
+
+	close(server_fd);
+	unlink(socket_path);
+	free(worker_threads);
+	free(workers);
+	olaf_db_destroy(db);
+	return 0;
+}
+
+#else
+
+int olaf_serve(Olaf_Config* config, const char* socket_path, size_t threads){
+	(void)(config);
+	(void)(threads);
+	fprintf(stderr, "Error: could not listen on '%s', the query server is not supported on Windows.\n", socket_path);
+	return -1;
+}
+
+#endif
+
+int olaf_serve_shard(Olaf_Config* config, const char* address){
+	//keeps the database open read only, audio stored while serving becomes visible
+	Olaf_DB *db = olaf_db_new_live(config->dbFolder);
+
+	Olaf_DB_Remote_Server *server = olaf_db_remote_server_new(db, address);
+	if(server == NULL){
+		olaf_db_destroy(db);
+		return -1;
+	}
+	fprintf(stderr, "Serving the fingerprints of '%s' on '%s'.\n", config->dbFolder, address);
+
+	olaf_db_remote_server_wait(server);
+	olaf_db_remote_server_destroy(server);
+	olaf_db_destroy(db);
+	return 0;
 }
 
-void olaf_delete(Olaf_Config* config,const char* raw_audio_path, const char* audio_identifier){
+int olaf_compact_export(Olaf_Config* config){
+	Olaf_DB *db = olaf_db_new(config->dbFolder, true);
+	bool exported = olaf_db_export_flat(db);
+	olaf_db_destroy(db);
+	if(!exported) return -1;
+
+	fprintf(stderr, "Exported the flat index of '%s'.\n", config->dbFolder);
+	return 0;
+}
+
+int olaf_merge_blocks(Olaf_Config* config){
+	Olaf_DB *db = olaf_db_new(config->dbFolder, false);
+	bool merged = olaf_db_merge_blocks(db);
+	olaf_db_destroy(db);
+	if(!merged) return -1;
+
+	fprintf(stderr, "Merged the fingerprints of '%s' into posting blocks.\n", config->dbFolder);
+	return 0;
+}
+
+void olaf_delete_indexed(Olaf_Config* config,size_t audio_identifiers_len,const char* audio_identifiers[], bool * deleted_audio_identifier){
+	//a single write transaction for all identifiers
+	Olaf_DB* db = olaf_db_new(config->dbFolder,false);
+
+	for(size_t index = 0 ; index < audio_identifiers_len ; index++){
+		const char* audio_identifier = audio_identifiers[index];
+		uint32_t audio_id = olaf_db_identifier_id(audio_identifier,strlen(audio_identifier));
+		size_t deleted = olaf_db_delete_resource(db,audio_id);
+		if(deleted > 0 && olaf_db_has_meta_data(db,&audio_id)){
+			olaf_db_delete_meta_data(db,&audio_id);
+		}
+		if(deleted > 0){
+			fprintf(stderr,"Deleted %zu fingerprints of '%s' (%u) with the resource index\n",deleted,audio_identifier,audio_id);
+		}
+		deleted_audio_identifier[index] = deleted > 0;
+	}
+
+	olaf_db_destroy(db);
+}
+
+int olaf_delete(Olaf_Config* config,const char* raw_audio_path, int raw_audio_fd, const char* audio_identifier){
 	//store the fingerprints in the database
 	Olaf_DB* db = olaf_db_new(config->dbFolder,true);
 	if(db == NULL){
@@ -442,7 +866,7 @@ void olaf_delete(Olaf_Config* config,const char* raw_audio_path, const char* aud
 		exit(-1);
 		//close the database
 		olaf_db_destroy(db);
-		return;
+		return -1;
 	}
 	//close the database
 	olaf_db_destroy(db);
@@ -451,10 +875,10 @@ void olaf_delete(Olaf_Config* config,const char* raw_audio_path, const char* aud
 	Olaf_Runner * runner = olaf_runner_new(OLAF_RUNNER_MODE_DELETE, config, NULL,NULL);
 
 	//create a new stream processor; NULL means the raw audio file could not be opened
-	Olaf_Stream_Processor* processor = olaf_stream_processor_new(runner,raw_audio_path,audio_identifier);
+	Olaf_Stream_Processor* processor = olaf_raw_audio_processor_new(runner,raw_audio_path,raw_audio_fd,audio_identifier);
 	if(processor == NULL){
 		olaf_runner_destroy(runner);
-		return;
+		return -1;
 	}
 
 	//process the audio file
@@ -465,6 +889,8 @@ void olaf_delete(Olaf_Config* config,const char* raw_audio_path, const char* aud
 
 	//destroy the runner
 	olaf_runner_destroy(runner);
+
+	return 0;
 }
 
 void olaf_print(Olaf_Config* config, const char* raw_audio_path, const char* audio_identifier){
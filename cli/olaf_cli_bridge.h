@@ -4,6 +4,7 @@
 #include <stdint.h>
 
 #include "olaf_config.h"
+#include "olaf_stream_processor.h"
 
 
 // Print database statistics
@@ -13,6 +14,10 @@ int olaf_stats(const Olaf_Config* config);
 // Get the default Olaf configuration
 Olaf_Config* olaf_default_config();
 
+// Create a stream processor for raw audio in a file or, when raw_audio_fd is not -1, from a
+// file descriptor which is closed with the processor. Waits for the first bytes of a file
+// descriptor and returns NULL if the stream ends before any audio arrives.
+Olaf_Stream_Processor * olaf_raw_audio_processor_new(Olaf_Runner * runner, const char* raw_audio_path, int raw_audio_fd, const char* audio_identifier);
 // store audio file in the database
 // This function takes a raw audio file path and an audio identifier (e.g., original file name, or a unique identifier).
 // It processes the audio file and stores the fingerprints in the database.
@@ -21,14 +26,50 @@ void olaf_store(Olaf_Config* config, const char* raw_audio_path, const char* aud
 // `exclude_identifier`: when non-zero, suppress result lines whose
 // match_identifier equals this hash (used to filter self-matches in dedup).
 // Pass 0 for no filtering.
-void olaf_query(Olaf_Config* config, size_t q_index, size_t q_total, const char * query_path, const char* raw_audio_path, const char* audio_identifier, uint32_t exclude_identifier);
+// Pass -1 as raw_audio_fd to read raw_audio_path, otherwise raw audio is read from the
+// file descriptor, e.g. a pipe from a decoder, which is closed afterwards. Returns -1 when
+// no raw audio could be read.
+int olaf_query(Olaf_Config* config, size_t q_index, size_t q_total, const char * query_path, const char* raw_audio_path, int raw_audio_fd, const char* audio_identifier, uint32_t exclude_identifier);
 
 // Same as olaf_query but prints a single JSON object per query to stdout
 // (instead of CSV lines) and suppresses the human-readable summary on stderr.
-void olaf_query_json(Olaf_Config* config, size_t q_index, size_t q_total, const char * query_path, const char* raw_audio_path, const char* audio_identifier, uint32_t exclude_identifier);
-
-// Delete fingerprints from the database by audio identifier
-void olaf_delete(Olaf_Config* config, const char* raw_audio_path, const char* audio_identifier);
+int olaf_query_json(Olaf_Config* config, size_t q_index, size_t q_total, const char * query_path, const char* raw_audio_path, int raw_audio_fd, const char* audio_identifier, uint32_t exclude_identifier);
+
+// Same as olaf_query, or olaf_query_json when json is true, with a runner which is kept for
+// many queries, e.g. one for each worker thread. The runner keeps the database open and its
+// FFT setup and extractors are reused. Returns -1 when no raw audio could be read.
+int olaf_query_with_runner(Olaf_Runner * runner, size_t q_index, size_t q_total, const char * query_path, const char* raw_audio_path, int raw_audio_fd, const char* audio_identifier, uint32_t exclude_identifier, bool json);
+
+// Query raw audio in memory, e.g. a fragment of a decoded file, without touching stdout.
+// The results, formatted as by olaf_query or olaf_query_json, are returned in a buffer so
+// fragments queried in parallel can be printed in order with olaf_query_output_print.
+// q_offset is the position of the raw audio in the query file in seconds. Returns NULL
+// when no raw audio could be read.
+char * olaf_query_samples(Olaf_Config* config, size_t q_index, size_t q_total, const char * query_path, float q_offset, const void * raw_audio, size_t raw_audio_size, const char* audio_identifier, uint32_t exclude_identifier, bool json, size_t * output_size);
+
+// Write the results of olaf_query_samples to stdout and free them
+void olaf_query_output_print(char * output, size_t output_size);
+
+// Serve queries over a local Unix socket until the process is stopped. The index stays
+// open and each of the threads keeps its own read transaction and FFT setup. A request is
+// a line 'query <csv|json> raw_audio_path' or 'pcm <csv|json> bytes [name]' followed
+// by the raw samples, the response is the result followed by an empty line.
+int olaf_serve(Olaf_Config* config, const char* socket_path, size_t threads);
+// Serve the fingerprint look-ups of the database to a coordinating process until the
+// process is stopped, see olaf_db_remote.h. The address is 'unix:path' or 'tcp:host:port'.
+int olaf_serve_shard(Olaf_Config* config, const char* address);
+// Export the fingerprint index to a flat, memory mapped file used by later look-ups, see
+// olaf_db_export_flat. Returns -1 if the export fails.
+int olaf_compact_export(Olaf_Config* config);
+// Merge the recently stored fingerprints into compressed posting blocks, see
+// olaf_db_merge_blocks. Returns -1 if the merge fails.
+int olaf_merge_blocks(Olaf_Config* config);
+// Delete fingerprints from the database by audio identifier, raw_audio_fd as for olaf_query
+int olaf_delete(Olaf_Config* config, const char* raw_audio_path, int raw_audio_fd, const char* audio_identifier);
+
+// Delete fingerprints and meta data with the resource index, without audio. Sets
+// deleted_audio_identifier[i] to false when the index has no fingerprints for an identifier.
+void olaf_delete_indexed(Olaf_Config* config,size_t audio_identifiers_len,const char* audio_identifiers[],bool * deleted_audio_identifier);
 
 // Print fingerprints to a specified file
 void olaf_print_to_file(Olaf_Config* config, const char* raw_audio_path, const char* audio_identifier,FILE * fp_cache_file, FILE * fp_meta_file);
@@ -42,7 +83,7 @@ uint32_t olaf_name_to_id(const char* audio_identifier);
 // Check if audio files exist in the database and print metadata
 void olaf_has(Olaf_Config* config,size_t audio_identifiers_len,const char* audio_identifiers[],bool * has_audio_identifier);
 
-// Store fingerprints from CSV files using cache and exit
+// Store fingerprints from binary or CSV cache files and exit
 int olaf_store_cached(int argc, const char* argv[]);
 
 // Main entry point for Olaf CLI bridge
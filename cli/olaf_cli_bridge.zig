@@ -13,12 +13,35 @@ const olaf = @cImport({
     @cInclude("olaf_cli_bridge.h");
     @cInclude("olaf_db.h");
     @cInclude("olaf_fp_db_writer_cache.h");
+    @cInclude("olaf_fp_db_writer_queue.h");
     @cInclude("olaf_runner.h");
     @cInclude("olaf_stream_processor.h");
 });
 
 pub const StoreFormat = enum { human, csv, json };
 
+/// Raw audio samples for the C core: a transcoded file or the read end of a
+/// pipe from a decoder. The C side closes a file descriptor when it is done.
+pub const RawAudio = union(enum) {
+    path: []const u8,
+    fd: c_int,
+};
+
+/// Null terminated copy of the raw audio path, null for a file descriptor.
+fn rawAudioPathZ(allocator: std.mem.Allocator, raw_audio: RawAudio) !?[:0]u8 {
+    return switch (raw_audio) {
+        .path => |path| try allocator.dupeZ(u8, path),
+        .fd => null,
+    };
+}
+
+fn rawAudioFd(raw_audio: RawAudio) c_int {
+    return switch (raw_audio) {
+        .path => -1,
+        .fd => |fd| fd,
+    };
+}
+
 pub const store_csv_header = "action,file_index,file_total,audio_identifier,internal_id,fingerprints,audio_seconds,cpu_seconds,fingerprints_per_second,realtime_factor\n";
 
 fn olaf_main(allocator: std.mem.Allocator, args_list: []const []const u8) !void {
@@ -73,37 +96,148 @@ fn copy_to_c_config(config: *const olaf_cli_config.Config, c_config: *olaf.Olaf_
     c_config.printResultEvery = config.print_result_every;
     c_config.maxDBCollisions = @intCast(config.max_db_collisions);
 
+    // Database configurations
+    c_config.resourceIndex = config.resource_index;
+
+    // Processing configurations
+    c_config.extractionThreads = @intCast(config.extraction_threads);
+
     debug("Configuration copy complete", .{});
 }
 
-pub fn olaf_store(
-    allocator: std.mem.Allocator,
-    raw_audio_path: []const u8,
-    audio_identifier: []const u8,
-    config: *const olaf_cli_config.Config,
-    index: usize,
-    total: usize,
-    format: StoreFormat,
-) !void {
-    const c_config = olaf.olaf_default_config(); // Ensure the default config is set
-    try copy_to_c_config(config, c_config);
+/// Writer queue shared by parallel store workers, see olaf_fp_db_writer_queue.h
+pub const StoreQueue = olaf.Olaf_FP_DB_Writer_Queue;
 
-    // Path configuration - Replace C-allocated dbFolder with Zig-allocated one
-    if (c_config.*.dbFolder) |original_db_folder| {
-        olaf.free(original_db_folder);
+/// Opens the database for writing on a dedicated writer thread. `capacity`
+/// is the number of fingerprint batches that may wait in the queue before
+/// extraction workers block.
+pub fn olaf_store_queue_new(allocator: std.mem.Allocator, config: *const olaf_cli_config.Config, capacity: usize) !*StoreQueue {
+    // The queue keeps its own copy of the folder name
+    const c_db_folder = try allocator.dupeZ(u8, config.db_folder);
+    defer allocator.free(c_db_folder);
+    return olaf.olaf_fp_db_writer_queue_new(c_db_folder.ptr, capacity, config.resource_index) orelse error.OutOfMemory;
+}
+
+/// Drains the queue, commits the write transaction and stops the writer thread.
+pub fn olaf_store_queue_destroy(queue: *StoreQueue) void {
+    olaf.olaf_fp_db_writer_queue_destroy(queue);
+}
+
+/// Divides the fingerprint index over the shard folders of the configuration.
+/// The shard folders should exist.
+pub fn olaf_create_shards(allocator: std.mem.Allocator, config: *const olaf_cli_config.Config) !void {
+    var arena = std.heap.ArenaAllocator.init(allocator);
+    defer arena.deinit();
+    const arena_allocator = arena.allocator();
+
+    const c_db_folder = try arena_allocator.dupeZ(u8, config.db_folder);
+    const c_shard_folders = try arena_allocator.alloc([*c]const u8, config.db_shards.len);
+    for (config.db_shards, 0..) |shard_folder, i| {
+        c_shard_folders[i] = (try arena_allocator.dupeZ(u8, shard_folder)).ptr;
     }
+    if (!olaf.olaf_db_create_shards(c_db_folder.ptr, c_shard_folders.ptr, c_shard_folders.len)) {
+        return error.ShardsNotCreated;
+    }
+}
 
+/// Database opened once, read only, for the query sessions of all workers.
+pub const QueryDB = olaf.Olaf_DB;
+
+/// Creates the database if it does not exist yet and opens it read only.
+pub fn olaf_query_db_new(allocator: std.mem.Allocator, config: *const olaf_cli_config.Config) !*QueryDB {
     const c_db_folder = try allocator.dupeZ(u8, config.db_folder);
-    c_config.*.dbFolder = c_db_folder.ptr;
+    defer allocator.free(c_db_folder);
+    olaf.olaf_db_destroy(olaf.olaf_db_new(c_db_folder.ptr, false) orelse return error.DatabaseNotOpened);
+    return olaf.olaf_db_new(c_db_folder.ptr, true) orelse error.DatabaseNotOpened;
+}
 
-    defer {
-        // Manual cleanup: free dbFolder (with Zig allocator) then config (with C allocator)
-        allocator.free(c_db_folder);
-        olaf.free(c_config);
+/// Closes the database after all sessions using it are destroyed.
+pub fn olaf_query_db_destroy(db: *QueryDB) void {
+    olaf.olaf_db_destroy(db);
+}
+
+/// A runner kept by a worker thread for many files. The C config, the FFT
+/// setup, the extractors and the database handle are created once instead of
+/// for every file; the extractors are reset between files.
+pub const Session = struct {
+    allocator: std.mem.Allocator,
+    c_config: *olaf.Olaf_Config,
+    c_db_folder: [:0]u8,
+    runner: *olaf.Olaf_Runner,
+    /// Reader handle of the shared query database, null for store sessions
+    db: ?*olaf.Olaf_DB,
+
+    pub const Target = union(enum) {
+        /// Query with an own read transaction on a database of olaf_query_db_new.
+        /// Reader handles are not created concurrently, see olaf_db_new_reader.
+        query: *QueryDB,
+        /// Store through the writer queue or, when null, open the database for
+        /// writing and hold the writer lock until the session is destroyed.
+        store: ?*StoreQueue,
+    };
+
+    pub fn create(allocator: std.mem.Allocator, config: *const olaf_cli_config.Config, target: Target) !*Session {
+        const session = try allocator.create(Session);
+        errdefer allocator.destroy(session);
+
+        const c_config = olaf.olaf_default_config();
+        errdefer olaf.free(c_config);
+        try copy_to_c_config(config, c_config);
+
+        // Path configuration - Replace C-allocated dbFolder with Zig-allocated one
+        if (c_config.*.dbFolder) |original_db_folder| {
+            olaf.free(original_db_folder);
+        }
+        const c_db_folder = try allocator.dupeZ(u8, config.db_folder);
+        errdefer allocator.free(c_db_folder);
+        c_config.*.dbFolder = c_db_folder.ptr;
+
+        var db: ?*olaf.Olaf_DB = null;
+        const runner = switch (target) {
+            .query => |query_db| blk: {
+                db = olaf.olaf_db_new_reader(query_db) orelse return error.DatabaseNotOpened;
+                break :blk olaf.olaf_runner_new_shared(olaf.OLAF_RUNNER_MODE_QUERY, c_config, db);
+            },
+            .store => |queue| if (queue) |q|
+                olaf.olaf_runner_new_queued(olaf.OLAF_RUNNER_MODE_STORE, c_config, q)
+            else
+                olaf.olaf_runner_new(olaf.OLAF_RUNNER_MODE_STORE, c_config, null, null),
+        };
+
+        session.* = .{
+            .allocator = allocator,
+            .c_config = c_config,
+            .c_db_folder = c_db_folder,
+            .runner = runner,
+            .db = db,
+        };
+        return session;
     }
 
-    const c_raw_audio_path = try allocator.dupeZ(u8, raw_audio_path);
-    defer allocator.free(c_raw_audio_path);
+    pub fn destroy(self: *Session) void {
+        // A store runner without queue commits and closes its database
+        olaf.olaf_runner_destroy(self.runner);
+        if (self.db) |db| olaf.olaf_db_destroy(db);
+        self.allocator.free(self.c_db_folder);
+        olaf.free(self.c_config);
+        self.allocator.destroy(self);
+    }
+};
+
+/// Returns false if no raw audio could be read, nothing is stored then.
+pub fn olaf_store(
+    allocator: std.mem.Allocator,
+    raw_audio: RawAudio,
+    audio_identifier: []const u8,
+    config: *const olaf_cli_config.Config,
+    index: usize,
+    total: usize,
+    format: StoreFormat,
+    queue: ?*StoreQueue,
+    session: ?*Session,
+) !bool {
+    const c_raw_audio_path = try rawAudioPathZ(allocator, raw_audio);
+    defer if (c_raw_audio_path) |path| allocator.free(path);
 
     const c_audio_identifier = try allocator.dupeZ(u8, audio_identifier);
     defer allocator.free(c_audio_identifier);
@@ -112,10 +246,15 @@ pub fn olaf_store(
     // stream-processor's hardcoded summary line, run the processor here, and
     // emit one record from Zig. This lets every format — including .human —
     // include the file_index / file_total progress prefix.
-    const runner = olaf.olaf_runner_new(olaf.OLAF_RUNNER_MODE_STORE, c_config, null, null);
-    defer olaf.olaf_runner_destroy(runner);
-
-    const processor = olaf.olaf_stream_processor_new(runner, c_raw_audio_path, c_audio_identifier) orelse return;
+    // With a queue the runner does not open the database: fingerprints are
+    // handed to the writer thread and extraction runs without the writer lock.
+    // Without a session of the worker thread a runner is made for this file.
+    const file_session = if (session == null) try Session.create(allocator, config, .{ .store = queue }) else null;
+    defer if (file_session) |s| s.destroy();
+    const runner = (session orelse file_session.?).runner;
+
+    const c_raw_audio_path_ptr: [*c]const u8 = if (c_raw_audio_path) |path| path.ptr else null;
+    const processor = olaf.olaf_raw_audio_processor_new(runner, c_raw_audio_path_ptr, rawAudioFd(raw_audio), c_audio_identifier) orelse return false;
     defer olaf.olaf_stream_processor_destroy(processor);
 
     olaf.olaf_stream_processor_set_suppress_summary(processor, true);
@@ -134,6 +273,7 @@ pub fn olaf_store(
     const internal_id: u32 = olaf.olaf_name_to_id(c_audio_identifier);
 
     try writeStoreSummary(format, index, total, audio_identifier, internal_id, fingerprints, audio_seconds, cpu_seconds);
+    return true;
 }
 
 fn writeStoreSummary(
@@ -265,7 +405,23 @@ fn writeJsonString(w: anytype, s: []const u8) !void {
 
 pub const OutputFormat = enum { csv, json };
 
-pub fn olaf_query(allocator: std.mem.Allocator, q_index: usize, q_total: usize, query_path: []const u8, raw_audio_path: []const u8, audio_identifier: []const u8, config: *const olaf_cli_config.Config, exclude_identifier: u32, format: OutputFormat) !void {
+/// With a session the runner of the worker thread is reused, else a runner
+/// is made for this query. Returns false if no raw audio could be read.
+pub fn olaf_query(allocator: std.mem.Allocator, q_index: usize, q_total: usize, query_path: []const u8, raw_audio: RawAudio, audio_identifier: []const u8, config: *const olaf_cli_config.Config, exclude_identifier: u32, format: OutputFormat, session: ?*Session) !bool {
+    const c_raw_audio_path = try rawAudioPathZ(allocator, raw_audio);
+    defer if (c_raw_audio_path) |path| allocator.free(path);
+    const c_raw_audio_path_ptr: [*c]const u8 = if (c_raw_audio_path) |path| path.ptr else null;
+
+    const c_audio_identifier = try allocator.dupeZ(u8, audio_identifier);
+    defer allocator.free(c_audio_identifier);
+
+    const c_query_path = try allocator.dupeZ(u8, query_path);
+    defer allocator.free(c_query_path);
+
+    if (session) |s| {
+        return olaf.olaf_query_with_runner(s.runner, q_index, q_total, c_query_path, c_raw_audio_path_ptr, rawAudioFd(raw_audio), c_audio_identifier, exclude_identifier, format == .json) == 0;
+    }
+
     const c_config = olaf.olaf_default_config(); // Ensure the default config is set
     try copy_to_c_config(config, c_config);
 
@@ -283,8 +439,44 @@ pub fn olaf_query(allocator: std.mem.Allocator, q_index: usize, q_total: usize,
         olaf.free(c_config);
     }
 
-    const c_raw_audio_path = try allocator.dupeZ(u8, raw_audio_path);
-    defer allocator.free(c_raw_audio_path);
+    const status = switch (format) {
+        .csv => olaf.olaf_query(c_config, q_index, q_total, c_query_path, c_raw_audio_path_ptr, rawAudioFd(raw_audio), c_audio_identifier, exclude_identifier),
+        .json => olaf.olaf_query_json(c_config, q_index, q_total, c_query_path, c_raw_audio_path_ptr, rawAudioFd(raw_audio), c_audio_identifier, exclude_identifier),
+    };
+    return status == 0;
+}
+
+/// Results of a query on raw audio in memory, owned by the C side until printed.
+pub const QueryOutput = struct {
+    text: [*c]u8,
+    len: usize,
+
+    /// Writes the results to stdout and frees them.
+    pub fn print(self: QueryOutput) void {
+        olaf.olaf_query_output_print(self.text, self.len);
+    }
+};
+
+/// Queries raw audio in memory, e.g. a fragment of a decoded file. The results
+/// are returned instead of printed so parallel queries can be printed in order.
+/// `query_offset` is the position of the raw audio in the query file in seconds.
+pub fn olaf_query_samples(allocator: std.mem.Allocator, q_index: usize, q_total: usize, query_path: []const u8, query_offset: f32, raw_audio: []const u8, audio_identifier: []const u8, config: *const olaf_cli_config.Config, exclude_identifier: u32, format: OutputFormat) !QueryOutput {
+    const c_config = olaf.olaf_default_config(); // Ensure the default config is set
+    try copy_to_c_config(config, c_config);
+
+    // Path configuration - Replace C-allocated dbFolder with Zig-allocated one
+    if (c_config.*.dbFolder) |original_db_folder| {
+        olaf.free(original_db_folder);
+    }
+
+    const c_db_folder = try allocator.dupeZ(u8, config.db_folder);
+    c_config.*.dbFolder = c_db_folder.ptr;
+
+    defer {
+        // Manual cleanup: free dbFolder (with Zig allocator) then config (with C allocator)
+        allocator.free(c_db_folder);
+        olaf.free(c_config);
+    }
 
     const c_audio_identifier = try allocator.dupeZ(u8, audio_identifier);
     defer allocator.free(c_audio_identifier);
@@ -292,13 +484,106 @@ pub fn olaf_query(allocator: std.mem.Allocator, q_index: usize, q_total: usize,
     const c_query_path = try allocator.dupeZ(u8, query_path);
     defer allocator.free(c_query_path);
 
-    switch (format) {
-        .csv => olaf.olaf_query(c_config, q_index, q_total, c_query_path, c_raw_audio_path, c_audio_identifier, exclude_identifier),
-        .json => olaf.olaf_query_json(c_config, q_index, q_total, c_query_path, c_raw_audio_path, c_audio_identifier, exclude_identifier),
+    var len: usize = 0;
+    const text = olaf.olaf_query_samples(c_config, q_index, q_total, c_query_path, query_offset, raw_audio.ptr, raw_audio.len, c_audio_identifier, exclude_identifier, format == .json, &len);
+    if (text == null) {
+        return error.QueryFailed;
+    }
+    return QueryOutput{ .text = text, .len = len };
+}
+
+/// Serves queries over a Unix socket until the process is stopped, see olaf_serve in olaf_cli_bridge.h
+pub fn olaf_serve(allocator: std.mem.Allocator, socket_path: []const u8, threads: usize, config: *const olaf_cli_config.Config) !void {
+    const c_config = olaf.olaf_default_config();
+    try copy_to_c_config(config, c_config);
+
+    // Path configuration - Replace C-allocated dbFolder with Zig-allocated one
+    if (c_config.*.dbFolder) |original_db_folder| {
+        olaf.free(original_db_folder);
+    }
+    const c_db_folder = try allocator.dupeZ(u8, config.db_folder);
+    c_config.*.dbFolder = c_db_folder.ptr;
+    defer {
+        allocator.free(c_db_folder);
+        olaf.free(c_config);
+    }
+
+    const c_socket_path = try allocator.dupeZ(u8, socket_path);
+    defer allocator.free(c_socket_path);
+
+    if (olaf.olaf_serve(c_config, c_socket_path, threads) != 0) {
+        return error.ServeFailed;
+    }
+}
+
+/// Serves the fingerprint look-ups of the database to a coordinator until the process is stopped, see olaf_serve_shard in olaf_cli_bridge.h
+pub fn olaf_serve_shard(allocator: std.mem.Allocator, address: []const u8, config: *const olaf_cli_config.Config) !void {
+    const c_config = olaf.olaf_default_config();
+    try copy_to_c_config(config, c_config);
+
+    // Path configuration - Replace C-allocated dbFolder with Zig-allocated one
+    if (c_config.*.dbFolder) |original_db_folder| {
+        olaf.free(original_db_folder);
+    }
+    const c_db_folder = try allocator.dupeZ(u8, config.db_folder);
+    c_config.*.dbFolder = c_db_folder.ptr;
+    defer {
+        allocator.free(c_db_folder);
+        olaf.free(c_config);
+    }
+
+    const c_address = try allocator.dupeZ(u8, address);
+    defer allocator.free(c_address);
+
+    if (olaf.olaf_serve_shard(c_config, c_address) != 0) {
+        return error.ServeFailed;
+    }
+}
+
+/// Exports the fingerprint index to a flat, memory mapped file, see olaf_compact_export in olaf_cli_bridge.h
+pub fn olaf_compact_export(allocator: std.mem.Allocator, config: *const olaf_cli_config.Config) !void {
+    const c_config = olaf.olaf_default_config();
+    try copy_to_c_config(config, c_config);
+
+    // Path configuration - Replace C-allocated dbFolder with Zig-allocated one
+    if (c_config.*.dbFolder) |original_db_folder| {
+        olaf.free(original_db_folder);
+    }
+    const c_db_folder = try allocator.dupeZ(u8, config.db_folder);
+    c_config.*.dbFolder = c_db_folder.ptr;
+    defer {
+        allocator.free(c_db_folder);
+        olaf.free(c_config);
+    }
+
+    if (olaf.olaf_compact_export(c_config) != 0) {
+        return error.ExportFailed;
     }
 }
 
-pub fn olaf_delete(allocator: std.mem.Allocator, raw_audio_path: []const u8, audio_identifier: []const u8, config: *const olaf_cli_config.Config) !void {
+/// Merges recently stored fingerprints into posting blocks, see olaf_merge_blocks in olaf_cli_bridge.h
+pub fn olaf_merge_blocks(allocator: std.mem.Allocator, config: *const olaf_cli_config.Config) !void {
+    const c_config = olaf.olaf_default_config();
+    try copy_to_c_config(config, c_config);
+
+    // Path configuration - Replace C-allocated dbFolder with Zig-allocated one
+    if (c_config.*.dbFolder) |original_db_folder| {
+        olaf.free(original_db_folder);
+    }
+    const c_db_folder = try allocator.dupeZ(u8, config.db_folder);
+    c_config.*.dbFolder = c_db_folder.ptr;
+    defer {
+        allocator.free(c_db_folder);
+        olaf.free(c_config);
+    }
+
+    if (olaf.olaf_merge_blocks(c_config) != 0) {
+        return error.MergeFailed;
+    }
+}
+
+/// Returns false if no raw audio could be read.
+pub fn olaf_delete(allocator: std.mem.Allocator, raw_audio: RawAudio, audio_identifier: []const u8, config: *const olaf_cli_config.Config) !bool {
     const c_config = olaf.olaf_default_config(); // Ensure the default config is set
     try copy_to_c_config(config, c_config);
 
@@ -316,13 +601,56 @@ pub fn olaf_delete(allocator: std.mem.Allocator, raw_audio_path: []const u8, aud
         olaf.free(c_config);
     }
 
-    const c_raw_audio_path = try allocator.dupeZ(u8, raw_audio_path);
-    defer allocator.free(c_raw_audio_path);
+    const c_raw_audio_path = try rawAudioPathZ(allocator, raw_audio);
+    defer if (c_raw_audio_path) |path| allocator.free(path);
+    const c_raw_audio_path_ptr: [*c]const u8 = if (c_raw_audio_path) |path| path.ptr else null;
 
     const c_audio_identifier = try allocator.dupeZ(u8, audio_identifier);
     defer allocator.free(c_audio_identifier);
 
-    olaf.olaf_delete(c_config, c_raw_audio_path, c_audio_identifier);
+    return olaf.olaf_delete(c_config, c_raw_audio_path_ptr, rawAudioFd(raw_audio), c_audio_identifier) == 0;
+}
+
+/// Deletes audio identifiers with the resource index, without decoding audio.
+/// Returns, for each identifier, whether it was found in the resource index.
+pub fn olaf_delete_indexed(allocator: std.mem.Allocator, audio_identifiers: []const []const u8, config: *const olaf_cli_config.Config) ![]bool {
+    const c_config = olaf.olaf_default_config();
+    try copy_to_c_config(config, c_config);
+
+    // Path configuration - Replace C-allocated dbFolder with Zig-allocated one
+    if (c_config.*.dbFolder) |original_db_folder| {
+        olaf.free(original_db_folder);
+    }
+    const c_db_folder = try allocator.dupeZ(u8, config.db_folder);
+    c_config.*.dbFolder = c_db_folder.ptr;
+    defer {
+        allocator.free(c_db_folder);
+        olaf.free(c_config);
+    }
+
+    // Convert audio identifiers to C strings
+    var c_audio_identifiers = try allocator.alloc([*c]const u8, audio_identifiers.len);
+    defer allocator.free(c_audio_identifiers);
+
+    var c_strings = try allocator.alloc([:0]u8, audio_identifiers.len);
+    defer {
+        for (c_strings) |c_str| {
+            allocator.free(c_str);
+        }
+        allocator.free(c_strings);
+    }
+
+    for (audio_identifiers, 0..) |id, i| {
+        c_strings[i] = try allocator.dupeZ(u8, id);
+        c_audio_identifiers[i] = c_strings[i].ptr;
+    }
+
+    const deleted = try allocator.alloc(bool, audio_identifiers.len);
+    errdefer allocator.free(deleted);
+
+    olaf.olaf_delete_indexed(c_config, audio_identifiers.len, c_audio_identifiers.ptr, @ptrCast(deleted.ptr));
+
+    return deleted;
 }
 
 pub fn olaf_stats(allocator: std.mem.Allocator, config: *const olaf_cli_config.Config) !void {
@@ -445,7 +773,7 @@ pub fn olaf_print_to_file(
     const c_cache_file = try allocator.dupeZ(u8, fp_cache_file);
     defer allocator.free(c_cache_file);
 
-    const c_cache_fp = olaf.fopen(c_cache_file, "w");
+    const c_cache_fp = olaf.fopen(c_cache_file, "wb");
     if (c_cache_fp == null) return error.FdopenFailed;
 
     const c_meta_file = try allocator.dupeZ(u8, fp_meta_file);
@@ -469,7 +797,7 @@ pub const CachedFile = struct {
     audio_path: []const u8,
 };
 
-pub fn olaf_store_cached_files(allocator: std.mem.Allocator, entries: []const CachedFile, config: *const olaf_cli_config.Config) !void {
+pub fn olaf_store_cached_files(allocator: std.mem.Allocator, entries: []const CachedFile, config: *const olaf_cli_config.Config, threads: u32) !void {
     const c_config = olaf.olaf_default_config();
     try copy_to_c_config(config, c_config);
 
@@ -490,20 +818,46 @@ pub fn olaf_store_cached_files(allocator: std.mem.Allocator, entries: []const Ca
     const db = olaf.olaf_db_new(c_db_folder, false);
     defer olaf.olaf_db_destroy(db);
 
-    // Process each cache file
+    // A fresh index is built in key order when the database is closed
+    _ = olaf.olaf_db_start_bulk_load(db);
+
+    if (config.resource_index) {
+        _ = olaf.olaf_db_enable_resource_index(db);
+    }
+
+    // The cache writers keep a reference to the cache path until they are destroyed
+    const c_cache_files = try allocator.alloc([:0]u8, entries.len);
+    defer allocator.free(c_cache_files);
+    const cache_writers = try allocator.alloc(?*olaf.Olaf_FP_DB_Writer_Cache, entries.len);
+    defer allocator.free(cache_writers);
+
+    var created: usize = 0;
+    defer {
+        for (cache_writers[0..created], c_cache_files[0..created]) |cache_writer, c_cache_file| {
+            olaf.olaf_fp_db_writer_cache_destroy(cache_writer);
+            allocator.free(c_cache_file);
+        }
+    }
+
     for (entries) |entry| {
         const c_cache_file = try allocator.dupeZ(u8, entry.cache_path);
-        defer allocator.free(c_cache_file);
-        const c_audio_path = try allocator.dupeZ(u8, entry.audio_path);
+        const c_audio_path = allocator.dupeZ(u8, entry.audio_path) catch |err| {
+            allocator.free(c_cache_file);
+            return err;
+        };
         defer allocator.free(c_audio_path);
 
         const audio_id: u64 = olaf.olaf_db_identifier_id(c_audio_path, entry.audio_path.len);
 
         const cache_writer = olaf.olaf_fp_db_writer_cache_new(db, c_config, c_cache_file);
         olaf.olaf_fp_db_writer_cache_set_audio_file_info(cache_writer, c_audio_path, audio_id);
-        olaf.olaf_fp_db_writer_cache_store(cache_writer);
-        olaf.olaf_fp_db_writer_cache_destroy(cache_writer);
+        c_cache_files[created] = c_cache_file;
+        cache_writers[created] = cache_writer;
+        created += 1;
     }
+
+    // Cache files are read by several threads, the database is written on this thread
+    olaf.olaf_fp_db_writer_cache_store_all(cache_writers.ptr, created, @max(threads, 1));
 }
 
 pub fn olaf_has(allocator: std.mem.Allocator, audio_identifiers: []const []const u8, config: *const olaf_cli_config.Config) ![]bool {
@@ -109,6 +109,20 @@ pub fn execute(allocator: std.mem.Allocator, args: *types.Args) !void {
                 try dir.deleteFile(entry.path);
             }
         }
+
+        // The fingerprints in the shards belong to the cleared database
+        for (config.db_shards) |shard_folder| {
+            var shard_dir = std.fs.cwd().openDir(shard_folder, .{}) catch |err| {
+                if (err == error.FileNotFound) continue;
+                return err;
+            };
+            defer shard_dir.close();
+            for ([_][]const u8{ "data.mdb", "lock.mdb", "olaf_fingerprints.flat" }) |file_name| {
+                shard_dir.deleteFile(file_name) catch |err| {
+                    if (err != error.FileNotFound) return err;
+                };
+            }
+        }
     }
 
     if (delete_cache) {
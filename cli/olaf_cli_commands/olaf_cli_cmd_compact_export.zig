@@ -0,0 +1,18 @@
+const std = @import("std");
+const olaf_cli_bridge = @import("../olaf_cli_bridge.zig");
+const types = @import("../olaf_cli_types.zig");
+
+const debug = std.log.scoped(.olaf_cli_compact_export).debug;
+
+pub const CommandInfo = struct {
+    pub const name = "compact_export";
+    pub const description = "Exports the fingerprint index to a compact, memory mapped file for faster look-ups.\n\t\tExport again after storing or deleting audio, an outdated export is ignored.";
+    pub const help = "";
+    pub const needs_audio_files = false;
+};
+
+pub fn execute(allocator: std.mem.Allocator, args: *types.Args) !void {
+    debug("Exporting the fingerprint index of {s}", .{args.config.?.db_folder});
+
+    try olaf_cli_bridge.olaf_compact_export(allocator, args.config.?);
+}
@@ -16,7 +16,7 @@ fn print(comptime fmt: []const u8, args: anytype) void {
 
 pub const CommandInfo = struct {
     pub const name = "delete";
-    pub const description = "Delete fingerprints from the database by audio identifier.";
+    pub const description = "Delete fingerprints from the database by audio identifier. Audio stored with a resource index is deleted without decoding it, also if the file has been moved or removed.";
     pub const help = "[audio_file...] | --with-ids [[audio_file audio_identifier] ...]";
     pub const needs_audio_files = true;
 };
@@ -36,7 +36,18 @@ pub fn execute(allocator: std.mem.Allocator, args: *types.Args) !void {
         return;
     }
 
+    // Audio stored with a resource index is deleted without decoding it again
+    const identifiers = try allocator.alloc([]const u8, args.audio_files.items.len);
+    defer allocator.free(identifiers);
     for (args.audio_files.items, 0..) |audio_file, index| {
+        identifiers[index] = audio_file.identifier;
+    }
+    const deleted = try olaf_cli_bridge.olaf_delete_indexed(allocator, identifiers, args.config.?);
+    defer allocator.free(deleted);
+
+    for (args.audio_files.items, 0..) |audio_file, index| {
+        if (deleted[index]) continue;
+
         debug("Delete audio file: {s} with identifier: {s}", .{ audio_file.path, audio_file.identifier });
         olaf_cli_threading.processAudioFile(
             allocator,
@@ -48,6 +59,8 @@ pub fn execute(allocator: std.mem.Allocator, args: *types.Args) !void {
             0,
             .csv,
             .human,
+            null,
+            null,
         ) catch |err| {
             return err;
         };
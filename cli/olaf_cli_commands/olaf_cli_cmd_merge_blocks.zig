@@ -0,0 +1,18 @@
+const std = @import("std");
+const olaf_cli_bridge = @import("../olaf_cli_bridge.zig");
+const types = @import("../olaf_cli_types.zig");
+
+const debug = std.log.scoped(.olaf_cli_merge_blocks).debug;
+
+pub const CommandInfo = struct {
+    pub const name = "merge_blocks";
+    pub const description = "Merges the recently stored fingerprints into compressed posting blocks, one per hash.\n\t\tThis also happens automatically when many fingerprints are stored since the last merge.";
+    pub const help = "";
+    pub const needs_audio_files = false;
+};
+
+pub fn execute(allocator: std.mem.Allocator, args: *types.Args) !void {
+    debug("Merging the fingerprints of {s} into posting blocks", .{args.config.?.db_folder});
+
+    try olaf_cli_bridge.olaf_merge_blocks(allocator, args.config.?);
+}
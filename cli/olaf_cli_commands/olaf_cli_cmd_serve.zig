@@ -0,0 +1,29 @@
+const std = @import("std");
+const builtin = @import("builtin");
+const olaf_cli_bridge = @import("../olaf_cli_bridge.zig");
+const olaf_cli_util = @import("../olaf_cli_util.zig");
+const types = @import("../olaf_cli_types.zig");
+
+const debug = std.log.scoped(.olaf_cli_serve).debug;
+
+pub const CommandInfo = struct {
+    pub const name = "serve";
+    pub const description = "Keeps the index open and answers queries over a Unix socket.\n\t\t--threads n\t The number of queries to handle in parallel.\n\t\t--socket path\t The socket to listen on (default: ~/.olaf/olaf.sock).";
+    pub const help = "[--threads n] [--socket path]";
+    pub const needs_audio_files = false;
+};
+
+pub fn execute(allocator: std.mem.Allocator, args: *types.Args) !void {
+    // the server listens on a Unix socket
+    if (builtin.os.tag == .windows) {
+        std.log.err("The query server is not supported on Windows.", .{});
+        return error.Unsupported;
+    }
+
+    const socket_path = try olaf_cli_util.expandPath(allocator, args.socket_path orelse "~/.olaf/olaf.sock");
+    defer allocator.free(socket_path);
+
+    debug("Serving queries on {s} with {d} threads", .{ socket_path, args.threads });
+
+    try olaf_cli_bridge.olaf_serve(allocator, socket_path, args.threads, args.config.?);
+}
@@ -0,0 +1,22 @@
+const std = @import("std");
+const olaf_cli_bridge = @import("../olaf_cli_bridge.zig");
+const olaf_cli_util = @import("../olaf_cli_util.zig");
+const types = @import("../olaf_cli_types.zig");
+
+const debug = std.log.scoped(.olaf_cli_serve_shard).debug;
+
+pub const CommandInfo = struct {
+    pub const name = "serve_shard";
+    pub const description = "Serves the fingerprint look-ups of the database to a coordinator with remote shards.\n\t\t--socket address\t 'unix:path' or 'tcp:host:port' (default: ~/.olaf/olaf_shard.sock).";
+    pub const help = "[--socket address]";
+    pub const needs_audio_files = false;
+};
+
+pub fn execute(allocator: std.mem.Allocator, args: *types.Args) !void {
+    const address = try olaf_cli_util.expandPath(allocator, args.socket_path orelse "~/.olaf/olaf_shard.sock");
+    defer allocator.free(address);
+
+    debug("Serving the fingerprints on {s}", .{address});
+
+    try olaf_cli_bridge.olaf_serve_shard(allocator, address, args.config.?);
+}
@@ -10,8 +10,8 @@ const fs = std.fs;
 
 pub const CommandInfo = struct {
     pub const name = "store_cached";
-    pub const description = "Stores fingerprints cached in text files into the database.\n\tAfter caching fingerprints with 'olaf cache audio_files...' use store_cached to index them.";
-    pub const help = "";
+    pub const description = "Stores fingerprints cached in binary cache files into the database.\n\tAfter caching fingerprints with 'olaf cache audio_files...' use store_cached to index them.\n\t\t--threads n\t The number of threads reading cache files.";
+    pub const help = "[--threads n]";
     pub const needs_audio_files = false;
 };
 
@@ -73,15 +73,21 @@ pub fn execute(allocator: std.mem.Allocator, args: *types.Args) !void {
 
     debug("Found {d} cache files to process\n", .{file_count});
 
-    // Process each cache file
+    // Collect the cache files to store, they are stored together in a single bulk load
+    var cached_files = std.ArrayList(olaf_cli_bridge.CachedFile){};
+    defer {
+        for (cached_files.items) |cached_file| {
+            allocator.free(cached_file.cache_path);
+            allocator.free(cached_file.audio_path);
+        }
+        cached_files.deinit(allocator);
+    }
+
     var current_index: usize = 0;
     var iter = cache_dir.iterate();
     while (try iter.next()) |entry| {
         if (entry.kind != .file or !std.mem.endsWith(u8, entry.name, ".tdb")) continue;
 
-        const cache_file_path = try std.fmt.allocPrint(allocator, "{s}/{s}", .{ cache_folder_expanded, entry.name });
-        defer allocator.free(cache_file_path);
-
         const i = current_index;
         current_index += 1;
         const index = i + 1;
@@ -100,8 +106,6 @@ pub fn execute(allocator: std.mem.Allocator, args: *types.Args) !void {
         };
 
         if (audio_filename) |filename| {
-            defer allocator.free(filename);
-
             // Check if already indexed (if configured to skip duplicates)
             if (config.skip_duplicates) {
                 const has_results = try olaf_cli_bridge.olaf_has(allocator, &[_][]const u8{filename}, config);
@@ -109,24 +113,32 @@ pub fn execute(allocator: std.mem.Allocator, args: *types.Args) !void {
 
                 if (has_results[0]) {
                     print("{d}/{d}, {s}, SKIPPED: already indexed audio file\n", .{ index, total, filename });
+                    allocator.free(filename);
                     continue;
                 }
             }
 
-            // Store cached fingerprints
-            debug("Processing cache file {d}/{d}: {s}\n", .{ index, total, cache_file_path });
-
-            try olaf_cli_bridge.olaf_store_cached_files(
-                allocator,
-                &[_]olaf_cli_bridge.CachedFile{.{ .cache_path = cache_file_path, .audio_path = filename }},
-                config,
-            );
-
-            print("{d}/{d}, {s}, stored from cache\n", .{ index, total, filename });
+            const cache_file_path = std.fmt.allocPrint(allocator, "{s}/{s}", .{ cache_folder_expanded, entry.name }) catch |err| {
+                allocator.free(filename);
+                return err;
+            };
+            cached_files.append(allocator, .{ .cache_path = cache_file_path, .audio_path = filename }) catch |err| {
+                allocator.free(cache_file_path);
+                allocator.free(filename);
+                return err;
+            };
         } else {
             print("{d}/{d}, WARNING: {s} has no path= entry: skipping\n", .{ index, total, meta_file_path });
         }
     }
 
-    print("Stored {d} cache files\n", .{file_count});
+    // Cache files are read in parallel, the database is written in key order when it is closed
+    debug("Storing {d} cache files with {d} threads\n", .{ cached_files.items.len, args.threads });
+    try olaf_cli_bridge.olaf_store_cached_files(allocator, cached_files.items, config, args.threads);
+
+    for (cached_files.items, 0..) |cached_file, i| {
+        print("{d}/{d}, {s}, stored from cache\n", .{ i + 1, cached_files.items.len, cached_file.audio_path });
+    }
+
+    print("Stored {d} cache files\n", .{cached_files.items.len});
 }
@@ -11,6 +11,8 @@ pub const Config = struct {
     // Path configurations
     db_folder: []const u8 = "~/.olaf/db/",
     cache_folder: []const u8 = "~/.olaf/cache",
+    // Folders or worker addresses of the shards the fingerprint index is divided over, empty for a single index
+    db_shards: []const []const u8 = &.{},
 
     // CLI specific configurations
     check_incoming_audio: bool = true,
@@ -57,6 +59,12 @@ pub const Config = struct {
     print_result_every: f32 = 0,
     max_db_collisions: u32 = 2000,
 
+    // Database configurations
+    resource_index: bool = false,
+
+    // Processing configurations
+    extraction_threads: u32 = 1,
+
     pub fn deinit(self: *Config, allocator: std.mem.Allocator) void {
         debug("Config deinit", .{});
 
@@ -71,6 +79,12 @@ pub const Config = struct {
         debug("Free db_folder cleanup", .{});
         allocator.free(self.db_folder);
 
+        debug("Free db_shards cleanup", .{});
+        for (self.db_shards) |shard| {
+            allocator.free(shard);
+        }
+        allocator.free(self.db_shards);
+
         debug("Free allowed_audio_file_extensions cleanup", .{});
         for (self.allowed_audio_file_extensions) |ext| {
             debug("Free allowed_audio_file_extension '{s}'", .{ext});
@@ -90,6 +104,10 @@ pub const Config = struct {
         try writer.print("Current Config:\n", .{});
         try writer.print("  db_folder: {s}\n", .{self.db_folder});
         try writer.print("  cache_folder: {s}\n", .{self.cache_folder});
+        try writer.print("  db_shards:\n", .{});
+        for (self.db_shards) |shard| {
+            try writer.print("    {s}\n", .{shard});
+        }
         try writer.print("  check_incoming_audio: {}\n", .{self.check_incoming_audio});
         try writer.print("  skip_duplicates: {}\n", .{self.skip_duplicates});
         try writer.print("  fragment_duration_in_seconds: {}\n", .{self.fragment_duration_in_seconds});
@@ -124,6 +142,8 @@ pub const Config = struct {
         try writer.print("  keep_matches_for: {d}\n", .{self.keep_matches_for});
         try writer.print("  print_result_every: {d}\n", .{self.print_result_every});
         try writer.print("  max_db_collisions: {}\n", .{self.max_db_collisions});
+        try writer.print("  resource_index: {}\n", .{self.resource_index});
+        try writer.print("  extraction_threads: {}\n", .{self.extraction_threads});
     }
 
     pub fn debugPrint(self: *const Config) void {
@@ -135,6 +155,10 @@ pub const Config = struct {
         debug("Current Config:", .{});
         debug("  db_folder: {s}", .{self.db_folder});
         debug("  cache_folder: {s}", .{self.cache_folder});
+        debug("  db_shards:", .{});
+        for (self.db_shards) |shard| {
+            debug("    {s}", .{shard});
+        }
         debug("  check_incoming_audio: {}", .{self.check_incoming_audio});
         debug("  skip_duplicates: {}", .{self.skip_duplicates});
         debug("  fragment_duration_in_seconds: {}", .{self.fragment_duration_in_seconds});
@@ -169,6 +193,8 @@ pub const Config = struct {
         debug("  keep_matches_for: {d}", .{self.keep_matches_for});
         debug("  print_result_every: {d}", .{self.print_result_every});
         debug("  max_db_collisions: {}", .{self.max_db_collisions});
+        debug("  resource_index: {}", .{self.resource_index});
+        debug("  extraction_threads: {}", .{self.extraction_threads});
     }
 
     pub fn infoPrint(self: *const Config) !void {
@@ -239,7 +265,23 @@ pub fn readJsonConfigOrDefault(allocator: std.mem.Allocator, path: []const u8) !
         defer allocator.free(cache_folder);
         config.cache_folder = try olaf_cli_util.expandPath(allocator, cache_folder);
 
-        // Array field
+        // Array fields
+        if (obj.get("db_shards")) |val| {
+            if (val == .array) {
+                const arr = val.array;
+                const shard_list = try allocator.alloc([]const u8, arr.items.len);
+                for (arr.items, 0..) |item, i| {
+                    if (item != .string) return error.InvalidShardFolder;
+                    shard_list[i] = try olaf_cli_util.expandPath(allocator, item.string);
+                }
+                config.db_shards = shard_list;
+            } else {
+                config.db_shards = try allocator.alloc([]const u8, 0);
+            }
+        } else {
+            config.db_shards = try allocator.alloc([]const u8, 0);
+        }
+
         if (obj.get("allowed_audio_file_extensions")) |val| {
             if (val == .array) {
                 const arr = val.array;
@@ -345,6 +387,12 @@ pub fn readJsonConfigOrDefault(allocator: std.mem.Allocator, path: []const u8) !
         if (obj.get("max_db_collisions")) |val| {
             if (val == .integer) config.max_db_collisions = @intCast(val.integer);
         }
+        if (obj.get("resource_index")) |val| {
+            if (val == .bool) config.resource_index = val.bool;
+        }
+        if (obj.get("extraction_threads")) |val| {
+            if (val == .integer) config.extraction_threads = @intCast(@max(1, val.integer));
+        }
 
         // Float fields
         if (obj.get("min_event_point_magnitude")) |val| {
@@ -382,6 +430,7 @@ pub fn readJsonConfigOrDefault(allocator: std.mem.Allocator, path: []const u8) !
             // to keep the config memory use consistent, we dupe the default values
             config.db_folder = try allocator.dupe(u8, config.db_folder);
             config.cache_folder = try allocator.dupe(u8, config.cache_folder);
+            config.db_shards = try allocator.alloc([]const u8, 0);
             const ext_list = try allocator.alloc([]const u8, config.allowed_audio_file_extensions.len);
             for (config.allowed_audio_file_extensions, 0..) |ext, i| {
                 ext_list[i] = try allocator.dupe(u8, ext);
@@ -1,4 +1,5 @@
 const std = @import("std");
+const builtin = @import("builtin");
 const Thread = std.Thread;
 const Mutex = Thread.Mutex;
 const WaitGroup = Thread.WaitGroup;
@@ -37,10 +38,46 @@ pub const AudioProcessTask = struct {
     output_format: olaf_cli_bridge.OutputFormat,
     /// Output format for store summaries. Ignored for non-store actions.
     store_format: olaf_cli_bridge.StoreFormat,
+    /// Shared database writer queue for parallel store. When null the
+    /// worker opens the database itself and holds the writer lock.
+    store_queue: ?*olaf_cli_bridge.StoreQueue,
+    /// Runners kept for the workers, null to make a runner for each file.
+    sessions: ?*SessionPool,
     error_mutex: *Mutex,
     error_list: *std.ArrayList([]const u8),
 };
 
+/// Sessions of the worker threads: a task takes a session, processes its file
+/// and gives the session back. There are at most as many sessions as tasks
+/// running at the same time, each keeps its runner for all files it processes.
+pub const SessionPool = struct {
+    allocator: std.mem.Allocator,
+    config: *const olaf_cli_config.Config,
+    target: olaf_cli_bridge.Session.Target,
+    mutex: Mutex = .{},
+    idle: std.ArrayList(*olaf_cli_bridge.Session) = .{},
+
+    fn acquire(self: *SessionPool) !*olaf_cli_bridge.Session {
+        // Also serializes the creation of database reader handles
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        if (self.idle.pop()) |session| return session;
+        return olaf_cli_bridge.Session.create(self.allocator, self.config, self.target);
+    }
+
+    fn release(self: *SessionPool, session: *olaf_cli_bridge.Session) void {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        self.idle.append(self.allocator, session) catch session.destroy();
+    }
+
+    /// Destroys the sessions, all tasks should be done.
+    fn deinit(self: *SessionPool) void {
+        for (self.idle.items) |session| session.destroy();
+        self.idle.deinit(self.allocator);
+    }
+};
+
 // Helper function to create a temporary raw audio file path
 fn createTempRawPath(allocator: std.mem.Allocator) ![]u8 {
     const tmp_dir = if (std.process.getEnvVarOwned(allocator, "TMPDIR")) |dir| dir else |_| try allocator.dupe(u8, "/tmp/");
@@ -57,10 +94,15 @@ fn createTempRawPath(allocator: std.mem.Allocator) ![]u8 {
     return try std.fmt.allocPrint(allocator, "{s}/olaf_audio_{d}_{d}.raw", .{ olaf_cache_dir, std.Thread.getCurrentId(), seq });
 }
 
-// Helper function to process an audio file and convert it to raw format
-pub fn processAudioFile(
+/// Decodes an audio file with ffmpeg into a pipe which the C reader consumes
+/// while ffmpeg is still decoding: no intermediate raw file is written.
+/// Returns false when ffmpeg ended successfully without producing any audio,
+/// the caller then falls back to a temporary raw file.
+fn processAudioStream(
     allocator: std.mem.Allocator,
     audio_file_with_id: olaf_cli_util.AudioFileWithId,
+    audio_identifier: []const u8,
+    options: olaf_cli_util_audio.AudioOptions,
     config: *const olaf_cli_config.Config,
     index: usize,
     total: usize,
@@ -68,23 +110,115 @@ pub fn processAudioFile(
     exclude_identifier: u32,
     output_format: olaf_cli_bridge.OutputFormat,
     store_format: olaf_cli_bridge.StoreFormat,
-) !void {
-    debug("Processing audio file {d}/{d}: {s}", .{ index + 1, total, audio_file_with_id.path });
+    store_queue: ?*olaf_cli_bridge.StoreQueue,
+    session: ?*olaf_cli_bridge.Session,
+) !bool {
+    var decoder = try olaf_cli_util_audio.spawnDecoder(allocator, audio_file_with_id.path, options);
+    errdefer _ = decoder.kill() catch {};
+
+    // The C reader owns and closes the read end of the pipe
+    const raw_audio = olaf_cli_bridge.RawAudio{ .fd = decoder.stdout.?.handle };
+    decoder.stdout = null;
+
+    const processed = switch (action) {
+        .Query => try olaf_cli_bridge.olaf_query(allocator, index, total, audio_file_with_id.path, raw_audio, audio_identifier, config, exclude_identifier, output_format, session),
+        .Store => try olaf_cli_bridge.olaf_store(allocator, raw_audio, audio_identifier, config, index, total, store_format, store_queue, session),
+        .Delete => try olaf_cli_bridge.olaf_delete(allocator, raw_audio, audio_identifier, config),
+    };
+
+    try olaf_cli_util_audio.waitForDecoder(&decoder);
+    return processed;
+}
 
+/// Decodes an audio file to a temporary raw file and processes it.
+fn processAudioTempFile(
+    allocator: std.mem.Allocator,
+    audio_file_with_id: olaf_cli_util.AudioFileWithId,
+    audio_identifier: []const u8,
+    options: olaf_cli_util_audio.AudioOptions,
+    config: *const olaf_cli_config.Config,
+    index: usize,
+    total: usize,
+    action: ProcessAction,
+    exclude_identifier: u32,
+    output_format: olaf_cli_bridge.OutputFormat,
+    store_format: olaf_cli_bridge.StoreFormat,
+    store_queue: ?*olaf_cli_bridge.StoreQueue,
+    session: ?*olaf_cli_bridge.Session,
+) !void {
     const raw_audio_path = try createTempRawPath(allocator);
     defer allocator.free(raw_audio_path);
     defer fs.cwd().deleteFile(raw_audio_path) catch {};
 
-    try olaf_cli_util_audio.convertToRaw(allocator, audio_file_with_id.path, raw_audio_path, config.target_sample_rate);
+    try olaf_cli_util_audio.convertAudioWithOptions(allocator, audio_file_with_id.path, raw_audio_path, options);
 
+    const raw_audio = olaf_cli_bridge.RawAudio{ .path = raw_audio_path };
     switch (action) {
-        .Query => try olaf_cli_bridge.olaf_query(allocator, index, total, audio_file_with_id.path, raw_audio_path, audio_file_with_id.identifier, config, exclude_identifier, output_format),
-        .Store => try olaf_cli_bridge.olaf_store(allocator, raw_audio_path, audio_file_with_id.identifier, config, index, total, store_format),
-        .Delete => try olaf_cli_bridge.olaf_delete(allocator, raw_audio_path, audio_file_with_id.identifier, config),
+        .Query => _ = try olaf_cli_bridge.olaf_query(allocator, index, total, audio_file_with_id.path, raw_audio, audio_identifier, config, exclude_identifier, output_format, session),
+        .Store => _ = try olaf_cli_bridge.olaf_store(allocator, raw_audio, audio_identifier, config, index, total, store_format, store_queue, session),
+        .Delete => _ = try olaf_cli_bridge.olaf_delete(allocator, raw_audio, audio_identifier, config),
+    }
+}
+
+/// Decodes an audio file and queries, stores or deletes it. Decoded audio is
+/// streamed from ffmpeg when possible, a temporary raw file is the fallback.
+fn processDecodedAudio(
+    allocator: std.mem.Allocator,
+    audio_file_with_id: olaf_cli_util.AudioFileWithId,
+    audio_identifier: []const u8,
+    options: olaf_cli_util_audio.AudioOptions,
+    config: *const olaf_cli_config.Config,
+    index: usize,
+    total: usize,
+    action: ProcessAction,
+    exclude_identifier: u32,
+    output_format: olaf_cli_bridge.OutputFormat,
+    store_format: olaf_cli_bridge.StoreFormat,
+    store_queue: ?*olaf_cli_bridge.StoreQueue,
+    session: ?*olaf_cli_bridge.Session,
+) !void {
+    // The C reader reads POSIX file descriptors, only a memory mapped
+    // temporary file can be split over several extraction threads
+    if (builtin.os.tag != .windows and config.extraction_threads <= 1) {
+        if (try processAudioStream(allocator, audio_file_with_id, audio_identifier, options, config, index, total, action, exclude_identifier, output_format, store_format, store_queue, session)) {
+            return;
+        }
+        debug("No audio decoded from {s}, retry with a temporary raw file", .{audio_file_with_id.path});
     }
+    try processAudioTempFile(allocator, audio_file_with_id, audio_identifier, options, config, index, total, action, exclude_identifier, output_format, store_format, store_queue, session);
+}
+
+// Helper function to process an audio file and convert it to raw format
+pub fn processAudioFile(
+    allocator: std.mem.Allocator,
+    audio_file_with_id: olaf_cli_util.AudioFileWithId,
+    config: *const olaf_cli_config.Config,
+    index: usize,
+    total: usize,
+    action: ProcessAction,
+    exclude_identifier: u32,
+    output_format: olaf_cli_bridge.OutputFormat,
+    store_format: olaf_cli_bridge.StoreFormat,
+    store_queue: ?*olaf_cli_bridge.StoreQueue,
+    session: ?*olaf_cli_bridge.Session,
+) !void {
+    debug("Processing audio file {d}/{d}: {s}", .{ index + 1, total, audio_file_with_id.path });
+
+    const options = olaf_cli_util_audio.AudioOptions{
+        .sample_rate = config.target_sample_rate,
+        .output_channels = 1,
+        .output_format = "f32le",
+        .output_codec = "pcm_f32le",
+    };
+
+    try processDecodedAudio(allocator, audio_file_with_id, audio_file_with_id.identifier, options, config, index, total, action, exclude_identifier, output_format, store_format, store_queue, session);
 }
 
 pub fn processAudioFileThreaded(task: AudioProcessTask) void {
+    // Without a session, e.g. when it could not be created, a runner is made for the file
+    const session: ?*olaf_cli_bridge.Session = if (task.sessions) |pool| pool.acquire() catch null else null;
+    defer if (session) |s| task.sessions.?.release(s);
+
     processAudioFile(
         task.allocator,
         task.audio_file,
@@ -95,6 +229,8 @@ pub fn processAudioFileThreaded(task: AudioProcessTask) void {
         task.exclude_identifier,
         task.output_format,
         task.store_format,
+        task.store_queue,
+        session,
     ) catch |process_err| {
         task.error_mutex.lock();
         defer task.error_mutex.unlock();
@@ -122,20 +258,56 @@ pub fn executeParallel(
     const filter_identity = (action == .Query) and !allow_identity_match;
     const actual_threads = @min(num_threads, audio_files.len);
 
+    // With fewer files than threads the remaining threads split the files
+    var file_config = config.*;
+    if (actual_threads > 0) {
+        file_config.extraction_threads = @max(config.extraction_threads, num_threads / @as(u32, @intCast(actual_threads)));
+    }
+
     if (actual_threads <= 1) {
         // Single-threaded execution
         debug("Processing {d} audio files (single-threaded, filter_identity={})", .{ audio_files.len, filter_identity });
+
+        // Queries reuse one runner and the opened database for all files,
+        // each stored file is still committed on its own
+        const query_db: ?*olaf_cli_bridge.QueryDB = if (action == .Query) try olaf_cli_bridge.olaf_query_db_new(allocator, config) else null;
+        defer if (query_db) |db| olaf_cli_bridge.olaf_query_db_destroy(db);
+        const session: ?*olaf_cli_bridge.Session = if (query_db) |db| try olaf_cli_bridge.Session.create(allocator, &file_config, .{ .query = db }) else null;
+        defer if (session) |s| s.destroy();
+
         for (audio_files, 0..) |audio_file, i| {
             const exclude = if (filter_identity)
                 try olaf_cli_bridge.olaf_name_to_id(allocator, audio_file.identifier)
             else
                 @as(u32, 0);
-            try processAudioFile(allocator, audio_file, config, i, audio_files.len, action, exclude, output_format, store_format);
+            try processAudioFile(allocator, audio_file, &file_config, i, audio_files.len, action, exclude, output_format, store_format, null, session);
         }
     } else {
         // Multi-threaded execution
         debug("Processing {d} audio files with {d} threads", .{ audio_files.len, actual_threads });
 
+        // Parallel store: workers only extract fingerprints and push batches
+        // to one writer thread which owns the single LMDB write transaction.
+        // Declared before the pool so it is drained and committed after all
+        // workers are done.
+        const store_queue: ?*olaf_cli_bridge.StoreQueue = if (action == .Store)
+            try olaf_cli_bridge.olaf_store_queue_new(allocator, config, actual_threads * 4)
+        else
+            null;
+        defer if (store_queue) |queue| olaf_cli_bridge.olaf_store_queue_destroy(queue);
+
+        // Each worker keeps a runner, with its FFT setup and extractors, for
+        // all the files it queries or stores. Queries share one opened
+        // database. Delete opens the database for writing for each file.
+        const query_db: ?*olaf_cli_bridge.QueryDB = if (action == .Query) try olaf_cli_bridge.olaf_query_db_new(allocator, config) else null;
+        defer if (query_db) |db| olaf_cli_bridge.olaf_query_db_destroy(db);
+        var sessions = SessionPool{
+            .allocator = allocator,
+            .config = &file_config,
+            .target = if (query_db) |db| .{ .query = db } else .{ .store = store_queue },
+        };
+        defer sessions.deinit();
+
         var pool: Thread.Pool = undefined;
         try pool.init(.{ .allocator = allocator, .n_jobs = actual_threads });
         defer pool.deinit();
@@ -160,13 +332,15 @@ pub fn executeParallel(
             const task = AudioProcessTask{
                 .allocator = allocator,
                 .audio_file = audio_file,
-                .config = config,
+                .config = &file_config,
                 .index = i,
                 .total = audio_files.len,
                 .action = action,
                 .exclude_identifier = exclude,
                 .output_format = output_format,
                 .store_format = store_format,
+                .store_queue = store_queue,
+                .sessions = if (action == .Delete) null else &sessions,
                 .error_mutex = &error_mutex,
                 .error_list = &error_list,
             };
@@ -198,10 +372,6 @@ fn processAudioFragment(
 ) !void {
     debug("Processing fragment at {d}s for {d}s from {s}", .{ fragment_start, fragment_duration, audio_file_with_id.path });
 
-    const raw_audio_path = try createTempRawPath(allocator);
-    defer allocator.free(raw_audio_path);
-    defer fs.cwd().deleteFile(raw_audio_path) catch {};
-
     // Convert the fragment to raw audio
     const options = olaf_cli_util_audio.AudioOptions{
         .sample_rate = config.target_sample_rate,
@@ -212,13 +382,6 @@ fn processAudioFragment(
         .duration = @floatFromInt(fragment_duration),
     };
 
-    try olaf_cli_util_audio.convertAudioWithOptions(
-        allocator,
-        audio_file_with_id.path,
-        raw_audio_path,
-        options,
-    );
-
     // Create identifier with fragment offset
     const fragment_identifier = try std.fmt.allocPrint(
         allocator,
@@ -227,14 +390,69 @@ fn processAudioFragment(
     );
     defer allocator.free(fragment_identifier);
 
-    switch (action) {
-        .Query => try olaf_cli_bridge.olaf_query(allocator, index, total, audio_file_with_id.path, raw_audio_path, fragment_identifier, config, exclude_identifier, output_format),
-        .Store => try olaf_cli_bridge.olaf_store(allocator, raw_audio_path, audio_file_with_id.path, config, index, total, store_format),
-        .Delete => try olaf_cli_bridge.olaf_delete(allocator, raw_audio_path, fragment_identifier, config),
-    }
+    // Stored fragments keep the path of the file as identifier
+    const audio_identifier = if (action == .Store) audio_file_with_id.path else fragment_identifier;
+    try processDecodedAudio(allocator, audio_file_with_id, audio_identifier, options, config, index, total, action, exclude_identifier, output_format, store_format, null, null);
 }
 
-/// Execute fragmented audio processing in parallel
+/// Worker task for querying a single fragment of a decoded audio file
+const FragmentQueryTask = struct {
+    allocator: std.mem.Allocator,
+    audio_file: olaf_cli_util.AudioFileWithId,
+    config: *const olaf_cli_config.Config,
+    index: usize,
+    total: usize,
+    /// Position of the fragment in the audio file in seconds.
+    fragment_start: f32,
+    /// The raw audio of the fragment, a slice of the decoded file.
+    raw_audio: []const u8,
+    exclude_identifier: u32,
+    output_format: olaf_cli_bridge.OutputFormat,
+    /// Receives the results, printed in fragment order when all fragments are done.
+    output: *?olaf_cli_bridge.QueryOutput,
+    error_mutex: *Mutex,
+    error_list: *std.ArrayList([]const u8),
+};
+
+fn queryFragment(task: FragmentQueryTask) !void {
+    debug("Querying fragment at {d}s from {s}", .{ task.fragment_start, task.audio_file.path });
+
+    // Create identifier with fragment offset
+    const fragment_identifier = try std.fmt.allocPrint(
+        task.allocator,
+        "{s}@{d}",
+        .{ task.audio_file.identifier, task.fragment_start },
+    );
+    defer task.allocator.free(fragment_identifier);
+
+    task.output.* = try olaf_cli_bridge.olaf_query_samples(
+        task.allocator,
+        task.index,
+        task.total,
+        task.audio_file.path,
+        task.fragment_start,
+        task.raw_audio,
+        fragment_identifier,
+        task.config,
+        task.exclude_identifier,
+        task.output_format,
+    );
+}
+
+fn queryFragmentThreaded(task: FragmentQueryTask) void {
+    queryFragment(task) catch |query_err| {
+        task.error_mutex.lock();
+        defer task.error_mutex.unlock();
+
+        const err_msg = std.fmt.allocPrint(task.allocator, "Failed to query {s} at {d}s: {}", .{ task.audio_file.path, task.fragment_start, query_err }) catch "Out of memory";
+        task.error_list.append(task.allocator, err_msg) catch {};
+        std.log.err("{s}", .{err_msg});
+    };
+}
+
+/// Execute fragmented audio processing in parallel. For queries each file is
+/// decoded once, the fragments are slices of the decoded audio which are
+/// queried by the thread pool. Results are printed in fragment order.
 pub fn executeFragmentedParallel(
     allocator: std.mem.Allocator,
     audio_files: []const olaf_cli_util.AudioFileWithId,
@@ -251,42 +469,104 @@ pub fn executeFragmentedParallel(
         audio_files.len, fragment_duration, num_threads, filter_identity,
     });
 
-    for (audio_files, 0..) |audio_file, file_index| {
-        // Get the total duration of the audio file
-        const total_duration = try olaf_cli_util_audio.getAudioDuration(allocator, audio_file.path);
+    if (fragment_duration == 0) {
+        return error.InvalidFragmentDuration;
+    }
+
+    if (action != .Query) {
+        // Stored or deleted fragments go to the database one at a time
+        for (audio_files, 0..) |audio_file, file_index| {
+            const total_duration = try olaf_cli_util_audio.getAudioDuration(allocator, audio_file.path);
+
+            var fragment_start: f32 = 0.0;
+            while (fragment_start < total_duration) {
+                const remaining = total_duration - fragment_start;
+                const current_duration = @min(@as(f32, @floatFromInt(fragment_duration)), remaining);
+
+                try processAudioFragment(allocator, audio_file, config, file_index, audio_files.len, fragment_start, fragment_duration, action, 0, output_format, store_format);
+
+                fragment_start += current_duration;
+            }
+        }
+        return;
+    }
+
+    const options = olaf_cli_util_audio.AudioOptions{
+        .sample_rate = config.target_sample_rate,
+        .output_channels = 1,
+        .output_format = "f32le",
+        .output_codec = "pcm_f32le",
+    };
+    const fragment_size = @as(usize, fragment_duration) * config.target_sample_rate * @sizeOf(f32);
+
+    const threaded = num_threads > 1;
+    var pool: Thread.Pool = undefined;
+    if (threaded) try pool.init(.{ .allocator = allocator, .n_jobs = num_threads });
+    defer if (threaded) pool.deinit();
+
+    var error_mutex = Mutex{};
+    var error_list = std.ArrayList([]const u8){};
+    defer {
+        for (error_list.items) |err_msg| {
+            allocator.free(err_msg);
+        }
+        error_list.deinit(allocator);
+    }
 
+    for (audio_files, 0..) |audio_file, file_index| {
         // Reference fingerprints are stored under the un-suffixed file
         // identifier, so the self-id is the hash of audio_file.identifier
-        // (NOT the fragment identifier processAudioFragment constructs).
+        // (NOT the fragment identifier queryFragment constructs).
         const exclude = if (filter_identity)
             try olaf_cli_bridge.olaf_name_to_id(allocator, audio_file.identifier)
         else
             @as(u32, 0);
 
-        var fragment_start: f32 = 0.0;
-        var fragment_index: usize = 0;
-
-        while (fragment_start < total_duration) {
-            const remaining = total_duration - fragment_start;
-            const current_duration = @min(@as(f32, @floatFromInt(fragment_duration)), remaining);
-
-            // TODO: Implement parallel fragment processing with thread pool
-            try processAudioFragment(
-                allocator,
-                audio_file,
-                config,
-                file_index,
-                audio_files.len,
-                fragment_start,
-                fragment_duration,
-                action,
-                exclude,
-                output_format,
-                store_format,
-            );
-
-            fragment_start += current_duration;
-            fragment_index += 1;
+        // A single decode per file instead of one ffprobe and an ffmpeg seek per fragment
+        const raw_audio = try olaf_cli_util_audio.decodeToMemory(allocator, audio_file.path, options);
+        defer allocator.free(raw_audio);
+
+        const fragment_count = (raw_audio.len + fragment_size - 1) / fragment_size;
+        const outputs = try allocator.alloc(?olaf_cli_bridge.QueryOutput, fragment_count);
+        defer allocator.free(outputs);
+        @memset(outputs, null);
+
+        var wait_group: WaitGroup = undefined;
+        wait_group.reset();
+
+        for (outputs, 0..) |*output, fragment_index| {
+            const begin = fragment_index * fragment_size;
+            const end = @min(begin + fragment_size, raw_audio.len);
+            const task = FragmentQueryTask{
+                .allocator = allocator,
+                .audio_file = audio_file,
+                .config = config,
+                .index = file_index,
+                .total = audio_files.len,
+                .fragment_start = @floatFromInt(fragment_index * fragment_duration),
+                .raw_audio = raw_audio[begin..end],
+                .exclude_identifier = exclude,
+                .output_format = output_format,
+                .output = output,
+                .error_mutex = &error_mutex,
+                .error_list = &error_list,
+            };
+
+            if (threaded) {
+                pool.spawnWg(&wait_group, queryFragmentThreaded, .{task});
+            } else {
+                queryFragmentThreaded(task);
+            }
         }
+
+        if (threaded) pool.waitAndWork(&wait_group);
+
+        for (outputs) |output| {
+            if (output) |results| results.print();
+        }
+    }
+
+    if (error_list.items.len > 0) {
+        return error.ProcessingFailed;
     }
 }
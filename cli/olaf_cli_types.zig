@@ -13,6 +13,7 @@ pub const Args = struct {
     allow_identity_match: bool = true,
     skip_store: bool = false,
     force: bool = false,
+    socket_path: ?[]const u8 = null,
     output_format: olaf_cli_bridge.OutputFormat = .csv,
     store_format: olaf_cli_bridge.StoreFormat = .human,
     config: ?*const olaf_cli_config.Config = null,
@@ -113,6 +113,33 @@ pub fn audioFileListWithId(
     }
 }
 
+/// Adds an audio file without checking that it exists. This allows to delete audio
+/// which has been moved or removed since it was stored, see the resource index.
+/// Without an explicit identifier, the path is used as the identifier.
+pub fn audioFileReference(
+    allocator: std.mem.Allocator,
+    audio_file_path: []const u8,
+    audio_file_identifier: ?[]const u8,
+    files: *std.ArrayList(AudioFileWithId),
+) !void {
+    const expanded = try expandPath(allocator, audio_file_path);
+    errdefer allocator.free(expanded);
+
+    const identifier = try allocator.dupe(u8, audio_file_identifier orelse expanded);
+    errdefer allocator.free(identifier);
+
+    debug("Missing audio file: {s} with identifier: {s}", .{ expanded, identifier });
+    try files.append(allocator, AudioFileWithId{ .path = expanded, .identifier = identifier });
+}
+
+/// Returns true if `path`, after expanding a leading `~`, exists.
+pub fn pathExists(allocator: std.mem.Allocator, path: []const u8) bool {
+    const expanded = expandPath(allocator, path) catch return false;
+    defer allocator.free(expanded);
+    fs.cwd().access(expanded, .{}) catch return false;
+    return true;
+}
+
 /// Returns true if the file at `path` has an extension in `allowed_audio_file_extensions` (case-insensitive).
 pub fn isAudioFile(path: []const u8, allowed_audio_file_extensions: []const []const u8) bool {
     const ext = std.fs.path.extension(path);
@@ -155,25 +155,16 @@ pub fn getAudioDuration(allocator: std.mem.Allocator, audio_file: []const u8) !f
     return try std.fmt.parseFloat(f32, trimmed);
 }
 
-/// Converts audio with custom options
-pub fn convertAudioWithOptions(
+/// Appends the ffmpeg command line for a conversion to `args`. Strings
+/// allocated for numbers are appended to `allocated_strings`.
+fn appendFFmpegArgs(
     allocator: std.mem.Allocator,
+    args: *std.ArrayList([]const u8),
+    allocated_strings: *std.ArrayList([]u8),
     input_file: []const u8,
     output_file: []const u8,
     options: AudioOptions,
 ) !void {
-    var args = std.ArrayList([]const u8){};
-    defer args.deinit(allocator);
-
-    // Keep track of allocated strings to free them later
-    var allocated_strings = std.ArrayList([]u8){};
-    defer {
-        for (allocated_strings.items) |str| {
-            allocator.free(str);
-        }
-        allocated_strings.deinit(allocator);
-    }
-
     // Base ffmpeg args
     try args.appendSlice(allocator, &.{ "ffmpeg", "-hide_banner", "-y", "-loglevel", "panic" });
 
@@ -232,6 +223,28 @@ pub fn convertAudioWithOptions(
         "-acodec",   options.output_codec,
         output_file,
     });
+}
+
+/// Converts audio with custom options
+pub fn convertAudioWithOptions(
+    allocator: std.mem.Allocator,
+    input_file: []const u8,
+    output_file: []const u8,
+    options: AudioOptions,
+) !void {
+    var args = std.ArrayList([]const u8){};
+    defer args.deinit(allocator);
+
+    // Keep track of allocated strings to free them later
+    var allocated_strings = std.ArrayList([]u8){};
+    defer {
+        for (allocated_strings.items) |str| {
+            allocator.free(str);
+        }
+        allocated_strings.deinit(allocator);
+    }
+
+    try appendFFmpegArgs(allocator, &args, &allocated_strings, input_file, output_file, options);
 
     const result = try runCommand(allocator, args.items);
     defer {
@@ -252,6 +265,70 @@ pub fn convertAudioWithOptions(
     }
 }
 
+/// Starts ffmpeg with the converted audio written to its stdout, so samples
+/// can be processed while the file is being decoded. The caller reads from
+/// `child.stdout` and calls `waitForDecoder`.
+pub fn spawnDecoder(
+    allocator: std.mem.Allocator,
+    input_file: []const u8,
+    options: AudioOptions,
+) !std.process.Child {
+    var args = std.ArrayList([]const u8){};
+    defer args.deinit(allocator);
+
+    var allocated_strings = std.ArrayList([]u8){};
+    defer {
+        for (allocated_strings.items) |str| {
+            allocator.free(str);
+        }
+        allocated_strings.deinit(allocator);
+    }
+
+    try appendFFmpegArgs(allocator, &args, &allocated_strings, input_file, "pipe:1", options);
+
+    debug("Decoding {s} to a pipe", .{input_file});
+
+    // The arguments are copied when the process is spawned
+    var child = std.process.Child.init(args.items, allocator);
+    child.stdin_behavior = .Ignore;
+    child.stdout_behavior = .Pipe;
+    // ffmpeg runs with -loglevel panic, nothing needs to be drained
+    child.stderr_behavior = .Ignore;
+    try child.spawn();
+    return child;
+}
+
+/// Waits for a decoder started with `spawnDecoder` and checks its exit code.
+pub fn waitForDecoder(child: *std.process.Child) !void {
+    const term = try child.wait();
+    switch (term) {
+        .Exited => |code| {
+            if (code != 0) {
+                std.debug.print("ffmpeg exited with code: {d}\n", .{code});
+                return error.FFmpegFailed;
+            }
+        },
+        else => return error.FFmpegFailed,
+    }
+}
+
+/// Decodes a complete audio file into memory. The caller owns the returned
+/// raw audio, formatted as requested by `options`.
+pub fn decodeToMemory(
+    allocator: std.mem.Allocator,
+    input_file: []const u8,
+    options: AudioOptions,
+) ![]u8 {
+    var decoder = try spawnDecoder(allocator, input_file, options);
+    errdefer _ = decoder.kill() catch {};
+
+    const raw_audio = try decoder.stdout.?.readToEndAlloc(allocator, std.math.maxInt(usize));
+    errdefer allocator.free(raw_audio);
+
+    try waitForDecoder(&decoder);
+    return raw_audio;
+}
+
 // Helper function to clean up test files
 fn cleanupTestFiles(files: []const []const u8) void {
     for (files) |file| {
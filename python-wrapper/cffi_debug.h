@@ -56,6 +56,8 @@ extern "Python" void olaf_python_wrapper_handle_result(
 		float keepMatchesFor;
 		float printResultEvery;
 		size_t maxDBCollisions;
+		bool resourceIndex;
+		int extractionThreads;
 	};
 	Olaf_Config* olaf_config_default(void);
 	Olaf_Config* olaf_config_test(void);
@@ -79,6 +81,8 @@ extern "Python" void olaf_python_wrapper_handle_result(
 	struct extracted_event_points{
 		struct eventpoint * eventPoints; 
 		int eventPointIndex; 
+		struct eventpoint * buffer; 
+		int bufferSize; 
 	};
 	typedef struct Olaf_EP_Extractor Olaf_EP_Extractor;
 	Olaf_EP_Extractor * olaf_ep_extractor_new(Olaf_Config * config);
@@ -101,10 +105,14 @@ extern "Python" void olaf_python_wrapper_handle_result(
 	struct extracted_fingerprints{
 		struct fingerprint * fingerprints; 
 		size_t fingerprintIndex; 
+		uint64_t * hashes; 
+		uint32_t * timeIndexes; 
+		int lastTimeIndex; 
 	};
 	typedef struct Olaf_FP_Extractor Olaf_FP_Extractor;
 	Olaf_FP_Extractor * olaf_fp_extractor_new(Olaf_Config * config);
 	void olaf_fp_extractor_destroy(Olaf_FP_Extractor * olaf_fp_extractor);
+	void olaf_fp_extractor_keep_details(Olaf_FP_Extractor * olaf_fp_extractor, bool keep_details);
 	struct extracted_fingerprints * olaf_fp_extractor_extract(Olaf_FP_Extractor * olaf_fp_extractor,struct extracted_event_points * eps,int audioBlockIndex);
 	size_t olaf_fp_extractor_total(Olaf_FP_Extractor * fp_extractor);
 	uint64_t olaf_fp_extractor_hash(struct fingerprint f);
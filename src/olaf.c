@@ -141,7 +141,7 @@ int olaf_has(int argc, const char* argv[]){
 	return 0;
 }
 
-/** @brief Stores cached fingerprints from CSV files to the database.
+/** @brief Stores cached fingerprints from binary or CSV cache files to the database.
  *  @param argc The argument count.
  *  @param argv The argument vector.
  *  @return Does not return; calls exit(0).
@@ -150,12 +150,25 @@ int olaf_store_cached(int argc, const char* argv[]){
 	Olaf_Config* config = olaf_config_default();
 	Olaf_DB* db = olaf_db_new(config->dbFolder,false);
 
-	for(int arg_index = 2 ; arg_index < argc ; arg_index++){
-		const char* csv_filename = argv[arg_index];
-		Olaf_FP_DB_Writer_Cache * cache_writer  = olaf_fp_db_writer_cache_new(db,config,csv_filename);
-		olaf_fp_db_writer_cache_store(cache_writer);
-		olaf_fp_db_writer_cache_destroy(cache_writer);
+	//A fresh index is built in key order when the database is closed
+	olaf_db_start_bulk_load(db);
+
+	if(config->resourceIndex){
+		olaf_db_enable_resource_index(db);
+	}
+
+	//the cache files are read by several threads, the database is written here
+	size_t files = argc > 2 ? (size_t) (argc - 2) : 0;
+	Olaf_FP_DB_Writer_Cache ** cache_writers = (Olaf_FP_DB_Writer_Cache **) malloc((files + 1) * sizeof(Olaf_FP_DB_Writer_Cache *));
+	for(size_t i = 0 ; i < files ; i++){
+		const char* csv_filename = argv[i + 2];
+		cache_writers[i] = olaf_fp_db_writer_cache_new(db,config,csv_filename);
+	}
+	olaf_fp_db_writer_cache_store_all(cache_writers,files,(size_t) config->extractionThreads);
+	for(size_t i = 0 ; i < files ; i++){
+		olaf_fp_db_writer_cache_destroy(cache_writers[i]);
 	}
+	free(cache_writers);
 	olaf_db_destroy(db);
 	olaf_config_destroy(config);
 	exit(0);
@@ -210,6 +223,11 @@ int main(int argc, const char* argv[]){
 
 	Olaf_Runner * runner = olaf_runner_new(runner_mode, config, NULL, NULL);
 
+	if(runner_mode == OLAF_RUNNER_MODE_STORE){
+		//A fresh index is built in key order when the runner is destroyed
+		olaf_db_start_bulk_load(runner->db);
+	}
+
 	if(runner_mode == OLAF_RUNNER_MODE_QUERY && argc == 2){
 		//read audio samples from standard input
 		runner->config->printResultEvery = 3;//print results every three seconds
@@ -229,6 +247,18 @@ int main(int argc, const char* argv[]){
 		for(int arg_index = 2 ; arg_index + 1 < argc ; arg_index+=2){
 			const char* raw_path =  argv[arg_index];
 			const char* orig_path = argv[arg_index + 1];
+
+			if(runner_mode == OLAF_RUNNER_MODE_DELETE){
+				//with a resource index the raw audio is not needed
+				uint32_t audio_id = olaf_db_identifier_id(orig_path,strlen(orig_path));
+				if(olaf_db_delete_resource(runner->db,audio_id) > 0){
+					if(olaf_db_has_meta_data(runner->db,&audio_id)){
+						olaf_db_delete_meta_data(runner->db,&audio_id);
+					}
+					continue;
+				}
+			}
+
 			Olaf_Stream_Processor* processor = olaf_stream_processor_new(runner,raw_path,orig_path);
 			olaf_stream_processor_process(processor);
 			olaf_stream_processor_destroy(processor);
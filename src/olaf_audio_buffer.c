@@ -0,0 +1,73 @@
+// Olaf: Overly Lightweight Acoustic Fingerprinting
+// Copyright (C) 2019-2025  Joren Six
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "olaf_config.h"
+#include "olaf_audio_buffer.h"
+
+//The number of steps buffered before the overlap is moved to the start of the buffer
+#define OLAF_AUDIO_BUFFER_STEPS 256
+
+//state information
+struct Olaf_Audio_Buffer{
+	float * samples; /**< The buffered samples, the current block is a view into it. */
+	size_t size; /**< The capacity of the samples array. */
+	size_t end; /**< Index after the last sample of the current block. */
+	size_t block_size; /**< The number of samples in a block. */
+	size_t step_size; /**< The number of new samples in each block. */
+};
+
+Olaf_Audio_Buffer * olaf_audio_buffer_new(Olaf_Config * config){
+	Olaf_Audio_Buffer * audio_buffer = (Olaf_Audio_Buffer *) malloc(sizeof(Olaf_Audio_Buffer));
+
+	audio_buffer->block_size = config->audioBlockSize;
+	audio_buffer->step_size = config->audioStepSize;
+	assert(audio_buffer->step_size <= audio_buffer->block_size);
+
+	size_t overlap_size = audio_buffer->block_size - audio_buffer->step_size;
+	audio_buffer->size = overlap_size + OLAF_AUDIO_BUFFER_STEPS * audio_buffer->step_size;
+
+	//the overlap of the first block is silence
+	audio_buffer->samples = (float *) calloc(audio_buffer->size, sizeof(float));
+	audio_buffer->end = overlap_size;
+
+	return audio_buffer;
+}
+
+float * olaf_audio_buffer_step(Olaf_Audio_Buffer * audio_buffer){
+	size_t overlap_size = audio_buffer->block_size - audio_buffer->step_size;
+
+	//buffer full: keep only the overlap with the next block
+	if(audio_buffer->end + audio_buffer->step_size > audio_buffer->size){
+		memmove(audio_buffer->samples, audio_buffer->samples + audio_buffer->end - overlap_size, overlap_size * sizeof(float));
+		audio_buffer->end = overlap_size;
+	}
+
+	float * step = audio_buffer->samples + audio_buffer->end;
+	audio_buffer->end += audio_buffer->step_size;
+	return step;
+}
+
+const float * olaf_audio_buffer_block(Olaf_Audio_Buffer * audio_buffer){
+	return audio_buffer->samples + audio_buffer->end - audio_buffer->block_size;
+}
+
+void olaf_audio_buffer_destroy(Olaf_Audio_Buffer * audio_buffer){
+	free(audio_buffer->samples);
+	free(audio_buffer);
+}
@@ -0,0 +1,79 @@
+// Olaf: Overly Lightweight Acoustic Fingerprinting
+// Copyright (C) 2019-2025  Joren Six
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/**
+ * @file olaf_audio_buffer.h
+ *
+ * @brief Overlapping audio blocks without shifting samples.
+ *
+ * Subsequent audio blocks overlap: each block is the end of the previous block followed 
+ * by a step of new samples. The buffer keeps many steps of samples next to each other 
+ * so each block is a contiguous view into the buffer. Only when the buffer is full the 
+ * overlap is moved to the start, instead of shifting the overlap for each step.
+ */
+#ifndef OLAF_AUDIO_BUFFER_H
+#define OLAF_AUDIO_BUFFER_H
+
+	#include "olaf_config.h"
+
+	/**
+	 * @struct Olaf_Audio_Buffer
+	 *
+	 * @brief Contains the buffered samples and the position of the current block.
+	 */
+	/** @typedef Olaf_Audio_Buffer
+	 *  @brief Typedef for struct Olaf_Audio_Buffer.
+	 */
+	typedef struct Olaf_Audio_Buffer Olaf_Audio_Buffer;
+
+	/**
+	 * @brief      Create a new audio buffer for blocks of config->audioBlockSize samples 
+	 * which advance config->audioStepSize samples. The first block starts with zeros.
+	 *
+	 * @param      config  The configuration
+	 *
+	 * @return     The state of the audio buffer.
+	 */
+	Olaf_Audio_Buffer * olaf_audio_buffer_new(Olaf_Config * config);
+
+	/**
+	 * @brief      Advance to the next block and return where its new samples go. 
+	 * Exactly config->audioStepSize samples should be written before the block is used.
+	 *
+	 * @param      audio_buffer  The audio buffer
+	 *
+	 * @return     Room for a step of new samples.
+	 */
+	float * olaf_audio_buffer_step(Olaf_Audio_Buffer * audio_buffer);
+
+	/**
+	 * @brief      The current block: the samples of the last step preceded by the overlap 
+	 * with earlier steps. The view is valid until the next call to olaf_audio_buffer_step.
+	 *
+	 * @param      audio_buffer  The audio buffer
+	 *
+	 * @return     A block of config->audioBlockSize samples.
+	 */
+	const float * olaf_audio_buffer_block(Olaf_Audio_Buffer * audio_buffer);
+
+	/**
+	 * @brief      Free the memory of the audio buffer.
+	 *
+	 * @param      audio_buffer  The audio buffer
+	 */
+	void olaf_audio_buffer_destroy(Olaf_Audio_Buffer * audio_buffer);
+
+#endif // OLAF_AUDIO_BUFFER_H
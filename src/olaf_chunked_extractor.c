@@ -0,0 +1,302 @@
+// Olaf: Overly Lightweight Acoustic Fingerprinting
+// Copyright (C) 2019-2025  Joren Six
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <limits.h>
+#include <pthread.h>
+
+#include "pffft.h"
+
+#include "olaf_chunked_extractor.h"
+#include "olaf_window.h"
+#include "olaf_ep_extractor.h"
+#include "olaf_fp_extractor.h"
+
+//The minimum number of audio blocks of a chunk, about 8 seconds with the default configuration
+#define OLAF_CHUNK_MIN_BLOCKS 1024
+
+struct olaf_chunk{
+	Olaf_Config * config; /**< The configuration */
+	Olaf_Reader * reader; /**< A part of the memory mapped audio file, starting at the first block */
+	Olaf_EP_Extractor * ep_extractor; /**< Event point extractor of the chunk */
+	PFFFT_Setup * fft_setup; /**< The shared FFT setup */
+	float * fft_in; /**< FFT input buffer of the chunk */
+	float * fft_out; /**< FFT output buffer of the chunk */
+
+	size_t start_block; /**< The first block of the chunk, the blocks before it only fill the event point filter */
+	size_t stop_block; /**< The block after the last block to process */
+	size_t block_index; /**< The next block to process */
+
+	struct eventpoint * event_points; /**< The new event points of all blocks, one block after the other */
+	size_t size; /**< The number of event points */
+	size_t capacity; /**< The number of event points that fit in the array */
+	size_t * ends; /**< For each block from the start the end of its new event points */
+	size_t ends_capacity; /**< The number of blocks that fit in the ends array */
+};
+
+struct Olaf_Chunked_Extractor{
+	Olaf_Config * config; /**< The configuration */
+	PFFFT_Setup * fft_setup; /**< The FFT setup shared by the chunks, it is only read */
+	Olaf_EP_Extractor * ep_extractor; /**< Collects the event points of the chunks in order */
+	Olaf_FP_Extractor * fp_extractor; /**< Combines the event points into fingerprints */
+	bool keep_details; /**< Keep the full fingerprint details */
+
+	uint64_t * hashes; /**< The hashes of all fingerprints */
+	uint32_t * time_indexes; /**< The t1 of all fingerprints */
+	struct fingerprint * details; /**< The details of all fingerprints, if they are kept */
+	size_t size; /**< The number of fingerprints */
+	size_t capacity; /**< The number of fingerprints that fit in the arrays */
+
+	size_t * batch_ends; /**< The end of each batch in the fingerprint arrays */
+	int * batch_last_time_indexes; /**< The last time index of each batch, see extracted_fingerprints */
+	size_t batches; /**< The number of batches */
+	size_t batches_capacity; /**< The number of batches that fit in the arrays */
+
+	struct extracted_fingerprints batch; /**< The batch returned by olaf_chunked_extractor_batch */
+	struct extracted_fingerprints * remaining; /**< The fingerprints of the remaining event points */
+};
+
+//Keep the new event points of a block, the extractor is emptied for the next block
+static void olaf_chunk_add_event_points(struct olaf_chunk * chunk, struct extracted_event_points * event_points){
+	size_t count = (size_t) event_points->eventPointIndex;
+	if(chunk->size + count > chunk->capacity){
+		chunk->capacity = 2 * (chunk->size + count);
+		chunk->event_points = (struct eventpoint *) realloc(chunk->event_points, chunk->capacity * sizeof(struct eventpoint));
+	}
+	memcpy(chunk->event_points + chunk->size, event_points->eventPoints, count * sizeof(struct eventpoint));
+	chunk->size += count;
+
+	size_t block = chunk->block_index - chunk->start_block;
+	if(block == chunk->ends_capacity){
+		chunk->ends_capacity = 2 * chunk->ends_capacity;
+		chunk->ends = (size_t *) realloc(chunk->ends, chunk->ends_capacity * sizeof(size_t));
+	}
+	chunk->ends[block] = chunk->size;
+
+	olaf_ep_extractor_expire(event_points,INT_MAX,chunk->config->maxEventPointUsages);
+}
+
+//Find the event points of the blocks of a chunk, the same way as olaf_stream_processor_process
+static void * olaf_chunk_process(void * arg){
+	struct olaf_chunk * chunk = (struct olaf_chunk *) arg;
+	Olaf_Config * config = chunk->config;
+	size_t samples_expected = config->audioStepSize;
+	const float * window = olaf_fft_window(config->audioBlockSize);
+
+	bool end_of_file = false;
+	while(!end_of_file && chunk->block_index < chunk->stop_block){
+		const float * audio_block;
+		size_t samples_read = olaf_reader_read_block(chunk->reader,&audio_block);
+
+		olaf_fft_window_apply(chunk->fft_in,audio_block,window,config->audioBlockSize);
+		pffft_transform_ordered(chunk->fft_setup, chunk->fft_in, chunk->fft_out, 0, PFFFT_FORWARD);
+
+		//before the start the event point filter is not filled yet: no event points are found
+		struct extracted_event_points * event_points = olaf_ep_extractor_extract(chunk->ep_extractor,chunk->fft_out,(int) chunk->block_index);
+		if(chunk->block_index >= chunk->start_block){
+			olaf_chunk_add_event_points(chunk,event_points);
+		}
+
+		end_of_file = samples_read < samples_expected;
+		chunk->block_index++;
+	}
+	return NULL;
+}
+
+static void olaf_chunk_init(struct olaf_chunk * chunk, Olaf_Chunked_Extractor * chunked_extractor, Olaf_Reader * reader, size_t start_block, size_t stop_block){
+	Olaf_Config * config = chunked_extractor->config;
+	size_t filter_blocks = config->filterSizeTime - 1;
+	size_t first_block = start_block < filter_blocks ? 0 : start_block - filter_blocks;
+
+	chunk->config = config;
+	//the first block is read after a block of step size, as in a sequential run
+	chunk->reader = olaf_reader_new_part(reader,(first_block + 1) * config->audioStepSize);
+	chunk->ep_extractor = olaf_ep_extractor_new(config);
+	chunk->fft_setup = chunked_extractor->fft_setup;
+	chunk->fft_in = (float *) pffft_aligned_malloc(config->audioBlockSize * sizeof(float));
+	chunk->fft_out = (float *) pffft_aligned_malloc(config->audioBlockSize * sizeof(float));
+
+	chunk->start_block = start_block;
+	chunk->stop_block = stop_block;
+	chunk->block_index = first_block;
+
+	chunk->event_points = NULL;
+	chunk->size = 0;
+	chunk->capacity = 0;
+	chunk->ends_capacity = OLAF_CHUNK_MIN_BLOCKS;
+	chunk->ends = (size_t *) malloc(chunk->ends_capacity * sizeof(size_t));
+}
+
+static void olaf_chunk_free(struct olaf_chunk * chunk){
+	olaf_reader_destroy(chunk->reader);
+	olaf_ep_extractor_destroy(chunk->ep_extractor);
+	pffft_aligned_free(chunk->fft_in);
+	pffft_aligned_free(chunk->fft_out);
+	free(chunk->event_points);
+	free(chunk->ends);
+}
+
+static void olaf_chunked_extractor_add_batch(Olaf_Chunked_Extractor * chunked_extractor, struct extracted_fingerprints * fingerprints){
+	size_t count = fingerprints->fingerprintIndex;
+	//consumers ignore empty batches
+	if(count == 0) return;
+
+	if(chunked_extractor->size + count > chunked_extractor->capacity){
+		chunked_extractor->capacity = 2 * (chunked_extractor->size + count);
+		chunked_extractor->hashes = (uint64_t *) realloc(chunked_extractor->hashes, chunked_extractor->capacity * sizeof(uint64_t));
+		chunked_extractor->time_indexes = (uint32_t *) realloc(chunked_extractor->time_indexes, chunked_extractor->capacity * sizeof(uint32_t));
+		if(chunked_extractor->keep_details){
+			chunked_extractor->details = (struct fingerprint *) realloc(chunked_extractor->details, chunked_extractor->capacity * sizeof(struct fingerprint));
+		}
+	}
+	if(chunked_extractor->batches == chunked_extractor->batches_capacity){
+		chunked_extractor->batches_capacity = chunked_extractor->batches_capacity == 0 ? 256 : 2 * chunked_extractor->batches_capacity;
+		chunked_extractor->batch_ends = (size_t *) realloc(chunked_extractor->batch_ends, chunked_extractor->batches_capacity * sizeof(size_t));
+		chunked_extractor->batch_last_time_indexes = (int *) realloc(chunked_extractor->batch_last_time_indexes, chunked_extractor->batches_capacity * sizeof(int));
+	}
+
+	memcpy(chunked_extractor->hashes + chunked_extractor->size, fingerprints->hashes, count * sizeof(uint64_t));
+	memcpy(chunked_extractor->time_indexes + chunked_extractor->size, fingerprints->timeIndexes, count * sizeof(uint32_t));
+	if(chunked_extractor->keep_details){
+		memcpy(chunked_extractor->details + chunked_extractor->size, fingerprints->fingerprints, count * sizeof(struct fingerprint));
+	}
+	chunked_extractor->size += count;
+
+	chunked_extractor->batch_ends[chunked_extractor->batches] = chunked_extractor->size;
+	chunked_extractor->batch_last_time_indexes[chunked_extractor->batches] = fingerprints->lastTimeIndex;
+	chunked_extractor->batches++;
+}
+
+Olaf_Chunked_Extractor * olaf_chunked_extractor_new(Olaf_Config * config, Olaf_Reader * reader, size_t threads, bool keep_details){
+	//the length is zero if the audio is not memory mapped
+	size_t number_of_blocks = olaf_reader_length(reader) / config->audioStepSize;
+
+	size_t number_of_chunks = threads;
+	while(number_of_chunks > 1 && number_of_blocks / number_of_chunks < OLAF_CHUNK_MIN_BLOCKS){
+		number_of_chunks--;
+	}
+	if(number_of_chunks < 2) return NULL;
+
+	Olaf_Chunked_Extractor * chunked_extractor = (Olaf_Chunked_Extractor *) malloc(sizeof(Olaf_Chunked_Extractor));
+	chunked_extractor->config = config;
+	chunked_extractor->fft_setup = pffft_new_setup(config->audioBlockSize,PFFFT_REAL);
+	chunked_extractor->ep_extractor = olaf_ep_extractor_new(config);
+	chunked_extractor->fp_extractor = olaf_fp_extractor_new(config);
+	olaf_fp_extractor_keep_details(chunked_extractor->fp_extractor,keep_details);
+	chunked_extractor->keep_details = keep_details;
+
+	chunked_extractor->hashes = NULL;
+	chunked_extractor->time_indexes = NULL;
+	chunked_extractor->details = NULL;
+	chunked_extractor->size = 0;
+	chunked_extractor->capacity = 0;
+	chunked_extractor->batch_ends = NULL;
+	chunked_extractor->batch_last_time_indexes = NULL;
+	chunked_extractor->batches = 0;
+	chunked_extractor->batches_capacity = 0;
+	chunked_extractor->remaining = NULL;
+
+	struct olaf_chunk * chunks = (struct olaf_chunk *) malloc(number_of_chunks * sizeof(struct olaf_chunk));
+	pthread_t * workers = (pthread_t *) malloc(number_of_chunks * sizeof(pthread_t));
+	bool * started = (bool *) malloc(number_of_chunks * sizeof(bool));
+
+	for(size_t k = 0 ; k < number_of_chunks ; k++){
+		size_t start = number_of_blocks * k / number_of_chunks;
+		//the last chunk stops at the end of the file
+		size_t stop = k == number_of_chunks - 1 ? SIZE_MAX : number_of_blocks * (k + 1) / number_of_chunks;
+		olaf_chunk_init(&chunks[k],chunked_extractor,reader,start,stop);
+		started[k] = pthread_create(&workers[k],NULL,olaf_chunk_process,&chunks[k]) == 0;
+	}
+
+	//combine the event points into fingerprints in order, while later chunks are still processed
+	struct extracted_event_points * event_points = NULL;
+	size_t block_index = 0;
+	for(size_t k = 0 ; k < number_of_chunks ; k++){
+		struct olaf_chunk * chunk = &chunks[k];
+		if(started[k]){
+			pthread_join(workers[k],NULL);
+		}else{
+			olaf_chunk_process(chunk);
+		}
+
+		for(block_index = chunk->start_block ; block_index < chunk->block_index ; block_index++){
+			size_t block = block_index - chunk->start_block;
+			size_t start = block == 0 ? 0 : chunk->ends[block - 1];
+			event_points = olaf_ep_extractor_append(chunked_extractor->ep_extractor,chunk->event_points + start,chunk->ends[block] - start,(int) block_index);
+
+			if(event_points->eventPointIndex > config->eventPointThreshold){
+				struct extracted_fingerprints * fingerprints = olaf_fp_extractor_extract(chunked_extractor->fp_extractor,event_points,(int) block_index);
+				olaf_chunked_extractor_add_batch(chunked_extractor,fingerprints);
+				fingerprints->fingerprintIndex = 0;
+			}
+		}
+		olaf_chunk_free(chunk);
+	}
+
+	//the event points left after the last block
+	if(event_points != NULL && event_points->eventPointIndex > 0){
+		chunked_extractor->remaining = olaf_fp_extractor_extract(chunked_extractor->fp_extractor,event_points,(int) block_index);
+	}
+
+	free(chunks);
+	free(workers);
+	free(started);
+
+	return chunked_extractor;
+}
+
+size_t olaf_chunked_extractor_batches(Olaf_Chunked_Extractor * chunked_extractor){
+	return chunked_extractor->batches;
+}
+
+struct extracted_fingerprints * olaf_chunked_extractor_batch(Olaf_Chunked_Extractor * chunked_extractor, size_t index){
+	assert(index < chunked_extractor->batches);
+
+	size_t start = index == 0 ? 0 : chunked_extractor->batch_ends[index - 1];
+
+	struct extracted_fingerprints * batch = &chunked_extractor->batch;
+	batch->fingerprints = chunked_extractor->keep_details ? chunked_extractor->details + start : NULL;
+	batch->fingerprintIndex = chunked_extractor->batch_ends[index] - start;
+	batch->hashes = chunked_extractor->hashes + start;
+	batch->timeIndexes = chunked_extractor->time_indexes + start;
+	batch->lastTimeIndex = chunked_extractor->batch_last_time_indexes[index];
+	return batch;
+}
+
+struct extracted_fingerprints * olaf_chunked_extractor_remaining(Olaf_Chunked_Extractor * chunked_extractor){
+	return chunked_extractor->remaining;
+}
+
+size_t olaf_chunked_extractor_total(Olaf_Chunked_Extractor * chunked_extractor){
+	return olaf_fp_extractor_total(chunked_extractor->fp_extractor);
+}
+
+void olaf_chunked_extractor_destroy(Olaf_Chunked_Extractor * chunked_extractor){
+	olaf_ep_extractor_destroy(chunked_extractor->ep_extractor);
+	olaf_fp_extractor_destroy(chunked_extractor->fp_extractor);
+	pffft_destroy_setup(chunked_extractor->fft_setup);
+
+	free(chunked_extractor->hashes);
+	free(chunked_extractor->time_indexes);
+	free(chunked_extractor->details);
+	free(chunked_extractor->batch_ends);
+	free(chunked_extractor->batch_last_time_indexes);
+	free(chunked_extractor);
+}
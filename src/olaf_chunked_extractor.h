@@ -0,0 +1,97 @@
+// Olaf: Overly Lightweight Acoustic Fingerprinting
+// Copyright (C) 2019-2025  Joren Six
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/**
+ * @file olaf_chunked_extractor.h
+ *
+ * @brief Extracts the fingerprints of a single long audio file with several threads.
+ *
+ * The audio blocks of a memory mapped file are split into chunks. The FFT and the event
+ * point detection of the chunks run in parallel: each chunk starts a filter length early
+ * so its event points are exactly the ones of a sequential run. The event points are
+ * then combined into fingerprints in order, on the calling thread, while later chunks
+ * are still processed. Which event points are combined depends on everything before
+ * them, so this part stays sequential. The resulting batches of fingerprints are the
+ * same as the ones of a sequential run, batch per batch.
+ */
+#ifndef OLAF_CHUNKED_EXTRACTOR_H
+#define OLAF_CHUNKED_EXTRACTOR_H
+
+	#include <stdbool.h>
+
+	#include "olaf_config.h"
+	#include "olaf_reader.h"
+	#include "olaf_fp_extractor.h"
+
+	/**
+	 * @struct Olaf_Chunked_Extractor
+	 *
+	 * @brief The stitched batches of fingerprints of an audio file.
+	 */
+	/** @typedef Olaf_Chunked_Extractor
+	 *  @brief Typedef for struct Olaf_Chunked_Extractor.
+	 */
+	typedef struct Olaf_Chunked_Extractor Olaf_Chunked_Extractor;
+
+	/**
+	 * Extract all fingerprints of a memory mapped audio file with several threads. The
+	 * reader is not read itself, each chunk uses a part of it.
+	 * @param config The configuration.
+	 * @param reader A reader for a memory mapped audio file, see olaf_reader_length().
+	 * @param threads The number of chunks processed in parallel.
+	 * @param keep_details Keep the full fingerprint details, see olaf_fp_extractor_keep_details().
+	 * @return The extracted fingerprints or NULL if the audio can not be split: if it is
+	 * not memory mapped or too short for the number of threads.
+	 */
+	Olaf_Chunked_Extractor * olaf_chunked_extractor_new(Olaf_Config * config, Olaf_Reader * reader, size_t threads, bool keep_details);
+
+	/**
+	 * The number of batches of fingerprints. A sequential run extracts a batch for each
+	 * audio block with enough event points, batches without fingerprints are left out.
+	 * @param chunked_extractor The extracted fingerprints.
+	 * @return The number of batches.
+	 */
+	size_t olaf_chunked_extractor_batches(Olaf_Chunked_Extractor * chunked_extractor);
+
+	/**
+	 * Returns a batch of fingerprints. The batch is valid until the next call.
+	 * @param chunked_extractor The extracted fingerprints.
+	 * @param index The batch index, less than olaf_chunked_extractor_batches().
+	 * @return The fingerprints of the batch.
+	 */
+	struct extracted_fingerprints * olaf_chunked_extractor_batch(Olaf_Chunked_Extractor * chunked_extractor, size_t index);
+
+	/**
+	 * The fingerprints of the event points left at the end of the audio, as extracted after
+	 * the last block of a sequential run.
+	 * @param chunked_extractor The extracted fingerprints.
+	 * @return The remaining fingerprints or NULL if no audio block was processed.
+	 */
+	struct extracted_fingerprints * olaf_chunked_extractor_remaining(Olaf_Chunked_Extractor * chunked_extractor);
+
+	/**
+	 * @param chunked_extractor The extracted fingerprints.
+	 * @return The total number of extracted fingerprints, see olaf_fp_extractor_total().
+	 */
+	size_t olaf_chunked_extractor_total(Olaf_Chunked_Extractor * chunked_extractor);
+
+	/**
+	 * Free memory and the readers of the chunks.
+	 * @param chunked_extractor The extracted fingerprints.
+	 */
+	void olaf_chunked_extractor_destroy(Olaf_Chunked_Extractor * chunked_extractor);
+
+#endif // OLAF_CHUNKED_EXTRACTOR_H
@@ -102,6 +102,12 @@ Olaf_Config* olaf_config_default(void){
 	//number of matches (hash collisions) 
 	config->maxDBCollisions = 2000;//for larger data sets use around 2000
 
+	//no resource index: delete needs the original audio
+	config->resourceIndex = false;
+
+	//extract fingerprints of an audio file on a single thread
+	config->extractionThreads = 1;
+
 	return config;
 }
 
@@ -174,6 +180,35 @@ Olaf_Config* olaf_config_mem(void){
 	return config;
 }
 
+//FNV-1a over the bytes of a 32 bit value
+static uint64_t olaf_config_digest_add(uint64_t digest, uint32_t value){
+	for(int i = 0 ; i < 4 ; i++){
+		digest ^= (value >> (8 * i)) & 0xFF;
+		digest *= 0x100000001B3ULL;
+	}
+	return digest;
+}
+
+uint64_t olaf_config_digest(const Olaf_Config * config){
+	uint32_t magnitude_bits;
+	memcpy(&magnitude_bits,&config->minEventPointMagnitude,sizeof(uint32_t));
+
+	const uint32_t parameters[] = {
+		config->audioBlockSize, config->audioSampleRate, config->audioStepSize,
+		config->filterSizeTime, config->filterSizeFrequency, magnitude_bits,
+		config->minFrequencyBin, config->maxEventPointUsages, config->maxEventPoints,
+		config->eventPointThreshold, config->sqrtMagnitude, config->useMagnitudeInfo,
+		config->numberOfEPsPerFP, config->minTimeDistance, config->maxTimeDistance,
+		config->minFreqDistance, config->maxFreqDistance
+	};
+
+	uint64_t digest = 0xCBF29CE484222325ULL;
+	for(size_t i = 0 ; i < sizeof(parameters) / sizeof(parameters[0]) ; i++){
+		digest = olaf_config_digest_add(digest,parameters[i]);
+	}
+	return digest;
+}
+
 void olaf_config_destroy(Olaf_Config * config){
 	free(config->dbFolder);
 	free(config);
@@ -17,6 +17,7 @@
 #include <string.h> //bool 
 #include <stdlib.h> //bool 
 #include <stdio.h>
+#include <stdint.h>
 
 /**
  * @file olaf_config.h
@@ -161,6 +162,20 @@
 		 * It can be considered as the number of times a fingerprint hash
 		 * is allowed to collide */
 		size_t maxDBCollisions;
+
+		//------------ Database configuration
+
+		/** Keep a resource index with the fingerprints of each stored audio file, 
+		 * so audio can be deleted by identifier without the original audio. 
+		 * This roughly doubles the size of the database. */
+		bool resourceIndex;
+
+		//------------ Processing configuration
+
+		/** The number of threads to extract fingerprints from a single audio file. Long, memory 
+		 * mapped raw audio files are split into chunks, other audio, e.g. a live stream, is 
+		 * processed by a pipeline of threads. The result is the same as with a single thread. */
+		int extractionThreads;
 	};
 
 	/**
@@ -188,6 +203,14 @@
 	 */
 	Olaf_Config* olaf_config_mem(void);
 
+	/**
+	 * A digest of the configuration parameters which determine the extracted fingerprints. 
+	 * Fingerprints extracted with configurations with a different digest do not match.
+	 * @param config      The configuration.
+	 * @return   A 64 bit hash of the fingerprint related parameters.
+	 */
+	uint64_t olaf_config_digest(const Olaf_Config *config);
+
 	/**
 	 * Free the memory used by the configuration struct
 	 * @param config      The configuration struct to destroy.
@@ -24,6 +24,8 @@
 
 #include "lmdb.h"
 #include "olaf_db.h"
+#include "olaf_db_flat.h"
+#include "olaf_db_shards.h"
 
 //Process-global writer mutex.
 //
@@ -36,6 +38,54 @@
 //commit in `olaf_db_destroy`. Readers (MDB_RDONLY) skip the mutex.
 static pthread_mutex_t olaf_db_writer_lock = PTHREAD_MUTEX_INITIALIZER;
 
+//Maximum number of fingerprints buffered in bulk load mode (16 bytes each, 
+//64MB by default, twice that while a run is sorted). A larger bulk load is 
+//sorted in runs of this size which are spilled to temporary files and merged 
+//when the index is built.
+#ifndef OLAF_DB_BULK_LOAD_MAX
+	#define OLAF_DB_BULK_LOAD_MAX (1<<22)
+#endif
+
+//Number of (key, value) pairs read or written at once while spilling and merging runs
+#define OLAF_DB_RUN_BLOCK_SIZE 4096
+
+//The flat copy of the fingerprint index in a database or shard folder, see olaf_db_export_flat
+#define OLAF_DB_FLAT_FILE "olaf_fingerprints.flat"
+
+//Number of reader slots in the lock file of a database, used by databases opened 
+//with olaf_db_new_live: one for each reader handle
+#define OLAF_DB_MAX_READERS 512
+
+//Once the fingerprint index is merged into posting blocks, the fingerprints stored since 
+//the last merge are merged again when a database with at least this many of them is closed
+#ifndef OLAF_DB_BLOCKS_DELTA_MAX
+	#define OLAF_DB_BLOCKS_DELTA_MAX (1<<20)
+#endif
+
+//The resource index maps an audio identifier (uint32_t) to a sorted list of 
+//fixed size postings, one for each stored fingerprint.
+#define OLAF_DB_RESOURCE_INDEX_FLAGS (MDB_INTEGERKEY | MDB_DUPSORT | MDB_DUPFIXED)
+
+//A posting in the resource index
+struct olaf_db_posting{
+	uint64_t hash; /**< The fingerprint hash, the key in the fingerprint index */
+	uint64_t t1; /**< The time stamp of the fingerprint, the high bits of the value */
+};
+
+//A fingerprint in a sorted run of a bulk load
+struct olaf_db_pair{
+	uint64_t key; /**< The fingerprint hash */
+	uint64_t value; /**< The fingerprint value */
+};
+
+//Reads a sorted run block by block during the merge
+struct olaf_db_run_reader{
+	FILE * file; /**< The temporary file with the run */
+	struct olaf_db_pair block[OLAF_DB_RUN_BLOCK_SIZE]; /**< The current block of the run */
+	size_t index; /**< The current pair in the block */
+	size_t size; /**< The number of pairs in the block */
+};
+
 struct Olaf_DB{
 	//the file name to serialize and deserialize the data
 	MDB_env *env; /**< The LMDB environment handle. */
@@ -43,13 +93,56 @@ struct Olaf_DB{
 
 	MDB_dbi dbi_fps; /**< Database handle for fingerprint storage. */
 	MDB_dbi dbi_resource_map; /**< Database handle for resource metadata. */
+	MDB_dbi dbi_resource_fps; /**< Database handle for the resource index: the fingerprints stored for each audio identifier. */
+	MDB_dbi dbi_blocks; /**< Database handle for the posting blocks: the compressed values of each hash. */
 
 	bool warning_given; /**< Whether a collision warning has been printed. */
 	bool holds_writer_lock; /**< True when this Olaf_DB owns olaf_db_writer_lock. */
+	bool readonly; /**< True when the database is opened in read only mode. */
+	bool resource_index; /**< True when the resource index is present and maintained. */
+	bool blocks; /**< True when the fingerprints are merged into posting blocks, dbi_fps then only holds the fingerprints stored since the last merge. */
+	bool owns_env; /**< False for a reader handle which shares the environment of another Olaf_DB. */
+	bool shared; /**< True when the database handles are published in the environment for reader handles. */
+
+	bool bulk_load; /**< True when fingerprints are buffered and appended in key order on flush. */
+	uint64_t * bulk_keys; /**< Buffered fingerprint hashes in bulk load mode. */
+	uint64_t * bulk_values; /**< Buffered fingerprint values in bulk load mode. */
+	size_t bulk_size; /**< Number of buffered fingerprints. */
+	size_t bulk_capacity; /**< Allocated size of the bulk load buffers. */
+	FILE ** bulk_runs; /**< Sorted runs spilled to temporary files in bulk load mode. */
+	size_t bulk_runs_size; /**< Number of spilled runs. */
+	uint64_t * bulk_scratch; /**< Scratch space to sort the runs, reused for each spilled run. */
+	size_t bulk_scratch_size; /**< Number of fingerprints which fit in the scratch space. */
+
+	Olaf_DB_Shards * shards; /**< The shards holding the fingerprints of a sharded database, NULL otherwise. */
+	bool is_shard; /**< True for a shard, which is only used through the database it belongs to. */
+
+	Olaf_DB_Flat * flat; /**< The flat copy of the fingerprint index of a read only database, NULL if there is none. */
+	bool use_flat; /**< True when look-ups use the flat index: it is a copy of the current snapshot. */
 
 	const char * mdb_folder; /**< Path to the LMDB database folder. */
 };
 
+//A cursor over the fingerprint index: the B-tree, merged with the posting blocks if 
+//there are any, or its flat copy
+struct olaf_db_cursor{
+	MDB_cursor * mdb_cursor; /**< The LMDB cursor on the fingerprints, NULL if the flat index is used */
+	MDB_cursor * blocks_cursor; /**< The LMDB cursor on the posting blocks, NULL without posting blocks */
+	const Olaf_DB_Flat * flat; /**< The flat index, NULL if the B-tree is used */
+	Olaf_DB_Flat_Cursor flat_cursor; /**< The position in the flat index */
+	uint64_t * block; /**< The decoded values of the current posting block */
+	size_t block_size; /**< The number of values in the current posting block, zero after the last one */
+	size_t block_index; /**< The current value in the posting block */
+	size_t block_capacity; /**< The allocated size of block */
+	uint64_t block_key; /**< The hash of the current posting block */
+	bool fingerprint; /**< True if the LMDB cursor on the fingerprints is on a fingerprint */
+	uint64_t fingerprint_key; /**< The hash at the LMDB cursor on the fingerprints */
+	uint64_t fingerprint_value; /**< The value at the LMDB cursor on the fingerprints */
+	bool in_block; /**< True if the current position is in the posting block */
+	uint64_t key; /**< The hash at the current position */
+	uint64_t value; /**< The value at the current position */
+};
+
 void e_ctx(int status_code, const char *operation, const char *db_folder) {
 	if (status_code != MDB_SUCCESS) {
 		fprintf(stderr, "Database Error in '%s': %s\n", operation, mdb_strerror(status_code));
@@ -68,12 +161,48 @@ void e(int status_code){
 	}
 }
 
-Olaf_DB * olaf_db_new(const char * mdb_folder,bool readonly){
+//Joins a folder and a file name, the result needs to be freed
+char * olaf_db_path(const char * folder,const char * file_name){
+	size_t folder_len = strlen(folder);
+	bool needs_sep = folder_len > 0
+		&& folder[folder_len - 1] != '/'
+		&& folder[folder_len - 1] != '\\';
+
+	size_t total_len = folder_len + (needs_sep ? 1 : 0) + strlen(file_name) + 1;
+	char * path = (char *) malloc(total_len);
+	if(path != NULL){
+		snprintf(path, total_len, "%s%s%s", folder, needs_sep ? "/" : "", file_name);
+	}
+	return path;
+}
+
+//Open the LMDB environment in a folder. A shard is only written through the database 
+//it belongs to, which holds the writer lock. A live read only environment registers 
+//its snapshots in the lock file, so writers of other processes leave them intact.
+static Olaf_DB * olaf_db_open(const char * mdb_folder,bool readonly,bool is_shard,bool live){
 
 	Olaf_DB *olaf_db = (Olaf_DB *) malloc(sizeof(Olaf_DB));
 
 	olaf_db->warning_given = false;
 	olaf_db->holds_writer_lock = false;
+	olaf_db->readonly = readonly;
+	olaf_db->resource_index = false;
+	olaf_db->blocks = false;
+	olaf_db->owns_env = true;
+	olaf_db->shared = false;
+	olaf_db->bulk_load = false;
+	olaf_db->bulk_keys = NULL;
+	olaf_db->bulk_values = NULL;
+	olaf_db->bulk_size = 0;
+	olaf_db->bulk_capacity = 0;
+	olaf_db->bulk_runs = NULL;
+	olaf_db->bulk_runs_size = 0;
+	olaf_db->bulk_scratch = NULL;
+	olaf_db->bulk_scratch_size = 0;
+	olaf_db->shards = NULL;
+	olaf_db->is_shard = is_shard;
+	olaf_db->flat = NULL;
+	olaf_db->use_flat = false;
 
 	//configure the max db size in bytes to be 1TB
 	//Fails silently when 1TB is reached
@@ -86,16 +215,22 @@ Olaf_DB * olaf_db_new(const char * mdb_folder,bool readonly){
 	//so the writer holds it for the full env-open + txn-begin + writes + commit
 	//+ env-close lifetime. This makes mdb_txn_begin safe across worker threads
 	//that each open their own MDB_env on the same DB folder.
-	if(!readonly){
+	if(!readonly && !is_shard){
 		pthread_mutex_lock(&olaf_db_writer_lock);
 		olaf_db->holds_writer_lock = true;
 	}
 
+	//The shards are written in parallel by worker threads, but the write transaction 
+	//of a shard is started and committed by the thread which opened it, see olaf_db_destroy.
+	//The reader handles of a live environment are used by several threads.
+	unsigned int env_flags = 0;
+	if(readonly) env_flags = live ? (MDB_RDONLY | MDB_NOTLS) : (MDB_RDONLY | MDB_NOLOCK);
+
 	e_ctx(mdb_env_create(&olaf_db->env), "mdb_env_create", mdb_folder);
-	e_ctx(mdb_env_set_maxreaders(olaf_db->env, 10), "mdb_env_set_maxreaders", mdb_folder);
+	e_ctx(mdb_env_set_maxreaders(olaf_db->env, OLAF_DB_MAX_READERS), "mdb_env_set_maxreaders", mdb_folder);
 	e_ctx(mdb_env_set_mapsize(olaf_db->env,max_db_size_in_bytes), "mdb_env_set_mapsize", mdb_folder);
-	e_ctx(mdb_env_set_maxdbs(olaf_db->env,2), "mdb_env_set_maxdbs", mdb_folder);
-	e_ctx(mdb_env_open(olaf_db->env, mdb_folder, readonly ? (MDB_RDONLY | MDB_NOLOCK) : 0, 0664), "mdb_env_open", mdb_folder);
+	e_ctx(mdb_env_set_maxdbs(olaf_db->env,4), "mdb_env_set_maxdbs", mdb_folder);
+	e_ctx(mdb_env_open(olaf_db->env, mdb_folder, env_flags, 0664), "mdb_env_open", mdb_folder);
 	e_ctx(mdb_txn_begin(olaf_db->env, NULL, readonly ? MDB_RDONLY : 0 , &olaf_db->txn), "mdb_txn_begin", mdb_folder);
 
 	unsigned int fingerprint_flags = MDB_INTEGERKEY | MDB_DUPSORT | MDB_DUPFIXED | MDB_INTEGERDUP;
@@ -107,17 +242,90 @@ Olaf_DB * olaf_db_new(const char * mdb_folder,bool readonly){
 		resource_flags |= MDB_CREATE;
 	}
 
-	olaf_db->mdb_folder = mdb_folder;
+	//the folder of a shard is read from the shard layout and owned by the shard
+	if(is_shard){
+		size_t folder_len = strlen(mdb_folder);
+		char * folder = (char *) malloc(folder_len + 1);
+		memcpy(folder,mdb_folder,folder_len + 1);
+		olaf_db->mdb_folder = folder;
+	}else{
+		olaf_db->mdb_folder = mdb_folder;
+	}
 
 	//open the database with flags sets
 	e_ctx(mdb_dbi_open(olaf_db->txn, "olaf_fingerprints",fingerprint_flags , &olaf_db->dbi_fps), "mdb_dbi_open(olaf_fingerprints)", mdb_folder);
 	e_ctx(mdb_dbi_open(olaf_db->txn, "olaf_resource_map",resource_flags , &olaf_db->dbi_resource_map), "mdb_dbi_open(olaf_resource_map)", mdb_folder);
 
-	
+	//The resource index is optional: it is only maintained if it has been 
+	//created before, see olaf_db_enable_resource_index
+	int rc = mdb_dbi_open(olaf_db->txn, "olaf_resource_fps",OLAF_DB_RESOURCE_INDEX_FLAGS , &olaf_db->dbi_resource_fps);
+	if(rc == MDB_SUCCESS){
+		olaf_db->resource_index = true;
+	}else if(rc != MDB_NOTFOUND){
+		e_ctx(rc, "mdb_dbi_open(olaf_resource_fps)", mdb_folder);
+	}
+
+	//The posting blocks are optional as well, see olaf_db_merge_blocks
+	rc = mdb_dbi_open(olaf_db->txn, "olaf_fingerprint_blocks",MDB_INTEGERKEY , &olaf_db->dbi_blocks);
+	if(rc == MDB_SUCCESS){
+		olaf_db->blocks = true;
+	}else if(rc != MDB_NOTFOUND){
+		e_ctx(rc, "mdb_dbi_open(olaf_fingerprint_blocks)", mdb_folder);
+	}
+
+	//Look-ups in a read only database use the flat index if it is a copy of this snapshot
+	if(readonly){
+		char * flat_path = olaf_db_path(mdb_folder,OLAF_DB_FLAT_FILE);
+		FILE * flat_file = flat_path != NULL ? fopen(flat_path,"rb") : NULL;
+		if(flat_file != NULL){
+			fclose(flat_file);
+			olaf_db->flat = olaf_db_flat_open(flat_path);
+		}
+		free(flat_path);
+		olaf_db->use_flat = olaf_db->flat != NULL && olaf_db_flat_txn_id(olaf_db->flat) == mdb_txn_id(olaf_db->txn);
+		if(olaf_db->flat != NULL && !olaf_db->use_flat){
+			fprintf(stderr,"Warning: the flat index in '%s' is out of date and is not used, export it again with compact_export\n",mdb_folder);
+		}
+	}
 
 	return olaf_db;
 }
 
+//Whether a folder contains a database
+bool olaf_db_exists(const char * mdb_folder){
+	char * data_path = olaf_db_path(mdb_folder,"data.mdb");
+	FILE * data = data_path != NULL ? fopen(data_path,"rb") : NULL;
+	free(data_path);
+	if(data == NULL) return false;
+	fclose(data);
+	return true;
+}
+
+Olaf_DB * olaf_db_open_shard(const char * shard_folder,bool readonly,bool live){
+	//the shards of a live database are created first
+	if(live && !olaf_db_exists(shard_folder)) olaf_db_destroy(olaf_db_open(shard_folder,false,true,false));
+	return olaf_db_open(shard_folder,readonly,true,live);
+}
+
+static Olaf_DB * olaf_db_new_internal(const char * mdb_folder,bool readonly,bool live){
+	//a read only database is created first
+	if(live && !olaf_db_exists(mdb_folder)) olaf_db_destroy(olaf_db_open(mdb_folder,false,false,false));
+
+	//The meta data stays in the database folder, the fingerprints are kept in the shards. 
+	//The shards are opened after the database, which holds the writer lock.
+	Olaf_DB * olaf_db = olaf_db_open(mdb_folder,readonly,false,live);
+	olaf_db->shards = olaf_db_shards_new(mdb_folder,readonly,live);
+	return olaf_db;
+}
+
+Olaf_DB * olaf_db_new(const char * mdb_folder,bool readonly){
+	return olaf_db_new_internal(mdb_folder,readonly,false);
+}
+
+Olaf_DB * olaf_db_new_live(const char * mdb_folder){
+	return olaf_db_new_internal(mdb_folder,true,true);
+}
+
 //string to unsigned 32 bit hash
 uint32_t olaf_db_string_hash(const char *key, size_t len){
 
@@ -156,22 +364,603 @@ uint32_t olaf_db_identifier_id(const char *identifier, size_t len){
 	return (uint32_t)value;
 }
 
-void olaf_db_store_internal(Olaf_DB * olaf_db,uint64_t * keys,uint64_t * values, size_t size,unsigned int flags){
+//Sort (key, value) pairs with an LSD radix sort: first 8 passes over
+//the value bytes, then 8 stable passes over the key bytes. Passes where
+//every element has the same byte (e.g. the high bytes of time stamps)
+//are skipped.
+static void olaf_db_radix_sort(uint64_t * keys,uint64_t * values, size_t size,uint64_t * tmp_keys,uint64_t * tmp_values){
+	size_t counts[256];
+
+	for(int pass = 0 ; pass < 16 ; pass++){
+		const uint64_t * digits = pass < 8 ? values : keys;
+		int shift = (pass % 8) * 8;
+
+		memset(counts,0,sizeof(counts));
+		for(size_t i = 0 ; i < size ; i++){
+			counts[(digits[i] >> shift) & 0xFF]++;
+		}
+
+		//all in one bucket: nothing to do for this byte
+		if(counts[(digits[0] >> shift) & 0xFF] == size) continue;
+
+		size_t offset = 0;
+		for(int b = 0 ; b < 256 ; b++){
+			size_t c = counts[b];
+			counts[b] = offset;
+			offset += c;
+		}
+
+		for(size_t i = 0 ; i < size ; i++){
+			size_t target = counts[(digits[i] >> shift) & 0xFF]++;
+			tmp_keys[target] = keys[i];
+			tmp_values[target] = values[i];
+		}
+		memcpy(keys,tmp_keys,size * sizeof(uint64_t));
+		memcpy(values,tmp_values,size * sizeof(uint64_t));
+	}
+}
+
+//Write a varint: 7 bits per byte, the high bit is set if more bytes follow
+static size_t olaf_db_varint_put(uint8_t * out,uint64_t value){
+	size_t n = 0;
+	while(value >= 0x80){
+		out[n++] = (uint8_t) (value | 0x80);
+		value >>= 7;
+	}
+	out[n++] = (uint8_t) value;
+	return n;
+}
+
+//Read a varint, returns NULL if it does not end before end
+static const uint8_t * olaf_db_varint_get(const uint8_t * in,const uint8_t * end,uint64_t * value){
+	//most deltas fit in a single byte
+	if(in < end && *in < 0x80){
+		*value = *in;
+		return in + 1;
+	}
+	uint64_t result = 0;
+	for(unsigned int shift = 0 ; in < end && shift < 64 ; shift += 7){
+		uint8_t byte = *in++;
+		result |= (uint64_t) (byte & 0x7F) << shift;
+		if(byte < 0x80){
+			*value = result;
+			return in;
+		}
+	}
+	return NULL;
+}
+
+//The maximum encoded size of a posting block with a number of values
+static size_t olaf_db_block_max_size(size_t size){
+	return 10 + 20 * size;
+}
+
+//Values in a posting block are ordered by audio identifier, then by time stamp
+static int olaf_db_block_value_compare(const void * a, const void * b){
+	uint64_t x = *(const uint64_t *) a;
+	uint64_t y = *(const uint64_t *) b;
+	x = (x << 32) | (x >> 32);
+	y = (y << 32) | (y >> 32);
+	return (x > y) - (x < y);
+}
+
+//Values in the B-tree are ordered numerically: by time stamp, then by audio identifier
+static int olaf_db_value_compare(const void * a, const void * b){
+	uint64_t x = *(const uint64_t *) a;
+	uint64_t y = *(const uint64_t *) b;
+	return (x > y) - (x < y);
+}
+
+//Put values in posting block order without duplicates and empty values, returns the new size
+static size_t olaf_db_block_sort(uint64_t * values,size_t size){
+	qsort(values,size,sizeof(uint64_t),olaf_db_block_value_compare);
+	size_t unique = 0;
+	for(size_t i = 0 ; i < size ; i++){
+		if(values[i] == 0 || (unique > 0 && values[unique - 1] == values[i])) continue;
+		values[unique++] = values[i];
+	}
+	return unique;
+}
+
+//A posting block holds the values of a hash: the number of values, then for each audio 
+//identifier the difference with the previous identifier, the number of values minus one, 
+//the first time stamp and the differences between the following time stamps. The values 
+//should be in posting block order, see olaf_db_block_sort.
+static size_t olaf_db_block_encode(const uint64_t * values,size_t size,uint8_t * block){
+	size_t n = olaf_db_varint_put(block,size);
+	uint32_t previous_id = 0;
+	size_t i = 0;
+	while(i < size){
+		uint32_t id = (uint32_t) values[i];
+		size_t end = i + 1;
+		while(end < size && (uint32_t) values[end] == id) end++;
+
+		n += olaf_db_varint_put(block + n,id - previous_id);
+		n += olaf_db_varint_put(block + n,end - i - 1);
+		uint32_t previous_t1 = 0;
+		for( ; i < end ; i++){
+			uint32_t t1 = (uint32_t) (values[i] >> 32);
+			n += olaf_db_varint_put(block + n,t1 - previous_t1);
+			previous_t1 = t1;
+		}
+		previous_id = id;
+	}
+	return n;
+}
+
+//The number of values in a posting block
+static size_t olaf_db_block_count(const MDB_val * block){
+	uint64_t count = 0;
+	const uint8_t * data = (const uint8_t *) block->mv_data;
+	if(olaf_db_varint_get(data,data + block->mv_size,&count) == NULL) return 0;
+	return (size_t) count;
+}
+
+//Decode the values of a posting block, at most values_size. Returns the number of decoded values.
+static size_t olaf_db_block_decode(const MDB_val * block,uint64_t * values,size_t values_size){
+	const uint8_t * in = (const uint8_t *) block->mv_data;
+	const uint8_t * end = in + block->mv_size;
+	uint64_t count = 0;
+	in = olaf_db_varint_get(in,end,&count);
+	if(in == NULL) return 0;
+	if(count < values_size) values_size = (size_t) count;
+
+	size_t size = 0;
+	uint64_t id = 0;
+	while(in != NULL && size < values_size){
+		uint64_t id_delta = 0;
+		uint64_t group_size = 0;
+		in = olaf_db_varint_get(in,end,&id_delta);
+		if(in != NULL) in = olaf_db_varint_get(in,end,&group_size);
+		id = (uint32_t) (id + id_delta);
+
+		uint64_t t1 = 0;
+		for(uint64_t j = 0 ; in != NULL && j <= group_size && size < values_size ; j++){
+			uint64_t t1_delta = 0;
+			in = olaf_db_varint_get(in,end,&t1_delta);
+			t1 = (uint32_t) (t1 + t1_delta);
+			if(in != NULL) values[size++] = (t1 << 32) | id;
+		}
+	}
+	return size;
+}
+
+//Buffers to decode and encode posting blocks
+struct olaf_db_block_buffer{
+	uint64_t * values; /**< Decoded values */
+	uint8_t * block; /**< An encoded posting block */
+	size_t capacity; /**< The maximum number of values */
+};
+
+static void olaf_db_block_buffer_reserve(struct olaf_db_block_buffer * buffer,size_t size){
+	if(size <= buffer->capacity) return;
+	while(buffer->capacity < size) buffer->capacity = buffer->capacity == 0 ? 1024 : 2 * buffer->capacity;
+	buffer->values = (uint64_t *) realloc(buffer->values,buffer->capacity * sizeof(uint64_t));
+	buffer->block = (uint8_t *) realloc(buffer->block,olaf_db_block_max_size(buffer->capacity));
+}
+
+//Replace the posting block of a hash, an empty one is removed
+static void olaf_db_block_put(Olaf_DB * olaf_db,uint64_t key,struct olaf_db_block_buffer * buffer,size_t size){
 	MDB_val mdb_key, mdb_value;
+	mdb_key.mv_size = sizeof(uint64_t);
+	mdb_key.mv_data = &key;
+	if(size == 0){
+		int rc = mdb_del(olaf_db->txn, olaf_db->dbi_blocks, &mdb_key, NULL);
+		if(rc != MDB_NOTFOUND) e(rc);
+		return;
+	}
+	mdb_value.mv_size = olaf_db_block_encode(buffer->values,size,buffer->block);
+	mdb_value.mv_data = buffer->block;
+	e(mdb_put(olaf_db->txn, olaf_db->dbi_blocks, &mdb_key, &mdb_value, 0));
+}
+
+//Merge the fingerprints stored since the last merge into the posting blocks, like a 
+//log-structured merge: each hash is rewritten once with all its values.
+static void olaf_db_blocks_merge(Olaf_DB * olaf_db){
+	MDB_cursor *cursor;
+	MDB_val mdb_key, mdb_value, block;
+	struct olaf_db_block_buffer buffer = { NULL, NULL, 0 };
+
+	e(mdb_cursor_open(olaf_db->txn, olaf_db->dbi_fps, &cursor));
+	int rc = mdb_cursor_get(cursor, &mdb_key, &mdb_value, MDB_FIRST);
+	while(rc == 0){
+		uint64_t key = *((uint64_t *) (mdb_key.mv_data));
+		mdb_size_t count;
+		e(mdb_cursor_count(cursor,&count));
+
+		MDB_val block_key;
+		block_key.mv_size = sizeof(uint64_t);
+		block_key.mv_data = &key;
+		size_t block_count = 0;
+		int block_rc = mdb_get(olaf_db->txn, olaf_db->dbi_blocks, &block_key, &block);
+		if(block_rc == 0){
+			block_count = olaf_db_block_count(&block);
+		}else if(block_rc != MDB_NOTFOUND){
+			e(block_rc);
+		}
+
+		olaf_db_block_buffer_reserve(&buffer,block_count + count);
+		size_t size = block_count > 0 ? olaf_db_block_decode(&block,buffer.values,block_count) : 0;
+
+		//the new values of the hash, several at a time
+		rc = mdb_cursor_get(cursor, &mdb_key, &mdb_value, MDB_GET_MULTIPLE);
+		while(rc == 0){
+			size_t n = mdb_value.mv_size / sizeof(uint64_t);
+			if(size + n > block_count + count) n = block_count + count - size;
+			memcpy(buffer.values + size,mdb_value.mv_data,n * sizeof(uint64_t));
+			size += n;
+			rc = mdb_cursor_get(cursor, &mdb_key, &mdb_value, MDB_NEXT_MULTIPLE);
+		}
+
+		size = olaf_db_block_sort(buffer.values,size);
+		olaf_db_block_put(olaf_db,key,&buffer,size);
+
+		rc = mdb_cursor_get(cursor, &mdb_key, &mdb_value, MDB_NEXT_NODUP);
+	}
+	mdb_cursor_close(cursor);
+
+	//the merged fingerprints are only kept in the posting blocks
+	e(mdb_drop(olaf_db->txn, olaf_db->dbi_fps, 0));
+
+	free(buffer.values);
+	free(buffer.block);
+}
+
+//Remove values from the posting blocks. The (key, value) pairs are sorted by key. 
+//Returns the number of removed values.
+static size_t olaf_db_blocks_remove(Olaf_DB * olaf_db,const uint64_t * keys,const uint64_t * values,size_t size){
+	MDB_val mdb_key, block;
+	struct olaf_db_block_buffer buffer = { NULL, NULL, 0 };
+	size_t number_of_removed = 0;
+
+	size_t i = 0;
+	while(i < size){
+		uint64_t key = keys[i];
+		size_t end = i + 1;
+		while(end < size && keys[end] == key) end++;
+
+		mdb_key.mv_size = sizeof(uint64_t);
+		mdb_key.mv_data = &key;
+		int rc = mdb_get(olaf_db->txn, olaf_db->dbi_blocks, &mdb_key, &block);
+		if(rc == 0){
+			size_t count = olaf_db_block_count(&block);
+			olaf_db_block_buffer_reserve(&buffer,count);
+			count = olaf_db_block_decode(&block,buffer.values,count);
+
+			//keep the values which are not removed, in order
+			size_t kept = 0;
+			for(size_t v = 0 ; v < count ; v++){
+				bool removed = false;
+				for(size_t j = i ; j < end && !removed ; j++) removed = values[j] == buffer.values[v];
+				if(!removed) buffer.values[kept++] = buffer.values[v];
+			}
+			if(kept < count){
+				number_of_removed += count - kept;
+				olaf_db_block_put(olaf_db,key,&buffer,kept);
+			}
+		}else if(rc != MDB_NOTFOUND){
+			e(rc);
+		}
+		i = end;
+	}
+
+	free(buffer.values);
+	free(buffer.block);
+	return number_of_removed;
+}
+
+//Add (key, value) pairs, sorted by key, to the posting blocks
+static void olaf_db_blocks_add(Olaf_DB * olaf_db,const uint64_t * keys,const uint64_t * values,size_t size){
+	MDB_val mdb_key, block;
+	struct olaf_db_block_buffer buffer = { NULL, NULL, 0 };
+
+	size_t i = 0;
+	while(i < size){
+		uint64_t key = keys[i];
+		size_t end = i + 1;
+		while(end < size && keys[end] == key) end++;
+
+		mdb_key.mv_size = sizeof(uint64_t);
+		mdb_key.mv_data = &key;
+		size_t count = 0;
+		int rc = mdb_get(olaf_db->txn, olaf_db->dbi_blocks, &mdb_key, &block);
+		if(rc == 0){
+			count = olaf_db_block_count(&block);
+		}else if(rc != MDB_NOTFOUND){
+			e(rc);
+		}
+
+		olaf_db_block_buffer_reserve(&buffer,count + end - i);
+		count = count > 0 ? olaf_db_block_decode(&block,buffer.values,count) : 0;
+		memcpy(buffer.values + count,values + i,(end - i) * sizeof(uint64_t));
+		count = olaf_db_block_sort(buffer.values,count + end - i);
+		olaf_db_block_put(olaf_db,key,&buffer,count);
+		i = end;
+	}
+
+	free(buffer.values);
+	free(buffer.block);
+}
+
+//The number of fingerprints in the posting blocks
+static size_t olaf_db_blocks_count(Olaf_DB * olaf_db){
+	if(!olaf_db->blocks) return 0;
+
+	MDB_cursor *cursor;
+	MDB_val mdb_key, block;
+	size_t count = 0;
+	e(mdb_cursor_open(olaf_db->txn, olaf_db->dbi_blocks, &cursor));
+	int rc = mdb_cursor_get(cursor, &mdb_key, &block, MDB_FIRST);
+	while(rc == 0){
+		count += olaf_db_block_count(&block);
+		rc = mdb_cursor_get(cursor, &mdb_key, &block, MDB_NEXT);
+	}
+	mdb_cursor_close(cursor);
+	return count;
+}
+
+//Store sorted (key, value) pairs with a single cursor. Because of the 
+//order the cursor mostly stays on the same, already dirty, leaf page.
+//Consecutive values for the same key are first tried with MDB_APPENDDUP, 
+//this fails with MDB_KEYEXIST when the key already has larger values.
+//With append true the fingerprint tree is expected to be empty (or to only 
+//contain smaller keys) and the whole tree is built with MDB_APPEND.
+static void olaf_db_store_sorted(Olaf_DB * olaf_db,uint64_t * keys,uint64_t * values, size_t size,bool append){
+	MDB_cursor *cursor;
+	MDB_val mdb_key, mdb_value;
+
+	//a bulk load goes straight into the posting blocks, if there are any
+	if(append && olaf_db->blocks){
+		olaf_db_blocks_add(olaf_db,keys,values,size);
+		return;
+	}
+
+	e(mdb_cursor_open(olaf_db->txn, olaf_db->dbi_fps, &cursor));
 
-	//store
 	for(size_t i = 0 ; i < size ; i++){
 		uint64_t key =  keys[i];
 		uint64_t value = values[i];
 
+		bool same_key = i > 0 && keys[i-1] == key;
+
+		//skip exact duplicates
+		if(same_key && values[i-1] == value) continue;
+
 		mdb_key.mv_size = sizeof(uint64_t);
 		mdb_key.mv_data = &key;
 
 		mdb_value.mv_size = sizeof(uint64_t);
 		mdb_value.mv_data = &value;
 
-		mdb_put(olaf_db->txn, olaf_db->dbi_fps, &mdb_key, &mdb_value, flags);
+		unsigned int flags = 0;
+		if(same_key){
+			flags = MDB_APPENDDUP;
+		} else if(append){
+			flags = MDB_APPEND;
+		}
+
+		int rc = mdb_cursor_put(cursor, &mdb_key, &mdb_value, flags);
+		if(rc == MDB_KEYEXIST && flags != 0){
+			//not in append order, fall back to a positioned insert
+			mdb_cursor_put(cursor, &mdb_key, &mdb_value, 0);
+		}
+	}
+
+	mdb_cursor_close(cursor);
+}
+
+//Add a posting to the resource index for each (key, value) pair. The 
+//audio identifier is the low 32 bits of the value.
+static void olaf_db_store_postings(Olaf_DB * olaf_db,const uint64_t * keys,const uint64_t * values, size_t size){
+	MDB_cursor *cursor;
+	MDB_val mdb_key, mdb_value;
+
+	e(mdb_cursor_open(olaf_db->txn, olaf_db->dbi_resource_fps, &cursor));
+
+	for(size_t i = 0 ; i < size ; i++){
+		uint32_t audio_id = (uint32_t) values[i];
+		struct olaf_db_posting posting = { keys[i], values[i] >> 32 };
+
+		mdb_key.mv_size = sizeof(uint32_t);
+		mdb_key.mv_data = &audio_id;
+
+		mdb_value.mv_size = sizeof(struct olaf_db_posting);
+		mdb_value.mv_data = &posting;
+
+		//an existing posting is left as is
+		int rc = mdb_cursor_put(cursor, &mdb_key, &mdb_value, MDB_NODUPDATA);
+		if(rc != MDB_KEYEXIST) e(rc);
 	}
+
+	mdb_cursor_close(cursor);
+}
+
+//Sort a copy of a batch and store it
+void olaf_db_store_internal(Olaf_DB * olaf_db,uint64_t * keys,uint64_t * values, size_t size,bool append){
+	if(size == 0) return;
+
+	uint64_t * sorted = (uint64_t *) malloc(4 * size * sizeof(uint64_t));
+	uint64_t * sorted_keys = sorted;
+	uint64_t * sorted_values = sorted + size;
+
+	memcpy(sorted_keys,keys,size * sizeof(uint64_t));
+	memcpy(sorted_values,values,size * sizeof(uint64_t));
+
+	olaf_db_radix_sort(sorted_keys,sorted_values,size,sorted + 2 * size,sorted + 3 * size);
+	olaf_db_store_sorted(olaf_db,sorted_keys,sorted_values,size,append);
+
+	if(olaf_db->resource_index){
+		olaf_db_store_postings(olaf_db,keys,values,size);
+	}
+
+	free(sorted);
+}
+
+//Sort the bulk load buffer and write it as a run to a temporary file. The 
+//postings of the resource index are not in key order and are stored right away.
+static void olaf_db_bulk_load_spill(Olaf_DB * olaf_db){
+	size_t size = olaf_db->bulk_size;
+	if(size == 0) return;
+
+	if(olaf_db->resource_index){
+		olaf_db_store_postings(olaf_db,olaf_db->bulk_keys,olaf_db->bulk_values,size);
+	}
+
+	if(olaf_db->bulk_scratch_size < size){
+		free(olaf_db->bulk_scratch);
+		olaf_db->bulk_scratch = (uint64_t *) malloc(2 * size * sizeof(uint64_t));
+		olaf_db->bulk_scratch_size = size;
+	}
+	olaf_db_radix_sort(olaf_db->bulk_keys,olaf_db->bulk_values,size,olaf_db->bulk_scratch,olaf_db->bulk_scratch + olaf_db->bulk_scratch_size);
+
+	FILE * run = tmpfile();
+	bool written = run != NULL;
+	struct olaf_db_pair block[OLAF_DB_RUN_BLOCK_SIZE];
+	for(size_t start = 0 ; written && start < size ; start += OLAF_DB_RUN_BLOCK_SIZE){
+		size_t count = size - start < OLAF_DB_RUN_BLOCK_SIZE ? size - start : OLAF_DB_RUN_BLOCK_SIZE;
+		for(size_t i = 0 ; i < count ; i++){
+			block[i].key = olaf_db->bulk_keys[start + i];
+			block[i].value = olaf_db->bulk_values[start + i];
+		}
+		written = fwrite(block,sizeof(struct olaf_db_pair),count,run) == count;
+	}
+
+	if(written && fseek(run,0,SEEK_SET) == 0){
+		olaf_db->bulk_runs = (FILE **) realloc(olaf_db->bulk_runs,(olaf_db->bulk_runs_size + 1) * sizeof(FILE *));
+		olaf_db->bulk_runs[olaf_db->bulk_runs_size++] = run;
+	}else{
+		//the merged runs are then no longer appended at the end of the tree but 
+		//the fallback to positioned inserts keeps the index correct
+		fprintf(stderr,"Warning: could not spill %zu sorted fingerprints to a temporary file, they are inserted directly.\n",size);
+		if(run != NULL) fclose(run);
+		olaf_db_store_sorted(olaf_db,olaf_db->bulk_keys,olaf_db->bulk_values,size,false);
+	}
+	olaf_db->bulk_size = 0;
+}
+
+//Read the next block of a run, returns false at the end of the run
+static bool olaf_db_run_reader_next_block(struct olaf_db_run_reader * reader){
+	reader->index = 0;
+	reader->size = fread(reader->block,sizeof(struct olaf_db_pair),OLAF_DB_RUN_BLOCK_SIZE,reader->file);
+	return reader->size > 0;
+}
+
+static bool olaf_db_run_reader_less(const struct olaf_db_run_reader * a,const struct olaf_db_run_reader * b){
+	const struct olaf_db_pair * pa = &a->block[a->index];
+	const struct olaf_db_pair * pb = &b->block[b->index];
+	return pa->key < pb->key || (pa->key == pb->key && pa->value < pb->value);
+}
+
+//Restore the min-heap order of the run readers from index i downwards
+static void olaf_db_run_heap_down(struct olaf_db_run_reader ** heap,size_t size,size_t i){
+	while(true){
+		size_t smallest = i;
+		size_t left = 2 * i + 1;
+		size_t right = left + 1;
+		if(left < size && olaf_db_run_reader_less(heap[left],heap[smallest])) smallest = left;
+		if(right < size && olaf_db_run_reader_less(heap[right],heap[smallest])) smallest = right;
+		if(smallest == i) return;
+		struct olaf_db_run_reader * tmp = heap[i];
+		heap[i] = heap[smallest];
+		heap[smallest] = tmp;
+		i = smallest;
+	}
+}
+
+//A k-way merge of the spilled runs: the merged pairs are in key order and the 
+//whole fingerprint tree is built with MDB_APPEND, with sequential reads of the runs.
+static void olaf_db_bulk_load_merge(Olaf_DB * olaf_db){
+	size_t runs = olaf_db->bulk_runs_size;
+	struct olaf_db_run_reader * readers = (struct olaf_db_run_reader *) malloc(runs * sizeof(struct olaf_db_run_reader));
+	struct olaf_db_run_reader ** heap = (struct olaf_db_run_reader **) malloc(runs * sizeof(struct olaf_db_run_reader *));
+
+	size_t heap_size = 0;
+	for(size_t r = 0 ; r < runs ; r++){
+		readers[r].file = olaf_db->bulk_runs[r];
+		if(olaf_db_run_reader_next_block(&readers[r])) heap[heap_size++] = &readers[r];
+	}
+	for(size_t i = heap_size ; i > 0 ; i--){
+		olaf_db_run_heap_down(heap,heap_size,i - 1);
+	}
+
+	//the bulk load buffers are reused for the merged output
+	size_t merged = 0;
+	while(heap_size > 0){
+		struct olaf_db_run_reader * reader = heap[0];
+		olaf_db->bulk_keys[merged] = reader->block[reader->index].key;
+		olaf_db->bulk_values[merged] = reader->block[reader->index].value;
+		merged++;
+
+		reader->index++;
+		if(reader->index == reader->size && !olaf_db_run_reader_next_block(reader)){
+			heap[0] = heap[--heap_size];
+		}
+		olaf_db_run_heap_down(heap,heap_size,0);
+
+		if(merged == olaf_db->bulk_capacity || heap_size == 0){
+			olaf_db_store_sorted(olaf_db,olaf_db->bulk_keys,olaf_db->bulk_values,merged,true);
+			merged = 0;
+		}
+	}
+
+	for(size_t r = 0 ; r < runs ; r++){
+		fclose(olaf_db->bulk_runs[r]);
+	}
+	free(olaf_db->bulk_runs);
+	olaf_db->bulk_runs = NULL;
+	olaf_db->bulk_runs_size = 0;
+	free(heap);
+	free(readers);
+}
+
+//Write the bulk load buffer with MDB_APPEND and leave bulk load mode: 
+//after the first flush keys are no longer guaranteed to be appended 
+//at the end of the tree. When runs are spilled the buffer is spilled 
+//as the last run and all runs are merged.
+void olaf_db_bulk_load_flush(Olaf_DB * olaf_db){
+	if(!olaf_db->bulk_load) return;
+
+	if(olaf_db->bulk_runs_size == 0){
+		olaf_db_store_internal(olaf_db,olaf_db->bulk_keys,olaf_db->bulk_values,olaf_db->bulk_size,true);
+	}else{
+		//the scratch space is only needed to sort the runs, not to merge them
+		olaf_db_bulk_load_spill(olaf_db);
+		free(olaf_db->bulk_scratch);
+		olaf_db->bulk_scratch = NULL;
+		olaf_db->bulk_scratch_size = 0;
+		olaf_db_bulk_load_merge(olaf_db);
+	}
+
+	free(olaf_db->bulk_keys);
+	free(olaf_db->bulk_values);
+	olaf_db->bulk_keys = NULL;
+	olaf_db->bulk_values = NULL;
+	olaf_db->bulk_size = 0;
+	olaf_db->bulk_capacity = 0;
+	olaf_db->bulk_load = false;
+}
+
+bool olaf_db_is_bulk_load(const Olaf_DB * olaf_db){
+	return olaf_db->bulk_load;
+}
+
+bool olaf_db_start_bulk_load(Olaf_DB * olaf_db){
+	if(olaf_db->shards != NULL) return olaf_db_shards_start_bulk_load(olaf_db->shards);
+
+	if(olaf_db->readonly || olaf_db->bulk_load) return olaf_db->bulk_load;
+
+	MDB_stat stats;
+	e(mdb_stat(olaf_db->txn, olaf_db->dbi_fps, &stats));
+
+	//only a fresh index can be built in append mode
+	if(stats.ms_entries != 0) return false;
+
+	olaf_db->bulk_capacity = 1<<16;
+	olaf_db->bulk_size = 0;
+	olaf_db->bulk_keys = (uint64_t *) malloc(olaf_db->bulk_capacity * sizeof(uint64_t));
+	olaf_db->bulk_values = (uint64_t *) malloc(olaf_db->bulk_capacity * sizeof(uint64_t));
+	olaf_db->bulk_load = true;
+	return true;
 }
 
 //store the meta data 
@@ -307,12 +1096,46 @@ bool olaf_db_has_meta_data(Olaf_DB * olaf_db, uint32_t * key){
 }
 
 void olaf_db_store(Olaf_DB * olaf_db,uint64_t * keys,uint64_t * values, size_t size){
-	olaf_db_store_internal(olaf_db,keys,values,size,0);
+	if(olaf_db->shards != NULL){
+		olaf_db_shards_store(olaf_db->shards,keys,values,size);
+		return;
+	}
+
+	if(!olaf_db->bulk_load){
+		olaf_db_store_internal(olaf_db,keys,values,size,false);
+		return;
+	}
+
+	//A very large fresh index is sorted in runs of OLAF_DB_BULK_LOAD_MAX 
+	//fingerprints which are merged when the index is built
+	if(olaf_db->bulk_size > 0 && olaf_db->bulk_size + size > OLAF_DB_BULK_LOAD_MAX){
+		olaf_db_bulk_load_spill(olaf_db);
+	}
+
+	if(olaf_db->bulk_size + size > olaf_db->bulk_capacity){
+		while(olaf_db->bulk_size + size > olaf_db->bulk_capacity) olaf_db->bulk_capacity *= 2;
+		olaf_db->bulk_keys = (uint64_t *) realloc(olaf_db->bulk_keys,olaf_db->bulk_capacity * sizeof(uint64_t));
+		olaf_db->bulk_values = (uint64_t *) realloc(olaf_db->bulk_values,olaf_db->bulk_capacity * sizeof(uint64_t));
+	}
+	memcpy(olaf_db->bulk_keys + olaf_db->bulk_size,keys,size * sizeof(uint64_t));
+	memcpy(olaf_db->bulk_values + olaf_db->bulk_size,values,size * sizeof(uint64_t));
+	olaf_db->bulk_size += size;
 }
 
 void olaf_db_delete(Olaf_DB * olaf_db,uint64_t * keys,uint64_t * values, size_t size){
 	MDB_val mdb_key, mdb_value;
 
+	if(olaf_db->shards != NULL){
+		olaf_db_shards_delete(olaf_db->shards,keys,values,size);
+		return;
+	}
+
+	olaf_db_bulk_load_flush(olaf_db);
+
+	//fingerprints which are not found have been merged into the posting blocks
+	uint64_t * merged = olaf_db->blocks ? (uint64_t *) malloc(4 * size * sizeof(uint64_t)) : NULL;
+	size_t number_of_merged = 0;
+
 	//store
 	for(size_t i = 0 ; i < size ; i++){
 		uint64_t key =  keys[i];
@@ -326,46 +1149,272 @@ void olaf_db_delete(Olaf_DB * olaf_db,uint64_t * keys,uint64_t * values, size_t
 
 		//printf("store: %u %u \n",key,value);
 
-		mdb_del(olaf_db->txn, olaf_db->dbi_fps, &mdb_key, &mdb_value);
+		int rc = mdb_del(olaf_db->txn, olaf_db->dbi_fps, &mdb_key, &mdb_value);
+		if(rc == MDB_NOTFOUND && merged != NULL){
+			merged[number_of_merged] = key;
+			merged[size + number_of_merged] = value;
+			number_of_merged++;
+		}
+
+		if(olaf_db->resource_index){
+			uint32_t audio_id = (uint32_t) value;
+			struct olaf_db_posting posting = { key, value >> 32 };
+
+			mdb_key.mv_size = sizeof(uint32_t);
+			mdb_key.mv_data = &audio_id;
+
+			mdb_value.mv_size = sizeof(struct olaf_db_posting);
+			mdb_value.mv_data = &posting;
+
+			mdb_del(olaf_db->txn, olaf_db->dbi_resource_fps, &mdb_key, &mdb_value);
+		}
+	}
+
+	if(merged != NULL){
+		olaf_db_radix_sort(merged,merged + size,number_of_merged,merged + 2 * size,merged + 3 * size);
+		olaf_db_blocks_remove(olaf_db,merged,merged + size,number_of_merged);
+		free(merged);
 	}
 }
-bool olaf_db_find_single(Olaf_DB * olaf_db,uint64_t start_key,uint64_t stop_key){
-	uint64_t results[1];
-	return 0 != olaf_db_find(olaf_db,start_key,stop_key,results,1);
+
+bool olaf_db_enable_resource_index(Olaf_DB * olaf_db){
+	if(olaf_db->shards != NULL) return olaf_db_shards_enable_resource_index(olaf_db->shards);
+
+	if(olaf_db->readonly || olaf_db->resource_index) return olaf_db->resource_index;
+
+	unsigned int flags = OLAF_DB_RESOURCE_INDEX_FLAGS | MDB_CREATE;
+	e_ctx(mdb_dbi_open(olaf_db->txn, "olaf_resource_fps",flags , &olaf_db->dbi_resource_fps), "mdb_dbi_open(olaf_resource_fps)", olaf_db->mdb_folder);
+	olaf_db->resource_index = true;
+	return true;
 }
 
-size_t olaf_db_find(Olaf_DB * olaf_db,uint64_t start_key,uint64_t stop_key, uint64_t * results, size_t results_size){
-	//fprintf(stderr,"start key: %u stop key: %u \n",start_key,stop_key);
+bool olaf_db_merge_blocks(Olaf_DB * olaf_db){
+	if(olaf_db->shards != NULL) return olaf_db_shards_merge_blocks(olaf_db->shards);
+
+	if(olaf_db->readonly){
+		fprintf(stderr,"Posting blocks can only be merged in a database opened in write mode\n");
+		return false;
+	}
+
+	olaf_db_bulk_load_flush(olaf_db);
+
+	if(!olaf_db->blocks){
+		unsigned int flags = MDB_INTEGERKEY | MDB_CREATE;
+		e_ctx(mdb_dbi_open(olaf_db->txn, "olaf_fingerprint_blocks",flags , &olaf_db->dbi_blocks), "mdb_dbi_open(olaf_fingerprint_blocks)", olaf_db->mdb_folder);
+		olaf_db->blocks = true;
+	}
+
+	olaf_db_blocks_merge(olaf_db);
+	return true;
+}
+
+size_t olaf_db_delete_resource(Olaf_DB * olaf_db,uint32_t audio_id){
+	if(olaf_db->shards != NULL) return olaf_db_shards_delete_resource(olaf_db->shards,audio_id);
+
+	if(olaf_db->readonly || !olaf_db->resource_index) return 0;
+
+	olaf_db_bulk_load_flush(olaf_db);
+
 	int rc;
-	size_t number_of_results = 0;
 	MDB_cursor *cursor;
 	MDB_val mdb_key, mdb_value;
 
+	mdb_key.mv_size = sizeof(uint32_t);
+	mdb_key.mv_data = &audio_id;
+
+	//read the postings of the resource, several at a time
+	e(mdb_cursor_open(olaf_db->txn, olaf_db->dbi_resource_fps, &cursor));
+	rc = mdb_cursor_get(cursor, &mdb_key, &mdb_value, MDB_SET);
+	if(rc == MDB_NOTFOUND){
+		mdb_cursor_close(cursor);
+		return 0;
+	}
+	e(rc);
+
+	size_t number_of_postings = 0;
+	mdb_size_t count;
+	e(mdb_cursor_count(cursor,&count));
+
+	uint64_t * buffer = (uint64_t *) malloc(4 * count * sizeof(uint64_t));
+	uint64_t * keys = buffer;
+	uint64_t * values = buffer + count;
+
+	rc = mdb_cursor_get(cursor, &mdb_key, &mdb_value, MDB_GET_MULTIPLE);
+	while(rc == 0){
+		const struct olaf_db_posting * postings = (const struct olaf_db_posting *) mdb_value.mv_data;
+		size_t n = mdb_value.mv_size / sizeof(struct olaf_db_posting);
+		for(size_t i = 0 ; i < n && number_of_postings < count ; i++){
+			keys[number_of_postings] = postings[i].hash;
+			values[number_of_postings] = (postings[i].t1 << 32) + audio_id;
+			number_of_postings++;
+		}
+		rc = mdb_cursor_get(cursor, &mdb_key, &mdb_value, MDB_NEXT_MULTIPLE);
+	}
+	mdb_cursor_close(cursor);
+
+	//the postings of this resource are no longer needed
+	mdb_key.mv_size = sizeof(uint32_t);
+	mdb_key.mv_data = &audio_id;
+	e(mdb_del(olaf_db->txn, olaf_db->dbi_resource_fps, &mdb_key, NULL));
+
+	//Delete the fingerprints in key order with a single cursor
+	olaf_db_radix_sort(keys,values,number_of_postings,buffer + 2 * count,buffer + 3 * count);
+
+	size_t number_of_deleted = 0;
+	size_t number_of_merged = 0;
 	e(mdb_cursor_open(olaf_db->txn, olaf_db->dbi_fps, &cursor));
+	for(size_t i = 0 ; i < number_of_postings ; i++){
+		mdb_key.mv_size = sizeof(uint64_t);
+		mdb_key.mv_data = &keys[i];
 
-	mdb_key.mv_size = sizeof(uint64_t);
-	mdb_key.mv_data = &start_key;
+		mdb_value.mv_size = sizeof(uint64_t);
+		mdb_value.mv_data = &values[i];
+
+		if(mdb_cursor_get(cursor, &mdb_key, &mdb_value, MDB_GET_BOTH) == 0){
+			e(mdb_cursor_del(cursor, 0));
+			number_of_deleted++;
+		}else{
+			//kept in order at the front, for the posting blocks
+			keys[number_of_merged] = keys[i];
+			values[number_of_merged] = values[i];
+			number_of_merged++;
+		}
+	}
+	mdb_cursor_close(cursor);
+
+	if(olaf_db->blocks){
+		number_of_deleted += olaf_db_blocks_remove(olaf_db,keys,values,number_of_merged);
+	}
 
+	free(buffer);
+
+	return number_of_deleted;
+}
+
+//Open a cursor on the flat index if it is current and allowed, on the B-tree otherwise
+static void olaf_db_cursor_open(Olaf_DB * olaf_db,struct olaf_db_cursor * cursor,bool allow_flat){
+	cursor->mdb_cursor = NULL;
+	cursor->blocks_cursor = NULL;
+	cursor->flat = allow_flat && olaf_db->use_flat ? olaf_db->flat : NULL;
+	cursor->block = NULL;
+	cursor->block_size = 0;
+	cursor->block_index = 0;
+	cursor->block_capacity = 0;
+	cursor->fingerprint = false;
+	cursor->in_block = false;
+	if(cursor->flat == NULL){
+		e(mdb_cursor_open(olaf_db->txn, olaf_db->dbi_fps, &cursor->mdb_cursor));
+		if(olaf_db->blocks) e(mdb_cursor_open(olaf_db->txn, olaf_db->dbi_blocks, &cursor->blocks_cursor));
+	}
+}
+
+static void olaf_db_cursor_get_fingerprint(struct olaf_db_cursor * cursor,MDB_val * mdb_key,MDB_val * mdb_value,MDB_cursor_op op){
+	cursor->fingerprint = mdb_cursor_get(cursor->mdb_cursor, mdb_key, mdb_value, op) == 0;
+	if(cursor->fingerprint){
+		cursor->fingerprint_key = *((uint64_t *) (mdb_key->mv_data));
+		cursor->fingerprint_value = *((uint64_t *) (mdb_value->mv_data));
+	}
+}
+
+//Decode the posting block at the cursor on the posting blocks, in the order of the B-tree
+//so a look-up which is cut short keeps the same values before and after a merge
+static void olaf_db_cursor_get_block(struct olaf_db_cursor * cursor,MDB_val * mdb_key,MDB_val * block,MDB_cursor_op op){
+	cursor->block_size = 0;
+	cursor->block_index = 0;
+	while(cursor->block_size == 0 && mdb_cursor_get(cursor->blocks_cursor, mdb_key, block, op) == 0){
+		size_t count = olaf_db_block_count(block);
+		if(count > cursor->block_capacity){
+			cursor->block_capacity = count;
+			cursor->block = (uint64_t *) realloc(cursor->block,count * sizeof(uint64_t));
+		}
+		cursor->block_key = *((uint64_t *) (mdb_key->mv_data));
+		cursor->block_size = olaf_db_block_decode(block,cursor->block,count);
+		qsort(cursor->block,cursor->block_size,sizeof(uint64_t),olaf_db_value_compare);
+		op = MDB_NEXT;
+	}
+}
+
+//The current position is the smallest (hash, value) pair of the posting block and the
+//fingerprints, as if all fingerprints were in the B-tree.
+static bool olaf_db_cursor_current(struct olaf_db_cursor * cursor){
+	cursor->in_block = cursor->block_index < cursor->block_size &&
+		(!cursor->fingerprint || cursor->block_key < cursor->fingerprint_key ||
+		(cursor->block_key == cursor->fingerprint_key && cursor->block[cursor->block_index] <= cursor->fingerprint_value));
+	if(cursor->in_block){
+		cursor->key = cursor->block_key;
+		cursor->value = cursor->block[cursor->block_index];
+		return true;
+	}
+	if(!cursor->fingerprint) return false;
+	cursor->key = cursor->fingerprint_key;
+	cursor->value = cursor->fingerprint_value;
+	return true;
+}
+
+//Position the cursor at the first fingerprint with a hash greater than or equal to key
+static bool olaf_db_cursor_seek(struct olaf_db_cursor * cursor,uint64_t key){
+	if(cursor->flat != NULL){
+		return olaf_db_flat_seek(cursor->flat,&cursor->flat_cursor,key,&cursor->key,&cursor->value);
+	}
 	uint64_t s = 0;
+	MDB_val mdb_key, mdb_value;
+	mdb_key.mv_size = sizeof(uint64_t);
+	mdb_key.mv_data = &key;
 	mdb_value.mv_size = sizeof(uint64_t);
 	mdb_value.mv_data = &s;
+	olaf_db_cursor_get_fingerprint(cursor,&mdb_key,&mdb_value,MDB_SET_RANGE);
+	if(cursor->blocks_cursor != NULL){
+		mdb_key.mv_size = sizeof(uint64_t);
+		mdb_key.mv_data = &key;
+		olaf_db_cursor_get_block(cursor,&mdb_key,&mdb_value,MDB_SET_RANGE);
+	}
+	return olaf_db_cursor_current(cursor);
+}
+
+//Move to the next fingerprint: the next value of the same hash or the first of the next hash
+static bool olaf_db_cursor_next(struct olaf_db_cursor * cursor){
+	if(cursor->flat != NULL){
+		return olaf_db_flat_next(cursor->flat,&cursor->flat_cursor,&cursor->key,&cursor->value);
+	}
+	MDB_val mdb_key, mdb_value;
+	if(!cursor->in_block){
+		olaf_db_cursor_get_fingerprint(cursor,&mdb_key,&mdb_value,MDB_NEXT);
+	}else if(++cursor->block_index == cursor->block_size){
+		olaf_db_cursor_get_block(cursor,&mdb_key,&mdb_value,MDB_NEXT);
+	}
+	return olaf_db_cursor_current(cursor);
+}
 
-	size_t result_index = 0;
+static void olaf_db_cursor_close(struct olaf_db_cursor * cursor){
+	if(cursor->mdb_cursor != NULL) mdb_cursor_close(cursor->mdb_cursor);
+	if(cursor->blocks_cursor != NULL) mdb_cursor_close(cursor->blocks_cursor);
+	free(cursor->block);
+}
 
-	//Position at first key greater than or equal to specified key.
-	rc = mdb_cursor_get(cursor, &mdb_key, &mdb_value, MDB_SET_RANGE );
+bool olaf_db_find_single(Olaf_DB * olaf_db,uint64_t start_key,uint64_t stop_key){
+	uint64_t results[1];
+	return 0 != olaf_db_find(olaf_db,start_key,stop_key,results,1);
+}
 
-	//query
-	do {
+size_t olaf_db_find(Olaf_DB * olaf_db,uint64_t start_key,uint64_t stop_key, uint64_t * results, size_t results_size){
+	size_t number_of_results = 0;
+	struct olaf_db_cursor cursor;
 
-		uint64_t keyInt = *((uint64_t *) (mdb_key.mv_data));
-		uint64_t valueInt = *((uint64_t *) (mdb_value.mv_data));
+	if(olaf_db->shards != NULL){
+		return olaf_db_shards_find(olaf_db->shards,start_key,stop_key,results,results_size);
+	}
+
+	olaf_db_bulk_load_flush(olaf_db);
 
-		if( keyInt > stop_key) break;
+	olaf_db_cursor_open(olaf_db,&cursor,true);
 
-		//fprintf(stderr,"Found key:  %p %llu, value: %p  %llu \n",mdb_key.mv_data,keyInt,mdb_value.mv_data,valueInt);
+	//Position at first key greater than or equal to specified key.
+	bool found = olaf_db_cursor_seek(&cursor,start_key);
 
-		if(result_index >= results_size){
+	//query
+	while(found && cursor.key <= stop_key){
+
+		if(number_of_results >= results_size){
 			//warn only once!
 			if(!olaf_db->warning_given){
 				olaf_db->warning_given = true;
@@ -376,44 +1425,149 @@ size_t olaf_db_find(Olaf_DB * olaf_db,uint64_t start_key,uint64_t stop_key, uint
 
 		//ignore empty results, currently unsure why these
 		//are present: check DB API call order to verify 
-		if(valueInt != 0){
-			results[result_index] = valueInt;
-			result_index++;
-			number_of_results = result_index; 
+		if(cursor.value != 0){
+			results[number_of_results] = cursor.value;
+			number_of_results++;
 		}
 
-		rc = mdb_cursor_get(cursor, &mdb_key, &mdb_value, MDB_NEXT_DUP );
-		if(rc == MDB_NOTFOUND ){
-			//printf("No Next Dup for key:  %p %llu \n",mdb_key.mv_data,keyInt);
-			rc = mdb_cursor_get(cursor, &mdb_key, &mdb_value, MDB_NEXT);
-		}
+		found = olaf_db_cursor_next(&cursor);
+	}
 
-	} while (rc == 0);
+	olaf_db_cursor_close(&cursor);
 
-	mdb_cursor_close(cursor);
+	return number_of_results;
+}
 
-	//fprintf(stderr,"start key: %llu stop key: %llu  results %zu \n",start_key,stop_key,number_of_results);
+//A search interval for one key of a batch lookup
+struct olaf_db_interval{
+	uint64_t start; /**< The first key of the interval */
+	uint64_t stop; /**< The last key of the interval, inclusive */
+	size_t index; /**< Index of the key in the batch */
+};
 
-	return number_of_results;
+static int olaf_db_interval_compare(const void * a, const void * b){
+	const struct olaf_db_interval * x = (const struct olaf_db_interval *) a;
+	const struct olaf_db_interval * y = (const struct olaf_db_interval *) b;
+	if(x->start != y->start) return x->start < y->start ? -1 : 1;
+	if(x->index != y->index) return x->index < y->index ? -1 : 1;
+	return 0;
 }
 
-size_t olaf_db_size(Olaf_DB * olaf_db){
-	//This assumes the default filename for MDB
-	const char* mdb_filename = "data.mdb";
+size_t olaf_db_find_batch(Olaf_DB * olaf_db,const uint64_t * keys,size_t keys_size,uint64_t range,uint64_t * results,size_t results_size,size_t max_results_per_key,size_t * result_counts){
+	memset(result_counts,0,keys_size * sizeof(size_t));
+	if(keys_size == 0) return 0;
 
-	size_t folder_len = strlen(olaf_db->mdb_folder);
-	bool needs_sep = folder_len > 0
-		&& olaf_db->mdb_folder[folder_len - 1] != '/'
-		&& olaf_db->mdb_folder[folder_len - 1] != '\\';
+	if(olaf_db->shards != NULL){
+		return olaf_db_shards_find_batch(olaf_db->shards,keys,keys_size,range,results,results_size,max_results_per_key,result_counts);
+	}
 
-	size_t total_len = folder_len + (needs_sep ? 1 : 0) + strlen(mdb_filename) + 1;
-	char *mdb_full_path_name = malloc(total_len);
-	if(!mdb_full_path_name) return 0;
+	olaf_db_bulk_load_flush(olaf_db);
+
+	//the intervals, sorted by start key
+	struct olaf_db_interval * intervals = (struct olaf_db_interval *) malloc(keys_size * sizeof(struct olaf_db_interval));
+	for(size_t i = 0 ; i < keys_size ; i++){
+		intervals[i].start = keys[i] >= range ? keys[i] - range : 0;
+		intervals[i].stop = keys[i] <= UINT64_MAX - range ? keys[i] + range : UINT64_MAX;
+		intervals[i].index = i;
+	}
+	qsort(intervals,keys_size,sizeof(struct olaf_db_interval),olaf_db_interval_compare);
+
+	//results in cursor order with the index of the key they belong to
+	size_t * found_indexes = (size_t *) malloc(results_size * sizeof(size_t));
+	uint64_t * found_values = (uint64_t *) malloc(results_size * sizeof(uint64_t));
+	size_t found = 0;
+	bool full = false;
+
+	struct olaf_db_cursor cursor;
+	bool positioned = false;
+	bool valid = false;
+
+	olaf_db_cursor_open(olaf_db,&cursor,true);
+
+	size_t group_begin = 0;
+	while(group_begin < keys_size && !full){
+
+		//merge overlapping intervals into one range
+		uint64_t group_start = intervals[group_begin].start;
+		uint64_t group_stop = intervals[group_begin].stop;
+		size_t group_end = group_begin + 1;
+		while(group_end < keys_size && intervals[group_end].start <= group_stop){
+			if(intervals[group_end].stop > group_stop) group_stop = intervals[group_end].stop;
+			group_end++;
+		}
+
+		//Only descend the B-tree if the cursor is before the range. The 
+		//cursor stays on the first key after the previous range, which is 
+		//often already past the start of this one.
+		if(!positioned || cursor.key < group_start){
+			valid = olaf_db_cursor_seek(&cursor,group_start);
+			positioned = true;
+		}
+
+		//no keys left in the tree
+		if(!valid) break;
+
+		while(valid && cursor.key <= group_stop){
+			uint64_t cursor_key = cursor.key;
+			uint64_t value = cursor.value;
+
+			//ignore empty results, see olaf_db_find
+			for(size_t j = group_begin ; value != 0 && j < group_end && intervals[j].start <= cursor_key ; j++){
+				if(intervals[j].stop < cursor_key) continue;
+
+				size_t index = intervals[j].index;
+				if(result_counts[index] >= max_results_per_key){
+					//warn only once!
+					if(!olaf_db->warning_given){
+						olaf_db->warning_given = true;
+						fprintf(stderr,"Warning: Results full, expected less than %zu hash collisions, configure config->maxDBCollisions to a higher number for larger indexex \n",max_results_per_key);
+					}
+					continue;
+				}
+				if(found == results_size){
+					full = true;
+					break;
+				}
+				found_indexes[found] = index;
+				found_values[found] = value;
+				found++;
+				result_counts[index]++;
+			}
+			if(full) break;
+
+			valid = olaf_db_cursor_next(&cursor);
+		}
+
+		group_begin = group_end;
+	}
+
+	olaf_db_cursor_close(&cursor);
+
+	//Scatter the results back per key, a stable counting sort on the key 
+	//index keeps the order of olaf_db_find for each key.
+	size_t * offsets = (size_t *) malloc(keys_size * sizeof(size_t));
+	size_t offset = 0;
+	for(size_t i = 0 ; i < keys_size ; i++){
+		offsets[i] = offset;
+		offset += result_counts[i];
+	}
+	for(size_t i = 0 ; i < found ; i++){
+		results[offsets[found_indexes[i]]++] = found_values[i];
+	}
 
-	snprintf(mdb_full_path_name, total_len, "%s%s%s",
-		olaf_db->mdb_folder,
-		needs_sep ? "/" : "",
-		mdb_filename);
+	free(offsets);
+	free(found_values);
+	free(found_indexes);
+	free(intervals);
+
+	return found;
+}
+
+//The size of the LMDB file in a folder
+static size_t olaf_db_file_size(const char * mdb_folder){
+	//This assumes the default filename for MDB
+	char *mdb_full_path_name = olaf_db_path(mdb_folder,"data.mdb");
+	if(!mdb_full_path_name) return 0;
 
 	FILE * db_file = fopen(mdb_full_path_name,"rb");
 	free(mdb_full_path_name);
@@ -427,25 +1581,21 @@ size_t olaf_db_size(Olaf_DB * olaf_db){
 	return fp_db_size_in_bytes;
 }
 
-void olaf_db_stats_verbose(Olaf_DB * olaf_db){
-	int rc;
-	MDB_cursor *cursor;
-	MDB_val mdb_key, mdb_value;
-
-	e(mdb_cursor_open(olaf_db->txn, olaf_db->dbi_fps, &cursor));
-
-	uint64_t key = 0;
-	mdb_key.mv_size = sizeof(uint64_t);
-	mdb_key.mv_data = &key;
+size_t olaf_db_size(Olaf_DB * olaf_db){
+	size_t size = olaf_db_file_size(olaf_db->mdb_folder);
+	if(olaf_db->shards != NULL) size += olaf_db_shards_size(olaf_db->shards);
+	return size;
+}
 
-	uint64_t value;
-	mdb_value.mv_size = sizeof(uint64_t);
-	mdb_value.mv_data = &value;
+void olaf_db_stats_verbose(Olaf_DB * olaf_db){
+	struct olaf_db_cursor cursor;
+	olaf_db_cursor_open(olaf_db,&cursor,false);
 
 	//Position at first key greater than or equal to specified key.
-	rc = mdb_cursor_get(cursor, &mdb_key, &mdb_value, MDB_SET_RANGE);
+	bool found = olaf_db_cursor_seek(&cursor,0);
 
-	if(rc != 0){
+	if(!found){
+		olaf_db_cursor_close(&cursor);
 		printf("Total fingerprints:\t%u\n",0);
 		return;
 	}
@@ -455,38 +1605,79 @@ void olaf_db_stats_verbose(Olaf_DB * olaf_db){
 	printf("  key  \tduration(s)\tPrints(#)\tPrints(#/s)\tpath\n");
 	//query
 	do {
-		uint64_t hash = *((uint64_t *) (mdb_key.mv_data));
-		uint64_t val = *((uint64_t *) (mdb_value.mv_data));
+		uint64_t hash = cursor.key;
+		uint64_t val = cursor.value;
 
 		uint32_t ref_t1 = (uint32_t) (val >> 32);
 		uint32_t ref_id = (uint32_t) val;
 
 		number_of_fps++;
 		printf("%12"PRIu64"\t%12"PRIu64": [%8d,%8d]\n",number_of_fps,hash,ref_id,ref_t1);
-		
-		rc = mdb_cursor_get(cursor, &mdb_key, &mdb_value, MDB_NEXT_DUP );
-		if(rc == MDB_NOTFOUND ){
-			rc = mdb_cursor_get(cursor, &mdb_key, &mdb_value, MDB_NEXT);
-		}
-	} while (rc == 0);
+	} while (olaf_db_cursor_next(&cursor));
+	olaf_db_cursor_close(&cursor);
 	printf("Total fingerprints:\t%"PRIu64"\n",number_of_fps);
 }
 
-void olaf_db_stats(Olaf_DB * olaf_db,bool verbose){
-	if(verbose){
-		olaf_db_stats_verbose(olaf_db);
+int olaf_db_index_stats(Olaf_DB * olaf_db,struct olaf_db_index_stats * stats){
+	MDB_stat mdb_stats;
+	int err = mdb_stat(olaf_db->txn, olaf_db->dbi_fps, &mdb_stats);
+	if(err != MDB_SUCCESS) return err;
+	stats->entries += mdb_stats.ms_entries;
+	if(mdb_stats.ms_depth > stats->depth) stats->depth = mdb_stats.ms_depth;
+	if(olaf_db->blocks){
+		e(mdb_stat(olaf_db->txn, olaf_db->dbi_blocks, &mdb_stats));
+		stats->blocks += mdb_stats.ms_entries;
+		stats->entries += olaf_db_blocks_count(olaf_db);
+		if(mdb_stats.ms_depth > stats->depth) stats->depth = mdb_stats.ms_depth;
+	}
+	if(olaf_db->use_flat) stats->flat_size += olaf_db_flat_file_size(olaf_db->flat);
+	if(olaf_db->resource_index){
+		e(mdb_stat(olaf_db->txn, olaf_db->dbi_resource_fps, &mdb_stats));
+		stats->resource_entries += mdb_stats.ms_entries;
+		stats->resource_index = true;
 	}
+	return MDB_SUCCESS;
+}
 
-	/* Get a database statistics */
+void olaf_db_stats(Olaf_DB * olaf_db,bool verbose){
+	olaf_db_bulk_load_flush(olaf_db);
+
+	/* Get a database statistics, the fingerprints are either in this database or in 
+	   its shards, remote shards are not included */
 	MDB_stat stats;
+	struct olaf_db_index_stats index_stats;
+	memset(&index_stats,0,sizeof(index_stats));
+	size_t remote_shards = 0;
 	int err = mdb_stat(olaf_db->txn, olaf_db->dbi_fps, &stats);
+	if(err == MDB_SUCCESS && olaf_db->shards != NULL){
+		err = olaf_db_shards_index_stats(olaf_db->shards,verbose,&index_stats,&remote_shards);
+	}else if(err == MDB_SUCCESS){
+		if(verbose) olaf_db_stats_verbose(olaf_db);
+		err = olaf_db_index_stats(olaf_db,&index_stats);
+	}
+
 	if (err == MDB_SUCCESS) {
 		printf("[MDB database statistics]\n");
 		printf("=========================\n");
 		printf("> Size of database page:        %u\n", stats.ms_psize);
-		printf("> Depth of the B-tree:          %u\n", stats.ms_depth);
-		printf("> Number of items in databases: %d\n", (int)stats.ms_entries);
+		printf("> Depth of the B-tree:          %u\n", index_stats.depth);
+		printf("> Number of items in databases: %d\n", (int)index_stats.entries);
 		printf("> File size of the databases:   %luMB\n", olaf_db_size(olaf_db) / (1024 * 1024));
+		if(index_stats.blocks > 0){
+			printf("> Number of posting blocks:     %zu\n", index_stats.blocks);
+		}
+		if(index_stats.flat_size > 0){
+			printf("> File size of the flat index:  %zuMB\n", index_stats.flat_size / (1024 * 1024));
+		}
+		if(olaf_db->shards != NULL){
+			printf("> Number of shards:             %zu\n", olaf_db_shards_count(olaf_db->shards));
+		}
+		if(remote_shards > 0){
+			printf("> Remote shards, not counted:   %zu\n", remote_shards);
+		}
+		if(index_stats.resource_index){
+			printf("> Items in the resource index:  %d\n", (int)index_stats.resource_entries);
+		}
 		printf("=========================\n\n");
 
 		olaf_db_stats_meta_data(olaf_db,true);
@@ -495,20 +1686,162 @@ void olaf_db_stats(Olaf_DB * olaf_db,bool verbose){
 	}
 }
 
+bool olaf_db_export_flat(Olaf_DB * olaf_db){
+	if(olaf_db->shards != NULL) return olaf_db_shards_export_flat(olaf_db->shards);
+
+	if(!olaf_db->readonly){
+		fprintf(stderr,"A flat index can only be exported from a database opened in read only mode\n");
+		return false;
+	}
+
+	MDB_stat stats;
+	e(mdb_stat(olaf_db->txn, olaf_db->dbi_fps, &stats));
+	size_t capacity = stats.ms_entries + olaf_db_blocks_count(olaf_db);
+
+	//the largest hash sizes the directory of the flat index
+	MDB_cursor *cursor;
+	MDB_val mdb_key, mdb_value;
+	uint64_t max_key = 0;
+	e(mdb_cursor_open(olaf_db->txn, olaf_db->dbi_fps, &cursor));
+	if(mdb_cursor_get(cursor, &mdb_key, &mdb_value, MDB_LAST) == 0){
+		max_key = *((uint64_t *) (mdb_key.mv_data));
+	}
+	mdb_cursor_close(cursor);
+	if(olaf_db->blocks){
+		e(mdb_cursor_open(olaf_db->txn, olaf_db->dbi_blocks, &cursor));
+		if(mdb_cursor_get(cursor, &mdb_key, &mdb_value, MDB_LAST) == 0 && *((uint64_t *) (mdb_key.mv_data)) > max_key){
+			max_key = *((uint64_t *) (mdb_key.mv_data));
+		}
+		mdb_cursor_close(cursor);
+	}
+
+	char * flat_path = olaf_db_path(olaf_db->mdb_folder,OLAF_DB_FLAT_FILE);
+	Olaf_DB_Flat_Writer * writer = flat_path != NULL ? olaf_db_flat_writer_new(flat_path,capacity,max_key,mdb_txn_id(olaf_db->txn)) : NULL;
+	free(flat_path);
+	if(writer == NULL) return false;
+
+	//the B-tree is walked in key order, empty values are left out as in olaf_db_find
+	struct olaf_db_cursor fingerprints;
+	olaf_db_cursor_open(olaf_db,&fingerprints,false);
+	bool complete = true;
+	bool found = olaf_db_cursor_seek(&fingerprints,0);
+	while(found && complete){
+		if(fingerprints.value != 0) complete = olaf_db_flat_writer_append(writer,fingerprints.key,fingerprints.value);
+		found = olaf_db_cursor_next(&fingerprints);
+	}
+	olaf_db_cursor_close(&fingerprints);
+
+	if(!olaf_db_flat_writer_destroy(writer,complete)){
+		fprintf(stderr,"Error: could not export the flat index of '%s'\n",olaf_db->mdb_folder);
+		return false;
+	}
+	return true;
+}
+
+Olaf_DB * olaf_db_new_reader(Olaf_DB * olaf_db){
+	if(!olaf_db->readonly || !olaf_db->owns_env){
+		fprintf(stderr,"Reader handles can only be created for a read only database\n");
+		return NULL;
+	}
+
+	//Database handles opened in a transaction only become visible to other 
+	//transactions after a commit: publish them once and restart the transaction
+	if(!olaf_db->shared){
+		e(mdb_txn_commit(olaf_db->txn));
+		e(mdb_txn_begin(olaf_db->env, NULL, MDB_RDONLY, &olaf_db->txn));
+		olaf_db->shared = true;
+	}
+
+	Olaf_DB *reader = (Olaf_DB *) malloc(sizeof(Olaf_DB));
+	*reader = *olaf_db;
+	reader->owns_env = false;
+	reader->holds_writer_lock = false;
+	reader->warning_given = false;
+	reader->shards = NULL;
+
+	//the reader slots of a live database can run out
+	int rc = mdb_txn_begin(olaf_db->env, NULL, MDB_RDONLY, &reader->txn);
+	if(rc != MDB_SUCCESS){
+		fprintf(stderr,"Error: no reader handle for '%s': %s\n",olaf_db->mdb_folder,mdb_strerror(rc));
+		free(reader);
+		return NULL;
+	}
+
+	//a reader of each shard
+	if(olaf_db->shards != NULL){
+		reader->shards = olaf_db_shards_new_reader(olaf_db->shards);
+		if(reader->shards == NULL){
+			olaf_db_destroy(reader);
+			return NULL;
+		}
+	}
+
+	return reader;
+}
+
+void olaf_db_renew(Olaf_DB * olaf_db){
+	if(!olaf_db->readonly) return;
+
+	//releases the snapshot and takes a new one, without allocations
+	mdb_txn_reset(olaf_db->txn);
+	e(mdb_txn_renew(olaf_db->txn));
+
+	//the flat index is a copy of an earlier snapshot after a change
+	if(olaf_db->flat != NULL){
+		olaf_db->use_flat = olaf_db_flat_txn_id(olaf_db->flat) == mdb_txn_id(olaf_db->txn);
+	}
+
+	if(olaf_db->shards != NULL) olaf_db_shards_renew(olaf_db->shards);
+}
+
+//Complete the writes of a database before its transaction is committed
+void olaf_db_finish(Olaf_DB * olaf_db){
+	if(!olaf_db->owns_env) return;
+
+	olaf_db_bulk_load_flush(olaf_db);
+
+	//merge the posting blocks once enough fingerprints are stored outside of them
+	if(olaf_db->blocks && !olaf_db->readonly){
+		MDB_stat stats;
+		e(mdb_stat(olaf_db->txn, olaf_db->dbi_fps, &stats));
+		if(stats.ms_entries >= OLAF_DB_BLOCKS_DELTA_MAX) olaf_db_blocks_merge(olaf_db);
+	}
+}
+
 //free memory resources
 void olaf_db_destroy(Olaf_DB * olaf_db){
 
 	//mdb_dbi_close(olaf_db->env, olaf_db->dbi_fps);
 	//mdb_dbi_close(olaf_db->env, olaf_db->dbi_resource_map);
 
+	//The shards are closed first
+	if(olaf_db->shards != NULL) olaf_db_shards_destroy(olaf_db->shards);
+
+	if(!olaf_db->owns_env){
+		//the environment stays open for the other handles
+		mdb_txn_abort(olaf_db->txn);
+		free(olaf_db);
+		return;
+	}
+
+	olaf_db_finish(olaf_db);
+
 	mdb_txn_commit(olaf_db->txn);
 	mdb_env_close(olaf_db->env);
 
+	if(olaf_db->flat != NULL){
+		olaf_db_flat_destroy(olaf_db->flat);
+	}
+
 	//Release the writer mutex AFTER the env is fully closed so the next
 	//worker sees the lock file in a clean state.
 	if(olaf_db->holds_writer_lock){
 		pthread_mutex_unlock(&olaf_db_writer_lock);
 	}
 
+	if(olaf_db->is_shard){
+		free((void *) olaf_db->mdb_folder);
+	}
+
 	free(olaf_db);
 }
@@ -58,9 +58,61 @@
 	 * Creates a new database, if the file name exists, read the contents
 	 * @param db_file_folder  The folder used to store database files
 	 * @param readonly The mode to open the database, if no write operations are expected this should be true.
+	 * A database with remote shards can only be opened read only, otherwise the process stops with an error.
 	 */
 	Olaf_DB * olaf_db_new(const char * db_file_folder,bool readonly);
 
+	/**
+	 * Open a database read only for a long running process which keeps answering queries
+	 * while other processes store or delete audio. Unlike a read only olaf_db_new, the
+	 * snapshots of this database and its reader handles are registered in the lock file
+	 * of the database, so writers do not reuse the pages they read. The database and its
+	 * shards are created if they do not exist yet.
+	 * @param db_file_folder The folder of the database.
+	 * @return The new database handle.
+	 */
+	Olaf_DB * olaf_db_new_live(const char * db_file_folder);
+
+	/**
+	 * Divide the fingerprint index of a database over several shards, each a data store in
+	 * its own folder, for example on its own disk. Fingerprints are routed to a shard by
+	 * their hash, meta data stays in the database folder. Stores, deletes and
+	 * look-ups of the shards run in parallel. The layout is written in the database folder
+	 * and is used by every olaf_db_new later on. Call this before the database is opened.
+	 * 
+	 * A shard can also be the address of a worker process which serves the shard folder,
+	 * see olaf_db_remote.h. Such a shard is only used for look-ups: the database is then
+	 * read only. Existing shards can be moved to other folders or workers by calling this
+	 * again with the same number of shards, for example back to the shard folders to store
+	 * or delete audio.
+	 * @param db_folder The folder of the database.
+	 * @param shard_folders The existing folders of the shards or worker addresses, in a fixed order.
+	 * @param shards The number of shards.
+	 * @return True if the database uses these shards, false if it already contains
+	 * fingerprints or is divided over another number of shards.
+	 */
+	bool olaf_db_create_shards(const char * db_folder,const char ** shard_folders,size_t shards);
+
+	/**
+	 * Creates an additional handle on a read only database. The handle has its own
+	 * read transaction but shares the environment, the memory map and database handles,
+	 * so each thread of a long running process can query the same warm index.
+	 * Create reader handles before they are used by other threads and destroy them
+	 * before the database they were created from.
+	 * @param db A database opened in read only mode with olaf_db_new or olaf_db_new_live.
+	 * @return A new handle or NULL if the database is not read only or if all reader
+	 * slots of a live database are in use.
+	 */
+	Olaf_DB * olaf_db_new_reader(Olaf_DB * db);
+
+	/**
+	 * Renew the read transaction of a read only database so that changes committed
+	 * after it was opened become visible. Does nothing for a writable database. Only a 
+	 * database opened with olaf_db_new_live is safe to renew while another process writes.
+	 * @param db The database.
+	 */
+	void olaf_db_renew(Olaf_DB * db);
+
 	/**
 	 * Free database related memory resources and close files or other resources.
 	 * @param db the database to close.
@@ -119,6 +171,19 @@
 	 */
 	void olaf_db_store(Olaf_DB * db, uint64_t * keys, uint64_t * values, size_t size);
 
+	/**
+	 * Switch a writable database with an empty fingerprint index to bulk load mode. Stored 
+	 * fingerprints are then buffered in memory, sorted and appended in key order when the 
+	 * database is closed (or when a delete or find needs them). This builds a fresh index 
+	 * without random B-tree inserts. Fingerprints which do not fit in memory are sorted in 
+	 * runs, spilled to temporary files and merged. Outside bulk load mode each stored batch 
+	 * is sorted and inserted with a single cursor.
+	 * @param db The database.
+	 * @return True if bulk load mode is active, false if the index already contains fingerprints 
+	 * or the database is read only.
+	 */
+	bool olaf_db_start_bulk_load(Olaf_DB * db);
+
 	/**
 	 * Delete a list of elements in the data store.
 	 * @param db The database.
@@ -128,6 +193,46 @@
 	 */
 	void olaf_db_delete(Olaf_DB * db, uint64_t * keys, uint64_t * values, size_t size);
 
+	/**
+	 * Create the resource index if it does not exist yet. The resource index keeps, for each audio 
+	 * identifier, the list of fingerprints stored for it. Once created it is maintained by every 
+	 * store and delete, also when the database is opened later on. Only audio stored after the 
+	 * resource index is created can be deleted with olaf_db_delete_resource.
+	 * @param db The database.
+	 * @return True if the resource index is present, false if the database is read only and 
+	 * has no resource index.
+	 */
+	bool olaf_db_enable_resource_index(Olaf_DB * db);
+
+	/**
+	 * Delete all fingerprints of an audio identifier with the resource index, without 
+	 * extracting fingerprints from the original audio. The meta-data is not deleted, 
+	 * see olaf_db_delete_meta_data.
+	 * @param db The database, opened in write mode.
+	 * @param audio_id The audio identifier.
+	 * @return The number of deleted fingerprints. Zero if there is no resource index or if the 
+	 * resource index has no fingerprints for the audio identifier.
+	 */
+	size_t olaf_db_delete_resource(Olaf_DB * db, uint32_t audio_id);
+
+	/**
+	 * Merge the fingerprint index into posting blocks: one LMDB item per hash with all its 
+	 * values, compressed. The values are grouped by audio identifier and the identifiers 
+	 * and time stamps are stored as varint coded differences. A hash with many collisions 
+	 * is then read with a single look-up instead of a cursor step per fingerprint. The index
+	 * is about half the size, but the blocks are decoded value by value: batched look-ups of
+	 * colliding hashes are slower than in the regular index. Posting blocks are only used
+	 * after this is called.
+	 * 
+	 * Fingerprints stored afterwards are kept in the regular index, which is searched 
+	 * together with the posting blocks, and are merged into the posting blocks when a
+	 * database with many of them is closed, or by calling this again. A bulk load, see
+	 * olaf_db_start_bulk_load, is added to the posting blocks directly.
+	 * @param db The database, opened in write mode.
+	 * @return True if the fingerprints are merged, false for a read only database.
+	 */
+	bool olaf_db_merge_blocks(Olaf_DB * db);
+
 	/**
 	 * Find a list of elements in the database store
 	 * @param db The database.
@@ -140,6 +245,25 @@
 	size_t olaf_db_find(Olaf_DB * db,uint64_t start_key,uint64_t stop_key,uint64_t * results, size_t results_size);
 
 
+	/**
+	 * Find elements for many keys at once, e.g. all fingerprint hashes of a query block. Each key k 
+	 * matches the keys in [k - range, k + range]. The intervals are sorted and overlapping intervals 
+	 * are merged so the database is walked once, in key order, with a single cursor.
+	 * 
+	 * The results are grouped per key: first the result_counts[0] results of keys[0], then 
+	 * the results of keys[1], ... For each key the order is the same as for olaf_db_find.
+	 * @param db The database.
+	 * @param keys The keys to search for.
+	 * @param keys_size The number of keys.
+	 * @param range The search range around each key.
+	 * @param results An array to store the results in.
+	 * @param results_size The maximum size of the results array. If it is full, the remaining results are dropped.
+	 * @param max_results_per_key The maximum number of results for a single key.
+	 * @param result_counts An array of keys_size elements receiving the number of results for each key.
+	 * @return The total number of found results.
+	 */
+	size_t olaf_db_find_batch(Olaf_DB * db,const uint64_t * keys,size_t keys_size,uint64_t range,uint64_t * results,size_t results_size,size_t max_results_per_key,size_t * result_counts);
+
 	/**
 	 * Checks if a hash is present in the database.
 	 * @param db The database.
@@ -149,6 +273,16 @@
 	 */
 	bool olaf_db_find_single(Olaf_DB * db,uint64_t start_key,uint64_t stop_key);
 
+	/**
+	 * Export the fingerprint index to a flat, memory mapped file in the database folder,
+	 * see olaf_db_flat.h. Databases opened in read only mode afterwards use the flat index
+	 * for look-ups instead of the B-tree, until the fingerprints change. The B-tree stays
+	 * the index which is updated. Each local shard of a sharded database is exported.
+	 * @param db A database opened in read only mode.
+	 * @return True if the flat index is written.
+	 */
+	bool olaf_db_export_flat(Olaf_DB * db);
+
 	/**
 	 * Print database statistics.
 	 * @param db The database.
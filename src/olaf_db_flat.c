@@ -0,0 +1,324 @@
+// Olaf: Overly Lightweight Acoustic Fingerprinting
+// Copyright (C) 2019-2025  Joren Six
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//The flat index is memory mapped with POSIX mmap, elsewhere it is read into memory
+#if !defined(_WIN32)
+	#define _POSIX_C_SOURCE 200809L
+	#define OLAF_FLAT_MMAP
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+#if defined(OLAF_FLAT_MMAP)
+	#include <sys/mman.h>
+#endif
+
+#include "olaf_db_flat.h"
+
+#define OLAF_DB_FLAT_MAGIC "OLAFFLAT"
+#define OLAF_DB_FLAT_VERSION 1
+
+//The average number of fingerprints per hash prefix in the directory
+#define OLAF_DB_FLAT_BUCKET_SIZE 16
+
+//The header is followed by the directory, the key column and the value column
+struct olaf_db_flat_header{
+	char magic[8]; /**< OLAF_DB_FLAT_MAGIC */
+	uint64_t version; /**< OLAF_DB_FLAT_VERSION */
+	uint64_t txn_id; /**< The LMDB transaction the index is a copy of */
+	uint64_t count; /**< The number of fingerprints */
+	uint64_t prefixes; /**< The number of hash prefixes in the directory */
+	uint64_t shift; /**< The number of low bits of a hash kept in the key column */
+	uint64_t key_width; /**< The size of a key in the key column: 4 or 8 bytes */
+	uint64_t values_offset; /**< The position of the value column in the file */
+};
+
+struct Olaf_DB_Flat{
+	const uint8_t * data; /**< The mapped file */
+	size_t size; /**< The size of the file */
+	uint64_t txn_id; /**< The LMDB transaction the index is a copy of */
+	size_t count; /**< The number of fingerprints */
+	uint64_t prefixes; /**< The number of hash prefixes */
+	unsigned int shift; /**< The number of low bits of a hash kept in the key column */
+	const uint64_t * directory; /**< The first fingerprint of each prefix, followed by count */
+	const uint32_t * keys32; /**< The low bits of the hashes if they fit in 32 bits, NULL otherwise */
+	const uint64_t * keys64; /**< The low bits of the hashes otherwise */
+	const uint64_t * values; /**< The values */
+};
+
+struct Olaf_DB_Flat_Writer{
+	char * path; /**< The flat index file */
+	char * tmp_path; /**< The file written, renamed to path when complete */
+	FILE * keys_file; /**< Positioned in the key column */
+	FILE * values_file; /**< Positioned in the value column, the same file */
+	struct olaf_db_flat_header header; /**< The header, completed when the index is */
+	uint64_t * directory; /**< The first fingerprint of each prefix */
+	uint64_t next_prefix; /**< The first prefix without a directory entry */
+	size_t capacity; /**< The maximum number of fingerprints */
+	uint64_t max_key; /**< The largest hash */
+	uint64_t last_key; /**< The hash added last */
+	bool ok; /**< False after an error */
+};
+
+static const uint8_t * olaf_db_flat_map(FILE * file,size_t size){
+	#if defined(OLAF_FLAT_MMAP)
+		void * mapped = mmap(NULL,size,PROT_READ,MAP_SHARED,fileno(file),0);
+		if(mapped == MAP_FAILED) return NULL;
+		//look-ups jump around the file
+		posix_madvise(mapped,size,POSIX_MADV_RANDOM);
+		return (const uint8_t *) mapped;
+	#else
+		uint8_t * data = (uint8_t *) malloc(size);
+		if(data == NULL) return NULL;
+		if(fseek(file,0,SEEK_SET) != 0 || fread(data,1,size,file) != size){
+			free(data);
+			return NULL;
+		}
+		return data;
+	#endif
+}
+
+static void olaf_db_flat_unmap(const uint8_t * data,size_t size){
+	#if defined(OLAF_FLAT_MMAP)
+		munmap((void *) data,size);
+	#else
+		(void)(size);
+		free((void *) data);
+	#endif
+}
+
+Olaf_DB_Flat * olaf_db_flat_open(const char * path){
+	FILE * file = fopen(path,"rb");
+	if(file == NULL) return NULL;
+
+	struct olaf_db_flat_header header;
+	fseek(file,0,SEEK_END);
+	long file_size = ftell(file);
+	fseek(file,0,SEEK_SET);
+	if(file_size < (long) sizeof(header) || fread(&header,sizeof(header),1,file) != 1 ||
+		memcmp(header.magic,OLAF_DB_FLAT_MAGIC,sizeof(header.magic)) != 0 || header.version != OLAF_DB_FLAT_VERSION){
+		fprintf(stderr,"Error: '%s' is not a flat index, it is not used.\n",path);
+		fclose(file);
+		return NULL;
+	}
+
+	//the columns should fit in the file
+	size_t size = (size_t) file_size;
+	uint64_t keys_offset = sizeof(header) + (header.prefixes + 1) * sizeof(uint64_t);
+	bool valid = header.shift < 64 && (header.key_width == 4 || header.key_width == 8) && header.prefixes > 0 &&
+		header.prefixes < size / sizeof(uint64_t) && header.count <= size / sizeof(uint64_t) &&
+		header.values_offset % sizeof(uint64_t) == 0 && header.values_offset >= keys_offset + header.count * header.key_width &&
+		header.values_offset + header.count * sizeof(uint64_t) <= size;
+
+	const uint8_t * data = valid ? olaf_db_flat_map(file,size) : NULL;
+	fclose(file);
+	if(data == NULL){
+		fprintf(stderr,"Error: the flat index '%s' is incomplete, it is not used.\n",path);
+		return NULL;
+	}
+
+	Olaf_DB_Flat * flat = (Olaf_DB_Flat *) malloc(sizeof(Olaf_DB_Flat));
+	flat->data = data;
+	flat->size = size;
+	flat->txn_id = header.txn_id;
+	flat->count = header.count;
+	flat->prefixes = header.prefixes;
+	flat->shift = (unsigned int) header.shift;
+	flat->directory = (const uint64_t *) (data + sizeof(header));
+	flat->keys32 = header.key_width == 4 ? (const uint32_t *) (data + keys_offset) : NULL;
+	flat->keys64 = header.key_width == 8 ? (const uint64_t *) (data + keys_offset) : NULL;
+	flat->values = (const uint64_t *) (data + header.values_offset);
+
+	if(flat->directory[flat->prefixes] != flat->count){
+		fprintf(stderr,"Error: the flat index '%s' is incomplete, it is not used.\n",path);
+		olaf_db_flat_destroy(flat);
+		return NULL;
+	}
+	return flat;
+}
+
+uint64_t olaf_db_flat_txn_id(const Olaf_DB_Flat * flat){
+	return flat->txn_id;
+}
+
+size_t olaf_db_flat_file_size(const Olaf_DB_Flat * flat){
+	return flat->size;
+}
+
+static uint64_t olaf_db_flat_key(const Olaf_DB_Flat * flat,const Olaf_DB_Flat_Cursor * cursor){
+	uint64_t low_bits = flat->keys32 != NULL ? flat->keys32[cursor->index] : flat->keys64[cursor->index];
+	return (cursor->prefix << flat->shift) | low_bits;
+}
+
+//The prefix of a fingerprint: the last directory entry at or before it, from a
+//prefix known to be at or before it. Empty prefixes share their position with the next one.
+static uint64_t olaf_db_flat_prefix(const Olaf_DB_Flat * flat,size_t index,uint64_t from){
+	uint64_t low = from;
+	uint64_t high = flat->prefixes - 1;
+	if(index < flat->directory[low + 1]) return low;
+	while(low < high){
+		uint64_t middle = low + (high - low + 1) / 2;
+		if(flat->directory[middle] <= index){
+			low = middle;
+		}else{
+			high = middle - 1;
+		}
+	}
+	return low;
+}
+
+bool olaf_db_flat_seek(const Olaf_DB_Flat * flat,Olaf_DB_Flat_Cursor * cursor,uint64_t key,uint64_t * found_key,uint64_t * found_value){
+	uint64_t prefix = key >> flat->shift;
+
+	//the largest hash has the last prefix
+	if(prefix >= flat->prefixes) return false;
+
+	//a binary search in the keys with the same prefix
+	uint64_t low_bits = key - (prefix << flat->shift);
+	size_t low = flat->directory[prefix];
+	size_t high = flat->directory[prefix + 1];
+	while(low < high){
+		size_t middle = low + (high - low) / 2;
+		uint64_t middle_bits = flat->keys32 != NULL ? flat->keys32[middle] : flat->keys64[middle];
+		if(middle_bits < low_bits){
+			low = middle + 1;
+		}else{
+			high = middle;
+		}
+	}
+	if(low >= flat->count) return false;
+
+	cursor->index = low;
+	cursor->prefix = olaf_db_flat_prefix(flat,low,prefix);
+	*found_key = olaf_db_flat_key(flat,cursor);
+	*found_value = flat->values[low];
+	return true;
+}
+
+bool olaf_db_flat_next(const Olaf_DB_Flat * flat,Olaf_DB_Flat_Cursor * cursor,uint64_t * found_key,uint64_t * found_value){
+	if(cursor->index + 1 >= flat->count) return false;
+
+	cursor->index++;
+	if(cursor->index >= flat->directory[cursor->prefix + 1]){
+		cursor->prefix = olaf_db_flat_prefix(flat,cursor->index,cursor->prefix + 1);
+	}
+	*found_key = olaf_db_flat_key(flat,cursor);
+	*found_value = flat->values[cursor->index];
+	return true;
+}
+
+void olaf_db_flat_destroy(Olaf_DB_Flat * flat){
+	olaf_db_flat_unmap(flat->data,flat->size);
+	free(flat);
+}
+
+Olaf_DB_Flat_Writer * olaf_db_flat_writer_new(const char * path,size_t capacity,uint64_t max_key,uint64_t txn_id){
+	//The directory has about one prefix for every OLAF_DB_FLAT_BUCKET_SIZE
+	//fingerprints, the other bits of a hash are kept in the key column.
+	unsigned int key_bits = 0;
+	while(key_bits < 64 && (max_key >> key_bits) != 0) key_bits++;
+	unsigned int prefix_bits = 0;
+	while(prefix_bits < key_bits && ((size_t) 1 << prefix_bits) * OLAF_DB_FLAT_BUCKET_SIZE < capacity) prefix_bits++;
+	if(key_bits - prefix_bits >= 64) prefix_bits = 1;
+	unsigned int shift = key_bits - prefix_bits;
+
+	Olaf_DB_Flat_Writer * writer = (Olaf_DB_Flat_Writer *) calloc(1,sizeof(Olaf_DB_Flat_Writer));
+	size_t path_len = strlen(path);
+	writer->path = (char *) malloc(path_len + 1);
+	writer->tmp_path = (char *) malloc(path_len + 5);
+	memcpy(writer->path,path,path_len + 1);
+	snprintf(writer->tmp_path,path_len + 5,"%s.tmp",path);
+
+	memcpy(writer->header.magic,OLAF_DB_FLAT_MAGIC,sizeof(writer->header.magic));
+	writer->header.version = OLAF_DB_FLAT_VERSION;
+	writer->header.txn_id = txn_id;
+	writer->header.prefixes = (max_key >> shift) + 1;
+	writer->header.shift = shift;
+	writer->header.key_width = shift <= 32 ? 4 : 8;
+
+	uint64_t keys_offset = sizeof(struct olaf_db_flat_header) + (writer->header.prefixes + 1) * sizeof(uint64_t);
+	uint64_t keys_size = capacity * writer->header.key_width;
+	writer->header.values_offset = keys_offset + (keys_size + 7) / 8 * 8;
+
+	writer->directory = (uint64_t *) calloc(writer->header.prefixes + 1,sizeof(uint64_t));
+	writer->capacity = capacity;
+	writer->max_key = max_key;
+	writer->ok = writer->directory != NULL;
+
+	//both columns are written front to back, each with its own file handle
+	writer->keys_file = fopen(writer->tmp_path,"w+b");
+	writer->values_file = writer->keys_file != NULL ? fopen(writer->tmp_path,"r+b") : NULL;
+	if(!writer->ok || writer->values_file == NULL ||
+		fseek(writer->keys_file,(long) keys_offset,SEEK_SET) != 0 || fseek(writer->values_file,(long) writer->header.values_offset,SEEK_SET) != 0){
+		fprintf(stderr,"Error: could not write the flat index '%s'.\n",writer->tmp_path);
+		olaf_db_flat_writer_destroy(writer,false);
+		return NULL;
+	}
+	return writer;
+}
+
+bool olaf_db_flat_writer_append(Olaf_DB_Flat_Writer * writer,uint64_t key,uint64_t value){
+	size_t count = writer->header.count;
+	if(!writer->ok || count == writer->capacity || key > writer->max_key || (count > 0 && key < writer->last_key)){
+		writer->ok = false;
+		return false;
+	}
+
+	uint64_t prefix = key >> writer->header.shift;
+	while(writer->next_prefix <= prefix) writer->directory[writer->next_prefix++] = count;
+
+	uint64_t low_bits = key - (prefix << writer->header.shift);
+	uint32_t low_bits32 = (uint32_t) low_bits;
+	if(writer->header.key_width == 4){
+		writer->ok = fwrite(&low_bits32,sizeof(uint32_t),1,writer->keys_file) == 1;
+	}else{
+		writer->ok = fwrite(&low_bits,sizeof(uint64_t),1,writer->keys_file) == 1;
+	}
+	writer->ok = writer->ok && fwrite(&value,sizeof(uint64_t),1,writer->values_file) == 1;
+
+	writer->last_key = key;
+	writer->header.count++;
+	return writer->ok;
+}
+
+bool olaf_db_flat_writer_destroy(Olaf_DB_Flat_Writer * writer,bool complete){
+	bool written = complete && writer->ok;
+	if(written){
+		while(writer->next_prefix <= writer->header.prefixes) writer->directory[writer->next_prefix++] = writer->header.count;
+		written = fflush(writer->values_file) == 0 && fseek(writer->keys_file,0,SEEK_SET) == 0 &&
+			fwrite(&writer->header,sizeof(struct olaf_db_flat_header),1,writer->keys_file) == 1 &&
+			fwrite(writer->directory,sizeof(uint64_t),writer->header.prefixes + 1,writer->keys_file) == writer->header.prefixes + 1;
+	}
+	if(writer->values_file != NULL && fclose(writer->values_file) != 0) written = false;
+	if(writer->keys_file != NULL && fclose(writer->keys_file) != 0) written = false;
+
+	//readers never see a partly written index
+	if(written && rename(writer->tmp_path,writer->path) != 0){
+		fprintf(stderr,"Error: could not replace the flat index '%s'.\n",writer->path);
+		written = false;
+	}
+	if(!written && writer->keys_file != NULL) remove(writer->tmp_path);
+
+	free(writer->directory);
+	free(writer->tmp_path);
+	free(writer->path);
+	free(writer);
+	return written;
+}
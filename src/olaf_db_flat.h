@@ -0,0 +1,137 @@
+// Olaf: Overly Lightweight Acoustic Fingerprinting
+// Copyright (C) 2019-2025  Joren Six
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/**
+ * @file olaf_db_flat.h
+ *
+ * @brief An immutable, memory mapped copy of the fingerprint index.
+ *
+ * The fingerprints are stored in key order in two columns: the low bits of each hash and
+ * the values. A directory with the first position of each hash prefix points into the
+ * columns, so a look-up reads one directory entry and searches a few neighbouring keys:
+ * one or two cache misses instead of a walk down the B-tree. Without per item overhead
+ * the file is smaller than the LMDB index.
+ *
+ * The file is written by olaf_db_export_flat and used by read only databases as long as
+ * the LMDB index has not changed since the export.
+ */
+
+#ifndef OLAF_DB_FLAT_H
+#define OLAF_DB_FLAT_H
+	#include <stdbool.h>
+	#include <stdint.h>
+	#include <stdlib.h>
+
+	/**
+	 * @struct Olaf_DB_Flat
+	 * @brief A loaded flat index.
+	 */
+	/** @typedef Olaf_DB_Flat
+	 *  @brief Typedef for struct Olaf_DB_Flat.
+	 */
+	typedef struct Olaf_DB_Flat Olaf_DB_Flat;
+
+	/**
+	 * @struct Olaf_DB_Flat_Writer
+	 * @brief Writes a flat index, fingerprint by fingerprint in key order.
+	 */
+	/** @typedef Olaf_DB_Flat_Writer
+	 *  @brief Typedef for struct Olaf_DB_Flat_Writer.
+	 */
+	typedef struct Olaf_DB_Flat_Writer Olaf_DB_Flat_Writer;
+
+	/**
+	 * @brief A position in a flat index.
+	 */
+	typedef struct {
+		size_t index; /**< The index of the fingerprint. */
+		uint64_t prefix; /**< The hash prefix of the fingerprint. */
+	} Olaf_DB_Flat_Cursor;
+
+	/**
+	 * Load a flat index.
+	 * @param path The flat index file.
+	 * @return The flat index or NULL if the file does not exist or is invalid.
+	 */
+	Olaf_DB_Flat * olaf_db_flat_open(const char * path);
+
+	/**
+	 * @param flat The flat index.
+	 * @return The identifier of the LMDB transaction the flat index is a copy of.
+	 */
+	uint64_t olaf_db_flat_txn_id(const Olaf_DB_Flat * flat);
+
+	/**
+	 * @param flat The flat index.
+	 * @return The size of the flat index file in bytes.
+	 */
+	size_t olaf_db_flat_file_size(const Olaf_DB_Flat * flat);
+
+	/**
+	 * Position a cursor on the first fingerprint with a hash equal to or larger than a key.
+	 * @param flat The flat index.
+	 * @param cursor The cursor.
+	 * @param key The key to search for.
+	 * @param found_key The hash at the new position.
+	 * @param found_value The value at the new position.
+	 * @return False if all hashes are smaller than the key.
+	 */
+	bool olaf_db_flat_seek(const Olaf_DB_Flat * flat,Olaf_DB_Flat_Cursor * cursor,uint64_t key,uint64_t * found_key,uint64_t * found_value);
+
+	/**
+	 * Move a positioned cursor to the next fingerprint.
+	 * @param flat The flat index.
+	 * @param cursor The cursor.
+	 * @param found_key The hash at the new position.
+	 * @param found_value The value at the new position.
+	 * @return False after the last fingerprint.
+	 */
+	bool olaf_db_flat_next(const Olaf_DB_Flat * flat,Olaf_DB_Flat_Cursor * cursor,uint64_t * found_key,uint64_t * found_value);
+
+	/**
+	 * Unmap the flat index and free memory.
+	 * @param flat The flat index.
+	 */
+	void olaf_db_flat_destroy(Olaf_DB_Flat * flat);
+
+	/**
+	 * Start writing a flat index. The file only replaces an existing flat index when it is complete.
+	 * @param path The flat index file.
+	 * @param capacity The maximum number of fingerprints.
+	 * @param max_key The largest hash.
+	 * @param txn_id The identifier of the LMDB transaction which is copied.
+	 * @return A writer or NULL if the file can not be written.
+	 */
+	Olaf_DB_Flat_Writer * olaf_db_flat_writer_new(const char * path,size_t capacity,uint64_t max_key,uint64_t txn_id);
+
+	/**
+	 * Add a fingerprint. Fingerprints are added in key order, with the values of a key in order.
+	 * @param writer The writer.
+	 * @param key The hash, at most max_key.
+	 * @param value The value.
+	 * @return False if the fingerprint is out of order or does not fit.
+	 */
+	bool olaf_db_flat_writer_append(Olaf_DB_Flat_Writer * writer,uint64_t key,uint64_t value);
+
+	/**
+	 * Complete the flat index, close the file and free memory.
+	 * @param writer The writer.
+	 * @param complete False to drop the file, for example after an error.
+	 * @return True if the flat index is written.
+	 */
+	bool olaf_db_flat_writer_destroy(Olaf_DB_Flat_Writer * writer,bool complete);
+
+#endif // OLAF_DB_FLAT_H
@@ -53,6 +53,32 @@ Olaf_DB * olaf_db_new(const char * db_file_folder,bool readonly){
 	return olaf_db;
 }
 
+Olaf_DB * olaf_db_new_live(const char * db_file_folder){
+	//The memory database does not change
+	return olaf_db_new(db_file_folder,true);
+}
+
+bool olaf_db_create_shards(const char * db_folder,const char ** shard_folders,size_t shards){
+	//The memory database is read only
+	(void)(db_folder);
+	(void)(shard_folders);
+	(void)(shards);
+	fprintf(stderr,"Error: the memory database can not be divided over shards.\n");
+	return false;
+}
+
+Olaf_DB * olaf_db_new_reader(Olaf_DB * olaf_db){
+	//The memory database is read only, a copy points to the same data
+	Olaf_DB *reader = (Olaf_DB *) malloc(sizeof(Olaf_DB));
+	*reader = *olaf_db;
+	return reader;
+}
+
+void olaf_db_renew(Olaf_DB * olaf_db){
+	//The memory database does not change
+	(void)(olaf_db);
+}
+
 void olaf_db_store(Olaf_DB * olaf_db, uint64_t * keys, uint64_t * values, size_t size){
 	(void)(olaf_db);
 	(void)(keys);
@@ -60,6 +86,39 @@ void olaf_db_store(Olaf_DB * olaf_db, uint64_t * keys, uint64_t * values, size_t
 	(void)(size);
 }
 
+void olaf_db_delete(Olaf_DB * olaf_db, uint64_t * keys, uint64_t * values, size_t size){
+	//Not supported: the memory database is read only
+	(void)(olaf_db);
+	(void)(keys);
+	(void)(values);
+	(void)(size);
+	fprintf(stderr,"Deleting fingerprints is not supported by the memory database\n");
+}
+
+bool olaf_db_start_bulk_load(Olaf_DB * olaf_db){
+	//The memory database is read only
+	(void)(olaf_db);
+	return false;
+}
+
+bool olaf_db_enable_resource_index(Olaf_DB * olaf_db){
+	//The memory database is read only
+	(void)(olaf_db);
+	return false;
+}
+
+size_t olaf_db_delete_resource(Olaf_DB * olaf_db, uint32_t audio_id){
+	(void)(olaf_db);
+	(void)(audio_id);
+	return 0;
+}
+
+bool olaf_db_merge_blocks(Olaf_DB * olaf_db){
+	//The memory database is read only
+	(void)(olaf_db);
+	return false;
+}
+
 void olaf_db_mem_unpack(uint64_t packed, uint64_t * hash, uint32_t * t){
 	*hash = (packed >> 16);
 	*t = (uint32_t)((uint16_t) packed) ; 
@@ -154,6 +213,20 @@ size_t olaf_db_find(Olaf_DB * olaf_db,uint64_t start_key,uint64_t stop_key,uint6
 	return number_of_results;
 }
 
+size_t olaf_db_find_batch(Olaf_DB * olaf_db,const uint64_t * keys,size_t keys_size,uint64_t range,uint64_t * results,size_t results_size,size_t max_results_per_key,size_t * result_counts){
+	//The memory database is small: one binary search per key
+	size_t total = 0;
+	for(size_t i = 0 ; i < keys_size ; i++){
+		uint64_t start_key = keys[i] >= range ? keys[i] - range : 0;
+		uint64_t stop_key = keys[i] + range;
+		size_t available = results_size - total;
+		if(available > max_results_per_key) available = max_results_per_key;
+		result_counts[i] = available == 0 ? 0 : olaf_db_find(olaf_db,start_key,stop_key,results + total,available);
+		total += result_counts[i];
+	}
+	return total;
+}
+
 bool olaf_db_find_single(Olaf_DB * olaf_db,uint64_t start_key,uint64_t stop_key){
 
 	//lin search, replace with binary search!
@@ -186,6 +259,13 @@ void olaf_db_destroy(Olaf_DB * olaf_db){
 	free(olaf_db);
 }
 
+bool olaf_db_export_flat(Olaf_DB * olaf_db){
+	//The memory database is already a sorted array
+	(void)(olaf_db);
+	fprintf(stderr,"Error: the memory database has no flat index.\n");
+	return false;
+}
+
 //print database statistics
 void olaf_db_stats(Olaf_DB * olaf_db,bool verbose){
 	(void)(verbose);
@@ -0,0 +1,563 @@
+// Olaf: Overly Lightweight Acoustic Fingerprinting
+// Copyright (C) 2019-2025  Joren Six
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//sockets and getaddrinfo are POSIX, on Windows no shard is remote
+#if !defined(_WIN32)
+	#define _POSIX_C_SOURCE 200809L
+	#define OLAF_DB_REMOTE_SOCKETS
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+#if defined(OLAF_DB_REMOTE_SOCKETS)
+	#include <errno.h>
+	#include <pthread.h>
+	#include <unistd.h>
+	#include <netdb.h>
+	#include <sys/socket.h>
+	#include <sys/un.h>
+	#include <netinet/in.h>
+	#include <netinet/tcp.h>
+#endif
+
+#include "olaf_db_remote.h"
+#include "olaf_db.h"
+
+#if defined(OLAF_DB_REMOTE_SOCKETS)
+
+//The request types, each request starts with a header of five 64 bit words
+#define OLAF_DB_REMOTE_FIND 1
+#define OLAF_DB_REMOTE_FIND_BATCH 2
+#define OLAF_DB_REMOTE_HEADER_SIZE 5
+
+//Limits of a single request, a worker closes connections which exceed them
+#define OLAF_DB_REMOTE_MAX_KEYS (1<<20)
+#define OLAF_DB_REMOTE_MAX_RESULTS (1<<24)
+
+//Results which do not fit are read in blocks and dropped
+#define OLAF_DB_REMOTE_DISCARD_SIZE 1024
+
+//A broken connection does not stop the process
+#if defined(MSG_NOSIGNAL)
+	#define OLAF_DB_REMOTE_SEND_FLAGS MSG_NOSIGNAL
+#else
+	#define OLAF_DB_REMOTE_SEND_FLAGS 0
+#endif
+
+struct Olaf_DB_Remote{
+	char * address; /**< The address of the worker. */
+	int fd; /**< The connected socket, -1 if not connected. */
+	size_t pending_keys; /**< The number of keys of the batch sent last, zero if no answer is expected. */
+	bool error_given; /**< Whether an unreachable worker has been reported. */
+};
+
+//A connection of the server, handled by a thread of its own
+struct olaf_db_remote_connection{
+	Olaf_DB_Remote_Server * server; /**< The server which accepted the connection */
+	Olaf_DB * reader; /**< A reader handle for this connection */
+	int fd; /**< The connected socket */
+	struct olaf_db_remote_connection * next; /**< The next open connection */
+};
+
+struct Olaf_DB_Remote_Server{
+	Olaf_DB * db; /**< The served database */
+	char * address; /**< The address the server listens on */
+	int fd; /**< The listening socket */
+	pthread_t accept_thread; /**< Accepts connections and starts their threads */
+	bool accepting; /**< False once the server is stopped */
+
+	pthread_mutex_t lock; /**< Guards the open connections */
+	pthread_cond_t closed; /**< Signalled when a connection closes */
+	struct olaf_db_remote_connection * connections; /**< The open connections */
+};
+
+bool olaf_db_remote_is_address(const char * address){
+	return strncmp(address,"unix:",5) == 0 || strncmp(address,"tcp:",4) == 0;
+}
+
+//Open a socket for an address, either connected to it or listening on it
+static int olaf_db_remote_socket(const char * address,bool listening){
+	if(strncmp(address,"tcp:",4) != 0){
+		const char * path = strncmp(address,"unix:",5) == 0 ? address + 5 : address;
+		struct sockaddr_un unix_address;
+		if(strlen(path) >= sizeof(unix_address.sun_path)){
+			fprintf(stderr,"Error: socket path '%s' is too long.\n",path);
+			return -1;
+		}
+		memset(&unix_address,0,sizeof(unix_address));
+		unix_address.sun_family = AF_UNIX;
+		strcpy(unix_address.sun_path,path);
+
+		int fd = socket(AF_UNIX,SOCK_STREAM,0);
+		if(fd < 0) return -1;
+		if(listening){
+			//a stale socket of a previous worker
+			unlink(path);
+			if(bind(fd,(struct sockaddr *) &unix_address,sizeof(unix_address)) == 0 && listen(fd,64) == 0) return fd;
+		}else if(connect(fd,(struct sockaddr *) &unix_address,sizeof(unix_address)) == 0){
+			return fd;
+		}
+		close(fd);
+		return -1;
+	}
+
+	// tcp:host:port, the host may be an IPv6 address with colons
+	char host[256];
+	const char * port = strrchr(address + 4,':');
+	size_t host_len = port == NULL ? 0 : (size_t) (port - (address + 4));
+	if(port == NULL || host_len == 0 || host_len >= sizeof(host)){
+		fprintf(stderr,"Error: expected an address as 'tcp:host:port', not '%s'.\n",address);
+		return -1;
+	}
+	memcpy(host,address + 4,host_len);
+	host[host_len] = '\0';
+	port++;
+
+	struct addrinfo hints;
+	struct addrinfo * addresses;
+	memset(&hints,0,sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	if(listening) hints.ai_flags = AI_PASSIVE;
+	if(getaddrinfo(host,port,&hints,&addresses) != 0) return -1;
+
+	int fd = -1;
+	for(struct addrinfo * a = addresses ; a != NULL && fd < 0 ; a = a->ai_next){
+		fd = socket(a->ai_family,a->ai_socktype,a->ai_protocol);
+		if(fd < 0) continue;
+		int on = 1;
+		//small requests and answers are sent right away
+		setsockopt(fd,IPPROTO_TCP,TCP_NODELAY,&on,sizeof(on));
+		if(listening){
+			setsockopt(fd,SOL_SOCKET,SO_REUSEADDR,&on,sizeof(on));
+			if(bind(fd,a->ai_addr,a->ai_addrlen) == 0 && listen(fd,64) == 0) break;
+		}else if(connect(fd,a->ai_addr,a->ai_addrlen) == 0){
+			break;
+		}
+		close(fd);
+		fd = -1;
+	}
+	freeaddrinfo(addresses);
+	return fd;
+}
+
+static void olaf_db_remote_no_sigpipe(int fd){
+#if defined(SO_NOSIGPIPE)
+	int on = 1;
+	setsockopt(fd,SOL_SOCKET,SO_NOSIGPIPE,&on,sizeof(on));
+#else
+	(void)(fd);
+#endif
+}
+
+static bool olaf_db_remote_write(int fd,const void * data,size_t size){
+	const char * bytes = (const char *) data;
+	while(size > 0){
+		ssize_t written = send(fd,bytes,size,OLAF_DB_REMOTE_SEND_FLAGS);
+		if(written < 0 && errno == EINTR) continue;
+		if(written <= 0) return false;
+		bytes += written;
+		size -= (size_t) written;
+	}
+	return true;
+}
+
+static bool olaf_db_remote_read(int fd,void * data,size_t size){
+	char * bytes = (char *) data;
+	while(size > 0){
+		ssize_t read = recv(fd,bytes,size,0);
+		if(read < 0 && errno == EINTR) continue;
+		if(read <= 0) return false;
+		bytes += read;
+		size -= (size_t) read;
+	}
+	return true;
+}
+
+Olaf_DB_Remote * olaf_db_remote_new(const char * address){
+	Olaf_DB_Remote * remote = (Olaf_DB_Remote *) malloc(sizeof(Olaf_DB_Remote));
+	size_t address_len = strlen(address);
+	remote->address = (char *) malloc(address_len + 1);
+	memcpy(remote->address,address,address_len + 1);
+	remote->fd = -1;
+	remote->pending_keys = 0;
+	remote->error_given = false;
+	return remote;
+}
+
+static bool olaf_db_remote_connect(Olaf_DB_Remote * remote){
+	if(remote->fd >= 0) return true;
+
+	remote->fd = olaf_db_remote_socket(remote->address,false);
+	if(remote->fd < 0){
+		//report once, until the worker is reachable again
+		if(!remote->error_given){
+			fprintf(stderr,"Error: could not connect to shard worker '%s': %s\n",remote->address,strerror(errno));
+			remote->error_given = true;
+		}
+		return false;
+	}
+	olaf_db_remote_no_sigpipe(remote->fd);
+	remote->error_given = false;
+	return true;
+}
+
+//Close a broken connection, the next look-up connects again
+static void olaf_db_remote_disconnect(Olaf_DB_Remote * remote){
+	if(!remote->error_given){
+		fprintf(stderr,"Error: lost the connection to shard worker '%s'\n",remote->address);
+		remote->error_given = true;
+	}
+	if(remote->fd >= 0) close(remote->fd);
+	remote->fd = -1;
+	remote->pending_keys = 0;
+}
+
+//Read the values of an answer, the values which do not fit are dropped
+static bool olaf_db_remote_read_values(Olaf_DB_Remote * remote,uint64_t * results,size_t count,size_t room){
+	size_t kept = count < room ? count : room;
+	if(!olaf_db_remote_read(remote->fd,results,kept * sizeof(uint64_t))) return false;
+	uint64_t discard[OLAF_DB_REMOTE_DISCARD_SIZE];
+	for(size_t left = count - kept ; left > 0 ; ){
+		size_t block = left < OLAF_DB_REMOTE_DISCARD_SIZE ? left : OLAF_DB_REMOTE_DISCARD_SIZE;
+		if(!olaf_db_remote_read(remote->fd,discard,block * sizeof(uint64_t))) return false;
+		left -= block;
+	}
+	return true;
+}
+
+size_t olaf_db_remote_find(Olaf_DB_Remote * remote,uint64_t start_key,uint64_t stop_key,uint64_t * results,size_t results_size){
+	if(!olaf_db_remote_connect(remote)) return 0;
+
+	uint64_t header[OLAF_DB_REMOTE_HEADER_SIZE] = {OLAF_DB_REMOTE_FIND,start_key,stop_key,results_size,0};
+	uint64_t count;
+	if(!olaf_db_remote_write(remote->fd,header,sizeof(header)) || !olaf_db_remote_read(remote->fd,&count,sizeof(count)) ||
+		!olaf_db_remote_read_values(remote,results,count,results_size)){
+		olaf_db_remote_disconnect(remote);
+		return 0;
+	}
+	return count < results_size ? count : results_size;
+}
+
+bool olaf_db_remote_find_batch_send(Olaf_DB_Remote * remote,const uint64_t * keys,size_t keys_size,uint64_t range,size_t results_size,size_t max_results_per_key){
+	remote->pending_keys = 0;
+	if(keys_size == 0 || !olaf_db_remote_connect(remote)) return false;
+
+	uint64_t header[OLAF_DB_REMOTE_HEADER_SIZE] = {OLAF_DB_REMOTE_FIND_BATCH,keys_size,range,results_size,max_results_per_key};
+	if(!olaf_db_remote_write(remote->fd,header,sizeof(header)) || !olaf_db_remote_write(remote->fd,keys,keys_size * sizeof(uint64_t))){
+		olaf_db_remote_disconnect(remote);
+		return false;
+	}
+	remote->pending_keys = keys_size;
+	return true;
+}
+
+size_t olaf_db_remote_find_batch_receive(Olaf_DB_Remote * remote,uint64_t * results,size_t results_size,size_t * result_counts){
+	size_t keys_size = remote->pending_keys;
+	remote->pending_keys = 0;
+	if(keys_size == 0) return 0;
+
+	uint64_t found;
+	uint64_t * counts = (uint64_t *) malloc(keys_size * sizeof(uint64_t));
+	bool ok = olaf_db_remote_read(remote->fd,&found,sizeof(found)) && olaf_db_remote_read(remote->fd,counts,keys_size * sizeof(uint64_t));
+
+	//the counts are limited to the results which fit
+	size_t total = 0;
+	bool full = ok && found >= results_size;
+	for(size_t i = 0 ; ok && i < keys_size ; i++){
+		size_t room = results_size - total;
+		ok = olaf_db_remote_read_values(remote,results + total,counts[i],room);
+		if(counts[i] > room) full = true;
+		result_counts[i] = counts[i] < room ? counts[i] : room;
+		total += result_counts[i];
+	}
+	free(counts);
+
+	if(!ok){
+		memset(result_counts,0,keys_size * sizeof(size_t));
+		olaf_db_remote_disconnect(remote);
+		return 0;
+	}
+	return full ? results_size : total;
+}
+
+void olaf_db_remote_destroy(Olaf_DB_Remote * remote){
+	if(remote->fd >= 0) close(remote->fd);
+	free(remote->address);
+	free(remote);
+}
+
+//Answer the requests on a connection until it is closed
+static void * olaf_db_remote_serve_connection(void * arg){
+	struct olaf_db_remote_connection * connection = (struct olaf_db_remote_connection *) arg;
+	Olaf_DB_Remote_Server * server = connection->server;
+
+	size_t keys_capacity = 0;
+	size_t results_capacity = 0;
+	uint64_t * keys = NULL;
+	size_t * counts = NULL;
+	uint64_t * answer = NULL;
+	uint64_t * results = NULL;
+
+	uint64_t header[OLAF_DB_REMOTE_HEADER_SIZE];
+	while(olaf_db_remote_read(connection->fd,header,sizeof(header))){
+		//see fingerprints stored after the worker was started
+		olaf_db_renew(connection->reader);
+
+		size_t results_size = header[3];
+		size_t keys_size = header[0] == OLAF_DB_REMOTE_FIND_BATCH ? header[1] : 0;
+		if((header[0] != OLAF_DB_REMOTE_FIND && header[0] != OLAF_DB_REMOTE_FIND_BATCH) ||
+			keys_size > OLAF_DB_REMOTE_MAX_KEYS || results_size > OLAF_DB_REMOTE_MAX_RESULTS){
+			fprintf(stderr,"Shard worker: closed a connection with an invalid request\n");
+			break;
+		}
+
+		if(results_size > results_capacity){
+			results_capacity = results_size;
+			results = (uint64_t *) realloc(results,results_capacity * sizeof(uint64_t));
+		}
+
+		bool ok;
+		if(header[0] == OLAF_DB_REMOTE_FIND){
+			uint64_t count = olaf_db_find(connection->reader,header[1],header[2],results,results_size);
+			ok = olaf_db_remote_write(connection->fd,&count,sizeof(count)) &&
+				olaf_db_remote_write(connection->fd,results,count * sizeof(uint64_t));
+		}else{
+			if(keys_size > keys_capacity){
+				keys_capacity = keys_size;
+				keys = (uint64_t *) realloc(keys,keys_capacity * sizeof(uint64_t));
+				counts = (size_t *) realloc(counts,keys_capacity * sizeof(size_t));
+				answer = (uint64_t *) realloc(answer,(keys_capacity + 1) * sizeof(uint64_t));
+			}
+			ok = olaf_db_remote_read(connection->fd,keys,keys_size * sizeof(uint64_t));
+			if(!ok) break;
+
+			size_t found = olaf_db_find_batch(connection->reader,keys,keys_size,header[2],results,results_size,header[4],counts);
+
+			//the number of results, the counts of the keys and the results
+			size_t total = 0;
+			answer[0] = found;
+			for(size_t i = 0 ; i < keys_size ; i++){
+				answer[i + 1] = counts[i];
+				total += counts[i];
+			}
+			ok = olaf_db_remote_write(connection->fd,answer,(keys_size + 1) * sizeof(uint64_t)) &&
+				olaf_db_remote_write(connection->fd,results,total * sizeof(uint64_t));
+		}
+		if(!ok) break;
+	}
+
+	free(results);
+	free(answer);
+	free(counts);
+	free(keys);
+
+	//the reader is destroyed before the server, and the database, can see the connection closed
+	olaf_db_destroy(connection->reader);
+
+	//the connection is forgotten before it is closed
+	pthread_mutex_lock(&server->lock);
+	struct olaf_db_remote_connection ** link = &server->connections;
+	while(*link != connection) link = &(*link)->next;
+	*link = connection->next;
+	pthread_cond_signal(&server->closed);
+	pthread_mutex_unlock(&server->lock);
+
+	close(connection->fd);
+	free(connection);
+	return NULL;
+}
+
+static void * olaf_db_remote_accept(void * arg){
+	Olaf_DB_Remote_Server * server = (Olaf_DB_Remote_Server *) arg;
+
+	while(true){
+		int fd = accept(server->fd,NULL,NULL);
+
+		pthread_mutex_lock(&server->lock);
+		bool accepting = server->accepting;
+		pthread_mutex_unlock(&server->lock);
+		if(!accepting){
+			if(fd >= 0) close(fd);
+			break;
+		}
+
+		if(fd < 0){
+			if(errno == EINTR || errno == ECONNABORTED) continue;
+			fprintf(stderr,"Shard worker stopped accepting connections: %s\n",strerror(errno));
+			pthread_mutex_lock(&server->lock);
+			server->accepting = false;
+			pthread_cond_broadcast(&server->closed);
+			pthread_mutex_unlock(&server->lock);
+			break;
+		}
+		olaf_db_remote_no_sigpipe(fd);
+
+		//reader handles are created here, before their thread uses them
+		Olaf_DB * reader = olaf_db_new_reader(server->db);
+		if(reader == NULL){
+			close(fd);
+			continue;
+		}
+		struct olaf_db_remote_connection * connection = (struct olaf_db_remote_connection *) malloc(sizeof(struct olaf_db_remote_connection));
+		connection->server = server;
+		connection->reader = reader;
+		connection->fd = fd;
+
+		pthread_mutex_lock(&server->lock);
+		connection->next = server->connections;
+		server->connections = connection;
+		pthread_mutex_unlock(&server->lock);
+
+		pthread_t thread;
+		if(pthread_create(&thread,NULL,olaf_db_remote_serve_connection,connection) == 0){
+			pthread_detach(thread);
+		}else{
+			olaf_db_remote_serve_connection(connection);
+		}
+	}
+	return NULL;
+}
+
+Olaf_DB_Remote_Server * olaf_db_remote_server_new(Olaf_DB * db,const char * address){
+	int fd = olaf_db_remote_socket(address,true);
+	if(fd < 0){
+		fprintf(stderr,"Error: could not listen on '%s': %s\n",address,strerror(errno));
+		return NULL;
+	}
+
+	Olaf_DB_Remote_Server * server = (Olaf_DB_Remote_Server *) malloc(sizeof(Olaf_DB_Remote_Server));
+	size_t address_len = strlen(address);
+	server->address = (char *) malloc(address_len + 1);
+	memcpy(server->address,address,address_len + 1);
+	server->db = db;
+	server->fd = fd;
+	server->accepting = true;
+	server->connections = NULL;
+	pthread_mutex_init(&server->lock,NULL);
+	pthread_cond_init(&server->closed,NULL);
+
+	if(pthread_create(&server->accept_thread,NULL,olaf_db_remote_accept,server) != 0){
+		fprintf(stderr,"Error: could not start the shard worker on '%s'\n",address);
+		close(fd);
+		pthread_cond_destroy(&server->closed);
+		pthread_mutex_destroy(&server->lock);
+		free(server->address);
+		free(server);
+		return NULL;
+	}
+	return server;
+}
+
+void olaf_db_remote_server_wait(Olaf_DB_Remote_Server * server){
+	pthread_mutex_lock(&server->lock);
+	while(server->accepting) pthread_cond_wait(&server->closed,&server->lock);
+	pthread_mutex_unlock(&server->lock);
+}
+
+void olaf_db_remote_server_destroy(Olaf_DB_Remote_Server * server){
+	pthread_mutex_lock(&server->lock);
+	server->accepting = false;
+	pthread_cond_broadcast(&server->closed);
+	pthread_mutex_unlock(&server->lock);
+
+	//a connection wakes up the accepting thread, which then stops
+	int wake = olaf_db_remote_socket(server->address,false);
+	if(wake >= 0) close(wake);
+	pthread_join(server->accept_thread,NULL);
+	close(server->fd);
+
+	//the threads of open connections stop reading and close them
+	pthread_mutex_lock(&server->lock);
+	for(struct olaf_db_remote_connection * c = server->connections ; c != NULL ; c = c->next){
+		shutdown(c->fd,SHUT_RDWR);
+	}
+	while(server->connections != NULL) pthread_cond_wait(&server->closed,&server->lock);
+	pthread_mutex_unlock(&server->lock);
+
+	if(strncmp(server->address,"tcp:",4) != 0){
+		unlink(strncmp(server->address,"unix:",5) == 0 ? server->address + 5 : server->address);
+	}
+
+	pthread_cond_destroy(&server->closed);
+	pthread_mutex_destroy(&server->lock);
+	free(server->address);
+	free(server);
+}
+
+#else
+
+bool olaf_db_remote_is_address(const char * address){
+	//a worker address is used as a folder name
+	(void)(address);
+	return false;
+}
+
+Olaf_DB_Remote * olaf_db_remote_new(const char * address){
+	fprintf(stderr,"Error: shard worker '%s' can not be reached, remote shards are not supported on Windows\n",address);
+	return NULL;
+}
+
+size_t olaf_db_remote_find(Olaf_DB_Remote * remote,uint64_t start_key,uint64_t stop_key,uint64_t * results,size_t results_size){
+	(void)(remote);
+	(void)(start_key);
+	(void)(stop_key);
+	(void)(results);
+	(void)(results_size);
+	return 0;
+}
+
+bool olaf_db_remote_find_batch_send(Olaf_DB_Remote * remote,const uint64_t * keys,size_t keys_size,uint64_t range,size_t results_size,size_t max_results_per_key){
+	(void)(remote);
+	(void)(keys);
+	(void)(keys_size);
+	(void)(range);
+	(void)(results_size);
+	(void)(max_results_per_key);
+	return false;
+}
+
+size_t olaf_db_remote_find_batch_receive(Olaf_DB_Remote * remote,uint64_t * results,size_t results_size,size_t * result_counts){
+	(void)(remote);
+	(void)(results);
+	(void)(results_size);
+	(void)(result_counts);
+	return 0;
+}
+
+void olaf_db_remote_destroy(Olaf_DB_Remote * remote){
+	(void)(remote);
+}
+
+Olaf_DB_Remote_Server * olaf_db_remote_server_new(Olaf_DB * db,const char * address){
+	(void)(db);
+	fprintf(stderr,"Error: could not listen on '%s', shard workers are not supported on Windows\n",address);
+	return NULL;
+}
+
+void olaf_db_remote_server_wait(Olaf_DB_Remote_Server * server){
+	(void)(server);
+}
+
+void olaf_db_remote_server_destroy(Olaf_DB_Remote_Server * server){
+	(void)(server);
+}
+
+#endif
@@ -0,0 +1,134 @@
+// Olaf: Overly Lightweight Acoustic Fingerprinting
+// Copyright (C) 2019-2025  Joren Six
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/**
+ * @file olaf_db_remote.h
+ *
+ * @brief Fingerprint look-ups in a shard served by another process.
+ *
+ * A shard worker process keeps the index of a shard open and answers look-ups over a
+ * socket. A sharded database can list the address of a worker instead of a shard folder,
+ * see olaf_db_create_shards. A query then sends the hashes of each remote shard as a
+ * single batch: the requests to all workers are sent before the answers are read, so
+ * the workers search in parallel.
+ *
+ * An address is either `unix:/path/to/socket` or `tcp:host:port`. Both ends should run
+ * on the same architecture, the hashes and values are sent in the native byte order.
+ */
+
+#ifndef OLAF_DB_REMOTE_H
+#define OLAF_DB_REMOTE_H
+	#include <stdbool.h>
+	#include <stdint.h>
+	#include <stdlib.h>
+
+	#include "olaf_db.h"
+
+	/**
+	 * @struct Olaf_DB_Remote
+	 * @brief A connection to a shard worker.
+	 */
+	/** @typedef Olaf_DB_Remote
+	 *  @brief Typedef for struct Olaf_DB_Remote.
+	 */
+	typedef struct Olaf_DB_Remote Olaf_DB_Remote;
+
+	/**
+	 * @struct Olaf_DB_Remote_Server
+	 * @brief A shard worker: the listening socket and a thread for each connection.
+	 */
+	/** @typedef Olaf_DB_Remote_Server
+	 *  @brief Typedef for struct Olaf_DB_Remote_Server.
+	 */
+	typedef struct Olaf_DB_Remote_Server Olaf_DB_Remote_Server;
+
+	/**
+	 * @param address A shard folder or the address of a shard worker.
+	 * @return True if this is the address of a shard worker.
+	 */
+	bool olaf_db_remote_is_address(const char * address);
+
+	/**
+	 * Connect to a shard worker. A connection which fails or breaks is opened again
+	 * on the next look-up.
+	 * @param address The address of the worker.
+	 * @return A new connection, not usable by several threads at the same time.
+	 */
+	Olaf_DB_Remote * olaf_db_remote_new(const char * address);
+
+	/**
+	 * Find the values of the keys in a range, see olaf_db_find.
+	 * @param remote The connection.
+	 * @param start_key The first key of the range.
+	 * @param stop_key The last key of the range, inclusive.
+	 * @param results The found values.
+	 * @param results_size The maximum number of results.
+	 * @return The number of results, zero if the worker is unreachable.
+	 */
+	size_t olaf_db_remote_find(Olaf_DB_Remote * remote,uint64_t start_key,uint64_t stop_key,uint64_t * results,size_t results_size);
+
+	/**
+	 * Send a batch look-up without waiting for the answer, see olaf_db_find_batch.
+	 * The answer is read with olaf_db_remote_find_batch_receive.
+	 * @param remote The connection.
+	 * @param keys The fingerprint hashes to look up.
+	 * @param keys_size The number of keys.
+	 * @param range The search range around each key.
+	 * @param results_size The maximum number of results.
+	 * @param max_results_per_key The maximum number of results for a single key.
+	 * @return False if the worker is unreachable.
+	 */
+	bool olaf_db_remote_find_batch_send(Olaf_DB_Remote * remote,const uint64_t * keys,size_t keys_size,uint64_t range,size_t results_size,size_t max_results_per_key);
+
+	/**
+	 * Read the answer to the batch look-up sent last. Results which do not fit are dropped.
+	 * @param remote The connection.
+	 * @param results The found values, for each key in the order of the batch.
+	 * @param results_size The room in results.
+	 * @param result_counts The number of results of each key of the batch.
+	 * @return The number of results, results_size if the results are full.
+	 */
+	size_t olaf_db_remote_find_batch_receive(Olaf_DB_Remote * remote,uint64_t * results,size_t results_size,size_t * result_counts);
+
+	/**
+	 * Close the connection and free memory.
+	 * @param remote The connection.
+	 */
+	void olaf_db_remote_destroy(Olaf_DB_Remote * remote);
+
+	/**
+	 * Serve the look-ups of a database on an address. Each connection is handled by a thread
+	 * with its own reader handle, see olaf_db_new_reader. Fingerprints stored while the
+	 * worker runs are found by later look-ups.
+	 * @param db A database opened with olaf_db_new_live, destroyed after the server.
+	 * @param address The address to listen on. A path without prefix is a Unix socket.
+	 * @return A running server or NULL if the address can not be used.
+	 */
+	Olaf_DB_Remote_Server * olaf_db_remote_server_new(Olaf_DB * db,const char * address);
+
+	/**
+	 * Block until the server stops accepting connections.
+	 * @param server The server.
+	 */
+	void olaf_db_remote_server_wait(Olaf_DB_Remote_Server * server);
+
+	/**
+	 * Stop accepting connections, close the open connections and free memory.
+	 * @param server The server.
+	 */
+	void olaf_db_remote_server_destroy(Olaf_DB_Remote_Server * server);
+
+#endif // OLAF_DB_REMOTE_H
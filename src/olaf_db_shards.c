@@ -0,0 +1,677 @@
+// Olaf: Overly Lightweight Acoustic Fingerprinting
+// Copyright (C) 2019-2025  Joren Six
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "lmdb.h"
+#include "olaf_db.h"
+#include "olaf_db_remote.h"
+#include "olaf_db_shards.h"
+
+//The file in the database folder listing the folders of the shards, one per line
+#define OLAF_DB_SHARD_LAYOUT "olaf_shards"
+
+//Maximum number of shards and the maximum length of a shard folder
+#define OLAF_DB_MAX_SHARDS 256
+#define OLAF_DB_MAX_PATH 4096
+
+//Fingerprints are assigned to shards by their hash without its low bits: groups of
+//2^OLAF_DB_SHARD_GROUP_BITS consecutive hashes are kept in the same shard. The search range
+//around a hash then stays within one group, at most two.
+#define OLAF_DB_SHARD_GROUP_BITS 6
+
+//Ranges spanning more groups are looked up in every shard
+#define OLAF_DB_SHARD_MAX_GROUPS 64
+
+//Batches of at least this size are stored in or deleted from the shards in parallel,
+//the database writer stores batches of about 3000 fingerprints
+#define OLAF_DB_SHARD_PARALLEL_STORE (1<<11)
+
+//Look-up batches with at least this many keys search the local shards in parallel
+#define OLAF_DB_SHARD_PARALLEL_FIND 64
+
+struct Olaf_DB_Shards{
+	Olaf_DB ** shards; /**< The local shards, NULL for a remote shard. */
+	Olaf_DB_Remote ** remotes; /**< The connections to the remote shards, NULL for a local shard. */
+	char ** folders; /**< The folder or the worker address of each shard. */
+	size_t size; /**< The number of shards. */
+	bool readonly; /**< True when the shards are opened in read only mode. */
+	bool warning_given; /**< Whether the error about writing to a remote shard has been printed. */
+};
+
+//Work for a single shard, run on a thread of its own
+struct olaf_db_shard_task{
+	Olaf_DB * shard; /**< The shard, NULL for a remote shard */
+	uint64_t * keys; /**< The fingerprint hashes for the shard */
+	uint64_t * values; /**< The fingerprint values for the shard */
+	size_t size; /**< The number of fingerprints */
+	uint32_t audio_id; /**< The audio identifier of a resource to delete */
+	uint64_t range; /**< The search range around the keys of a look-up */
+	size_t results_size; /**< The room for the results of a look-up */
+	size_t max_results_per_key; /**< The maximum number of results per key of a look-up */
+	size_t * result_counts; /**< The number of results of each key of a look-up */
+	size_t result; /**< The result of the task */
+};
+
+static char * olaf_db_shards_copy(const char * folder){
+	size_t folder_len = strlen(folder);
+	char * copy = (char *) malloc(folder_len + 1);
+	memcpy(copy,folder,folder_len + 1);
+	return copy;
+}
+
+static Olaf_DB_Shards * olaf_db_shards_alloc(size_t size,bool readonly){
+	Olaf_DB_Shards * shards = (Olaf_DB_Shards *) malloc(sizeof(Olaf_DB_Shards));
+	shards->shards = (Olaf_DB **) calloc(size,sizeof(Olaf_DB *));
+	shards->remotes = (Olaf_DB_Remote **) calloc(size,sizeof(Olaf_DB_Remote *));
+	shards->folders = (char **) calloc(size,sizeof(char *));
+	shards->size = size;
+	shards->readonly = readonly;
+	shards->warning_given = false;
+	return shards;
+}
+
+//Read the shard folders of a database, returns the number of shards. The folders need to be freed.
+static size_t olaf_db_read_shard_layout(const char * db_folder,char ** shard_folders){
+	char * layout_path = olaf_db_path(db_folder,OLAF_DB_SHARD_LAYOUT);
+	FILE * layout = layout_path != NULL ? fopen(layout_path,"r") : NULL;
+	free(layout_path);
+	if(layout == NULL) return 0;
+
+	size_t shards = 0;
+	char line[OLAF_DB_MAX_PATH];
+	while(shards < OLAF_DB_MAX_SHARDS && fgets(line,OLAF_DB_MAX_PATH,layout) != NULL){
+		size_t len = strcspn(line,"\r\n");
+		if(len == 0) continue;
+		line[len] = '\0';
+		shard_folders[shards] = olaf_db_shards_copy(line);
+		shards++;
+	}
+	fclose(layout);
+	return shards;
+}
+
+Olaf_DB_Shards * olaf_db_shards_new(const char * db_folder,bool readonly,bool live){
+	char * shard_folders[OLAF_DB_MAX_SHARDS];
+	size_t size = olaf_db_read_shard_layout(db_folder,shard_folders);
+	if(size == 0) return NULL;
+
+	//The fingerprints of a remote shard can not be written: a store would lose them
+	for(size_t s = 0 ; s < size && !readonly ; s++){
+		if(olaf_db_remote_is_address(shard_folders[s])){
+			fprintf(stderr,"Database Error: the database in '%s' has a remote shard '%s' and can only be opened read only.\n",db_folder,shard_folders[s]);
+			fprintf(stderr,"  Hint: store or delete with the shard folders in the shard layout, then list the workers again.\n");
+			exit(-42);
+		}
+	}
+
+	Olaf_DB_Shards * shards = olaf_db_shards_alloc(size,readonly);
+	for(size_t s = 0 ; s < size ; s++){
+		shards->folders[s] = shard_folders[s];
+		if(olaf_db_remote_is_address(shard_folders[s])){
+			shards->remotes[s] = olaf_db_remote_new(shard_folders[s]);
+		}else{
+			shards->shards[s] = olaf_db_open_shard(shard_folders[s],readonly,live);
+		}
+	}
+	return shards;
+}
+
+bool olaf_db_create_shards(const char * db_folder,const char ** shard_folders,size_t shards){
+	if(shards == 0 || shards > OLAF_DB_MAX_SHARDS){
+		fprintf(stderr,"Error: the number of shards should be between 1 and %d, not %zu.\n",OLAF_DB_MAX_SHARDS,shards);
+		return false;
+	}
+
+	//The fingerprints are routed by the number of shards: the shards of an existing
+	//layout can be moved or served by workers, but not added or removed
+	char * existing[OLAF_DB_MAX_SHARDS];
+	size_t existing_shards = olaf_db_read_shard_layout(db_folder,existing);
+	bool moved = false;
+	if(existing_shards > 0){
+		bool same_size = existing_shards == shards;
+		for(size_t s = 0 ; s < existing_shards ; s++){
+			if(same_size && strcmp(existing[s],shard_folders[s]) != 0) moved = true;
+			free(existing[s]);
+		}
+		if(!same_size){
+			fprintf(stderr,"Error: the database in '%s' is already divided over %zu shards.\n",db_folder,existing_shards);
+		}
+		if(!same_size || !moved) return same_size;
+	}
+
+	//the fingerprints of an existing index are not redistributed, only the index
+	//in the database folder itself is opened
+	if(olaf_db_exists(db_folder)){
+		Olaf_DB * olaf_db = olaf_db_open_shard(db_folder,true,false);
+		struct olaf_db_index_stats stats;
+		memset(&stats,0,sizeof(stats));
+		int err = olaf_db_index_stats(olaf_db,&stats);
+		olaf_db_destroy(olaf_db);
+		if(err != MDB_SUCCESS || stats.entries != 0){
+			fprintf(stderr,"Error: the database in '%s' already contains fingerprints, it can not be divided over shards.\n",db_folder);
+			return false;
+		}
+	}
+
+	char * layout_path = olaf_db_path(db_folder,OLAF_DB_SHARD_LAYOUT);
+	FILE * layout = layout_path != NULL ? fopen(layout_path,"w") : NULL;
+	free(layout_path);
+	if(layout == NULL){
+		fprintf(stderr,"Error: could not write the shard layout in '%s'.\n",db_folder);
+		return false;
+	}
+	for(size_t s = 0 ; s < shards ; s++){
+		fprintf(layout,"%s\n",shard_folders[s]);
+	}
+	fclose(layout);
+	return true;
+}
+
+size_t olaf_db_shards_count(const Olaf_DB_Shards * shards){
+	return shards->size;
+}
+
+//The shard of a group of hashes: Fibonacci hashing spreads neighbouring groups over the shards
+static size_t olaf_db_shard_of_group(const Olaf_DB_Shards * shards,uint64_t group){
+	return (size_t) (((group * UINT64_C(0x9E3779B97F4A7C15)) >> 32) % shards->size);
+}
+
+static size_t olaf_db_shard_of_key(const Olaf_DB_Shards * shards,uint64_t key){
+	return olaf_db_shard_of_group(shards,key >> OLAF_DB_SHARD_GROUP_BITS);
+}
+
+//The shards holding the keys of [start_key, stop_key]. For a narrow range they are listed
+//in key order, a wide range is looked up in all shards.
+static size_t olaf_db_shards_of_range(const Olaf_DB_Shards * shards,uint64_t start_key,uint64_t stop_key,size_t * range_shards){
+	uint64_t first_group = start_key >> OLAF_DB_SHARD_GROUP_BITS;
+	uint64_t last_group = stop_key >> OLAF_DB_SHARD_GROUP_BITS;
+
+	if(last_group - first_group >= OLAF_DB_SHARD_MAX_GROUPS){
+		for(size_t s = 0 ; s < shards->size ; s++) range_shards[s] = s;
+		return shards->size;
+	}
+
+	size_t number_of_shards = 0;
+	for(uint64_t group = first_group ; group <= last_group ; group++){
+		size_t shard = olaf_db_shard_of_group(shards,group);
+		bool listed = false;
+		for(size_t i = 0 ; i < number_of_shards && !listed ; i++) listed = range_shards[i] == shard;
+		if(!listed) range_shards[number_of_shards++] = shard;
+	}
+	return number_of_shards;
+}
+
+//Split a batch over the shards: the pairs of shard s end up between offsets[s] and offsets[s+1]
+static void olaf_db_shards_partition(const Olaf_DB_Shards * shards,const uint64_t * keys,const uint64_t * values,size_t size,uint64_t * shard_keys,uint64_t * shard_values,size_t * offsets){
+	memset(offsets,0,(shards->size + 1) * sizeof(size_t));
+	for(size_t i = 0 ; i < size ; i++){
+		offsets[olaf_db_shard_of_key(shards,keys[i]) + 1]++;
+	}
+	for(size_t s = 0 ; s < shards->size ; s++){
+		offsets[s + 1] += offsets[s];
+	}
+
+	size_t * fill = (size_t *) malloc(shards->size * sizeof(size_t));
+	memcpy(fill,offsets,shards->size * sizeof(size_t));
+	for(size_t i = 0 ; i < size ; i++){
+		size_t target = fill[olaf_db_shard_of_key(shards,keys[i])]++;
+		shard_keys[target] = keys[i];
+		shard_values[target] = values[i];
+	}
+	free(fill);
+}
+
+//Run a task for each shard. The shards are independent environments, each with
+//its own transaction, so the tasks run in parallel.
+static void olaf_db_shards_run(struct olaf_db_shard_task * tasks,size_t size,void * (*task)(void *)){
+	pthread_t * threads = (pthread_t *) malloc(size * sizeof(pthread_t));
+	bool * started = (bool *) malloc(size * sizeof(bool));
+	for(size_t s = 0 ; s < size ; s++){
+		started[s] = pthread_create(&threads[s],NULL,task,&tasks[s]) == 0;
+		//without a thread the task runs here
+		if(!started[s]) task(&tasks[s]);
+	}
+	for(size_t s = 0 ; s < size ; s++){
+		if(started[s]) pthread_join(threads[s],NULL);
+	}
+	free(started);
+	free(threads);
+}
+
+//A task for each local shard, the number of local shards is stored in local
+static struct olaf_db_shard_task * olaf_db_shards_tasks(Olaf_DB_Shards * shards,size_t * local){
+	struct olaf_db_shard_task * tasks = (struct olaf_db_shard_task *) calloc(shards->size,sizeof(struct olaf_db_shard_task));
+	*local = 0;
+	for(size_t s = 0 ; s < shards->size ; s++){
+		if(shards->shards[s] != NULL) tasks[(*local)++].shard = shards->shards[s];
+	}
+	return tasks;
+}
+
+static void * olaf_db_shard_flush_task(void * arg){
+	struct olaf_db_shard_task * task = (struct olaf_db_shard_task *) arg;
+	olaf_db_bulk_load_flush(task->shard);
+	return NULL;
+}
+
+//Sort and append the bulk loads of the shards in parallel
+static void olaf_db_shards_flush(Olaf_DB_Shards * shards){
+	bool bulk_load = false;
+	for(size_t s = 0 ; s < shards->size ; s++){
+		bulk_load = bulk_load || (shards->shards[s] != NULL && olaf_db_is_bulk_load(shards->shards[s]));
+	}
+	if(!bulk_load) return;
+
+	size_t local;
+	struct olaf_db_shard_task * tasks = olaf_db_shards_tasks(shards,&local);
+	olaf_db_shards_run(tasks,local,olaf_db_shard_flush_task);
+	free(tasks);
+}
+
+bool olaf_db_shards_start_bulk_load(Olaf_DB_Shards * shards){
+	bool bulk_load = true;
+	for(size_t s = 0 ; s < shards->size ; s++){
+		bulk_load = shards->shards[s] != NULL && olaf_db_start_bulk_load(shards->shards[s]) && bulk_load;
+	}
+	return bulk_load;
+}
+
+static void * olaf_db_shard_store_task(void * arg){
+	struct olaf_db_shard_task * task = (struct olaf_db_shard_task *) arg;
+	olaf_db_store(task->shard,task->keys,task->values,task->size);
+	return NULL;
+}
+
+static void * olaf_db_shard_delete_task(void * arg){
+	struct olaf_db_shard_task * task = (struct olaf_db_shard_task *) arg;
+	olaf_db_delete(task->shard,task->keys,task->values,task->size);
+	return NULL;
+}
+
+//Store or delete each part of a batch in its shard, a large batch in parallel
+static void olaf_db_shards_apply(Olaf_DB_Shards * shards,uint64_t * keys,uint64_t * values, size_t size,void * (*task)(void *)){
+	uint64_t * buffer = (uint64_t *) malloc(2 * size * sizeof(uint64_t));
+	size_t * offsets = (size_t *) malloc((shards->size + 1) * sizeof(size_t));
+	olaf_db_shards_partition(shards,keys,values,size,buffer,buffer + size,offsets);
+
+	//a database with remote shards is opened read only, see olaf_db_shards_new
+	size_t local = 0;
+	struct olaf_db_shard_task * tasks = (struct olaf_db_shard_task *) calloc(shards->size,sizeof(struct olaf_db_shard_task));
+	for(size_t s = 0 ; s < shards->size ; s++){
+		if(shards->shards[s] == NULL){
+			if(offsets[s + 1] > offsets[s] && !shards->warning_given){
+				shards->warning_given = true;
+				fprintf(stderr,"Error: fingerprints can not be stored in or deleted from remote shard '%s'\n",shards->folders[s]);
+			}
+			continue;
+		}
+		tasks[local].shard = shards->shards[s];
+		tasks[local].keys = buffer + offsets[s];
+		tasks[local].values = buffer + size + offsets[s];
+		tasks[local].size = offsets[s + 1] - offsets[s];
+		local++;
+	}
+
+	//in bulk load mode a store only buffers the fingerprints
+	if(size >= OLAF_DB_SHARD_PARALLEL_STORE && local > 0 && !olaf_db_is_bulk_load(tasks[0].shard)){
+		olaf_db_shards_run(tasks,local,task);
+	}else{
+		for(size_t l = 0 ; l < local ; l++){
+			if(tasks[l].size > 0) task(&tasks[l]);
+		}
+	}
+
+	free(tasks);
+	free(offsets);
+	free(buffer);
+}
+
+void olaf_db_shards_store(Olaf_DB_Shards * shards,uint64_t * keys,uint64_t * values,size_t size){
+	olaf_db_shards_apply(shards,keys,values,size,olaf_db_shard_store_task);
+}
+
+void olaf_db_shards_delete(Olaf_DB_Shards * shards,uint64_t * keys,uint64_t * values,size_t size){
+	olaf_db_shards_apply(shards,keys,values,size,olaf_db_shard_delete_task);
+}
+
+bool olaf_db_shards_enable_resource_index(Olaf_DB_Shards * shards){
+	//each shard keeps the postings of its own fingerprints
+	bool resource_index = true;
+	for(size_t s = 0 ; s < shards->size ; s++){
+		resource_index = shards->shards[s] != NULL && olaf_db_enable_resource_index(shards->shards[s]) && resource_index;
+	}
+	return resource_index;
+}
+
+static void * olaf_db_shard_merge_blocks_task(void * arg){
+	struct olaf_db_shard_task * task = (struct olaf_db_shard_task *) arg;
+	task->result = olaf_db_merge_blocks(task->shard) ? 1 : 0;
+	return NULL;
+}
+
+bool olaf_db_shards_merge_blocks(Olaf_DB_Shards * shards){
+	//the local shards are merged in parallel, a worker merges its own shard
+	for(size_t s = 0 ; s < shards->size ; s++){
+		if(shards->remotes[s] != NULL){
+			fprintf(stderr,"Remote shard '%s' is not merged, merge it where the worker runs\n",shards->folders[s]);
+		}
+	}
+
+	size_t local;
+	struct olaf_db_shard_task * tasks = olaf_db_shards_tasks(shards,&local);
+	olaf_db_shards_run(tasks,local,olaf_db_shard_merge_blocks_task);
+
+	bool merged = true;
+	for(size_t l = 0 ; l < local ; l++) merged = merged && tasks[l].result == 1;
+	free(tasks);
+	return merged;
+}
+
+static void * olaf_db_shard_delete_resource_task(void * arg){
+	struct olaf_db_shard_task * task = (struct olaf_db_shard_task *) arg;
+	task->result = olaf_db_delete_resource(task->shard,task->audio_id);
+	return NULL;
+}
+
+size_t olaf_db_shards_delete_resource(Olaf_DB_Shards * shards,uint32_t audio_id){
+	size_t local;
+	struct olaf_db_shard_task * tasks = olaf_db_shards_tasks(shards,&local);
+	for(size_t l = 0 ; l < local ; l++) tasks[l].audio_id = audio_id;
+	olaf_db_shards_run(tasks,local,olaf_db_shard_delete_resource_task);
+
+	size_t number_of_deleted = 0;
+	for(size_t l = 0 ; l < local ; l++) number_of_deleted += tasks[l].result;
+	free(tasks);
+	return number_of_deleted;
+}
+
+//Look up a range in a single local or remote shard
+static size_t olaf_db_shard_find(Olaf_DB_Shards * shards,size_t s,uint64_t start_key,uint64_t stop_key,uint64_t * results,size_t results_size){
+	if(shards->remotes[s] != NULL){
+		return olaf_db_remote_find(shards->remotes[s],start_key,stop_key,results,results_size);
+	}
+	return olaf_db_find(shards->shards[s],start_key,stop_key,results,results_size);
+}
+
+//Look up a narrow range group by group, in key order. A wide range is looked up
+//in each shard, its results are then ordered per shard.
+size_t olaf_db_shards_find(Olaf_DB_Shards * shards,uint64_t start_key,uint64_t stop_key,uint64_t * results,size_t results_size){
+	uint64_t first_group = start_key >> OLAF_DB_SHARD_GROUP_BITS;
+	uint64_t last_group = stop_key >> OLAF_DB_SHARD_GROUP_BITS;
+	size_t number_of_results = 0;
+
+	olaf_db_shards_flush(shards);
+
+	if(stop_key < start_key) return 0;
+
+	if(last_group - first_group >= OLAF_DB_SHARD_MAX_GROUPS){
+		for(size_t s = 0 ; s < shards->size && number_of_results < results_size ; s++){
+			number_of_results += olaf_db_shard_find(shards,s,start_key,stop_key,results + number_of_results,results_size - number_of_results);
+		}
+		return number_of_results;
+	}
+
+	for(uint64_t group = first_group ; group <= last_group && number_of_results < results_size ; group++){
+		uint64_t start = group == first_group ? start_key : group << OLAF_DB_SHARD_GROUP_BITS;
+		uint64_t stop = group == last_group ? stop_key : ((group + 1) << OLAF_DB_SHARD_GROUP_BITS) - 1;
+		size_t s = olaf_db_shard_of_group(shards,group);
+		number_of_results += olaf_db_shard_find(shards,s,start,stop,results + number_of_results,results_size - number_of_results);
+	}
+	return number_of_results;
+}
+
+static void * olaf_db_shard_find_batch_task(void * arg){
+	struct olaf_db_shard_task * task = (struct olaf_db_shard_task *) arg;
+	task->result = olaf_db_find_batch(task->shard,task->keys,task->size,task->range,task->values,task->results_size,task->max_results_per_key,task->result_counts);
+	return NULL;
+}
+
+//Fan a batch out over the shards: each shard gets a batch of the keys with a search range
+//in one of its groups of hashes. The results of the shards are then gathered per key.
+size_t olaf_db_shards_find_batch(Olaf_DB_Shards * shards,const uint64_t * keys,size_t keys_size,uint64_t range,uint64_t * results,size_t results_size,size_t max_results_per_key,size_t * result_counts){
+	size_t number_of_shards = shards->size;
+
+	olaf_db_shards_flush(shards);
+
+	//the shards of each key, usually a single one
+	size_t * key_offsets = (size_t *) malloc((keys_size + 1) * sizeof(size_t));
+	size_t entries_capacity = keys_size + number_of_shards;
+	size_t * entry_shards = (size_t *) malloc(entries_capacity * sizeof(size_t));
+	size_t entries = 0;
+	for(size_t i = 0 ; i < keys_size ; i++){
+		if(entries + number_of_shards > entries_capacity){
+			entries_capacity = 2 * entries_capacity;
+			entry_shards = (size_t *) realloc(entry_shards,entries_capacity * sizeof(size_t));
+		}
+		uint64_t start = keys[i] >= range ? keys[i] - range : 0;
+		uint64_t stop = keys[i] <= UINT64_MAX - range ? keys[i] + range : UINT64_MAX;
+		key_offsets[i] = entries;
+		entries += olaf_db_shards_of_range(shards,start,stop,entry_shards + entries);
+	}
+	key_offsets[keys_size] = entries;
+
+	//the batch of each shard
+	size_t * shard_offsets = (size_t *) calloc(number_of_shards + 1,sizeof(size_t));
+	for(size_t j = 0 ; j < entries ; j++) shard_offsets[entry_shards[j] + 1]++;
+	for(size_t s = 0 ; s < number_of_shards ; s++) shard_offsets[s + 1] += shard_offsets[s];
+
+	size_t * fill = (size_t *) malloc(number_of_shards * sizeof(size_t));
+	memcpy(fill,shard_offsets,number_of_shards * sizeof(size_t));
+	uint64_t * shard_keys = (uint64_t *) malloc((entries + 1) * sizeof(uint64_t));
+	size_t * entry_positions = (size_t *) malloc((entries + 1) * sizeof(size_t));
+	for(size_t i = 0 ; i < keys_size ; i++){
+		for(size_t j = key_offsets[i] ; j < key_offsets[i + 1] ; j++){
+			size_t position = fill[entry_shards[j]]++;
+			shard_keys[position] = keys[i];
+			entry_positions[j] = position;
+		}
+	}
+
+	//each shard has room for all results of its batch, at most results_size
+	size_t * room_offsets = (size_t *) malloc((number_of_shards + 1) * sizeof(size_t));
+	room_offsets[0] = 0;
+	for(size_t s = 0 ; s < number_of_shards ; s++){
+		size_t size = shard_offsets[s + 1] - shard_offsets[s];
+		size_t room = max_results_per_key > 0 && size > results_size / max_results_per_key ? results_size : size * max_results_per_key;
+		room_offsets[s + 1] = room_offsets[s] + room;
+	}
+
+	size_t * shard_counts = (size_t *) calloc(entries + 1,sizeof(size_t));
+	uint64_t * shard_results = (uint64_t *) malloc((room_offsets[number_of_shards] + 1) * sizeof(uint64_t));
+	struct olaf_db_shard_task * tasks = (struct olaf_db_shard_task *) calloc(number_of_shards,sizeof(struct olaf_db_shard_task));
+	for(size_t s = 0 ; s < number_of_shards ; s++){
+		tasks[s].shard = shards->shards[s];
+		tasks[s].keys = shard_keys + shard_offsets[s];
+		tasks[s].size = shard_offsets[s + 1] - shard_offsets[s];
+		tasks[s].values = shard_results + room_offsets[s];
+		tasks[s].results_size = room_offsets[s + 1] - room_offsets[s];
+		tasks[s].range = range;
+		tasks[s].max_results_per_key = max_results_per_key;
+		tasks[s].result_counts = shard_counts + shard_offsets[s];
+	}
+
+	//The batches of remote shards are sent first: the workers search them while the
+	//local shards are searched
+	size_t local = 0;
+	struct olaf_db_shard_task * local_tasks = (struct olaf_db_shard_task *) malloc(number_of_shards * sizeof(struct olaf_db_shard_task));
+	for(size_t s = 0 ; s < number_of_shards ; s++){
+		if(tasks[s].size == 0) continue;
+		if(shards->remotes[s] == NULL){
+			local_tasks[local++] = tasks[s];
+			continue;
+		}
+		olaf_db_remote_find_batch_send(shards->remotes[s],tasks[s].keys,tasks[s].size,range,tasks[s].results_size,max_results_per_key);
+	}
+
+	//a large batch searches the local shards in parallel
+	if(local > 1 && keys_size >= OLAF_DB_SHARD_PARALLEL_FIND){
+		olaf_db_shards_run(local_tasks,local,olaf_db_shard_find_batch_task);
+	}else{
+		for(size_t l = 0 ; l < local ; l++) olaf_db_shard_find_batch_task(&local_tasks[l]);
+	}
+
+	//a shard which fills all of results_size might have dropped results
+	bool full = false;
+	for(size_t l = 0 ; l < local ; l++){
+		full = full || (local_tasks[l].result == local_tasks[l].results_size && local_tasks[l].results_size == results_size);
+	}
+	for(size_t s = 0 ; s < number_of_shards ; s++){
+		if(tasks[s].size == 0 || shards->remotes[s] == NULL) continue;
+		size_t found = olaf_db_remote_find_batch_receive(shards->remotes[s],tasks[s].values,tasks[s].results_size,tasks[s].result_counts);
+		full = full || (found == tasks[s].results_size && tasks[s].results_size == results_size);
+	}
+	free(local_tasks);
+	free(tasks);
+
+	//the results of each shard are in the order of its batch
+	free(fill);
+	size_t * result_offsets = (size_t *) malloc((entries + 1) * sizeof(size_t));
+	for(size_t s = 0 ; s < number_of_shards ; s++){
+		size_t offset = room_offsets[s];
+		for(size_t position = shard_offsets[s] ; position < shard_offsets[s + 1] ; position++){
+			result_offsets[position] = offset;
+			offset += shard_counts[position];
+		}
+	}
+
+	size_t total = 0;
+	for(size_t i = 0 ; i < keys_size ; i++){
+		result_counts[i] = 0;
+		for(size_t j = key_offsets[i] ; j < key_offsets[i + 1] ; j++){
+			size_t position = entry_positions[j];
+			size_t count = shard_counts[position];
+			if(result_counts[i] + count > max_results_per_key) count = max_results_per_key - result_counts[i];
+			if(total + count > results_size){
+				count = results_size - total;
+				full = true;
+			}
+			memcpy(results + total,shard_results + result_offsets[position],count * sizeof(uint64_t));
+			result_counts[i] += count;
+			total += count;
+		}
+	}
+
+	free(result_offsets);
+	free(room_offsets);
+	free(shard_results);
+	free(shard_counts);
+	free(entry_positions);
+	free(shard_keys);
+	free(shard_offsets);
+	free(entry_shards);
+	free(key_offsets);
+
+	//a full results array is reported as such, even if a few results were dropped while
+	//combining the shards, so the caller can retry with more room
+	return full ? results_size : total;
+}
+
+size_t olaf_db_shards_size(Olaf_DB_Shards * shards){
+	size_t size = 0;
+	for(size_t s = 0 ; s < shards->size ; s++){
+		if(shards->shards[s] != NULL) size += olaf_db_size(shards->shards[s]);
+	}
+	return size;
+}
+
+int olaf_db_shards_index_stats(Olaf_DB_Shards * shards,bool verbose,struct olaf_db_index_stats * stats,size_t * remote_shards){
+	olaf_db_shards_flush(shards);
+
+	if(verbose){
+		for(size_t s = 0 ; s < shards->size ; s++){
+			if(shards->shards[s] != NULL) olaf_db_stats_verbose(shards->shards[s]);
+		}
+	}
+
+	int err = MDB_SUCCESS;
+	for(size_t s = 0 ; s < shards->size && err == MDB_SUCCESS ; s++){
+		if(shards->shards[s] == NULL){
+			(*remote_shards)++;
+			continue;
+		}
+		err = olaf_db_index_stats(shards->shards[s],stats);
+	}
+	return err;
+}
+
+bool olaf_db_shards_export_flat(Olaf_DB_Shards * shards){
+	//each local shard has a flat index of its own
+	bool exported = true;
+	for(size_t s = 0 ; s < shards->size ; s++){
+		if(shards->shards[s] == NULL){
+			fprintf(stderr,"Remote shard '%s' is not exported, export it where the worker runs\n",shards->folders[s]);
+			continue;
+		}
+		exported = olaf_db_export_flat(shards->shards[s]) && exported;
+	}
+	return exported;
+}
+
+Olaf_DB_Shards * olaf_db_shards_new_reader(Olaf_DB_Shards * shards){
+	Olaf_DB_Shards * readers = olaf_db_shards_alloc(shards->size,true);
+	for(size_t s = 0 ; s < shards->size ; s++){
+		readers->folders[s] = olaf_db_shards_copy(shards->folders[s]);
+		//a connection of its own to the worker
+		if(shards->remotes[s] != NULL){
+			readers->remotes[s] = olaf_db_remote_new(shards->folders[s]);
+			continue;
+		}
+		readers->shards[s] = olaf_db_new_reader(shards->shards[s]);
+		if(readers->shards[s] == NULL){
+			olaf_db_shards_destroy(readers);
+			return NULL;
+		}
+	}
+	return readers;
+}
+
+void olaf_db_shards_renew(Olaf_DB_Shards * shards){
+	//a worker renews its own snapshot
+	for(size_t s = 0 ; s < shards->size ; s++){
+		if(shards->shards[s] != NULL) olaf_db_renew(shards->shards[s]);
+	}
+}
+
+static void * olaf_db_shard_finish_task(void * arg){
+	struct olaf_db_shard_task * task = (struct olaf_db_shard_task *) arg;
+	olaf_db_finish(task->shard);
+	return NULL;
+}
+
+void olaf_db_shards_destroy(Olaf_DB_Shards * shards){
+	//the bulk loads of writable shards are built in parallel
+	if(!shards->readonly){
+		size_t local;
+		struct olaf_db_shard_task * tasks = olaf_db_shards_tasks(shards,&local);
+		olaf_db_shards_run(tasks,local,olaf_db_shard_finish_task);
+		free(tasks);
+	}
+
+	for(size_t s = 0 ; s < shards->size ; s++){
+		if(shards->shards[s] != NULL) olaf_db_destroy(shards->shards[s]);
+		if(shards->remotes[s] != NULL) olaf_db_remote_destroy(shards->remotes[s]);
+		free(shards->folders[s]);
+	}
+	free(shards->folders);
+	free(shards->remotes);
+	free(shards->shards);
+	free(shards);
+}
@@ -0,0 +1,197 @@
+// Olaf: Overly Lightweight Acoustic Fingerprinting
+// Copyright (C) 2019-2025  Joren Six
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/**
+ * @file olaf_db_shards.h
+ *
+ * @brief The shards of a sharded database, only used by olaf_db.c.
+ *
+ * A sharded database keeps its meta data in its own folder and its fingerprints in the
+ * shards listed in its shard layout, see olaf_db_create_shards. Each local shard is an
+ * Olaf_DB of its own, a remote shard is a connection to a worker, see olaf_db_remote.h.
+ * The functions here route fingerprints to the shards and run the work of each shard on
+ * a thread of its own. The second part lists the few functions of olaf_db.c they use
+ * besides the public API.
+ */
+
+#ifndef OLAF_DB_SHARDS_H
+#define OLAF_DB_SHARDS_H
+	#include <stdbool.h>
+	#include <stdint.h>
+	#include <stdlib.h>
+
+	#include "olaf_db.h"
+
+	/**
+	 * @struct Olaf_DB_Shards
+	 * @brief The local and remote shards of a database.
+	 */
+	/** @typedef Olaf_DB_Shards
+	 *  @brief Typedef for struct Olaf_DB_Shards.
+	 */
+	typedef struct Olaf_DB_Shards Olaf_DB_Shards;
+
+	/**
+	 * @brief Statistics of the fingerprint index of a database or its shards.
+	 */
+	struct olaf_db_index_stats{
+		size_t entries; /**< The number of fingerprints. */
+		size_t resource_entries; /**< The number of postings in the resource index. */
+		size_t blocks; /**< The number of posting blocks. */
+		size_t flat_size; /**< The size of the flat index in use, in bytes. */
+		unsigned int depth; /**< The depth of the deepest B-tree. */
+		bool resource_index; /**< True if the resource index is maintained. */
+	};
+
+	/**
+	 * Open the shards listed in the shard layout of a database. A database with a remote
+	 * shard can only be opened read only, otherwise the process stops with an error.
+	 * @param db_folder The database folder.
+	 * @param readonly Open the shards read only.
+	 * @param live Open the shards with olaf_db_open_shard as live databases.
+	 * @return The shards, NULL if the database is not divided over shards.
+	 */
+	Olaf_DB_Shards * olaf_db_shards_new(const char * db_folder,bool readonly,bool live);
+
+	/**
+	 * @param shards The shards of a read only database.
+	 * @return A reader handle of each shard, see olaf_db_new_reader, NULL if one is not available.
+	 */
+	Olaf_DB_Shards * olaf_db_shards_new_reader(Olaf_DB_Shards * shards);
+
+	/**
+	 * @param shards The shards.
+	 * @return The number of shards.
+	 */
+	size_t olaf_db_shards_count(const Olaf_DB_Shards * shards);
+
+	/** See olaf_db_start_bulk_load. */
+	bool olaf_db_shards_start_bulk_load(Olaf_DB_Shards * shards);
+
+	/** See olaf_db_store, a large batch is stored in the shards in parallel. */
+	void olaf_db_shards_store(Olaf_DB_Shards * shards,uint64_t * keys,uint64_t * values,size_t size);
+
+	/** See olaf_db_delete, a large batch is deleted from the shards in parallel. */
+	void olaf_db_shards_delete(Olaf_DB_Shards * shards,uint64_t * keys,uint64_t * values,size_t size);
+
+	/** See olaf_db_enable_resource_index. */
+	bool olaf_db_shards_enable_resource_index(Olaf_DB_Shards * shards);
+
+	/** See olaf_db_merge_blocks, the local shards are merged in parallel. */
+	bool olaf_db_shards_merge_blocks(Olaf_DB_Shards * shards);
+
+	/** See olaf_db_delete_resource. */
+	size_t olaf_db_shards_delete_resource(Olaf_DB_Shards * shards,uint32_t audio_id);
+
+	/** See olaf_db_find. */
+	size_t olaf_db_shards_find(Olaf_DB_Shards * shards,uint64_t start_key,uint64_t stop_key,uint64_t * results,size_t results_size);
+
+	/** See olaf_db_find_batch. */
+	size_t olaf_db_shards_find_batch(Olaf_DB_Shards * shards,const uint64_t * keys,size_t keys_size,uint64_t range,uint64_t * results,size_t results_size,size_t max_results_per_key,size_t * result_counts);
+
+	/**
+	 * @param shards The shards.
+	 * @return The size of the files of the local shards, in bytes.
+	 */
+	size_t olaf_db_shards_size(Olaf_DB_Shards * shards);
+
+	/**
+	 * Add the statistics of the fingerprint indexes of the local shards.
+	 * @param shards The shards.
+	 * @param verbose Print each fingerprint of the local shards.
+	 * @param stats The statistics to add to.
+	 * @param remote_shards The number of remote shards, which are not counted.
+	 * @return MDB_SUCCESS or the LMDB error.
+	 */
+	int olaf_db_shards_index_stats(Olaf_DB_Shards * shards,bool verbose,struct olaf_db_index_stats * stats,size_t * remote_shards);
+
+	/** See olaf_db_export_flat, each local shard has a flat index of its own. */
+	bool olaf_db_shards_export_flat(Olaf_DB_Shards * shards);
+
+	/** See olaf_db_renew. */
+	void olaf_db_shards_renew(Olaf_DB_Shards * shards);
+
+	/**
+	 * Close the shards. The writes of writable shards are completed in parallel, their
+	 * transactions are committed by the calling thread, which started them.
+	 * @param shards The shards.
+	 */
+	void olaf_db_shards_destroy(Olaf_DB_Shards * shards);
+
+	//Defined in olaf_db.c
+
+	/**
+	 * @param folder A folder.
+	 * @param file_name A file name.
+	 * @return The path of the file in the folder, it needs to be freed.
+	 */
+	char * olaf_db_path(const char * folder,const char * file_name);
+
+	/**
+	 * @param mdb_folder A folder.
+	 * @return True if the folder contains a database.
+	 */
+	bool olaf_db_exists(const char * mdb_folder);
+
+	/**
+	 * Open a local shard. It is only written through the database it belongs to, which
+	 * holds the writer lock. A missing shard of a live database is created.
+	 * @param shard_folder The shard folder, copied.
+	 * @param readonly Open the shard read only.
+	 * @param live Open the shard as a live database, see olaf_db_new_live.
+	 * @return The shard.
+	 */
+	Olaf_DB * olaf_db_open_shard(const char * shard_folder,bool readonly,bool live);
+
+	/**
+	 * @param olaf_db A database.
+	 * @return True if fingerprints are buffered in bulk load mode.
+	 */
+	bool olaf_db_is_bulk_load(const Olaf_DB * olaf_db);
+
+	/**
+	 * Sort and append the buffered fingerprints of a bulk load, see olaf_db_start_bulk_load.
+	 * @param olaf_db A database.
+	 */
+	void olaf_db_bulk_load_flush(Olaf_DB * olaf_db);
+
+	/**
+	 * Complete the writes of a database before its transaction is committed.
+	 * @param olaf_db A database.
+	 */
+	void olaf_db_finish(Olaf_DB * olaf_db);
+
+	/**
+	 * @param olaf_db A database.
+	 * @return The size of its files and the files of its local shards, in bytes.
+	 */
+	size_t olaf_db_size(Olaf_DB * olaf_db);
+
+	/**
+	 * Print each fingerprint of a database.
+	 * @param olaf_db A database.
+	 */
+	void olaf_db_stats_verbose(Olaf_DB * olaf_db);
+
+	/**
+	 * Add the statistics of the fingerprint index of a database.
+	 * @param olaf_db A database.
+	 * @param stats The statistics to add to.
+	 * @return MDB_SUCCESS or the LMDB error.
+	 */
+	int olaf_db_index_stats(Olaf_DB * olaf_db,struct olaf_db_index_stats * stats);
+
+#endif // OLAF_DB_SHARDS_H
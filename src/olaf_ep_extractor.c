@@ -17,6 +17,7 @@
 #include <stdio.h>
 #include <math.h>
 #include <assert.h>
+#include <string.h>
 
 #include "olaf_ep_extractor.h"
 #include "olaf_config.h"
@@ -26,11 +27,15 @@
 struct Olaf_EP_Extractor{
 	Olaf_Config * config; /**< The Olaf configuration */
 
-	float** mags; /**< The magnitudes calculated from the FFT */
+	float* mags; /**< Ring of filterSizeTime rows with the magnitudes calculated from the FFT, stored contiguously */
 
-	float** maxes; /**< The vertical max-filtered magnitudes */
+	float* maxes; /**< Ring of filterSizeTime rows with the vertical max-filtered magnitudes */
 
-	int filterIndex; /**< Current index into the max filter */
+	float* suffixMaxes; /**< Per ring row: the time max from that row up to the end of the previous segment of filterSizeTime rows */
+
+	float* prefixMaxes; /**< The time max from the start of the current segment of filterSizeTime rows up to the latest row */
+
+	size_t rowIndex; /**< The number of audio blocks processed, the latest row is at rowIndex - 1 */
 
 	int audioBlockIndex; /**< Index of the current audio block being processed */
 
@@ -45,76 +50,111 @@ Olaf_EP_Extractor * olaf_ep_extractor_new(Olaf_Config * config){
 
 	ep_extractor->config = config;
 
-	int halfAudioBlockSize = config->audioBlockSize / 2;
+	size_t halfAudioBlockSize = config->audioBlockSize / 2;
+	size_t ringSize = config->filterSizeTime * halfAudioBlockSize;
 
-	ep_extractor->eventPoints.eventPoints = (struct eventpoint *) calloc(config->maxEventPoints , sizeof(struct eventpoint));
+	//twice the maximum so that the live event points only need to be moved 
+	//to the start of the buffer once every maxEventPoints event points
+	ep_extractor->eventPoints.bufferSize = 2 * config->maxEventPoints;
+	ep_extractor->eventPoints.buffer = (struct eventpoint *) calloc(ep_extractor->eventPoints.bufferSize , sizeof(struct eventpoint));
+	if(ep_extractor->eventPoints.buffer == NULL) fprintf(stdout,"Failed to allocate memory: eventPoints");
+	ep_extractor->eventPoints.eventPoints = ep_extractor->eventPoints.buffer;
 	ep_extractor->eventPoints.eventPointIndex = 0;
-	if(ep_extractor->eventPoints.eventPoints == NULL) fprintf(stdout,"Failed to allocate memory: eventPoints");
-
-	//initialize t with a high number
-	for(int i = 0 ; i < config->maxEventPoints; i++){
-		ep_extractor->eventPoints.eventPoints[i].timeIndex = 1<<23;
-	}
 	
-	ep_extractor->mags  =(float **) calloc(config->filterSizeTime , sizeof(float *));
-	if(ep_extractor->mags == NULL) fprintf(stdout,"Failed to allocate memory: mags");
-	ep_extractor->maxes = (float **) calloc(config->filterSizeTime , sizeof(float *));
-	if(ep_extractor->maxes == NULL) fprintf(stdout,"Failed to allocate memory: maxes");
-
-	for(int i = 0; i < config->filterSizeTime ;i++){
-		ep_extractor->maxes[i]= (float *) calloc(halfAudioBlockSize , sizeof(float));
-		if(ep_extractor->maxes[i] == NULL) fprintf(stdout,"Failed to allocate memory: maxes[i]");
-
-		ep_extractor->mags[i] = (float *) calloc(halfAudioBlockSize , sizeof(float));
-		if(ep_extractor->mags[i] == NULL) fprintf(stderr,"Failed to allocate memory: mags[i]");
-	}
-
-	ep_extractor->filterIndex = 0;
+	ep_extractor->mags = (float *) calloc(ringSize , sizeof(float));
+	if(ep_extractor->mags == NULL) fprintf(stderr,"Failed to allocate memory: mags");
+	ep_extractor->maxes = (float *) calloc(ringSize , sizeof(float));
+	if(ep_extractor->maxes == NULL) fprintf(stderr,"Failed to allocate memory: maxes");
+	ep_extractor->suffixMaxes = (float *) calloc(ringSize , sizeof(float));
+	if(ep_extractor->suffixMaxes == NULL) fprintf(stderr,"Failed to allocate memory: suffixMaxes");
+	ep_extractor->prefixMaxes = (float *) calloc(halfAudioBlockSize , sizeof(float));
+	if(ep_extractor->prefixMaxes == NULL) fprintf(stderr,"Failed to allocate memory: prefixMaxes");
+
+	ep_extractor->rowIndex = 0;
 	return ep_extractor;
 }
 
-void olaf_ep_extractor_destroy(Olaf_EP_Extractor * ep_extractor){
-	free(ep_extractor->eventPoints.eventPoints);
+void olaf_ep_extractor_reset(Olaf_EP_Extractor * ep_extractor){
+	//the rings are filled again before they are read
+	ep_extractor->rowIndex = 0;
+	ep_extractor->eventPoints.eventPoints = ep_extractor->eventPoints.buffer;
+	ep_extractor->eventPoints.eventPointIndex = 0;
+}
 
-	for(int i = 0; i < ep_extractor->config->filterSizeTime ;i++){
-	  free(ep_extractor->maxes[i]);
-	  free(ep_extractor->mags[i]);
-	}
+void olaf_ep_extractor_destroy(Olaf_EP_Extractor * ep_extractor){
+	free(ep_extractor->eventPoints.buffer);
 
+	free(ep_extractor->prefixMaxes);
+	free(ep_extractor->suffixMaxes);
 	free(ep_extractor->maxes);
 	free(ep_extractor->mags);
 	free(ep_extractor);
 }
 
+//Returns a row of one of the rings: rows are counted from the first audio block
+static inline float * olaf_ep_extractor_row(const Olaf_EP_Extractor * ep_extractor, float * ring, size_t row){
+	size_t halfAudioBlockSize = ep_extractor->config->audioBlockSize/2;
+	return ring + (row % ep_extractor->config->filterSizeTime) * halfAudioBlockSize;
+}
+
+//Power spectrum of the interleaved complex FFT output: re*re + im*im per bin, or its square
+//root. The vector versions below compute exactly the same values as this scalar version.
+static void olaf_ep_extractor_power_scalar(const float* fft_out, float* mags, size_t start, size_t size, bool sqrt_magnitude){
+	for(size_t i = start ; i < size ; i++){
+		float power = fft_out[2*i] * fft_out[2*i] + fft_out[2*i+1] * fft_out[2*i+1];
+		mags[i] = sqrt_magnitude ? sqrtf(power) : power;
+	}
+}
 
 #if defined(__ARM_NEON)
 
-	#include <arm_neon.h>
-	
-	// ARM NEON implementation here
-	float olaf_ep_extractor_max_filter_time(float* array, size_t array_size){
-		assert(array_size % 4 == 0);
-		float32x4_t vec_max = vld1q_f32(array);
-		for (size_t j = 4; j < array_size; j += 4) {
-			float32x4_t vec = vld1q_f32(array + j);
-			vec_max = vmaxq_f32(vec_max, vec);
+	// ARM NEON: four bins at a time, vld2q splits real and imaginary parts
+	static void olaf_ep_extractor_power(const float* fft_out, float* mags, size_t size, bool sqrt_magnitude){
+		#if !defined(__aarch64__)
+			//32 bit NEON has no exact vector square root
+			if(sqrt_magnitude){
+				olaf_ep_extractor_power_scalar(fft_out,mags,0,size,true);
+				return;
+			}
+		#endif
+		size_t i = 0;
+		for(; i + 4 <= size ; i += 4){
+			float32x4x2_t bins = vld2q_f32(fft_out + 2*i);
+			float32x4_t power = vaddq_f32(vmulq_f32(bins.val[0],bins.val[0]),vmulq_f32(bins.val[1],bins.val[1]));
+			#if defined(__aarch64__)
+				if(sqrt_magnitude) power = vsqrtq_f32(power);
+			#endif
+			vst1q_f32(mags + i, power);
 		}
-		float32x2_t max_val = vpmax_f32(vget_low_f32(vec_max), vget_high_f32(vec_max));
-		max_val = vpmax_f32(max_val, max_val);
-		return vget_lane_f32(max_val, 0);
+		olaf_ep_extractor_power_scalar(fft_out,mags,i,size,sqrt_magnitude);
 	}
 
-#else
-	//naive fallback here, sse version is slower!
-	float olaf_ep_extractor_max_filter_time(float* array,size_t array_size){
-		float max = -10000000;
-		for(size_t i = 0 ; i < array_size;i++){
-			if(array[i]>max) max = array[i];
+#elif defined(__SSE__)
+
+	#include <xmmintrin.h>
+
+	// SSE: four bins at a time, shuffles gather the squared real and imaginary parts
+	static void olaf_ep_extractor_power(const float* fft_out, float* mags, size_t size, bool sqrt_magnitude){
+		size_t i = 0;
+		for(; i + 4 <= size ; i += 4){
+			__m128 low = _mm_loadu_ps(fft_out + 2*i);
+			__m128 high = _mm_loadu_ps(fft_out + 2*i + 4);
+			low = _mm_mul_ps(low,low);
+			high = _mm_mul_ps(high,high);
+			__m128 power = _mm_add_ps(_mm_shuffle_ps(low,high,_MM_SHUFFLE(2,0,2,0)),_mm_shuffle_ps(low,high,_MM_SHUFFLE(3,1,3,1)));
+			if(sqrt_magnitude) power = _mm_sqrt_ps(power);
+			_mm_storeu_ps(mags + i, power);
 		}
-		return max;
+		olaf_ep_extractor_power_scalar(fft_out,mags,i,size,sqrt_magnitude);
 	}
-#endif
 
+#else
+
+	static void olaf_ep_extractor_power(const float* fft_out, float* mags, size_t size, bool sqrt_magnitude){
+		olaf_ep_extractor_power_scalar(fft_out,mags,0,size,sqrt_magnitude);
+	}
+
+#endif
 
 void olaf_ep_extractor_print_ep(struct eventpoint e){
 	fprintf(stderr,"t:%d, f:%d, u:%d, mag:%.4f\n",e.timeIndex,e.frequencyBin,e.usages,e.magnitude);
@@ -125,56 +165,139 @@ void olaf_ep_extractor_max_filter_frequency(float* data, float * max, int length
 	olaf_max_filter(data,length,filterSize , max);
 }
 
-void extract_internal(Olaf_EP_Extractor * ep_extractor){
+//Makes sure there is room at the tail of the ring buffer. When the tail reaches 
+//the end of the storage, the event points are moved back to the start.
+static struct eventpoint * olaf_ep_extractor_tail(struct extracted_event_points * eventPoints, int eventPointIndex){
+	int head = (int) (eventPoints->eventPoints - eventPoints->buffer);
+	if(head + eventPointIndex == eventPoints->bufferSize){
+		memmove(eventPoints->buffer,eventPoints->eventPoints,eventPointIndex * sizeof(struct eventpoint));
+		eventPoints->eventPoints = eventPoints->buffer;
+	}
+	return eventPoints->eventPoints;
+}
+
+//Adds an event point at the tail unless the maximum number of event points is reached
+static int olaf_ep_extractor_add(Olaf_EP_Extractor * ep_extractor, int eventPointIndex, int timeIndex, int frequencyBin, float magnitude){
+	if(eventPointIndex == ep_extractor->config->maxEventPoints ){
+		fprintf(stderr,"Warning: Eventpoint maximum index %d reached, event points are ignored, consider increasing config->maxEventPoints if you see this often. \n",ep_extractor->config->maxEventPoints);
+		return eventPointIndex;
+	}
+
+	struct eventpoint * eventPoints = olaf_ep_extractor_tail(&ep_extractor->eventPoints,eventPointIndex);
+	eventPoints[eventPointIndex].timeIndex = timeIndex;
+	eventPoints[eventPointIndex].frequencyBin = frequencyBin;
+	eventPoints[eventPointIndex].magnitude = magnitude;
+	eventPoints[eventPointIndex].usages = 0;
+
+	//fprintf(stderr,"New EP found ");
+	//olaf_ep_extractor_print_ep(eventPoints[eventPointIndex]);
+
+	eventPointIndex++;
+	assert(eventPointIndex <= ep_extractor->config->maxEventPoints);
+	return eventPointIndex;
+}
+
+void olaf_ep_extractor_expire(struct extracted_event_points * eventPoints, int cutoffTime, int maxEventPointUsages){
+	//the event points are ordered by time: the expired ones are at the head
+	int expired = 0;
+	while(expired < eventPoints->eventPointIndex && eventPoints->eventPoints[expired].timeIndex <= cutoffTime){
+		expired++;
+	}
+	eventPoints->eventPoints += expired;
+	eventPoints->eventPointIndex -= expired;
+
+	//event points used too many times are rare: only compact from the first one on
+	struct eventpoint * eps = eventPoints->eventPoints;
+	int i = 0;
+	while(i < eventPoints->eventPointIndex && eps[i].usages != maxEventPointUsages){
+		i++;
+	}
+	int kept = i;
+	for(; i < eventPoints->eventPointIndex ; i++){
+		if(eps[i].usages != maxEventPointUsages){
+			eps[kept] = eps[i];
+			kept++;
+		}
+	}
+	eventPoints->eventPointIndex = kept;
+}
+
+//The max filter in time is a van Herk/Gil-Werman filter over the ring. The rows are split
+//in segments of filterSizeTime rows. A window of filterSizeTime rows ending at the latest
+//row covers the tail of the previous segment and the head of the current one, so its max is
+//the max of a suffix max of the previous segment and the prefix max of the current one. 
+//Both are kept up to date per frequency bin with a constant number of operations per block.
+static void olaf_ep_extractor_max_filter_time(Olaf_EP_Extractor * ep_extractor, size_t row){
+	size_t filterSizeTime = (size_t) ep_extractor->config->filterSizeTime;
+	size_t halfAudioBlockSize = ep_extractor->config->audioBlockSize/2;
+	const float * maxes = olaf_ep_extractor_row(ep_extractor,ep_extractor->maxes,row);
+	float * prefixMaxes = ep_extractor->prefixMaxes;
+
+	if(row % filterSizeTime == 0){
+		//start of a new segment
+		memcpy(prefixMaxes,maxes,halfAudioBlockSize * sizeof(float));
+	}else{
+		for(size_t j = 0 ; j < halfAudioBlockSize ; j++){
+			prefixMaxes[j] = maxes[j] > prefixMaxes[j] ? maxes[j] : prefixMaxes[j];
+		}
+	}
+}
+
+//Once a segment is complete the ring holds exactly its rows: calculate the suffix maxes
+//backwards. These are used for the windows ending in the next segment.
+static void olaf_ep_extractor_segment_complete(Olaf_EP_Extractor * ep_extractor, size_t row){
+	size_t filterSizeTime = (size_t) ep_extractor->config->filterSizeTime;
+	size_t halfAudioBlockSize = ep_extractor->config->audioBlockSize/2;
+
+	float * next = olaf_ep_extractor_row(ep_extractor,ep_extractor->suffixMaxes,row);
+	memcpy(next,olaf_ep_extractor_row(ep_extractor,ep_extractor->maxes,row),halfAudioBlockSize * sizeof(float));
+
+	for(size_t t = 1 ; t < filterSizeTime ; t++){
+		const float * maxes = olaf_ep_extractor_row(ep_extractor,ep_extractor->maxes,row - t);
+		float * suffix = olaf_ep_extractor_row(ep_extractor,ep_extractor->suffixMaxes,row - t);
+		for(size_t j = 0 ; j < halfAudioBlockSize ; j++){
+			suffix[j] = maxes[j] > next[j] ? maxes[j] : next[j];
+		}
+		next = suffix;
+	}
+}
+
+void extract_internal(Olaf_EP_Extractor * ep_extractor, size_t row){
 
 	size_t filterSizeTime = (size_t) ep_extractor->config->filterSizeTime;
 	size_t halfFilterSizeTime = ep_extractor->config->halfFilterSizeTime;
 	size_t halfAudioBlockSize = ep_extractor->config->audioBlockSize/2;
-	struct eventpoint * eventPoints = ep_extractor->eventPoints.eventPoints;
 	int eventPointIndex = ep_extractor->eventPoints.eventPointIndex;
 	int minFreqencyBin = ep_extractor->config->minFrequencyBin;
 
+	//the window holds the rows [firstRow, row]
+	size_t firstRow = row + 1 - filterSizeTime;
+	const float * mags = olaf_ep_extractor_row(ep_extractor,ep_extractor->mags,firstRow + halfFilterSizeTime);
+	const float * maxes = olaf_ep_extractor_row(ep_extractor,ep_extractor->maxes,firstRow + halfFilterSizeTime);
+	const float * prefixMaxes = ep_extractor->prefixMaxes;
+	//if the window is a complete segment the prefix max covers it
+	const float * suffixMaxes = (row + 1) % filterSizeTime == 0 ? NULL : olaf_ep_extractor_row(ep_extractor,ep_extractor->suffixMaxes,firstRow);
+
 	//do not start at zero 
 	for(size_t j = minFreqencyBin ; j < halfAudioBlockSize - 1 ; j++){
 
-		float currentVal = ep_extractor->mags[halfFilterSizeTime][j];
-    //the vertically filtered max value
-    float maxVal = ep_extractor->maxes[halfFilterSizeTime][j];
-
-    //if the current value is too low (below abs threshold) or not equal to the
-    //vertical max value, then this is not an event point and can be skipped.
-    //This also skips calculating the horizontal max value and wasting resources
-    if(currentVal < ep_extractor->config->minEventPointMagnitude || currentVal != maxVal){
-      continue;
-    }
-
-    //Only now execute the horizontal max filter
-    float timeslice[filterSizeTime];
-    for(size_t t = 0 ; t < filterSizeTime; t++){
-      timeslice[t] = ep_extractor->maxes[t][j];
-    }
-	maxVal = olaf_ep_extractor_max_filter_time(timeslice,ep_extractor->config->filterSizeTime);
+		float currentVal = mags[j];
+		//the vertically filtered max value
+		float maxVal = maxes[j];
+
+		//if the current value is too low (below abs threshold) or not equal to the
+		//vertical max value, then this is not an event point and can be skipped.
+		if(currentVal < ep_extractor->config->minEventPointMagnitude || currentVal != maxVal){
+			continue;
+		}
+
+		//the horizontal max value
+		maxVal = prefixMaxes[j];
+		if(suffixMaxes != NULL && suffixMaxes[j] > maxVal) maxVal = suffixMaxes[j];
 		
 		if(currentVal == maxVal){
 			int timeIndex = ep_extractor->audioBlockIndex - halfFilterSizeTime;
-			int frequencyBin = j;
-			float magnitude = ep_extractor->mags[halfFilterSizeTime][frequencyBin];
-
-			if(eventPointIndex == ep_extractor->config->maxEventPoints ){
-				fprintf(stderr,"Warning: Eventpoint maximum index %d reached, event points are ignored, consider increasing config->maxEventPoints if you see this often. \n",ep_extractor->config->maxEventPoints);
-			}else{
-				eventPoints[eventPointIndex].timeIndex = timeIndex;
-				eventPoints[eventPointIndex].frequencyBin = frequencyBin;
-				eventPoints[eventPointIndex].magnitude = magnitude;
-				eventPoints[eventPointIndex].usages = 0;
-
-				//fprintf(stderr,"New EP found ");
-				//olaf_ep_extractor_print_ep(eventPoints[eventPointIndex]);
-				
-				eventPointIndex++;
-			}
-			assert(eventPointIndex <= ep_extractor->config->maxEventPoints);
-			
+			eventPointIndex = olaf_ep_extractor_add(ep_extractor,eventPointIndex,timeIndex,j,mags[j]);
 		}
 	}
 	
@@ -182,66 +305,53 @@ void extract_internal(Olaf_EP_Extractor * ep_extractor){
 	ep_extractor->eventPoints.eventPointIndex = eventPointIndex;
 }
 
-void rotate(Olaf_EP_Extractor * ep_extractor){
-	//shift the magnitudes to the right
-	//temporarily keep a reference to the first buffer
-	float* tempMax = ep_extractor->maxes[0];
-	float* tempMag = ep_extractor->mags[0];
-
-	//shift buffers by one
-	for(int i = 1 ; i < ep_extractor->config->filterSizeTime ; i++){
-		ep_extractor->maxes[i-1]=ep_extractor->maxes[i];
-		ep_extractor->mags[i-1]=ep_extractor->mags[i];
-	}
-	
-	//
-	assert(ep_extractor->filterIndex == ep_extractor->config->filterSizeTime-1);
-
-	//store the first at the last place
-	ep_extractor->maxes[ep_extractor->config->filterSizeTime-1] = tempMax;
-	ep_extractor->mags[ep_extractor->config->filterSizeTime-1] = tempMag;
+float * olaf_ep_extractor_mags(Olaf_EP_Extractor * olaf_ep_extractor){
+	//the magnitudes of the latest audio block
+	assert(olaf_ep_extractor->rowIndex > 0);
+	return olaf_ep_extractor_row(olaf_ep_extractor,olaf_ep_extractor->mags,olaf_ep_extractor->rowIndex - 1);
 }
 
-float * olaf_ep_extractor_mags(Olaf_EP_Extractor * olaf_ep_extractor){
-	//this needs to be called after rotate() above 
-	//and the index is incremented
-	if(olaf_ep_extractor->filterIndex==olaf_ep_extractor->config->filterSizeTime-1){
-		return olaf_ep_extractor->mags[olaf_ep_extractor->config->filterSizeTime-2];
-	}else{
-		return olaf_ep_extractor->mags[olaf_ep_extractor->filterIndex-1];
+struct extracted_event_points * olaf_ep_extractor_append(Olaf_EP_Extractor * ep_extractor, const struct eventpoint * eventPoints, size_t count, int audioBlockIndex){
+	int eventPointIndex = ep_extractor->eventPoints.eventPointIndex;
+
+	ep_extractor->audioBlockIndex = audioBlockIndex;
+	for(size_t i = 0 ; i < count ; i++){
+		eventPointIndex = olaf_ep_extractor_add(ep_extractor,eventPointIndex,eventPoints[i].timeIndex,eventPoints[i].frequencyBin,eventPoints[i].magnitude);
 	}
+	ep_extractor->eventPoints.eventPointIndex = eventPointIndex;
+
+	return &ep_extractor->eventPoints;
 }
 
 struct extracted_event_points * olaf_ep_extractor_extract(Olaf_EP_Extractor * ep_extractor, float* fft_out, int audioBlockIndex){
 
-	int filterIndex = ep_extractor->filterIndex;
+	size_t row = ep_extractor->rowIndex;
+	size_t filterSizeTime = (size_t) ep_extractor->config->filterSizeTime;
+	float * mags = olaf_ep_extractor_row(ep_extractor,ep_extractor->mags,row);
+	float * maxes = olaf_ep_extractor_row(ep_extractor,ep_extractor->maxes,row);
 
 	ep_extractor->audioBlockIndex = audioBlockIndex;
 
-	int magnitudeIndex = 0;
-	for(int j = 0 ; j < ep_extractor->config->audioBlockSize ; j+=2){
-		if(ep_extractor->config->sqrtMagnitude){
-			ep_extractor->mags[filterIndex][magnitudeIndex] = sqrt(fft_out[j] * fft_out[j] + fft_out[j+1] * fft_out[j+1]);
-		}else{
-			ep_extractor->mags[filterIndex][magnitudeIndex] = fft_out[j] * fft_out[j] + fft_out[j+1] * fft_out[j+1];	
-		}
-		magnitudeIndex++;
-	}
+	olaf_ep_extractor_power(fft_out,mags,ep_extractor->config->audioBlockSize/2,ep_extractor->config->sqrtMagnitude);
 
 	//process the fft frame in frequency (vertically)
-	olaf_ep_extractor_max_filter_frequency(ep_extractor->mags[filterIndex],ep_extractor->maxes[filterIndex],ep_extractor->config->audioBlockSize/2,ep_extractor->config->halfFilterSizeFrequency);
+	olaf_ep_extractor_max_filter_frequency(mags,maxes,ep_extractor->config->audioBlockSize/2,ep_extractor->config->halfFilterSizeFrequency);
+
+	//and update the max filter in time (horizontally)
+	olaf_ep_extractor_max_filter_time(ep_extractor,row);
 	
-	if(filterIndex==ep_extractor->config->filterSizeTime-1){
+	if(row + 1 >= filterSizeTime){
 		//enough history to extract event points
-		extract_internal(ep_extractor);
+		extract_internal(ep_extractor,row);
+	}
 
-		//shift the magnitudes so that there is room for a new audio block 
-		rotate(ep_extractor);
-	}else{
-		//not enough history to extract event points
-		ep_extractor->filterIndex++;
+	if((row + 1) % filterSizeTime == 0){
+		olaf_ep_extractor_segment_complete(ep_extractor,row);
 	}
 
+	//the next audio block overwrites the oldest row of the rings
+	ep_extractor->rowIndex++;
+
 	//fprintf(stderr,"Extract event_points for audio block %d \n", audioBlockIndex );
 	return &ep_extractor->eventPoints;
 }
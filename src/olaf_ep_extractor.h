@@ -43,10 +43,16 @@
 	/**
 	 * @struct extracted_event_points
 	 * @brief The result of event point extraction is a list of event points.
+	 *
+	 * The event points are kept in time order in a ring buffer. New event points are added at 
+	 * the tail, expired event points are removed by advancing the head. The event points between 
+	 * head and tail are always contiguous so they can be used as a plain array.
 	 */
 	struct extracted_event_points{
-		struct eventpoint * eventPoints; /**< Array of extracted event points. */
-		int eventPointIndex; /**< The current index into the event points array. */
+		struct eventpoint * eventPoints; /**< Array of extracted event points, starts at the head of the ring buffer. */
+		int eventPointIndex; /**< The number of event points, the tail of the ring buffer. */
+		struct eventpoint * buffer; /**< The storage of the ring buffer. */
+		int bufferSize; /**< The number of event points that fit in the storage. */
 	};
 	
 	/**
@@ -82,6 +88,28 @@
 	 */
 	struct extracted_event_points * olaf_ep_extractor_extract(Olaf_EP_Extractor * olaf_ep_extractor, float* fft_magnitudes, int audioBlockIndex);
 
+	/**
+	 * Add event points found by another extractor for this audio block, e.g. for a part of 
+	 * the audio processed on another thread. The event points end up as if 
+	 * olaf_ep_extractor_extract() found them.
+	 * @param olaf_ep_extractor The EP extractor state struct.
+	 * @param eventPoints The new event points, ordered by time.
+	 * @param count The number of new event points.
+	 * @param audioBlockIndex The audio block time index.
+	 * @return The event points, including the new ones.
+	 */
+	struct extracted_event_points * olaf_ep_extractor_append(Olaf_EP_Extractor * olaf_ep_extractor, const struct eventpoint * eventPoints, size_t count, int audioBlockIndex);
+
+	/**
+	 * Remove event points which can not be used for fingerprints anymore: event points at or 
+	 * before the cutoff time are removed from the head, event points used the maximum number 
+	 * of times are removed in place. The order of the remaining event points is kept.
+	 * @param eventPoints The event points to update.
+	 * @param cutoffTime The time index of the last event point to remove.
+	 * @param maxEventPointUsages The number of usages after which an event point is removed.
+	 */
+	void olaf_ep_extractor_expire(struct extracted_event_points * eventPoints, int cutoffTime, int maxEventPointUsages);
+
 	/**
 	 * For debug and visualization purposes: return the current fft magnitudes.
 	 * @param olaf_ep_extractor The EP extractor state struct.
@@ -89,6 +117,13 @@
 	 */
 	float * olaf_ep_extractor_mags(Olaf_EP_Extractor * olaf_ep_extractor);
 
+	/**
+	 * Forget all audio blocks and event points so the extractor can be reused for the next 
+	 * audio file. The memory is kept: nothing is allocated again.
+	 * @param olaf_ep_extractor The EP extractor to reset.
+	 */
+	void olaf_ep_extractor_reset(Olaf_EP_Extractor * olaf_ep_extractor);
+
 	/**
 	 * Free memory or other resources.
 	 * @param  olaf_ep_extractor The EP extractor to destroy.
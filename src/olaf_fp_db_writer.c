@@ -19,6 +19,7 @@
 #include <stdio.h>
 
 #include "olaf_fp_db_writer.h"
+#include "olaf_fp_db_writer_queue.h"
 #include "olaf_db.h"
 
 struct Olaf_FP_DB_Writer{
@@ -31,6 +32,8 @@ struct Olaf_FP_DB_Writer{
 
 	Olaf_DB * db; /**< Reference to the fingerprint database */
 
+	Olaf_FP_DB_Writer_Queue * queue; /**< If not NULL, batches are queued for a writer thread in stead of written to db */
+
 	uint32_t audio_file_identifier; /**< Identifier of the audio file being stored */
 };
 
@@ -39,6 +42,7 @@ Olaf_FP_DB_Writer * olaf_fp_db_writer_new(Olaf_DB* db,uint32_t audio_file_identi
 	Olaf_FP_DB_Writer *db_writer = (Olaf_FP_DB_Writer *) malloc(sizeof(Olaf_FP_DB_Writer));
 
 	db_writer->db = db;
+	db_writer->queue = NULL;
 	db_writer->threshold = 0.8 * (1<<12);
 	db_writer->index=0;
 	
@@ -47,12 +51,31 @@ Olaf_FP_DB_Writer * olaf_fp_db_writer_new(Olaf_DB* db,uint32_t audio_file_identi
 	return db_writer;
 }
 
+Olaf_FP_DB_Writer * olaf_fp_db_writer_new_queued(Olaf_FP_DB_Writer_Queue * queue,uint32_t audio_file_identifier){
+	Olaf_FP_DB_Writer *db_writer = olaf_fp_db_writer_new(NULL,audio_file_identifier);
+	db_writer->queue = queue;
+	return db_writer;
+}
+
+static void olaf_fp_db_writer_flush(Olaf_FP_DB_Writer * db_writer, bool store){
+	if(db_writer->queue != NULL && store)
+		olaf_fp_db_writer_queue_store(db_writer->queue,db_writer->keys,db_writer->values,db_writer->index);
+	else if(db_writer->queue != NULL)
+		olaf_fp_db_writer_queue_delete(db_writer->queue,db_writer->keys,db_writer->values,db_writer->index);
+	else if(store)
+		olaf_db_store(db_writer->db,db_writer->keys,db_writer->values,db_writer->index);
+	else
+		olaf_db_delete(db_writer->db,db_writer->keys,db_writer->values,db_writer->index);
+
+	db_writer->index = 0;
+}
+
 void olaf_fp_db_writer_store( Olaf_FP_DB_Writer * db_writer , struct extracted_fingerprints * fingerprints ){
 
 	for(size_t i = 0 ; i < fingerprints->fingerprintIndex; i++){
 
-		uint64_t key = olaf_fp_extractor_hash(fingerprints->fingerprints[i]);
-		uint64_t fingerprint_t1 = fingerprints->fingerprints[i].timeIndex1;
+		uint64_t key = fingerprints->hashes[i];
+		uint64_t fingerprint_t1 = fingerprints->timeIndexes[i];
 		uint64_t fingerprint_id = db_writer->audio_file_identifier;
 
 		db_writer->keys[db_writer->index] = key;
@@ -64,16 +87,15 @@ void olaf_fp_db_writer_store( Olaf_FP_DB_Writer * db_writer , struct extracted_f
 	fingerprints->fingerprintIndex = 0;
 	
 	if(db_writer->index > db_writer->threshold){
-		olaf_db_store(db_writer->db,db_writer->keys,db_writer->values,db_writer->index);
-		db_writer->index = 0;
+		olaf_fp_db_writer_flush(db_writer,true);
 	}
 }
 
 void olaf_fp_db_writer_delete( Olaf_FP_DB_Writer * db_writer , struct extracted_fingerprints * fingerprints ){
 	for(size_t i = 0 ; i < fingerprints->fingerprintIndex; i++){
 
-		uint64_t key = olaf_fp_extractor_hash(fingerprints->fingerprints[i]);
-		uint64_t fingerprint_t1 = fingerprints->fingerprints[i].timeIndex1;
+		uint64_t key = fingerprints->hashes[i];
+		uint64_t fingerprint_t1 = fingerprints->timeIndexes[i];
 		uint64_t fingerprint_id = db_writer->audio_file_identifier;
 		//uint32_t significant = hash_to_store>>46;
 
@@ -90,8 +112,7 @@ void olaf_fp_db_writer_delete( Olaf_FP_DB_Writer * db_writer , struct extracted_
 	//printf("%s\n", "store" );
 	//store if threshold is exceeded
 	if(db_writer->index > db_writer->threshold){
-		olaf_db_delete(db_writer->db,db_writer->keys,db_writer->values,db_writer->index);
-		db_writer->index = 0;
+		olaf_fp_db_writer_flush(db_writer,false);
 	}
 }
 
@@ -99,12 +120,7 @@ void olaf_fp_db_writer_delete( Olaf_FP_DB_Writer * db_writer , struct extracted_
 void olaf_fp_db_writer_destroy(Olaf_FP_DB_Writer * db_writer,bool store){
 	
 	//store or delete remaining hashes
-	if(store)
-		olaf_db_store(db_writer->db,db_writer->keys,db_writer->values,db_writer->index);
-	else
-		olaf_db_delete(db_writer->db,db_writer->keys,db_writer->values,db_writer->index);
-
-	db_writer->index = 0;
+	olaf_fp_db_writer_flush(db_writer,store);
 
 	free(db_writer);
 }
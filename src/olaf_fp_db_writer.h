@@ -27,6 +27,7 @@
 	
 	#include "olaf_db.h"
 	#include "olaf_fp_extractor.h"
+	#include "olaf_fp_db_writer_queue.h"
 	
 	/**
      * @struct Olaf_FP_DB_Writer
@@ -48,6 +49,17 @@
 	 */
 	Olaf_FP_DB_Writer * olaf_fp_db_writer_new(Olaf_DB* db,uint32_t audio_file_identifier);
 
+	/**
+	 * @brief      Initialize a new db writer which pushes its batches to a writer queue in stead of 
+	 * writing to the database directly.
+	 *
+	 * @param      queue                  The writer queue.
+	 * @param[in]  audio_file_identifier  The audio file identifier.
+	 *
+	 * @return     A newly initialized db writer struct. 
+	 */
+	Olaf_FP_DB_Writer * olaf_fp_db_writer_new_queued(Olaf_FP_DB_Writer_Queue * queue,uint32_t audio_file_identifier);
+
 	/**
 	 * @brief      Cache and store fingerprints.
 	 *
@@ -13,13 +13,29 @@
 
 // You should have received a copy of the GNU Affero General Public License
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//Binary cache files are memory mapped with POSIX mmap, elsewhere they are read with stdio
+#if !defined(_WIN32)
+	#define _POSIX_C_SOURCE 200809L
+	#define OLAF_CACHE_MMAP
+#endif
+
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdbool.h>
+#include <pthread.h>
 
+#if defined(OLAF_CACHE_MMAP)
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
 
 #include "olaf_fp_db_writer_cache.h"
+#include "olaf_fp_file_writer.h"
 #include "olaf_config.h"
 #include "olaf_db.h"
 
@@ -27,11 +43,17 @@ struct Olaf_FP_DB_Writer_Cache{
 	Olaf_DB * db; /**< Reference to the fingerprint database */
 	Olaf_Config * config; /**< Reference to the Olaf configuration */
 
-	const char* csv_filename; /**< Path to the CSV cache file */
+	const char* cache_filename; /**< Path to the binary or CSV cache file */
 
-	uint64_t fp_hashes[FP_ARRAY_SIZE]; /**< Cached fingerprint hash keys */
-	uint64_t fp_values[FP_ARRAY_SIZE]; /**< Cached fingerprint hash values */
-	size_t fp_index; /**< Current index into the fingerprint cache arrays */
+	int state; /**< 0 before loading, 1 when loaded and -1 for a cache file which is not stored */
+	const uint64_t * fp_hashes; /**< Loaded fingerprint hash keys, mapped in place for a binary cache file */
+	uint64_t * fp_values; /**< Loaded fingerprint hash values */
+	uint64_t * parsed_hashes; /**< Fingerprint hash keys parsed from a CSV cache file */
+	size_t fp_index; /**< Number of loaded fingerprints */
+	size_t fp_capacity; /**< Allocated size of the parsed arrays */
+
+	const uint8_t * data; /**< The loaded binary cache file */
+	size_t data_size; /**< Size of the loaded binary cache file */
 
 	size_t fp_counter; /**< Total number of fingerprints processed */
 	uint64_t last_fp_t1; /**< Timestamp of the last fingerprint t1 value */
@@ -40,9 +62,6 @@ struct Olaf_FP_DB_Writer_Cache{
 	const char* audio_filename; /**< File name of the current audio file */
 };
 
-
-
-
 void olaf_fp_db_writer_cache_set_audio_file_info(Olaf_FP_DB_Writer_Cache *db_writer_cache, const char *audio_file_path, uint64_t audio_file_identifier){
 	if(db_writer_cache->audio_filename != NULL){
 		free((void*)db_writer_cache->audio_filename);
@@ -58,15 +77,22 @@ void olaf_fp_db_writer_cache_set_audio_file_info(Olaf_FP_DB_Writer_Cache *db_wri
 
 int olaf_fp_db_writer_cache_parse_csv_line(Olaf_FP_DB_Writer_Cache * db_writer_cache,char *line) {
 
+	if(db_writer_cache->fp_index == db_writer_cache->fp_capacity){
+		db_writer_cache->fp_capacity = db_writer_cache->fp_capacity == 0 ? FP_ARRAY_SIZE : 2 * db_writer_cache->fp_capacity;
+		db_writer_cache->parsed_hashes = (uint64_t *) realloc(db_writer_cache->parsed_hashes,db_writer_cache->fp_capacity * sizeof(uint64_t));
+		db_writer_cache->fp_values = (uint64_t *) realloc(db_writer_cache->fp_values,db_writer_cache->fp_capacity * sizeof(uint64_t));
+	}
+
     int column_counter = 0;
 
-    char *token = strtok(line, ",");
-    while (token != NULL && column_counter < 2) {
+    //several loader threads parse at the same time, strtok would share its state
+    char *token = line;
+    while (column_counter < 2) {
 
     	//fp_hash (column 0)
     	if(column_counter == 0){
     		uint64_t hash = strtoull(token, NULL, 10);
-    		db_writer_cache->fp_hashes[db_writer_cache->fp_index] = hash;
+    		db_writer_cache->parsed_hashes[db_writer_cache->fp_index] = hash;
     	}
 
     	//fp t1 (column 1)
@@ -77,9 +103,11 @@ int olaf_fp_db_writer_cache_parse_csv_line(Olaf_FP_DB_Writer_Cache * db_writer_c
     		db_writer_cache->fp_values[db_writer_cache->fp_index] = (fingerprint_t<<32) + fingerprint_id; 
     	}
 
-        token = strtok(NULL, ",");
-
         column_counter ++;
+
+        token = strchr(token, ',');
+        if(token == NULL) break;
+        token++;
     }
 
     db_writer_cache->fp_index++;
@@ -91,29 +119,122 @@ int olaf_fp_db_writer_cache_parse_csv_line(Olaf_FP_DB_Writer_Cache * db_writer_c
 
 void olaf_fp_db_writer_cache_read_csv_file(Olaf_FP_DB_Writer_Cache * db_writer_cache) {
 
-    FILE *fp = fopen(db_writer_cache->csv_filename, "r");
+    FILE *fp = fopen(db_writer_cache->cache_filename, "r");
     if (fp == NULL) {
-        fprintf(stderr,"Failed to open file: %s\n", db_writer_cache->csv_filename);
+        fprintf(stderr,"Failed to open file: %s\n", db_writer_cache->cache_filename);
         return;
     }
 
     char line[MAX_LINE_LEN];
     while (fgets(line, MAX_LINE_LEN, fp) != NULL) {
         olaf_fp_db_writer_cache_parse_csv_line(db_writer_cache,line);
-        if(db_writer_cache->fp_index == FP_ARRAY_SIZE){
-			olaf_db_store(db_writer_cache->db,db_writer_cache->fp_hashes,db_writer_cache->fp_values,db_writer_cache->fp_index);
-			db_writer_cache->fp_index = 0;
-		}
     }
 
     fclose(fp);
+	db_writer_cache->fp_hashes = db_writer_cache->parsed_hashes;
+}
+
+//Loads the whole binary cache file: mapped in place or, without mmap, read into memory
+static const uint8_t * olaf_fp_db_writer_cache_map(FILE * file, size_t size){
+	#if defined(OLAF_CACHE_MMAP)
+		void * mapped = mmap(NULL,size,PROT_READ,MAP_PRIVATE,fileno(file),0);
+		if(mapped == MAP_FAILED) return NULL;
+		//the columns are read once from start to end
+		posix_madvise(mapped,size,POSIX_MADV_SEQUENTIAL);
+		return (const uint8_t *) mapped;
+	#else
+		uint8_t * data = (uint8_t *) malloc(size);
+		if(data == NULL) return NULL;
+		if(fseek(file,0,SEEK_SET) != 0 || fread(data,1,size,file) != size){
+			free(data);
+			return NULL;
+		}
+		return data;
+	#endif
+}
+
+static void olaf_fp_db_writer_cache_unmap(const uint8_t * data, size_t size){
+	#if defined(OLAF_CACHE_MMAP)
+		munmap((void *) data,size);
+	#else
+		(void)(size);
+		free((void *) data);
+	#endif
+}
+
+//Loads the fingerprints of a binary cache file. Returns 1 if they are loaded, -1 for an 
+//invalid binary cache file and 0 if the file is not in the binary format: it is then read as csv.
+static int olaf_fp_db_writer_cache_read_binary_file(Olaf_FP_DB_Writer_Cache * db_writer_cache){
+	FILE *file = fopen(db_writer_cache->cache_filename, "rb");
+	if (file == NULL) return 0;
+
+	struct olaf_fp_cache_header header;
+	if(fread(&header,sizeof(struct olaf_fp_cache_header),1,file) != 1 || memcmp(header.magic,OLAF_FP_CACHE_MAGIC,sizeof(header.magic)) != 0){
+		fclose(file);
+		return 0;
+	}
+
+	//from here on the file is handled as a binary cache file
+	fseek(file,0,SEEK_END);
+	long file_size = ftell(file);
+	size_t size = sizeof(struct olaf_fp_cache_header) + header.fingerprints * (sizeof(uint64_t) + sizeof(uint32_t));
+	if(header.version != OLAF_FP_CACHE_VERSION || file_size < 0 || (size_t) file_size != size){
+		fprintf(stderr,"Error: %s is not a valid version %d cache file, it is not stored.\n",db_writer_cache->cache_filename,OLAF_FP_CACHE_VERSION);
+		fclose(file);
+		return -1;
+	}
+	if(header.config_digest != olaf_config_digest(db_writer_cache->config)){
+		fprintf(stderr,"Error: the fingerprints in %s were extracted with another configuration, they are not stored.\n",db_writer_cache->cache_filename);
+		fclose(file);
+		return -1;
+	}
+
+	const uint8_t * data = olaf_fp_db_writer_cache_map(file,size);
+	fclose(file);
+	if(data == NULL){
+		fprintf(stderr,"Error: could not read %s.\n",db_writer_cache->cache_filename);
+		return -1;
+	}
+
+	//without meta data the identifier of the header is used
+	uint64_t fingerprint_id = db_writer_cache->audio_file_identifier;
+	if(fingerprint_id == 0) fingerprint_id = header.audio_identifier;
+
+	//the hashes are handed to the database in place, only the values are calculated
+	size_t fingerprints = (size_t) header.fingerprints;
+	const uint64_t * hashes = (const uint64_t *) (data + sizeof(struct olaf_fp_cache_header));
+	const uint32_t * time_indexes = (const uint32_t *) (hashes + fingerprints);
+	db_writer_cache->fp_values = (uint64_t *) malloc((fingerprints > 0 ? fingerprints : 1) * sizeof(uint64_t));
+	for(size_t i = 0 ; i < fingerprints ; i++){
+		db_writer_cache->fp_values[i] = (((uint64_t) time_indexes[i])<<32) + fingerprint_id;
+	}
+
+	db_writer_cache->data = data;
+	db_writer_cache->data_size = size;
+	db_writer_cache->fp_hashes = hashes;
+	db_writer_cache->fp_index = fingerprints;
+	db_writer_cache->fp_counter += fingerprints;
+	db_writer_cache->last_fp_t1 = header.last_time_index;
+
+	return 1;
+}
 
-    //store all remaining fp's
-    olaf_db_store(db_writer_cache->db,db_writer_cache->fp_hashes,db_writer_cache->fp_values,db_writer_cache->fp_index);
-	db_writer_cache->fp_index = 0;    
+//Release the loaded fingerprints
+static void olaf_fp_db_writer_cache_release(Olaf_FP_DB_Writer_Cache * db_writer_cache){
+	if(db_writer_cache->data != NULL){
+		olaf_fp_db_writer_cache_unmap(db_writer_cache->data,db_writer_cache->data_size);
+		db_writer_cache->data = NULL;
+	}
+	free(db_writer_cache->parsed_hashes);
+	free(db_writer_cache->fp_values);
+	db_writer_cache->parsed_hashes = NULL;
+	db_writer_cache->fp_values = NULL;
+	db_writer_cache->fp_hashes = NULL;
+	db_writer_cache->fp_index = 0;
+	db_writer_cache->fp_capacity = 0;
 }
 
-Olaf_FP_DB_Writer_Cache * olaf_fp_db_writer_cache_new(Olaf_DB* db,Olaf_Config * config,const char *csv_filename){
+Olaf_FP_DB_Writer_Cache * olaf_fp_db_writer_cache_new(Olaf_DB* db,Olaf_Config * config,const char *cache_filename){
 	Olaf_FP_DB_Writer_Cache *db_writer_cache = (Olaf_FP_DB_Writer_Cache *) malloc(sizeof(Olaf_FP_DB_Writer_Cache));
 
 	db_writer_cache->db = db;
@@ -122,17 +243,42 @@ Olaf_FP_DB_Writer_Cache * olaf_fp_db_writer_cache_new(Olaf_DB* db,Olaf_Config *
 	db_writer_cache->audio_file_identifier = 0;
 	db_writer_cache->audio_filename = NULL;
 
+	db_writer_cache->state = 0;
+	db_writer_cache->fp_hashes = NULL;
+	db_writer_cache->fp_values = NULL;
+	db_writer_cache->parsed_hashes = NULL;
 	db_writer_cache->fp_index = 0;
+	db_writer_cache->fp_capacity = 0;
+	db_writer_cache->data = NULL;
+	db_writer_cache->data_size = 0;
+
 	db_writer_cache->fp_counter = 0;
+	db_writer_cache->last_fp_t1 = 0;
 
-	db_writer_cache->csv_filename = csv_filename;
+	db_writer_cache->cache_filename = cache_filename;
 
 	return db_writer_cache;
 }
 
+void olaf_fp_db_writer_cache_load(Olaf_FP_DB_Writer_Cache * db_writer_cache){
+	if(db_writer_cache->state != 0) return;
+
+	int binary = olaf_fp_db_writer_cache_read_binary_file(db_writer_cache);
+	if(binary == 0) olaf_fp_db_writer_cache_read_csv_file(db_writer_cache);
+	db_writer_cache->state = binary < 0 ? -1 : 1;
+}
+
 void olaf_fp_db_writer_cache_store( Olaf_FP_DB_Writer_Cache * db_writer_cache){
 	
-	olaf_fp_db_writer_cache_read_csv_file(db_writer_cache);
+	olaf_fp_db_writer_cache_load(db_writer_cache);
+	if(db_writer_cache->state < 0) return;
+
+	//the keys are only read by the database
+	for(size_t start = 0 ; start < db_writer_cache->fp_index ; start += FP_ARRAY_SIZE){
+		size_t count = db_writer_cache->fp_index - start < FP_ARRAY_SIZE ? db_writer_cache->fp_index - start : FP_ARRAY_SIZE;
+		olaf_db_store(db_writer_cache->db,(uint64_t *) (db_writer_cache->fp_hashes + start),db_writer_cache->fp_values + start,count);
+	}
+	olaf_fp_db_writer_cache_release(db_writer_cache);
 
 	float secondsPerBlock = ((float) db_writer_cache->config->audioStepSize) / ((float) db_writer_cache->config->audioSampleRate);
 
@@ -146,12 +292,103 @@ void olaf_fp_db_writer_cache_store( Olaf_FP_DB_Writer_Cache * db_writer_cache){
 	meta_data.fingerprints = db_writer_cache->fp_counter;
 	uint32_t audio_identifier = (uint32_t) db_writer_cache->audio_file_identifier;
 	olaf_db_store_meta_data(db_writer_cache->db,&audio_identifier,&meta_data);
+
+	//a cache file is stored once
+	db_writer_cache->state = -1;
+}
+
+//Shared state of the threads loading cache files for olaf_fp_db_writer_cache_store_all
+struct olaf_fp_db_writer_cache_loader{
+	Olaf_FP_DB_Writer_Cache ** cache_writers; /**< The cache writers to load and store, in order */
+	bool * loaded; /**< True for each loaded cache writer */
+	size_t size; /**< The number of cache writers */
+	size_t window; /**< The maximum number of loaded cache writers waiting to be stored */
+	size_t next; /**< The next cache writer to load */
+	size_t stored; /**< The number of stored cache writers */
+	pthread_mutex_t lock; /**< Guards the indexes and loaded flags */
+	pthread_cond_t changed; /**< Signals a loaded or stored cache writer */
+};
+
+//Load the cache writer at index, the lock is held on entry and exit
+static void olaf_fp_db_writer_cache_load_next(struct olaf_fp_db_writer_cache_loader * loader){
+	size_t index = loader->next++;
+	pthread_mutex_unlock(&loader->lock);
+	olaf_fp_db_writer_cache_load(loader->cache_writers[index]);
+	pthread_mutex_lock(&loader->lock);
+	loader->loaded[index] = true;
+	pthread_cond_broadcast(&loader->changed);
+}
+
+static void * olaf_fp_db_writer_cache_load_worker(void * arg){
+	struct olaf_fp_db_writer_cache_loader * loader = (struct olaf_fp_db_writer_cache_loader *) arg;
+	pthread_mutex_lock(&loader->lock);
+	while(loader->next < loader->size){
+		if(loader->next >= loader->stored + loader->window){
+			pthread_cond_wait(&loader->changed,&loader->lock);
+		}else{
+			olaf_fp_db_writer_cache_load_next(loader);
+		}
+	}
+	pthread_mutex_unlock(&loader->lock);
+	return NULL;
+}
+
+void olaf_fp_db_writer_cache_store_all(Olaf_FP_DB_Writer_Cache ** cache_writers, size_t size, size_t threads){
+	if(threads <= 1 || size <= 1){
+		for(size_t i = 0 ; i < size ; i++){
+			olaf_fp_db_writer_cache_store(cache_writers[i]);
+		}
+		return;
+	}
+
+	struct olaf_fp_db_writer_cache_loader loader;
+	loader.cache_writers = cache_writers;
+	loader.loaded = (bool *) calloc(size,sizeof(bool));
+	loader.size = size;
+	loader.window = 2 * threads;
+	loader.next = 0;
+	loader.stored = 0;
+	pthread_mutex_init(&loader.lock,NULL);
+	pthread_cond_init(&loader.changed,NULL);
+
+	pthread_t * workers = (pthread_t *) malloc(threads * sizeof(pthread_t));
+	size_t started = 0;
+	for(size_t t = 0 ; t < threads ; t++){
+		if(pthread_create(&workers[started],NULL,olaf_fp_db_writer_cache_load_worker,&loader) == 0) started++;
+	}
+
+	//the database is only written on this thread, in the order of the cache writers
+	pthread_mutex_lock(&loader.lock);
+	for(size_t i = 0 ; i < size ; i++){
+		while(!loader.loaded[i]){
+			//not yet taken by a worker: load it here
+			if(loader.next == i){
+				olaf_fp_db_writer_cache_load_next(&loader);
+			}else{
+				pthread_cond_wait(&loader.changed,&loader.lock);
+			}
+		}
+		pthread_mutex_unlock(&loader.lock);
+		olaf_fp_db_writer_cache_store(cache_writers[i]);
+		pthread_mutex_lock(&loader.lock);
+		loader.stored++;
+		pthread_cond_broadcast(&loader.changed);
+	}
+	pthread_mutex_unlock(&loader.lock);
+
+	for(size_t t = 0 ; t < started ; t++){
+		pthread_join(workers[t],NULL);
+	}
+	free(workers);
+	free(loader.loaded);
+	pthread_mutex_destroy(&loader.lock);
+	pthread_cond_destroy(&loader.changed);
 }
 
 void olaf_fp_db_writer_cache_destroy(Olaf_FP_DB_Writer_Cache * db_writer_cache){
 	if(db_writer_cache->audio_filename !=NULL){
 		free((void*)db_writer_cache->audio_filename);
 	}
-	//store or delete remaining hashes
+	olaf_fp_db_writer_cache_release(db_writer_cache);
 	free(db_writer_cache);
 }
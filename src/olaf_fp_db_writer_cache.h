@@ -18,8 +18,14 @@
 /**
  * @file olaf_fp_db_writer_cache.h
  *
- * @brief Reads fingerprints from a csv file and stores them in a database.
+ * @brief Reads fingerprints from a cache file and stores them in a database.
  *
+ * A cache file is either in the binary cache format, see olaf_fp_file_writer.h, or a csv 
+ * file with a fingerprint hash and t1 on each line. A binary cache file is memory mapped 
+ * and its columns are handed to the database without parsing.
+ *
+ * Many cache files can be stored with olaf_fp_db_writer_cache_store_all(): the files are 
+ * read and parsed by several threads while the database is written on the calling thread.
  */
 
 #ifndef OLAF_FP_DB_WRITER_CACHE_H
@@ -35,7 +41,7 @@
 	#define MAX_LINE_LEN 2048
 	/** @brief Maximum length of a single token in the CSV file. */
 	#define MAX_TOKEN_LEN 512
-	/** @brief Size of the fingerprint array buffer. */
+	/** @brief Number of fingerprints handed to the database at once. */
 	#define FP_ARRAY_SIZE 10000
 	
 	/**
@@ -53,19 +59,39 @@
 	 *
 	 * @param      db            The database.
 	 * @param      config        The configuration.
-	 * @param[in]  csv_filename  The csv filename to parse and store.
+	 * @param[in]  cache_filename  The binary or csv cache file to store.
 	 *
 	 * @return     Newly initialized state information.
 	 */
-	Olaf_FP_DB_Writer_Cache * olaf_fp_db_writer_cache_new(Olaf_DB* db,Olaf_Config * config,const char *csv_filename);
+	Olaf_FP_DB_Writer_Cache * olaf_fp_db_writer_cache_new(Olaf_DB* db,Olaf_Config * config,const char *cache_filename);
+
+	/**
+	 * @brief      Read the cache file into memory without accessing the database. This can 
+	 * be called on another thread than the one storing the fingerprints. The audio file 
+	 * information needs to be set before loading.
+	 *
+	 * @param      olaf_fp_db_writer_cache  The olaf fp database writer cache
+	 */
+	void olaf_fp_db_writer_cache_load( Olaf_FP_DB_Writer_Cache * olaf_fp_db_writer_cache);
 
 	/**
-	 * @brief      Read the csv file and store the fingerpints within the file. Or an error if the CSV is malformed.
+	 * @brief      Read the cache file, if not loaded yet, and store the fingerpints within the file. A binary cache 
+	 * file extracted with another configuration, see olaf_config_digest(), is not stored.
 	 *
 	 * @param      olaf_fp_db_writer_cache  The olaf fp database writer cache
 	 */
 	void olaf_fp_db_writer_cache_store( Olaf_FP_DB_Writer_Cache * olaf_fp_db_writer_cache);
 
+	/**
+	 * @brief      Store many cache files. The files are loaded in parallel, at most a few 
+	 * files ahead of the database writes, and stored in order on the calling thread.
+	 *
+	 * @param      cache_writers  The cache writers to store, with their audio file information set.
+	 * @param[in]  size           The number of cache writers.
+	 * @param[in]  threads        The number of threads loading cache files.
+	 */
+	void olaf_fp_db_writer_cache_store_all(Olaf_FP_DB_Writer_Cache ** cache_writers, size_t size, size_t threads);
+
 	/**
 	 * @brief      Set the audio file path and identifier for the cache writer.
 	 *
@@ -76,7 +102,7 @@
 	void olaf_fp_db_writer_cache_set_audio_file_info(Olaf_FP_DB_Writer_Cache *olaf_fp_db_writer_cache, const char *audio_file_path, uint64_t audio_file_identifier);
 
 	/**
-	 * @brief      Free resources and close the CSV file.
+	 * @brief      Free resources.
 	 *
 	 * @param      olaf_fp_db_writer_cache  The olaf fp database writer cache
 	 */
@@ -52,11 +52,17 @@ Olaf_FP_DB_Writer * olaf_fp_db_writer_new(Olaf_DB* db,uint32_t audio_file_identi
 	return db_writer;
 }
 
+Olaf_FP_DB_Writer * olaf_fp_db_writer_new_queued(Olaf_FP_DB_Writer_Queue * queue,uint32_t audio_file_identifier){
+	//There is no writer thread for the memory database
+	(void)(queue);
+	return olaf_fp_db_writer_new(NULL,audio_file_identifier);
+}
+
 void olaf_fp_db_writer_store( Olaf_FP_DB_Writer * db_writer , struct extracted_fingerprints * fingerprints ){
 
 	for(size_t i = 0 ; i < fingerprints->fingerprintIndex; i++){
-		uint64_t fp_hash = olaf_fp_extractor_hash(fingerprints->fingerprints[i]);
-		uint64_t fp_time = (uint16_t) fingerprints->fingerprints[i].timeIndex1;
+		uint64_t fp_hash = fingerprints->hashes[i];
+		uint64_t fp_time = (uint16_t) fingerprints->timeIndexes[i];
 		if(db_writer->index < db_writer->hashes_size){
 			uint64_t hash_with_time = (fp_hash << 16) + fp_time;
 			db_writer->hashes[db_writer->index]= hash_with_time;
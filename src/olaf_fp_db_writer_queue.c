@@ -0,0 +1,213 @@
+// Olaf: Overly Lightweight Acoustic Fingerprinting
+// Copyright (C) 2019-2025  Joren Six
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "olaf_fp_db_writer_queue.h"
+#include "olaf_db.h"
+
+#define OLAF_QUEUE_ITEM_STORE 1
+#define OLAF_QUEUE_ITEM_DELETE 2
+#define OLAF_QUEUE_ITEM_STORE_META_DATA 3
+#define OLAF_QUEUE_ITEM_DELETE_META_DATA 4
+
+struct Olaf_FP_DB_Writer_Queue_Item{
+	int action; /**< What to do with the item: store, delete, store meta-data or delete meta-data */
+	uint64_t * keys; /**< Fingerprint hashes, owned by the queue */
+	uint64_t * values; /**< Fingerprint values, owned by the queue */
+	size_t size; /**< The size of both keys and values */
+	uint32_t audio_identifier; /**< The audio identifier for meta-data items */
+	Olaf_Resource_Meta_data meta_data; /**< Meta-data for meta-data store items */
+};
+
+struct Olaf_FP_DB_Writer_Queue{
+	struct Olaf_FP_DB_Writer_Queue_Item * items; /**< Ring buffer with queued items */
+	size_t capacity; /**< Maximum number of queued items */
+	size_t head; /**< Index of the next item to write to the database */
+	size_t count; /**< Number of queued items */
+
+	bool closed; /**< True when no more items are expected */
+
+	pthread_mutex_t lock; /**< Guards the ring buffer state */
+	pthread_cond_t not_empty; /**< Signalled when an item is pushed or the queue is closed */
+	pthread_cond_t not_full; /**< Signalled when the writer takes an item */
+
+	pthread_t writer_thread; /**< The thread owning the database and write transaction */
+
+	char * db_file_folder; /**< A copy of the database folder */
+
+	bool resource_index; /**< Whether the writer creates the resource index */
+};
+
+static void olaf_fp_db_writer_queue_apply(Olaf_DB * db, struct Olaf_FP_DB_Writer_Queue_Item * item){
+	switch(item->action){
+		case OLAF_QUEUE_ITEM_STORE:
+			olaf_db_store(db,item->keys,item->values,item->size);
+			break;
+		case OLAF_QUEUE_ITEM_DELETE:
+			olaf_db_delete(db,item->keys,item->values,item->size);
+			break;
+		case OLAF_QUEUE_ITEM_STORE_META_DATA:
+			olaf_db_store_meta_data(db,&item->audio_identifier,&item->meta_data);
+			break;
+		case OLAF_QUEUE_ITEM_DELETE_META_DATA:
+			olaf_db_delete_meta_data(db,&item->audio_identifier);
+			break;
+	}
+	free(item->keys);
+	free(item->values);
+}
+
+static void * olaf_fp_db_writer_queue_run(void * arg){
+	Olaf_FP_DB_Writer_Queue * queue = (Olaf_FP_DB_Writer_Queue *) arg;
+
+	//The write transaction is bound to the thread that starts it, 
+	//so the database is opened, written and committed here.
+	Olaf_DB * db = olaf_db_new(queue->db_file_folder,false);
+
+	if(queue->resource_index){
+		olaf_db_enable_resource_index(db);
+	}
+
+	//A fresh index is built in key order when the queue is destroyed
+	olaf_db_start_bulk_load(db);
+
+	while(true){
+		pthread_mutex_lock(&queue->lock);
+		while(queue->count == 0 && !queue->closed){
+			pthread_cond_wait(&queue->not_empty,&queue->lock);
+		}
+		if(queue->count == 0 && queue->closed){
+			pthread_mutex_unlock(&queue->lock);
+			break;
+		}
+		struct Olaf_FP_DB_Writer_Queue_Item item = queue->items[queue->head];
+		queue->head = (queue->head + 1) % queue->capacity;
+		queue->count--;
+		pthread_cond_signal(&queue->not_full);
+		pthread_mutex_unlock(&queue->lock);
+
+		//the database is written without holding the queue lock
+		olaf_fp_db_writer_queue_apply(db,&item);
+	}
+
+	//commits the transaction
+	olaf_db_destroy(db);
+
+	return NULL;
+}
+
+static void olaf_fp_db_writer_queue_push(Olaf_FP_DB_Writer_Queue * queue, struct Olaf_FP_DB_Writer_Queue_Item * item){
+	pthread_mutex_lock(&queue->lock);
+	while(queue->count == queue->capacity){
+		pthread_cond_wait(&queue->not_full,&queue->lock);
+	}
+	size_t tail = (queue->head + queue->count) % queue->capacity;
+	queue->items[tail] = *item;
+	queue->count++;
+	pthread_cond_signal(&queue->not_empty);
+	pthread_mutex_unlock(&queue->lock);
+}
+
+static void olaf_fp_db_writer_queue_push_fingerprints(Olaf_FP_DB_Writer_Queue * queue, int action, uint64_t * keys, uint64_t * values, size_t size){
+	if(size == 0) return;
+
+	struct Olaf_FP_DB_Writer_Queue_Item item;
+	memset(&item,0,sizeof(item));
+	item.action = action;
+	item.size = size;
+	item.keys = (uint64_t *) malloc(size * sizeof(uint64_t));
+	item.values = (uint64_t *) malloc(size * sizeof(uint64_t));
+	memcpy(item.keys,keys,size * sizeof(uint64_t));
+	memcpy(item.values,values,size * sizeof(uint64_t));
+
+	olaf_fp_db_writer_queue_push(queue,&item);
+}
+
+Olaf_FP_DB_Writer_Queue * olaf_fp_db_writer_queue_new(const char * db_file_folder, size_t capacity, bool resource_index){
+	Olaf_FP_DB_Writer_Queue * queue = (Olaf_FP_DB_Writer_Queue *) malloc(sizeof(Olaf_FP_DB_Writer_Queue));
+
+	if(capacity == 0) capacity = 1;
+
+	queue->items = (struct Olaf_FP_DB_Writer_Queue_Item *) calloc(capacity,sizeof(struct Olaf_FP_DB_Writer_Queue_Item));
+	queue->capacity = capacity;
+	queue->head = 0;
+	queue->count = 0;
+	queue->closed = false;
+
+	size_t folder_length = strlen(db_file_folder) + 1;
+	queue->db_file_folder = (char *) malloc(folder_length);
+	memcpy(queue->db_file_folder,db_file_folder,folder_length);
+	queue->resource_index = resource_index;
+
+	pthread_mutex_init(&queue->lock,NULL);
+	pthread_cond_init(&queue->not_empty,NULL);
+	pthread_cond_init(&queue->not_full,NULL);
+
+	if(pthread_create(&queue->writer_thread,NULL,olaf_fp_db_writer_queue_run,queue) != 0){
+		fprintf(stderr,"Error: could not start the database writer thread\n");
+		exit(-42);
+	}
+
+	return queue;
+}
+
+void olaf_fp_db_writer_queue_store(Olaf_FP_DB_Writer_Queue * queue, uint64_t * keys, uint64_t * values, size_t size){
+	olaf_fp_db_writer_queue_push_fingerprints(queue,OLAF_QUEUE_ITEM_STORE,keys,values,size);
+}
+
+void olaf_fp_db_writer_queue_delete(Olaf_FP_DB_Writer_Queue * queue, uint64_t * keys, uint64_t * values, size_t size){
+	olaf_fp_db_writer_queue_push_fingerprints(queue,OLAF_QUEUE_ITEM_DELETE,keys,values,size);
+}
+
+void olaf_fp_db_writer_queue_store_meta_data(Olaf_FP_DB_Writer_Queue * queue, uint32_t key, Olaf_Resource_Meta_data * meta_data){
+	struct Olaf_FP_DB_Writer_Queue_Item item;
+	memset(&item,0,sizeof(item));
+	item.action = OLAF_QUEUE_ITEM_STORE_META_DATA;
+	item.audio_identifier = key;
+	item.meta_data = *meta_data;
+	olaf_fp_db_writer_queue_push(queue,&item);
+}
+
+void olaf_fp_db_writer_queue_delete_meta_data(Olaf_FP_DB_Writer_Queue * queue, uint32_t key){
+	struct Olaf_FP_DB_Writer_Queue_Item item;
+	memset(&item,0,sizeof(item));
+	item.action = OLAF_QUEUE_ITEM_DELETE_META_DATA;
+	item.audio_identifier = key;
+	olaf_fp_db_writer_queue_push(queue,&item);
+}
+
+void olaf_fp_db_writer_queue_destroy(Olaf_FP_DB_Writer_Queue * queue){
+	pthread_mutex_lock(&queue->lock);
+	queue->closed = true;
+	pthread_cond_signal(&queue->not_empty);
+	pthread_mutex_unlock(&queue->lock);
+
+	//wait for the writer to drain the queue and commit
+	pthread_join(queue->writer_thread,NULL);
+
+	pthread_cond_destroy(&queue->not_full);
+	pthread_cond_destroy(&queue->not_empty);
+	pthread_mutex_destroy(&queue->lock);
+
+	free(queue->db_file_folder);
+	free(queue->items);
+	free(queue);
+}
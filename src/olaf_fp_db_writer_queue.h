@@ -0,0 +1,109 @@
+// Olaf: Overly Lightweight Acoustic Fingerprinting
+// Copyright (C) 2019-2025  Joren Six
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+/**
+ * @file olaf_fp_db_writer_queue.h
+ *
+ * @brief A bounded queue between fingerprint extraction and a single database writer thread.
+ *
+ * LMDB allows only one write transaction at a time. When several audio files are stored in 
+ * parallel, each worker would otherwise hold the writer lock for the full duration of 
+ * decoding, FFT and fingerprint extraction. With this queue, workers only extract 
+ * fingerprints and push (hash, value) batches. One dedicated thread owns the database, 
+ * the single write transaction and the final commit.
+ * 
+ * Batches from a single producer are applied in the order they were pushed, so 
+ * meta-data pushed after the fingerprints of a file is stored after those fingerprints.
+ *
+ */
+
+#ifndef OLAF_FP_DB_WRITER_QUEUE_H
+#define OLAF_FP_DB_WRITER_QUEUE_H
+	#include <stdbool.h>
+	#include <stdint.h>
+	#include <stdlib.h>
+
+	#include "olaf_db.h"
+	#include "olaf_resource_meta_data.h"
+
+	/**
+     * @struct Olaf_FP_DB_Writer_Queue
+     * @brief An opaque struct with the queue, its synchronization primitives and the writer thread.
+     * 
+     */
+	/** @typedef Olaf_FP_DB_Writer_Queue
+	 *  @brief Typedef for struct Olaf_FP_DB_Writer_Queue.
+	 */
+	typedef struct Olaf_FP_DB_Writer_Queue Olaf_FP_DB_Writer_Queue;
+
+	/**
+	 * @brief      Open the database in write mode on a new writer thread and start consuming batches.
+	 *
+	 * @param[in]  db_file_folder  The folder with the database files.
+	 * @param[in]  capacity        The maximum number of batches waiting in the queue. Producers block when the queue is full.
+	 * @param[in]  resource_index  Create the resource index if it does not exist, see olaf_db_enable_resource_index.
+	 *
+	 * @return     A new queue with a running writer thread.
+	 */
+	Olaf_FP_DB_Writer_Queue * olaf_fp_db_writer_queue_new(const char * db_file_folder, size_t capacity, bool resource_index);
+
+	/**
+	 * @brief      Queue a batch of fingerprints to store. The arrays are copied, the caller keeps ownership.
+	 *
+	 * @param      queue   The queue.
+	 * @param      keys    The fingerprint hashes.
+	 * @param      values  The values: time stamp and audio identifier.
+	 * @param[in]  size    The size of both arrays.
+	 */
+	void olaf_fp_db_writer_queue_store(Olaf_FP_DB_Writer_Queue * queue, uint64_t * keys, uint64_t * values, size_t size);
+
+	/**
+	 * @brief      Queue a batch of fingerprints to delete. The arrays are copied, the caller keeps ownership.
+	 *
+	 * @param      queue   The queue.
+	 * @param      keys    The fingerprint hashes.
+	 * @param      values  The values: time stamp and audio identifier.
+	 * @param[in]  size    The size of both arrays.
+	 */
+	void olaf_fp_db_writer_queue_delete(Olaf_FP_DB_Writer_Queue * queue, uint64_t * keys, uint64_t * values, size_t size);
+
+	/**
+	 * @brief      Queue meta-data to store.
+	 *
+	 * @param      queue      The queue.
+	 * @param[in]  key        The audio identifier.
+	 * @param      meta_data  The meta-data, copied into the queue.
+	 */
+	void olaf_fp_db_writer_queue_store_meta_data(Olaf_FP_DB_Writer_Queue * queue, uint32_t key, Olaf_Resource_Meta_data * meta_data);
+
+	/**
+	 * @brief      Queue the removal of meta-data.
+	 *
+	 * @param      queue  The queue.
+	 * @param[in]  key    The audio identifier.
+	 */
+	void olaf_fp_db_writer_queue_delete_meta_data(Olaf_FP_DB_Writer_Queue * queue, uint32_t key);
+
+	/**
+	 * @brief      Wait until all queued batches are written, commit the transaction, stop the writer thread 
+	 * and free resources. No producer should push after or during this call.
+	 *
+	 * @param      queue  The queue.
+	 */
+	void olaf_fp_db_writer_queue_destroy(Olaf_FP_DB_Writer_Queue * queue);
+
+#endif //OLAF_FP_DB_WRITER_QUEUE_H
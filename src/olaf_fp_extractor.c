@@ -30,6 +30,7 @@ struct Olaf_FP_Extractor{
 	Olaf_Config * config; /**< Reference to the Olaf configuration */
 	size_t total_fp_extracted; /**< Total number of fingerprints extracted so far */
 	bool warning_given; /**< Whether a warning has already been emitted */
+	bool keep_details; /**< Whether the full fingerprint details are stored next to the hashes */
 };
 
 Olaf_FP_Extractor * olaf_fp_extractor_new(Olaf_Config * config){
@@ -41,22 +42,33 @@ Olaf_FP_Extractor * olaf_fp_extractor_new(Olaf_Config * config){
 	fp_extractor->config = config;
 
 	fp_extractor->fingerprints.fingerprints = (struct fingerprint *) calloc(config->maxFingerprints , sizeof(struct fingerprint));
+	fp_extractor->fingerprints.hashes = (uint64_t *) calloc(config->maxFingerprints , sizeof(uint64_t));
+	fp_extractor->fingerprints.timeIndexes = (uint32_t *) calloc(config->maxFingerprints , sizeof(uint32_t));
 
 	fp_extractor->fingerprints.fingerprintIndex = 0;
+	fp_extractor->fingerprints.lastTimeIndex = 0;
+	fp_extractor->keep_details = true;
 	fp_extractor->total_fp_extracted=0;
 
 	return fp_extractor;
 }
 
 void olaf_fp_extractor_destroy(Olaf_FP_Extractor * fp_extractor){
+	free(fp_extractor->fingerprints.timeIndexes);
+	free(fp_extractor->fingerprints.hashes);
 	free(fp_extractor->fingerprints.fingerprints);
 	free(fp_extractor);
 }
 
-int olaf_ep_compare_event_points (const void * a, const void * b) {
-	struct eventpoint aPoint = *(struct eventpoint*) a;
-	struct eventpoint bPoint = *(struct eventpoint*) b;
-	return (aPoint.timeIndex - bPoint.timeIndex);
+void olaf_fp_extractor_reset(Olaf_FP_Extractor * fp_extractor){
+	fp_extractor->fingerprints.fingerprintIndex = 0;
+	fp_extractor->fingerprints.lastTimeIndex = 0;
+	fp_extractor->total_fp_extracted = 0;
+	fp_extractor->warning_given = false;
+}
+
+void olaf_fp_extractor_keep_details(Olaf_FP_Extractor * fp_extractor, bool keep_details){
+	fp_extractor->keep_details = keep_details || fp_extractor->config->verbose;
 }
 
 size_t olaf_fp_extractor_total(Olaf_FP_Extractor * fp_extractor){
@@ -89,30 +101,16 @@ size_t olaf_fp_extractor_total(Olaf_FP_Extractor * fp_extractor){
 //A binary search for 1546xx in the reference database ends up at one of the above arrows. 
 //Subsequently all the 1546xx values are identified by iteration in both directions.
 //
-uint64_t olaf_fp_extractor_hash(struct fingerprint f){
-	int f1 = f.frequencyBin1;
-	int f2 = f.frequencyBin2;
-	int f3 = f.frequencyBin3;
-
-	int t1 = f.timeIndex1;
-	int t2 = f.timeIndex2;
-	int t3 = f.timeIndex3;
-
-	float m1 = f.magnitude1;
-	float m2 = f.magnitude2;
-	float m3 = f.magnitude3;
+static inline uint64_t olaf_fp_extractor_hash_event_points(int f1,int t1,int f2,int t2,int f3,int t3){
 
 	uint64_t f1LargerThanF2 = f1 > f2 ? 1 : 0;
 	uint64_t f2LargerThanF3 = f2 > f3 ? 1 : 0;
 	uint64_t f3LargerThanF1 = f3 > f1 ? 1 : 0;
 
-	uint64_t m1LargerThanm2 = m1 > m2 ? 1 : 0;
-	uint64_t m2LargerThanm3 = m2 > m3 ? 1 : 0;
-	uint64_t m3LargerThanm1 = m3 > m1 ? 1 : 0;
-	
-	m1LargerThanm2 = 0;
-	m2LargerThanm3 = 0;
-	m3LargerThanm1 = 0;
+	//magnitude information is not used in the hash
+	uint64_t m1LargerThanm2 = 0;
+	uint64_t m2LargerThanm3 = 0;
+	uint64_t m3LargerThanm1 = 0;
 
 	uint64_t dt1t2LargerThant3t2 = (t2 - t1) > (t3 - t2) ? 1 : 0;
 	uint64_t df1f2LargerThanf3f2 = abs(f2 - f1) > abs(f3 - f2) ? 1 : 0;
@@ -144,6 +142,35 @@ uint64_t olaf_fp_extractor_hash(struct fingerprint f){
 	return hash;
 }
 
+uint64_t olaf_fp_extractor_hash(struct fingerprint f){
+	return olaf_fp_extractor_hash_event_points(f.frequencyBin1,f.timeIndex1,f.frequencyBin2,f.timeIndex2,f.frequencyBin3,f.timeIndex3);
+}
+
+//Stores a fingerprint: the hash is calculated once here, consumers only read the hash and t1
+static inline void olaf_fp_extractor_add(Olaf_FP_Extractor * fp_extractor,int t1,int f1,float m1,int t2,int f2,float m2,int t3,int f3,float m3){
+	struct extracted_fingerprints * fingerprints = &fp_extractor->fingerprints;
+	size_t index = fingerprints->fingerprintIndex;
+
+	fingerprints->hashes[index] = olaf_fp_extractor_hash_event_points(f1,t1,f2,t2,f3,t3);
+	fingerprints->timeIndexes[index] = (uint32_t) t1;
+	fingerprints->lastTimeIndex = t3;
+
+	if(fp_extractor->keep_details){
+		struct fingerprint * f = &fingerprints->fingerprints[index];
+		f->timeIndex1 = t1;
+		f->timeIndex2 = t2;
+		f->timeIndex3 = t3;
+
+		f->frequencyBin1 = f1;
+		f->frequencyBin2 = f2;
+		f->frequencyBin3 = f3;
+
+		f->magnitude1 = m1;
+		f->magnitude2 = m2;
+		f->magnitude3 = m3;
+	}
+}
+
 void olaf_fp_extractor_print(struct fingerprint f){
 	fprintf(stderr,"FP hash: %" PRIu64 " \n", olaf_fp_extractor_hash(f));
 	fprintf(stderr,"\tt1: %d, f1: %d, m1: %.3f\n", f.timeIndex1,f.frequencyBin1,f.magnitude1);
@@ -242,18 +269,7 @@ struct extracted_fingerprints * olaf_fp_extractor_extract_three(Olaf_FP_Extracto
 						}else{
 
 
-							//temporarily store (do not increment fingerprint index, unless it is not yet discovered)
-							fp_extractor->fingerprints.fingerprints[fp_extractor->fingerprints.fingerprintIndex].timeIndex1 = t1;
-							fp_extractor->fingerprints.fingerprints[fp_extractor->fingerprints.fingerprintIndex].timeIndex2 = t2;
-							fp_extractor->fingerprints.fingerprints[fp_extractor->fingerprints.fingerprintIndex].timeIndex3 = t3;
-
-							fp_extractor->fingerprints.fingerprints[fp_extractor->fingerprints.fingerprintIndex].frequencyBin1 = f1;				
-							fp_extractor->fingerprints.fingerprints[fp_extractor->fingerprints.fingerprintIndex].frequencyBin2 = f2;
-							fp_extractor->fingerprints.fingerprints[fp_extractor->fingerprints.fingerprintIndex].frequencyBin3 = f3;
-							
-							fp_extractor->fingerprints.fingerprints[fp_extractor->fingerprints.fingerprintIndex].magnitude1 = m1;				
-							fp_extractor->fingerprints.fingerprints[fp_extractor->fingerprints.fingerprintIndex].magnitude2 = m2;
-							fp_extractor->fingerprints.fingerprints[fp_extractor->fingerprints.fingerprintIndex].magnitude3 = m3;
+							olaf_fp_extractor_add(fp_extractor,t1,f1,m1,t2,f2,m2,t3,f3,m3);
 
 							//count event point usages:
 							eventPoints->eventPoints[i].usages++;
@@ -338,18 +354,8 @@ struct extracted_fingerprints * olaf_fp_extractor_extract_two(Olaf_FP_Extractor
 					}
 				}else{
 					
-					//temporarily store (do not increment fingerprint index, unless it is not yet discovered)
-					fp_extractor->fingerprints.fingerprints[fp_extractor->fingerprints.fingerprintIndex].timeIndex1 = t1;
-					fp_extractor->fingerprints.fingerprints[fp_extractor->fingerprints.fingerprintIndex].timeIndex2 = t2;
-					fp_extractor->fingerprints.fingerprints[fp_extractor->fingerprints.fingerprintIndex].timeIndex3 = t2;
-
-					fp_extractor->fingerprints.fingerprints[fp_extractor->fingerprints.fingerprintIndex].frequencyBin1 = f1;				
-					fp_extractor->fingerprints.fingerprints[fp_extractor->fingerprints.fingerprintIndex].frequencyBin2 = f2;
-					fp_extractor->fingerprints.fingerprints[fp_extractor->fingerprints.fingerprintIndex].frequencyBin3 = f2;
-					
-					fp_extractor->fingerprints.fingerprints[fp_extractor->fingerprints.fingerprintIndex].magnitude1 = m1;				
-					fp_extractor->fingerprints.fingerprints[fp_extractor->fingerprints.fingerprintIndex].magnitude2 = m2;
-					fp_extractor->fingerprints.fingerprints[fp_extractor->fingerprints.fingerprintIndex].magnitude3 = m2;
+					//the third event point is the second one
+					olaf_fp_extractor_add(fp_extractor,t1,f1,m1,t2,f2,m2,t2,f2,m2);
 
 					//count event point usages:
 					eventPoints->eventPoints[i].usages++;
@@ -390,32 +396,9 @@ struct extracted_fingerprints * olaf_fp_extractor_extract(Olaf_FP_Extractor * fp
 
 
 	int cutoffTime = eventPoints->eventPoints[eventPoints->eventPointIndex-1].timeIndex - fp_extractor->config->maxTimeDistance;
-	int maxEventPointUsages = fp_extractor->config->maxEventPointUsages;
-	//prepare the array for the next event loops
-	for(int i = 0 ; i < eventPoints->eventPointIndex ; i++){
-
-		//mark the event points that are too old, or used too many times
-		if(eventPoints->eventPoints[i].timeIndex <= cutoffTime || eventPoints->eventPoints[i].usages == maxEventPointUsages){
-			eventPoints->eventPoints[i].timeIndex = 1<<23;
-			eventPoints->eventPoints[i].frequencyBin = 0;
-			eventPoints->eventPoints[i].magnitude = 0;
-		}
-	}
-
-	//sort the array from low timeIndex to high
-	//the marked event points have a high time index
-	//qsort(eventPoints->eventPoints,fp_extractor->config->maxEventPoints, sizeof(struct eventpoint), olaf_ep_compare_event_points);
-	qsort(eventPoints->eventPoints,fp_extractor->config->maxEventPoints, sizeof(struct eventpoint), olaf_ep_compare_event_points);
-
-	//find the first marked event point: this is where the next point needs to be stored
-	for(int i = 0 ; i <eventPoints->eventPointIndex ; i++){
-
-		if(eventPoints->eventPoints[i].timeIndex == 1<<23){
-			//the next point needs to be stored at this index
-			eventPoints->eventPointIndex  = i;
-			break;
-		}
-	}
+	
+	//prepare the event points for the next event loops: remove the ones that are too old, or used too many times
+	olaf_ep_extractor_expire(eventPoints,cutoffTime,fp_extractor->config->maxEventPointUsages);
 
 	fp_extractor->total_fp_extracted+=fp_extractor->fingerprints.fingerprintIndex;
 	//eventPoints->eventPointIndex  = 0;
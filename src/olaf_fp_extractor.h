@@ -29,6 +29,7 @@
 	#include "olaf_config.h"
 	#include "olaf_ep_extractor.h"
 	#include <stdint.h>
+	#include <stdbool.h>
 	
     /**
 	 * @struct fingerprint
@@ -59,10 +60,17 @@
 	 * @brief The result of fingerprint extraction: a list of fingerprints
 	 * with a size. 
 	 * 
+	 * For each fingerprint the hash and the time index of the first event point 
+	 * are stored in separate arrays: this is all that is needed to store or match 
+	 * fingerprints. The full fingerprint details are only kept on request, see 
+	 * olaf_fp_extractor_keep_details().
 	 */
 	struct extracted_fingerprints{
-		struct fingerprint * fingerprints; /**< Array of extracted fingerprints. */
+		struct fingerprint * fingerprints; /**< Array of extracted fingerprints, only filled in if details are kept. */
 		size_t fingerprintIndex; /**< The current index into the fingerprints array. */
+		uint64_t * hashes; /**< The hash of each extracted fingerprint. */
+		uint32_t * timeIndexes; /**< The time index of the first event point of each extracted fingerprint. */
+		int lastTimeIndex; /**< The time index of the last event point of the last extracted fingerprint. */
 	};
 	
 	/**
@@ -88,6 +96,22 @@
 	 */ 
 	void olaf_fp_extractor_destroy(Olaf_FP_Extractor * olaf_fp_extractor);
 
+	/**
+	 * Forget the fingerprints and the total so the extractor can be reused for the next 
+	 * audio file, without allocating memory again.
+	 * @param olaf_fp_extractor The state to reset.
+	 */
+	void olaf_fp_extractor_reset(Olaf_FP_Extractor * olaf_fp_extractor);
+
+	/**
+	 * Keep the full fingerprint details (time, frequency and magnitude of each event point) next 
+	 * to the hashes. By default details are kept. Storing or matching fingerprints only needs 
+	 * the hashes and time indexes. Details are always kept in verbose mode.
+	 * @param olaf_fp_extractor The state information.
+	 * @param keep_details True if the fingerprints array should be filled in.
+	 */
+	void olaf_fp_extractor_keep_details(Olaf_FP_Extractor * olaf_fp_extractor, bool keep_details);
+
 	/**
 	 * Extract fingerprints from a list of event points.
 	 * @param olaf_fp_extractor  The state information.
@@ -15,6 +15,7 @@
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdbool.h>
 #include <inttypes.h>
 #include <string.h>
 
@@ -22,27 +23,113 @@
 #include "olaf_fp_extractor.h"
 #include "olaf_db.h"
 
+//A fingerprint in the binary cache format
+struct olaf_fp_cache_entry{
+	uint64_t hash; /**< The fingerprint hash */
+	uint32_t t1; /**< The time index of the first event point */
+};
+
 struct Olaf_FP_File_Writer{
 	FILE * output_file; /**< The output file handle for writing fingerprints */
+
+	bool binary; /**< True for the binary cache format: fingerprints are written when the writer is destroyed */
+	struct olaf_fp_cache_header header; /**< The header of the binary cache file */
+	struct olaf_fp_cache_entry * entries; /**< The fingerprints to write to the binary cache file */
+	size_t entries_capacity; /**< The allocated number of entries */
 };
 
 Olaf_FP_File_Writer * olaf_fp_file_writer_new( FILE * output_file){
 	Olaf_FP_File_Writer *file_writer = (Olaf_FP_File_Writer *) malloc(sizeof(Olaf_FP_File_Writer));
 	file_writer->output_file = output_file;
+	file_writer->binary = false;
+	file_writer->entries = NULL;
+	file_writer->entries_capacity = 0;
+	return file_writer;
+}
+
+Olaf_FP_File_Writer * olaf_fp_file_writer_new_binary( FILE * output_file, Olaf_Config * config, uint32_t audio_identifier){
+	Olaf_FP_File_Writer *file_writer = olaf_fp_file_writer_new(output_file);
+	file_writer->binary = true;
+
+	memset(&file_writer->header,0,sizeof(struct olaf_fp_cache_header));
+	memcpy(file_writer->header.magic,OLAF_FP_CACHE_MAGIC,sizeof(file_writer->header.magic));
+	file_writer->header.version = OLAF_FP_CACHE_VERSION;
+	file_writer->header.config_digest = olaf_config_digest(config);
+	file_writer->header.audio_identifier = audio_identifier;
+
+	file_writer->entries_capacity = 4096;
+	file_writer->entries = (struct olaf_fp_cache_entry *) malloc(file_writer->entries_capacity * sizeof(struct olaf_fp_cache_entry));
 	return file_writer;
 }
 
 void olaf_fp_file_writer_write_header(Olaf_FP_File_Writer * file_writer){
+	//the binary header is written together with the fingerprints
+	if(file_writer->binary) return;
+
 	fprintf(file_writer->output_file, "fp_hash, ");
 	fprintf(file_writer->output_file, "t1, f1, m1, ");
 	fprintf(file_writer->output_file, "t2, f2, m2, ");
 	fprintf(file_writer->output_file, "t3, f3, m3\n");
 }
 
+//Only the hashes and t1 are kept for the binary cache format
+static void olaf_fp_file_writer_add(Olaf_FP_File_Writer * file_writer , struct extracted_fingerprints * fingerprints ){
+	size_t size = (size_t) file_writer->header.fingerprints;
+	if(size + fingerprints->fingerprintIndex > file_writer->entries_capacity){
+		while(size + fingerprints->fingerprintIndex > file_writer->entries_capacity) file_writer->entries_capacity *= 2;
+		file_writer->entries = (struct olaf_fp_cache_entry *) realloc(file_writer->entries,file_writer->entries_capacity * sizeof(struct olaf_fp_cache_entry));
+	}
+	for(size_t i = 0 ; i < fingerprints->fingerprintIndex; i++){
+		file_writer->entries[size + i].hash = fingerprints->hashes[i];
+		file_writer->entries[size + i].t1 = fingerprints->timeIndexes[i];
+		if(fingerprints->timeIndexes[i] > file_writer->header.last_time_index){
+			file_writer->header.last_time_index = fingerprints->timeIndexes[i];
+		}
+	}
+	file_writer->header.fingerprints += fingerprints->fingerprintIndex;
+}
+
+static int olaf_fp_file_writer_compare(const void * a, const void * b){
+	const struct olaf_fp_cache_entry * first = (const struct olaf_fp_cache_entry *) a;
+	const struct olaf_fp_cache_entry * second = (const struct olaf_fp_cache_entry *) b;
+	if(first->hash != second->hash) return first->hash < second->hash ? -1 : 1;
+	if(first->t1 != second->t1) return first->t1 < second->t1 ? -1 : 1;
+	return 0;
+}
+
+//Write the header and the sorted columns of the binary cache format
+static void olaf_fp_file_writer_write_binary(Olaf_FP_File_Writer * file_writer){
+	size_t size = (size_t) file_writer->header.fingerprints;
+	qsort(file_writer->entries,size,sizeof(struct olaf_fp_cache_entry),olaf_fp_file_writer_compare);
+
+	//the entries are split in columns with a buffer for each block of entries
+	uint64_t hashes[1024];
+	uint32_t time_indexes[1024];
+
+	bool written = fwrite(&file_writer->header,sizeof(struct olaf_fp_cache_header),1,file_writer->output_file) == 1;
+	for(size_t start = 0 ; written && start < size ; start += 1024){
+		size_t count = size - start < 1024 ? size - start : 1024;
+		for(size_t i = 0 ; i < count ; i++) hashes[i] = file_writer->entries[start + i].hash;
+		written = fwrite(hashes,sizeof(uint64_t),count,file_writer->output_file) == count;
+	}
+	for(size_t start = 0 ; written && start < size ; start += 1024){
+		size_t count = size - start < 1024 ? size - start : 1024;
+		for(size_t i = 0 ; i < count ; i++) time_indexes[i] = file_writer->entries[start + i].t1;
+		written = fwrite(time_indexes,sizeof(uint32_t),count,file_writer->output_file) == count;
+	}
+	if(!written){
+		fprintf(stderr,"Error: could not write %zu cached fingerprints.\n",size);
+	}
+}
+
 void olaf_fp_file_writer_write( Olaf_FP_File_Writer * file_writer , struct extracted_fingerprints * fingerprints ){
+	if(file_writer->binary){
+		olaf_fp_file_writer_add(file_writer,fingerprints);
+		return;
+	}
 	for(size_t i = 0 ; i < fingerprints->fingerprintIndex; i++){
 		struct fingerprint f = fingerprints->fingerprints[i];
-		fprintf(file_writer->output_file, "%"PRIu64 ", ", olaf_fp_extractor_hash(f));
+		fprintf(file_writer->output_file, "%"PRIu64 ", ", fingerprints->hashes[i]);
 		fprintf(file_writer->output_file, "%d, %d, %.6f, ", f.timeIndex1,f.frequencyBin1,f.magnitude1);
 		fprintf(file_writer->output_file, "%d, %d, %.6f, ", f.timeIndex2,f.frequencyBin2,f.magnitude2);
 		fprintf(file_writer->output_file, "%d, %d, %.6f\n", f.timeIndex3,f.frequencyBin3,f.magnitude3);
@@ -51,6 +138,10 @@ void olaf_fp_file_writer_write( Olaf_FP_File_Writer * file_writer , struct extra
 
 void olaf_fp_file_writer_destroy(Olaf_FP_File_Writer * file_writer, Olaf_Resource_Meta_data * meta_data, FILE * fp_meta_file){
 
+	if(file_writer->binary){
+		olaf_fp_file_writer_write_binary(file_writer);
+		free(file_writer->entries);
+	}
 
 	if(file_writer->output_file != NULL && file_writer->output_file !=stdout) {
 		fclose(file_writer->output_file);
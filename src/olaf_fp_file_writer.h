@@ -17,18 +17,40 @@
 /**
  * @file olaf_fp_file_writer.h
  *
- * @brief Olaf fingerprint extractor: combines event points into fingerprints.
+ * @brief Writes fingerprints to a file: as text or in the binary cache format.
  *
- * The fingerprint extractor is responsible for combining event points into
- * fingerprints and also defines the fingerprint struct.
+ * The text format has a line with the hash and the details of each fingerprint. The binary 
+ * cache format is meant to be stored later on, see olaf_fp_db_writer_cache.h. It starts with 
+ * a header, struct olaf_fp_cache_header, followed by two columns: the hashes of the 
+ * fingerprints sorted in ascending order, each an uint64_t, and the t1 time index of each 
+ * fingerprint, each an uint32_t. Numbers are written in the native byte order.
  */
 
 #ifndef OLAF_FP_FILE_WRITER_H
 #define OLAF_FP_FILE_WRITER_H
 	#include <stdint.h>
 
+	#include "olaf_config.h"
 	#include "olaf_fp_extractor.h"
 	#include "olaf_resource_meta_data.h"
+
+	/** @brief The first bytes of a binary fingerprint cache file. */
+	#define OLAF_FP_CACHE_MAGIC "OLAFFPC"
+	/** @brief The version of the binary fingerprint cache format. */
+	#define OLAF_FP_CACHE_VERSION 1
+
+	/**
+	 * @struct olaf_fp_cache_header
+	 * @brief The header of a binary fingerprint cache file, followed by the hash and t1 columns.
+	 */
+	struct olaf_fp_cache_header{
+		char magic[7]; /**< OLAF_FP_CACHE_MAGIC without the terminating zero. */
+		uint8_t version; /**< OLAF_FP_CACHE_VERSION. */
+		uint64_t config_digest; /**< The olaf_config_digest() of the configuration used to extract the fingerprints. */
+		uint32_t audio_identifier; /**< The identifier of the audio file. */
+		uint32_t last_time_index; /**< The largest t1 of the fingerprints, a measure for the duration. */
+		uint64_t fingerprints; /**< The number of fingerprints, the length of both columns. */
+	};
 	
 	/**
 	 * @struct Olaf_FP_File_Writer
@@ -51,7 +73,19 @@
 	Olaf_FP_File_Writer * olaf_fp_file_writer_new( FILE * output_file);
 
 	/**
-	 * @brief      Write the header line to the file.
+	 * @brief      Create a new file writer for the binary cache format. The fingerprints are kept 
+	 * in memory, sorted and written when the writer is destroyed.
+	 *
+	 * @param      output_file        The output file, opened in binary mode.
+	 * @param      config             The configuration used to extract the fingerprints.
+	 * @param[in]  audio_identifier   The identifier of the audio file.
+	 *
+	 * @return     State information related to file writer.
+	 */
+	Olaf_FP_File_Writer * olaf_fp_file_writer_new_binary( FILE * output_file, Olaf_Config * config, uint32_t audio_identifier);
+
+	/**
+	 * @brief      Write the header line to a text file.
 	 *
 	 * @param      file_writer  The olaf fp file writer state information.
 	 */
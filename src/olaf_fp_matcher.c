@@ -17,8 +17,8 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <inttypes.h>
+#include <limits.h>
 
-#include "hash-table.h"
 #include "olaf_fp_matcher.h"
 #include "olaf_fp_extractor.h"
 #include "olaf_db.h"
@@ -39,63 +39,248 @@ struct match_result{
 
 	uint32_t matchIdentifier; /**< The matching audio file identifier */
 
-	uint64_t result_hash_table_key; /**< The key used in the hash table */
+	uint64_t result_hash_table_key; /**< The key used in the vote table */
+
+	uint32_t bucket; /**< Stream mode only: the time bucket of queryFingerprintT1, OLAF_FP_MATCHER_LATE_BUCKET or OLAF_FP_MATCHER_NO_BUCKET */
+
+	uint32_t bucketPrevious; /**< Stream mode only: the previous match record (index + 1) in the same time bucket, 0 for none */
+
+	uint32_t bucketNext; /**< Stream mode only: the next match record (index + 1) in the same time bucket, 0 for none */
 };
 
+/** @struct meta_data_cache_entry
+ * @brief Meta data of a recently printed match, so periodic prints do not query the database again.
+ */
+struct meta_data_cache_entry{
+	bool used; /**< True if the entry holds meta data */
+
+	uint32_t matchIdentifier; /**< The audio file identifier of the meta data */
+
+	Olaf_Resource_Meta_data meta_data; /**< The meta data as returned by the database */
+};
+
+//The initial number of slots in the vote table, a power of two
+#define OLAF_FP_MATCHER_INITIAL_SLOTS (1<<12)
+
+//The bucket for matches which are already older than the expiry threshold
+#define OLAF_FP_MATCHER_LATE_BUCKET UINT32_MAX
+
+//A match record which is not (yet) linked in a time bucket
+#define OLAF_FP_MATCHER_NO_BUCKET (UINT32_MAX - 1)
+
+//The number of entries in the direct mapped meta data cache, a power of two
+#define OLAF_FP_MATCHER_META_DATA_CACHE_SIZE 16
+
 inline int max ( int a, int b ) { return a > b ? a : b; }
 inline int min ( int a, int b ) { return a < b ? a : b; }
 
 struct Olaf_FP_Matcher{
 
-	HashTable *result_hash_table; /**< Hash table mapping match_id/time-diff combinations to match structs */
+	struct match_result * matches; /**< Arena with all match records, dense so it can be scanned without chasing pointers */
+
+	size_t matches_size; /**< The number of match records in use */
+
+	size_t matches_capacity; /**< The allocated number of match records, grows by doubling */
+
+	uint32_t * slots; /**< Open addressing vote table with linear probing: index + 1 of a match record, 0 for an empty slot */
+
+	size_t slots_mask; /**< The number of slots minus one, the number of slots is a power of two */
+
+	uint32_t * buckets; /**< Stream mode only: a ring of time buckets, one per audio block. Each holds the first match record (index + 1) of a list of matches with that queryFingerprintT1. NULL if matches are kept */
+
+	size_t buckets_mask; /**< The number of time buckets minus one, the number of buckets is a power of two */
+
+	size_t buckets_count; /**< The number of match records in the ring of time buckets */
+
+	int buckets_first; /**< The oldest time which can have matches in the ring */
+
+	int buckets_last; /**< The newest time which can have matches in the ring */
+
+	uint32_t late_matches; /**< The first match record (index + 1) of matches created with an already expired time */
+
+	int expired_before; /**< Matches with a queryFingerprintT1 before this time have been removed */
 
 	Olaf_DB * db; /**< The database to use */
 
 	Olaf_Config * config; /**< The configuration of Olaf */
 
-	uint64_t * db_results; /**< List of results returned by the database, limited to maxDBCollisions */
+	uint64_t * db_results; /**< List of results returned by the database for a batch of fingerprints, limited to maxDBCollisions per fingerprint */
+
+	size_t db_results_size; /**< Allocated size of db_results, grows when a batch does not fit */
+
+	size_t * db_result_counts; /**< Number of database results per fingerprint in a batch */
+
 
 	Olaf_FP_Matcher_Result_Callback result_callback; /**< Callback invoked for each match result */
 
 	const char * header; /**< Optional header string for result output */
 
 	int last_print_at; /**< Audio block index of the last printed result */
+
+	struct match_result ** top_results; /**< Bounded min-heap with the best maxResults matches, allocated on the first print */
+
+	struct meta_data_cache_entry * meta_data_cache; /**< Direct mapped cache with meta data of printed matches, allocated on the first print */
 };
 
-//For the hash table use a 64 bit key mapped to 32 bits
-unsigned int uint64_t_hash(void *vlocation){
-	uint64_t *location;
+//Map a match_id/time-diff key to a slot with a multiplicative (Fibonacci) hash
+static inline size_t olaf_fp_matcher_home_slot(const Olaf_FP_Matcher * fp_matcher,uint64_t key){
+	return (size_t) ((key * 0x9E3779B97F4A7C15ULL) >> 32) & fp_matcher->slots_mask;
+}
 
-	location = (uint64_t *) vlocation;
+//The slot pointing to the match record at index
+static size_t olaf_fp_matcher_slot_of(const Olaf_FP_Matcher * fp_matcher,size_t index){
+	size_t slot = olaf_fp_matcher_home_slot(fp_matcher,fp_matcher->matches[index].result_hash_table_key);
+	while(fp_matcher->slots[slot] != index + 1){
+		slot = (slot + 1) & fp_matcher->slots_mask;
+	}
+	return slot;
+}
 
-	uint32_t low_bits = (uint32_t) *location;
-	uint32_t high_bits = (uint32_t) ((*location) >> 32);
+//Double the number of slots and reinsert all match records
+static void olaf_fp_matcher_grow_slots(Olaf_FP_Matcher * fp_matcher){
+	size_t number_of_slots = 2 * (fp_matcher->slots_mask + 1);
+	free(fp_matcher->slots);
+	fp_matcher->slots = (uint32_t *) calloc(number_of_slots , sizeof(uint32_t));
+	fp_matcher->slots_mask = number_of_slots - 1;
+
+	for(size_t i = 0 ; i < fp_matcher->matches_size ; i++){
+		size_t slot = olaf_fp_matcher_home_slot(fp_matcher,fp_matcher->matches[i].result_hash_table_key);
+		while(fp_matcher->slots[slot] != 0){
+			slot = (slot + 1) & fp_matcher->slots_mask;
+		}
+		fp_matcher->slots[slot] = (uint32_t) (i + 1);
+	}
+}
 
-	//simply or them together
-	return (unsigned int) (low_bits ^ high_bits);
+//The head of the list of match records in a time bucket
+static inline uint32_t * olaf_fp_matcher_bucket_head(Olaf_FP_Matcher * fp_matcher,uint32_t bucket){
+	return bucket == OLAF_FP_MATCHER_LATE_BUCKET ? &fp_matcher->late_matches : &fp_matcher->buckets[bucket];
 }
 
-//Check whether two hash keys are equal
-int uint64_t_equal(void *vlocation1, void *vlocation2){
-	uint64_t *location1;
-	uint64_t *location2;
+//Add the match record at index to the front of the list of its time bucket
+static void olaf_fp_matcher_bucket_link(Olaf_FP_Matcher * fp_matcher,size_t index){
+	struct match_result * match = &fp_matcher->matches[index];
+	uint32_t * head = olaf_fp_matcher_bucket_head(fp_matcher,match->bucket);
 
-	location1 = (uint64_t *) vlocation1;
-	location2 = (uint64_t *) vlocation2;
+	match->bucketPrevious = 0;
+	match->bucketNext = *head;
+	if(*head != 0) fp_matcher->matches[*head - 1].bucketPrevious = (uint32_t) (index + 1);
+	*head = (uint32_t) (index + 1);
 
-	return *location1 == *location2;
+	if(match->bucket != OLAF_FP_MATCHER_LATE_BUCKET) fp_matcher->buckets_count++;
 }
 
+//Remove the match record at index from the list of its time bucket
+static void olaf_fp_matcher_bucket_unlink(Olaf_FP_Matcher * fp_matcher,size_t index){
+	struct match_result * match = &fp_matcher->matches[index];
+
+	if(match->bucketPrevious != 0) fp_matcher->matches[match->bucketPrevious - 1].bucketNext = match->bucketNext;
+	else *olaf_fp_matcher_bucket_head(fp_matcher,match->bucket) = match->bucketNext;
+	if(match->bucketNext != 0) fp_matcher->matches[match->bucketNext - 1].bucketPrevious = match->bucketPrevious;
 
-//void olaf_hash_table_key_free_func(void *key){
-	//NOOP, key is freed by value free func
-	//
-	//fprintf(stderr,"%llu free key\n", *((uint64_t *)key));
-	//free(key);
-//}
+	if(match->bucket != OLAF_FP_MATCHER_LATE_BUCKET) fp_matcher->buckets_count--;
+}
 
-void olaf_hash_table_value_free_func(void *value){
-	free(value);
+//Double the number of time buckets and relink the match records. This only 
+//happens when the matches in the ring span more time than there are buckets.
+static void olaf_fp_matcher_grow_buckets(Olaf_FP_Matcher * fp_matcher){
+	size_t number_of_buckets = 2 * (fp_matcher->buckets_mask + 1);
+	free(fp_matcher->buckets);
+	fp_matcher->buckets = (uint32_t *) calloc(number_of_buckets , sizeof(uint32_t));
+	fp_matcher->buckets_mask = number_of_buckets - 1;
+	fp_matcher->buckets_count = 0;
+
+	for(size_t i = 0 ; i < fp_matcher->matches_size ; i++){
+		struct match_result * match = &fp_matcher->matches[i];
+		if(match->bucket == OLAF_FP_MATCHER_LATE_BUCKET || match->bucket == OLAF_FP_MATCHER_NO_BUCKET) continue;
+		match->bucket = (uint32_t) ((size_t) match->queryFingerprintT1 & fp_matcher->buckets_mask);
+		olaf_fp_matcher_bucket_link(fp_matcher,i);
+	}
+}
+
+//Put the match record at index, with an updated queryFingerprintT1, in its time bucket
+static void olaf_fp_matcher_bucket_update(Olaf_FP_Matcher * fp_matcher,size_t index,bool is_new){
+	if(!is_new) olaf_fp_matcher_bucket_unlink(fp_matcher,index);
+	fp_matcher->matches[index].bucket = OLAF_FP_MATCHER_NO_BUCKET;
+
+	int t = fp_matcher->matches[index].queryFingerprintT1;
+
+	if(t < fp_matcher->expired_before){
+		//removed with the next expiry, whatever the current time is
+		fp_matcher->matches[index].bucket = OLAF_FP_MATCHER_LATE_BUCKET;
+	}else{
+		if(fp_matcher->buckets_count == 0){
+			fp_matcher->buckets_first = t;
+			fp_matcher->buckets_last = t;
+		}else{
+			fp_matcher->buckets_first = min(fp_matcher->buckets_first,t);
+			fp_matcher->buckets_last = max(fp_matcher->buckets_last,t);
+		}
+		//each bucket holds a single time
+		while((size_t) (fp_matcher->buckets_last - fp_matcher->buckets_first) > fp_matcher->buckets_mask){
+			olaf_fp_matcher_grow_buckets(fp_matcher);
+		}
+		fp_matcher->matches[index].bucket = (uint32_t) ((size_t) t & fp_matcher->buckets_mask);
+	}
+
+	olaf_fp_matcher_bucket_link(fp_matcher,index);
+}
+
+//Create the ring of time buckets, with one bucket for each audio block in the 
+//window, and put the existing match records in it
+static void olaf_fp_matcher_start_buckets(Olaf_FP_Matcher * fp_matcher){
+	Olaf_Config * config = fp_matcher->config;
+	size_t max_age = (size_t) ((config->keepMatchesFor * config->audioSampleRate) / config->audioStepSize);
+	size_t number_of_buckets = 64;
+	while(number_of_buckets < max_age + 2) number_of_buckets *= 2;
+
+	fp_matcher->buckets = (uint32_t *) calloc(number_of_buckets , sizeof(uint32_t));
+	fp_matcher->buckets_mask = number_of_buckets - 1;
+
+	for(size_t i = 0 ; i < fp_matcher->matches_size ; i++){
+		fp_matcher->matches[i].bucket = OLAF_FP_MATCHER_NO_BUCKET;
+	}
+	for(size_t i = 0 ; i < fp_matcher->matches_size ; i++){
+		olaf_fp_matcher_bucket_update(fp_matcher,i,true);
+	}
+}
+
+//Remove the match record at index. The following slots of the probe sequence
+//are shifted back, so no tombstones are needed. The last match record is moved 
+//into the freed place to keep the arena dense.
+static void olaf_fp_matcher_remove_match(Olaf_FP_Matcher * fp_matcher,size_t index){
+	size_t mask = fp_matcher->slots_mask;
+	size_t hole = olaf_fp_matcher_slot_of(fp_matcher,index);
+	size_t next = (hole + 1) & mask;
+
+	while(fp_matcher->slots[next] != 0){
+		size_t home = olaf_fp_matcher_home_slot(fp_matcher,fp_matcher->matches[fp_matcher->slots[next] - 1].result_hash_table_key);
+		//move the entry back if the hole is between its home slot and its current slot
+		if(((next - home) & mask) >= ((next - hole) & mask)){
+			fp_matcher->slots[hole] = fp_matcher->slots[next];
+			hole = next;
+		}
+		next = (next + 1) & mask;
+	}
+	fp_matcher->slots[hole] = 0;
+
+	if(fp_matcher->buckets != NULL) olaf_fp_matcher_bucket_unlink(fp_matcher,index);
+
+	size_t last = fp_matcher->matches_size - 1;
+	if(index != last){
+		size_t last_slot = olaf_fp_matcher_slot_of(fp_matcher,last);
+		fp_matcher->matches[index] = fp_matcher->matches[last];
+		fp_matcher->slots[last_slot] = (uint32_t) (index + 1);
+
+		//point the neighbours in the time bucket to the new place
+		if(fp_matcher->buckets != NULL){
+			struct match_result * moved = &fp_matcher->matches[index];
+			if(moved->bucketPrevious != 0) fp_matcher->matches[moved->bucketPrevious - 1].bucketNext = (uint32_t) (index + 1);
+			else *olaf_fp_matcher_bucket_head(fp_matcher,moved->bucket) = (uint32_t) (index + 1);
+			if(moved->bucketNext != 0) fp_matcher->matches[moved->bucketNext - 1].bucketPrevious = (uint32_t) (index + 1);
+		}
+	}
+	fp_matcher->matches_size--;
 }
 
 //Creates a new matcher 
@@ -103,47 +288,79 @@ Olaf_FP_Matcher * olaf_fp_matcher_new(Olaf_Config * config,Olaf_DB* db,Olaf_FP_M
 	Olaf_FP_Matcher *fp_matcher = (Olaf_FP_Matcher *) malloc(sizeof(Olaf_FP_Matcher));
 	
 	//The database results are integers which combine a time info and match id
-	fp_matcher->db_results = (uint64_t *) calloc(config->maxDBCollisions , sizeof(uint64_t));
-	fp_matcher->result_hash_table = hash_table_new(uint64_t_hash,uint64_t_equal);
+	fp_matcher->db_results_size = config->maxDBCollisions;
+	fp_matcher->db_results = (uint64_t *) calloc(fp_matcher->db_results_size , sizeof(uint64_t));
+	fp_matcher->db_result_counts = (size_t *) calloc(config->maxFingerprints , sizeof(size_t));
+	fp_matcher->matches_size = 0;
+	fp_matcher->matches_capacity = OLAF_FP_MATCHER_INITIAL_SLOTS / 2;
+	fp_matcher->matches = (struct match_result *) malloc(fp_matcher->matches_capacity * sizeof(struct match_result));
+	fp_matcher->slots = (uint32_t *) calloc(OLAF_FP_MATCHER_INITIAL_SLOTS , sizeof(uint32_t));
+	fp_matcher->slots_mask = OLAF_FP_MATCHER_INITIAL_SLOTS - 1;
+
+	//In stream mode the matches are kept in time buckets so expiry does not need to scan all of them
+	fp_matcher->buckets = NULL;
+	fp_matcher->buckets_mask = 0;
+	fp_matcher->buckets_count = 0;
+	fp_matcher->buckets_first = 0;
+	fp_matcher->buckets_last = 0;
+	fp_matcher->late_matches = 0;
+	fp_matcher->expired_before = INT_MIN;
+
 	fp_matcher->last_print_at = 0;
+	fp_matcher->top_results = NULL;
+	fp_matcher->meta_data_cache = NULL;
 	fp_matcher->config = config;
 	fp_matcher->db = db;
 	fp_matcher->result_callback = callback;
 	fp_matcher->header = NULL;
 
-	hash_table_register_free_functions(fp_matcher->result_hash_table,NULL, olaf_hash_table_value_free_func);
+	if(config->keepMatchesFor != 0){
+		olaf_fp_matcher_start_buckets(fp_matcher);
+	}
 
 	return fp_matcher;
 }
 
-// This iterates the hash table with matches and 
-// removes old matches for streaming purposes reset all matches which are too old
+// Removes old matches for streaming purposes: reset all matches which are too old.
+// The time buckets older than the window are emptied, so the cost is proportional 
+// to the number of removed matches and the elapsed time, not to the number of matches.
 void olaf_fp_matcher_remove_old_matches(Olaf_FP_Matcher * fp_matcher, int current_query_time ){
 	
 	//from seconds to the number of blocks 
 	int max_age = (int) ((fp_matcher->config->keepMatchesFor  * fp_matcher->config->audioSampleRate) /  fp_matcher->config->audioStepSize);
 
-	HashTableIterator iterator;
-	HashTablePair pair;
-	hash_table_iterate(fp_matcher->result_hash_table, &iterator);
-	while (hash_table_iter_has_more(&iterator)) {
-		pair = hash_table_iter_next(&iterator);
-		struct match_result * match = (struct match_result *) pair.value;
-		int age = current_query_time - match->queryFingerprintT1;
-		bool too_old = age > max_age;
-		if(too_old){
-			hash_table_remove(fp_matcher->result_hash_table, pair.key);
-			//printf("Match too old and removed. Current query time %d, match time %d, age %d, max age %d\n",current_query_time,match->queryFingerprintT1,age,max_age);
+	//keepMatchesFor was changed after the matcher was created
+	if(fp_matcher->buckets == NULL){
+		olaf_fp_matcher_start_buckets(fp_matcher);
+	}
+
+	//a match is too old if current_query_time - queryFingerprintT1 > max_age
+	int threshold = current_query_time - max_age;
+
+	//matches created with an expired time are always too old
+	while(fp_matcher->late_matches != 0){
+		olaf_fp_matcher_remove_match(fp_matcher,fp_matcher->late_matches - 1);
+	}
+
+	while(fp_matcher->buckets_count > 0 && fp_matcher->buckets_first < threshold){
+		uint32_t * head = &fp_matcher->buckets[(size_t) fp_matcher->buckets_first & fp_matcher->buckets_mask];
+		while(*head != 0){
+			olaf_fp_matcher_remove_match(fp_matcher,*head - 1);
 		}
+		fp_matcher->buckets_first++;
 	}
+
+	fp_matcher->expired_before = max(fp_matcher->expired_before,threshold);
 }
 
-// Counts matches for each hash hit and puts them in a hash table.
-// A match_id and time difference are keys in the hash table, the value
-// is a match_result struct pointer.
+// Counts matches for each hash hit and puts them in the vote table.
+// A match_id and time difference are keys in the vote table, the value
+// is the index of a match_result in the arena.
 //
 // This method should be fast since a single fingerprint hash could 
-// return a thousand hits (collisons) from a large database
+// return a thousand hits (collisons) from a large database: there are 
+// no function pointers, and no allocations except when the arena or the 
+// table doubles.
 // 
 void olaf_fp_matcher_tally_results(Olaf_FP_Matcher * fp_matcher,int queryFingerprintT1,int referenceFingerprintT1,uint32_t matchIdentifier){
 	
@@ -156,40 +373,61 @@ void olaf_fp_matcher_tally_results(Olaf_FP_Matcher * fp_matcher,int queryFingerp
 
 	uint64_t result_hash_table_key = diff_part + match_part;
 	
-	struct match_result * match = (struct match_result *) hash_table_lookup(fp_matcher->result_hash_table,&result_hash_table_key);
-
-	if(match!=NULL){
-		//Update match when found
-		match->referenceFingerprintT1 = referenceFingerprintT1;
-		match->queryFingerprintT1 = queryFingerprintT1;
-		match->matchCount = match->matchCount + 1;
-		match->firstReferenceFingerprintT1 = min(referenceFingerprintT1,match->firstReferenceFingerprintT1);
-		match->lastReferenceFingerprintT1 = max(referenceFingerprintT1,match->lastReferenceFingerprintT1);
-		//if(match->matchCount>5) printf("UPDATE  %llu hash table size: %d  match_count: %d  %llu index, query time %d \n",result_hash_table_key,hash_table_num_entries(fp_matcher->result_hash_table),match->matchCount,fp_matcher->m_results_index,match->queryFingerprintT1);
-	}else{
-		//Create new hashtable entry if not found
+	size_t slot = olaf_fp_matcher_home_slot(fp_matcher,result_hash_table_key);
+	while(fp_matcher->slots[slot] != 0){
+		struct match_result * match = &fp_matcher->matches[fp_matcher->slots[slot] - 1];
+		if(match->result_hash_table_key == result_hash_table_key){
+			//Update match when found
+			match->referenceFingerprintT1 = referenceFingerprintT1;
+			match->queryFingerprintT1 = queryFingerprintT1;
+			match->matchCount = match->matchCount + 1;
+			match->firstReferenceFingerprintT1 = min(referenceFingerprintT1,match->firstReferenceFingerprintT1);
+			match->lastReferenceFingerprintT1 = max(referenceFingerprintT1,match->lastReferenceFingerprintT1);
+			if(fp_matcher->buckets != NULL){
+				olaf_fp_matcher_bucket_update(fp_matcher,fp_matcher->slots[slot] - 1,false);
+			}
+			return;
+		}
+		slot = (slot + 1) & fp_matcher->slots_mask;
+	}
 
-		match = (struct match_result *) malloc(sizeof(struct match_result));
+	//Create a new match record if not found
 
-		match->referenceFingerprintT1 = referenceFingerprintT1;
-		match->firstReferenceFingerprintT1 = referenceFingerprintT1;
-		match->lastReferenceFingerprintT1 = referenceFingerprintT1;
-		match->queryFingerprintT1 = queryFingerprintT1;
-		match->matchCount = 1;
-		match->matchIdentifier = matchIdentifier;
-		match->result_hash_table_key = result_hash_table_key;
-	
-		//printf("INSERT  %llu hash table size: %d \n",result_hash_table_key,hash_table_num_entries(fp_matcher->result_hash_table));
+	//keep the load factor of the table below one half
+	if(2 * (fp_matcher->matches_size + 1) > fp_matcher->slots_mask + 1){
+		olaf_fp_matcher_grow_slots(fp_matcher);
+		slot = olaf_fp_matcher_home_slot(fp_matcher,result_hash_table_key);
+		while(fp_matcher->slots[slot] != 0){
+			slot = (slot + 1) & fp_matcher->slots_mask;
+		}
+	}
+
+	if(fp_matcher->matches_size == fp_matcher->matches_capacity){
+		fp_matcher->matches_capacity *= 2;
+		fp_matcher->matches = (struct match_result *) realloc(fp_matcher->matches,fp_matcher->matches_capacity * sizeof(struct match_result));
+	}
+
+	struct match_result * match = &fp_matcher->matches[fp_matcher->matches_size];
+	match->referenceFingerprintT1 = referenceFingerprintT1;
+	match->firstReferenceFingerprintT1 = referenceFingerprintT1;
+	match->lastReferenceFingerprintT1 = referenceFingerprintT1;
+	match->queryFingerprintT1 = queryFingerprintT1;
+	match->matchCount = 1;
+	match->matchIdentifier = matchIdentifier;
+	match->result_hash_table_key = result_hash_table_key;
 
-		hash_table_insert(fp_matcher->result_hash_table, &match->result_hash_table_key, match);
+	fp_matcher->matches_size++;
+	fp_matcher->slots[slot] = (uint32_t) fp_matcher->matches_size;
+
+	if(fp_matcher->buckets != NULL){
+		olaf_fp_matcher_bucket_update(fp_matcher,fp_matcher->matches_size - 1,true);
 	}
 }
 
-//Match a single fingerprint with the database
-void olaf_fp_matcher_match_single_fingerprint(Olaf_FP_Matcher * fp_matcher,uint32_t queryFingerprintT1,uint64_t queryFingerprintHash){
+//Match the database results of a single fingerprint
+void olaf_fp_matcher_match_single_fingerprint(Olaf_FP_Matcher * fp_matcher,uint32_t queryFingerprintT1,uint64_t queryFingerprintHash,const uint64_t * db_results,size_t number_of_results){
 
 	int range = fp_matcher->config->searchRange;
-	size_t number_of_results = olaf_db_find(fp_matcher->db,queryFingerprintHash-range,queryFingerprintHash+range,fp_matcher->db_results,fp_matcher->config->maxDBCollisions);
 
 	if(fp_matcher->config->verbose){
 		fprintf(stderr,"Matched fp hash %" PRIu64 " with database at q t1 %u, search range %d.\n\tNumber of results: %zu \n\tMax num results: %zu \n",queryFingerprintHash,queryFingerprintT1,range,number_of_results,fp_matcher->config->maxDBCollisions);
@@ -202,9 +440,9 @@ void olaf_fp_matcher_match_single_fingerprint(Olaf_FP_Matcher * fp_matcher,uint3
 	for(size_t i = 0 ; i < number_of_results && i < fp_matcher->config->maxDBCollisions  ; i++){
 		
 		//The 32 most significant bits represent ref t1
-		uint32_t referenceFingerprintT1 =  (uint32_t) (fp_matcher->db_results[i] >> 32);
+		uint32_t referenceFingerprintT1 =  (uint32_t) (db_results[i] >> 32);
 		//The last 32 bits represent the match identifier
-		uint32_t matchIdentifier = (uint32_t) fp_matcher->db_results[i]; 
+		uint32_t matchIdentifier = (uint32_t) db_results[i]; 
 
 		if(fp_matcher->config->verbose){
 			int delta = (int) queryFingerprintT1 - (int) referenceFingerprintT1;
@@ -215,6 +453,30 @@ void olaf_fp_matcher_match_single_fingerprint(Olaf_FP_Matcher * fp_matcher,uint3
 	}
 }
 
+//Look up all fingerprints of a block with a single database call
+static void olaf_fp_matcher_match_fingerprints(Olaf_FP_Matcher * fp_matcher, struct extracted_fingerprints *  fingerprints ){
+	size_t number_of_fingerprints = fingerprints->fingerprintIndex;
+	if(number_of_fingerprints == 0) return;
+
+	size_t total = 0;
+	while(true){
+		total = olaf_db_find_batch(fp_matcher->db,fingerprints->hashes,number_of_fingerprints,fp_matcher->config->searchRange,
+			fp_matcher->db_results,fp_matcher->db_results_size,fp_matcher->config->maxDBCollisions,fp_matcher->db_result_counts);
+
+		//results might be dropped if the results array is full: grow and try again
+		if(total < fp_matcher->db_results_size) break;
+		fp_matcher->db_results_size *= 2;
+		fp_matcher->db_results = (uint64_t *) realloc(fp_matcher->db_results,fp_matcher->db_results_size * sizeof(uint64_t));
+	}
+
+	size_t offset = 0;
+	for(size_t i = 0 ; i < number_of_fingerprints ; i++ ){
+		size_t count = fp_matcher->db_result_counts[i];
+		olaf_fp_matcher_match_single_fingerprint(fp_matcher,fingerprints->timeIndexes[i],fingerprints->hashes[i],fp_matcher->db_results + offset,count);
+		offset += count;
+	}
+}
+
 void olaf_fp_matcher_set_header(Olaf_FP_Matcher * fp_matcher, const char * header){
 	fp_matcher->header = header;
 }
@@ -226,15 +488,11 @@ void olaf_fp_matcher_print_header(Olaf_FP_Matcher * fp_matcher){
 
 void olaf_fp_matcher_match(Olaf_FP_Matcher * fp_matcher, struct extracted_fingerprints *  fingerprints ){
 	
-	for(size_t i = 0 ; i < fingerprints->fingerprintIndex ; i++ ){
-		struct fingerprint f = fingerprints->fingerprints[i];
-		uint64_t hash = olaf_fp_extractor_hash(f);
-		olaf_fp_matcher_match_single_fingerprint(fp_matcher,f.timeIndex1,hash);
-	}
+	olaf_fp_matcher_match_fingerprints(fp_matcher,fingerprints);
 	
 	if(fingerprints->fingerprintIndex > 0 && fp_matcher->config->printResultEvery != 0){
 		int printResultEvery = (fp_matcher->config->printResultEvery *  fp_matcher->config->audioSampleRate ) /  fp_matcher->config->audioStepSize;
-		int current_query_time = fingerprints->fingerprints[fingerprints->fingerprintIndex-1].timeIndex3;
+		int current_query_time = fingerprints->lastTimeIndex;
 		//printf("Current time: %d, Last print at: %d \n", current_query_time,fp_matcher->last_print_at );
 		if( current_query_time - fp_matcher->last_print_at > printResultEvery){
 			olaf_fp_matcher_print_header(fp_matcher);
@@ -245,7 +503,7 @@ void olaf_fp_matcher_match(Olaf_FP_Matcher * fp_matcher, struct extracted_finger
 
 	//remove old matches.
 	if( fingerprints->fingerprintIndex > 0 && fp_matcher->config->keepMatchesFor != 0 ){
-		int current_query_time = fingerprints->fingerprints[fingerprints->fingerprintIndex-1].timeIndex3;
+		int current_query_time = fingerprints->lastTimeIndex;
 		olaf_fp_matcher_remove_old_matches(fp_matcher,current_query_time);
 	}
 	
@@ -271,40 +529,79 @@ void olaf_fp_matcher_callback_print_result(int matchCount, float queryStart, flo
 }
 
 
-//Print the final results: sort the m_results array and print
+//Restore the min-heap property (lowest match count on top) from index i down
+static void olaf_fp_matcher_sift_down(struct match_result ** heap,size_t heap_size,size_t i){
+	while(true){
+		size_t smallest = i;
+		size_t left = 2 * i + 1;
+		size_t right = left + 1;
+		if(left < heap_size && heap[left]->matchCount < heap[smallest]->matchCount) smallest = left;
+		if(right < heap_size && heap[right]->matchCount < heap[smallest]->matchCount) smallest = right;
+		if(smallest == i) return;
+		struct match_result * tmp = heap[i];
+		heap[i] = heap[smallest];
+		heap[smallest] = tmp;
+		i = smallest;
+	}
+}
+
+//Restore the min-heap property from index i up
+static void olaf_fp_matcher_sift_up(struct match_result ** heap,size_t i){
+	while(i > 0){
+		size_t parent = (i - 1) / 2;
+		if(heap[parent]->matchCount <= heap[i]->matchCount) return;
+		struct match_result * tmp = heap[i];
+		heap[i] = heap[parent];
+		heap[parent] = tmp;
+		i = parent;
+	}
+}
+
+//Meta data for a match identifier, only queried from the database on a cache miss
+static const Olaf_Resource_Meta_data * olaf_fp_matcher_meta_data(Olaf_FP_Matcher * fp_matcher,uint32_t matchIdentifier){
+	struct meta_data_cache_entry * entry = &fp_matcher->meta_data_cache[matchIdentifier & (OLAF_FP_MATCHER_META_DATA_CACHE_SIZE - 1)];
+	if(!entry->used || entry->matchIdentifier != matchIdentifier){
+		entry->used = true;
+		entry->matchIdentifier = matchIdentifier;
+		//stays empty if the database has no meta data for the identifier
+		entry->meta_data.path[0] = '\0';
+		olaf_db_find_meta_data(fp_matcher->db,&matchIdentifier,&entry->meta_data);
+	}
+	return &entry->meta_data;
+}
+
+//Print the final results: select the best maxResults matches with a bounded heap, sort and print
 void olaf_fp_matcher_print_results(Olaf_FP_Matcher * fp_matcher){
 	size_t match_results_index = 0;
 	size_t match_results_max = fp_matcher->config->maxResults;
-	struct match_result ** match_results = (struct match_result **) calloc(match_results_max, sizeof(struct match_result*));
 
-	HashTableIterator iterator;
-	HashTablePair pair;
-	hash_table_iterate(fp_matcher->result_hash_table, &iterator);
-	while (hash_table_iter_has_more(&iterator)) {
-		pair = hash_table_iter_next(&iterator);
-		struct match_result * match = (struct match_result *) pair.value;
+	if(fp_matcher->top_results == NULL){
+		fp_matcher->top_results = (struct match_result **) calloc(match_results_max, sizeof(struct match_result*));
+		fp_matcher->meta_data_cache = (struct meta_data_cache_entry *) calloc(OLAF_FP_MATCHER_META_DATA_CACHE_SIZE, sizeof(struct meta_data_cache_entry));
+	}
+	struct match_result ** match_results = fp_matcher->top_results;
+
+	for(size_t m = 0 ; m < fp_matcher->matches_size ; m++){
+		struct match_result * match = &fp_matcher->matches[m];
 
 		if(match->matchCount >= fp_matcher->config->minMatchCount){
 
 			if(match_results_max == match_results_index){
-				qsort(match_results, match_results_index, sizeof(struct match_result *), olaf_fp_sort_results_by_match_count);
-		
-				//replace the match with the lowes count with the current if it has a higher count
-				int current_least = match_results[match_results_index-1]->matchCount;
-
-			
-				if(match->matchCount > current_least){
-					match_results[match_results_index-1] = match;
+				//replace the match with the lowest count with the current if it has a higher count
+				if(match_results_max > 0 && match->matchCount > match_results[0]->matchCount){
+					match_results[0] = match;
+					olaf_fp_matcher_sift_down(match_results,match_results_index,0);
 				}
 			}else{
 				match_results[match_results_index] = match;
+				olaf_fp_matcher_sift_up(match_results,match_results_index);
 				match_results_index++;
 			}
 		}
 	}
 
+	//only the selected matches are sorted
 	if(match_results_index > 0){
-
 		qsort(match_results, match_results_index, sizeof(struct match_result *), olaf_fp_sort_results_by_match_count);
 	}
 
@@ -324,10 +621,9 @@ void olaf_fp_matcher_print_results(Olaf_FP_Matcher * fp_matcher){
 			
 			uint32_t matchIdentifier = match->matchIdentifier;
 
-			Olaf_Resource_Meta_data meta_data;
-			olaf_db_find_meta_data(fp_matcher->db,&matchIdentifier,&meta_data);
+			const Olaf_Resource_Meta_data * meta_data = olaf_fp_matcher_meta_data(fp_matcher,matchIdentifier);
 
-			fp_matcher->result_callback(match->matchCount,queryStart,queryStop,meta_data.path,matchIdentifier,referenceStart,referenceStop);
+			fp_matcher->result_callback(match->matchCount,queryStart,queryStop,meta_data->path,matchIdentifier,referenceStart,referenceStop);
 		}
 	}
 
@@ -336,14 +632,17 @@ void olaf_fp_matcher_print_results(Olaf_FP_Matcher * fp_matcher){
 		//printf("%d, %.2f, %.2f, %s, %u, %.2f, %.2f\n",0,0.0,0.0,"",0,0.0,0.0);
 		fp_matcher->result_callback(0,0,0,"",0,0,0);
 	}
-
-	free(match_results);
 }
 
 
 
 void olaf_fp_matcher_destroy(Olaf_FP_Matcher * fp_matcher){
-	hash_table_free(fp_matcher->result_hash_table);
+	free(fp_matcher->matches);
+	free(fp_matcher->slots);
+	free(fp_matcher->buckets);
 	free(fp_matcher->db_results);
+	free(fp_matcher->db_result_counts);
+	free(fp_matcher->top_results);
+	free(fp_matcher->meta_data_cache);
 	free(fp_matcher);
 }
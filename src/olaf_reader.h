@@ -25,6 +25,7 @@
 #ifndef OLAF_READER_H
 #define OLAF_READER_H
 
+    #include <stdio.h>
     #include "olaf_config.h"
     
 
@@ -49,6 +50,39 @@
      * @return     A struct with internal state.
      */
     Olaf_Reader * olaf_reader_new(Olaf_Config * config,const char * source);
+    /**
+     * @brief      Create a new reader for an already opened stream, e.g. a pipe, 
+     * a socket or an in memory buffer. The reader takes ownership and closes the 
+     * stream when it is destroyed.
+     *
+     * @param      config      The configuration
+     * @param      audio_file  The stream with raw mono samples of a certain format.
+     *
+     * @return     A struct with internal state.
+     */
+    Olaf_Reader * olaf_reader_new_file(Olaf_Config * config,FILE * audio_file);
+
+    /**
+     * @brief      Create a reader for a part of a memory mapped audio file. The part shares 
+     * the mapping of the given reader and its first step starts at first_sample. Parts can 
+     * be read from several threads at the same time. The reader of the complete file is 
+     * then considered read. Destroy parts before the reader they were created from.
+     *
+     * @param      olaf_reader   The reader of the complete file.
+     * @param[in]  first_sample  The index of the first new sample.
+     *
+     * @return     A new reader or NULL if the audio file is not memory mapped.
+     */
+    Olaf_Reader * olaf_reader_new_part(Olaf_Reader * olaf_reader,size_t first_sample);
+
+    /**
+     * @brief      The number of samples of a memory mapped audio file.
+     *
+     * @param      olaf_reader  The olaf reader state.
+     *
+     * @return     The number of samples, zero if it is not known beforehand e.g. for a stream.
+     */
+    size_t olaf_reader_length(Olaf_Reader * olaf_reader);
 
     /**
      * @brief      Read an audio block with overlap.
@@ -60,6 +94,17 @@
      */
     size_t olaf_reader_read(Olaf_Reader * olaf_reader,float * block);
 
+    /**
+     * @brief      Read the next audio block with overlap without copying it. The 
+     * block is a view into the reader and valid until the next read.
+     *
+     * @param      olaf_reader  The olaf reader
+     * @param      block        Receives the audio block of config->audioBlockSize samples.
+     *  
+     * @return     The number of new samples read.
+     */
+    size_t olaf_reader_read_block(Olaf_Reader * olaf_reader,const float ** block);
+
     /**
      * @brief      Returns the number of samples read.
      *
@@ -14,23 +14,90 @@
 // You should have received a copy of the GNU Affero General Public License
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
+//Regular files are memory mapped with POSIX mmap, elsewhere stdio is used
+#if !defined(_WIN32)
+	#define _POSIX_C_SOURCE 200809L
+	#define OLAF_READER_MMAP
+#endif
+
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 //#include <signal.h> //signal not supported by wasm
 
+#if defined(OLAF_READER_MMAP)
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
 #include "olaf_config.h"
 #include "olaf_reader.h"
+#include "olaf_audio_buffer.h"
+
+//The stdio buffer of opened audio files: few large reads instead of one per block
+#define OLAF_READER_FILE_BUFFER_SIZE (1 << 20)
 
 struct Olaf_Reader{
 	Olaf_Config* config; /**< The Olaf configuration */
 
-	FILE* audio_file; /**< The file currently being read */
+	FILE* audio_file; /**< The file currently being read, NULL if it is memory mapped */
 
 	size_t total_samples_read; /**< Total number of audio samples read so far */
 
 	bool end_of_file_reached; /**< Per-reader EOF flag (was a process-global, unsafe under threads) */
+
+	Olaf_Audio_Buffer * audio_buffer; /**< Overlapping blocks of the samples read so far */
+
+	const float * mapped_samples; /**< The samples of a memory mapped file, blocks are views into it */
+
+	size_t mapped_length; /**< The number of samples in the memory mapped file */
+
+	size_t mapped_index; /**< Index of the next new sample in the memory mapped file */
+
+	float * edge_block; /**< The first and last blocks of a mapped file, padded with silence */
+
+	bool owns_mapping; /**< False for a part of a file mapped by another reader */
 };
 
+#if defined(OLAF_READER_MMAP)
+
+	//Map a regular file with at least one sample, returns false if it is not possible
+	static bool olaf_reader_map(Olaf_Reader * reader,const char * source){
+		int fd = open(source,O_RDONLY);
+		if(fd < 0) return false;
+
+		struct stat file_stat;
+		if(fstat(fd,&file_stat) != 0 || !S_ISREG(file_stat.st_mode) || (size_t) file_stat.st_size < sizeof(float)){
+			close(fd);
+			return false;
+		}
+
+		size_t mapped_bytes = (size_t) file_stat.st_size;
+		void * mapped = mmap(NULL,mapped_bytes,PROT_READ,MAP_PRIVATE,fd,0);
+		//the mapping stays valid after the file descriptor is closed
+		close(fd);
+		if(mapped == MAP_FAILED) return false;
+
+		//the file is read once from start to end
+		posix_madvise(mapped,mapped_bytes,POSIX_MADV_SEQUENTIAL);
+
+		reader->mapped_samples = (const float *) mapped;
+		reader->mapped_length = mapped_bytes / sizeof(float);
+		reader->edge_block = (float *) malloc(reader->config->audioBlockSize * sizeof(float));
+		return true;
+	}
+
+	static void olaf_reader_unmap(Olaf_Reader * reader){
+		if(reader->owns_mapping){
+			munmap((void *) reader->mapped_samples,reader->mapped_length * sizeof(float));
+		}
+		free(reader->edge_block);
+	}
+
+#endif
+
 //void olaf_reader_trap(int signal){
 //	if(signal == SIGINT){
 //		end_of_file_reached = true;
@@ -45,6 +112,20 @@ Olaf_Reader * olaf_reader_new(Olaf_Config * config,const char * source){
 	reader->config = config;
 	reader->total_samples_read = 0;
 	reader->end_of_file_reached = false;
+	reader->audio_file = NULL;
+	reader->audio_buffer = NULL;
+	reader->mapped_samples = NULL;
+	reader->mapped_length = 0;
+	reader->mapped_index = 0;
+	reader->edge_block = NULL;
+	reader->owns_mapping = true;
+
+	#if defined(OLAF_READER_MMAP)
+		//raw audio files are walked in place without copies
+		if(source != NULL && olaf_reader_map(reader,source)){
+			return reader;
+		}
+	#endif
 
 	FILE* file = NULL;
 	if(source == NULL){
@@ -58,40 +139,115 @@ Olaf_Reader * olaf_reader_new(Olaf_Config * config,const char * source){
 		}
 	}
 
+	//A partial read from a pipe returns what is available, a large buffer does not add latency
+	setvbuf(file, NULL, _IOFBF, OLAF_READER_FILE_BUFFER_SIZE);
+
 	reader->audio_file = file;
+	reader->audio_buffer = olaf_audio_buffer_new(config);
 
 	return reader;
 }
 
-size_t olaf_reader_read(Olaf_Reader *reader ,float * audio_block){
-	
-	size_t number_of_samples_read;
+Olaf_Reader * olaf_reader_new_file(Olaf_Config * config,FILE * audio_file){
+	Olaf_Reader *reader = (Olaf_Reader *) malloc(sizeof(Olaf_Reader));
+	reader->config = config;
+	reader->total_samples_read = 0;
+	reader->end_of_file_reached = false;
+	reader->audio_file = audio_file;
+	reader->audio_buffer = olaf_audio_buffer_new(config);
+	reader->mapped_samples = NULL;
+	reader->mapped_length = 0;
+	reader->mapped_index = 0;
+	reader->edge_block = NULL;
+	reader->owns_mapping = true;
+	return reader;
+}
+
+Olaf_Reader * olaf_reader_new_part(Olaf_Reader * olaf_reader,size_t first_sample){
+	if(olaf_reader->mapped_samples == NULL) return NULL;
 
+	Olaf_Reader *reader = (Olaf_Reader *) malloc(sizeof(Olaf_Reader));
+	*reader = *olaf_reader;
+	reader->total_samples_read = 0;
+	reader->end_of_file_reached = false;
+	reader->mapped_index = first_sample < olaf_reader->mapped_length ? first_sample : olaf_reader->mapped_length;
+	reader->edge_block = (float *) malloc(reader->config->audioBlockSize * sizeof(float));
+	reader->owns_mapping = false;
+
+	//the file is read by its parts
+	olaf_reader->end_of_file_reached = true;
+	return reader;
+}
+
+size_t olaf_reader_length(Olaf_Reader * reader){
+	return reader->mapped_length;
+}
+
+//A block of a memory mapped file: a view if it lies within the file, else a padded copy
+static size_t olaf_reader_read_mapped_block(Olaf_Reader *reader ,const float ** audio_block){
 	size_t step_size = reader->config->audioStepSize;
 	size_t block_size = reader->config->audioBlockSize;
-	size_t overlap_size = block_size - step_size;
 
-	//make room for the new samples: shift the oldest to the beginning
-	for(size_t i = 0 ; i < overlap_size;i++){
-		audio_block[i]=audio_block[i+step_size];
+	size_t available = reader->mapped_length - reader->mapped_index;
+	size_t number_of_samples_read = available < step_size ? available : step_size;
+
+	//the block ends where the step would end, also when the file ends earlier
+	size_t block_end = reader->mapped_index + step_size;
+
+	if(number_of_samples_read == step_size && block_end >= block_size){
+		*audio_block = reader->mapped_samples + block_end - block_size;
+	}else{
+		//silence before the first and after the last sample
+		size_t silent_start = block_end >= block_size ? 0 : block_size - block_end;
+		for(size_t i = 0 ; i < block_size ; i++){
+			size_t sample_index = block_end + i - block_size;
+			bool in_file = i >= silent_start && sample_index < reader->mapped_length;
+			reader->edge_block[i] = in_file ? reader->mapped_samples[sample_index] : 0;
+		}
+		*audio_block = reader->edge_block;
 	}
 
-	//start from the middle of the array
-	float* startAddress = &audio_block[overlap_size];
+	if(number_of_samples_read < step_size){
+		reader->end_of_file_reached = true;
+	}
+	reader->mapped_index += number_of_samples_read;
+	reader->total_samples_read += number_of_samples_read;
 
-	// copy the file into the audioData:
-	number_of_samples_read = fread(startAddress,reader->config->bytesPerAudioSample,step_size,reader->audio_file);
+	return number_of_samples_read;
+}
+
+size_t olaf_reader_read_block(Olaf_Reader *reader ,const float ** audio_block){
+
+	if(reader->mapped_samples != NULL){
+		return olaf_reader_read_mapped_block(reader,audio_block);
+	}
+
+	size_t step_size = reader->config->audioStepSize;
+
+	//the new samples follow the overlap with the previous block, nothing is shifted
+	float* step = olaf_audio_buffer_step(reader->audio_buffer);
+
+	size_t number_of_samples_read = fread(step,reader->config->bytesPerAudioSample,step_size,reader->audio_file);
 
 	//When reading the last buffer, make sure that the block is zero filled
-	for(size_t i = overlap_size + number_of_samples_read ; i < overlap_size + step_size ;i++){
-		audio_block[i] = 0;
+	for(size_t i = number_of_samples_read ; i < step_size ;i++){
+		step[i] = 0;
 	}
 	
 	if(feof(reader->audio_file)) {
 		reader->end_of_file_reached = true;
-    }
+	}
 	reader->total_samples_read+=number_of_samples_read;
 
+	*audio_block = olaf_audio_buffer_block(reader->audio_buffer);
+
+	return number_of_samples_read;
+}
+
+size_t olaf_reader_read(Olaf_Reader *reader ,float * audio_block){
+	const float * block;
+	size_t number_of_samples_read = olaf_reader_read_block(reader,&block);
+	memcpy(audio_block,block,reader->config->audioBlockSize * sizeof(float));
 	return number_of_samples_read;
 }
 
@@ -101,11 +257,21 @@ size_t olaf_reader_total_samples_read(Olaf_Reader * reader){
 
 void olaf_reader_destroy(Olaf_Reader *  reader){
 
-	if(!reader->end_of_file_reached){
+	//a part of a file is not necessarily read to the end
+	if(!reader->end_of_file_reached && reader->owns_mapping){
 		fprintf(stderr, "Warning: not reached end of file\n");
 	}
 
+	#if defined(OLAF_READER_MMAP)
+		if(reader->mapped_samples != NULL){
+			olaf_reader_unmap(reader);
+			free(reader);
+			return;
+		}
+	#endif
+
 	// after reading, close the file
 	fclose(reader->audio_file);
+	olaf_audio_buffer_destroy(reader->audio_buffer);
 	free(reader);
 }
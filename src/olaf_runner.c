@@ -4,13 +4,15 @@
 #include "pffft.h"
 #include "assert.h"
 
-Olaf_Runner * olaf_runner_new(int mode, Olaf_Config * config, FILE * fp_cache_file, FILE * fp_meta_file){
+static Olaf_Runner * olaf_runner_new_internal(int mode, Olaf_Config * config, FILE * fp_cache_file, FILE * fp_meta_file, Olaf_FP_DB_Writer_Queue * db_queue, Olaf_DB * shared_db){
 	Olaf_Runner *runner = (Olaf_Runner *) malloc(sizeof(Olaf_Runner));
 
 	runner->mode = mode;
 	runner->config =  config;
 	runner->fp_cache_file = fp_cache_file;
 	runner->fp_meta_file = fp_meta_file;
+	runner->db_queue = db_queue;
+	runner->owns_db = shared_db == NULL;
 	
 	//The raw format and size of float should be 32 bits
 	assert(runner->config->bytesPerAudioSample == sizeof(float));
@@ -24,23 +26,55 @@ Olaf_Runner * olaf_runner_new(int mode, Olaf_Config * config, FILE * fp_cache_fi
 	runner->fft_in = (float *) pffft_aligned_malloc(bytesPerAudioBlock);//fft input
 	runner->fft_out= (float *) pffft_aligned_malloc(bytesPerAudioBlock);//fft output
 
+	//the extractors are reused for each audio file
+	runner->ep_extractor = olaf_ep_extractor_new(runner->config);
+	runner->fp_extractor = olaf_fp_extractor_new(runner->config);
+	//only printed fingerprints need more than the hashes and time indexes
+	olaf_fp_extractor_keep_details(runner->fp_extractor,mode == OLAF_RUNNER_MODE_PRINT);
+
 	//no db needed in print mode!
 	if(mode == OLAF_RUNNER_MODE_PRINT || mode == OLAF_RUNNER_MODE_CACHE){
 		runner->db = NULL;
 		if(runner->config->verbose){
 			fprintf(stderr, "No DB needed in PRINT or CACHE mode\n");
 		}
+	} else if(db_queue != NULL){
+		//the writer queue owns the db
+		runner->db = NULL;
+	} else if(shared_db != NULL){
+		//the caller owns the db
+		runner->db = shared_db;
 	} else {
 		bool readonly_db = (mode == OLAF_RUNNER_MODE_QUERY);
 		if(runner->config->verbose){
 			fprintf(stderr, "Open DB at in readonly mode %d folder '%s'\n", readonly_db, runner->config->dbFolder);
 		}
 		runner->db = olaf_db_new(runner->config->dbFolder,readonly_db);
+
+		if(mode == OLAF_RUNNER_MODE_STORE && runner->config->resourceIndex){
+			olaf_db_enable_resource_index(runner->db);
+		}
 	}
 	
 	return runner;
 }
 
+Olaf_Runner * olaf_runner_new(int mode, Olaf_Config * config, FILE * fp_cache_file, FILE * fp_meta_file){
+	return olaf_runner_new_internal(mode, config, fp_cache_file, fp_meta_file, NULL, NULL);
+}
+
+Olaf_Runner * olaf_runner_new_queued(int mode, Olaf_Config * config, Olaf_FP_DB_Writer_Queue * db_queue){
+	assert(mode == OLAF_RUNNER_MODE_STORE || mode == OLAF_RUNNER_MODE_DELETE);
+	assert(db_queue != NULL);
+	return olaf_runner_new_internal(mode, config, NULL, NULL, db_queue, NULL);
+}
+
+Olaf_Runner * olaf_runner_new_shared(int mode, Olaf_Config * config, Olaf_DB * db){
+	assert(mode == OLAF_RUNNER_MODE_QUERY);
+	assert(db != NULL);
+	return olaf_runner_new_internal(mode, config, NULL, NULL, NULL, db);
+}
+
 void olaf_runner_destroy(Olaf_Runner * runner){	
 
 	//cleanup fft structures
@@ -49,7 +83,10 @@ void olaf_runner_destroy(Olaf_Runner * runner){
 	
 	pffft_destroy_setup(runner->fftSetup);
 
-	if(runner->db!= NULL){
+	olaf_fp_extractor_destroy(runner->fp_extractor);
+	olaf_ep_extractor_destroy(runner->ep_extractor);
+
+	if(runner->db!= NULL && runner->owns_db){
 		//When the database becomes large (GBs), the following
 		//commits a transaction to disk, which takes considerable time!
 		//It is advised to then use multiple files in one program run.
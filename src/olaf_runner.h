@@ -19,6 +19,10 @@
  *
  * @brief Helps to run query, store, delete or print commands. These share a lot of functionality but differ in crucial parts.
  * To keep this organized the runner keeps some shared state.
+ *
+ * The FFT setup, the extractors and the database are kept for the lifetime of the runner. A runner 
+ * can be kept, e.g. for each worker thread, to process many audio files one after the other: only 
+ * one stream processor should use a runner at a time.
  */
 
 #ifndef OLAF_RUNNER_H
@@ -26,6 +30,9 @@
 
 	#include "olaf_config.h"
 	#include "olaf_db.h"
+	#include "olaf_fp_db_writer_queue.h"
+	#include "olaf_ep_extractor.h"
+	#include "olaf_fp_extractor.h"
 	#include "pffft.h"
 	
 	/** @brief Runner mode for querying the database. */
@@ -59,11 +66,17 @@
 
 		Olaf_DB* db; /**< The database. */
 
+		Olaf_FP_DB_Writer_Queue* db_queue; /**< If not NULL, store and delete go through this writer queue and db is NULL. */
+		bool owns_db; /**< False if the database is shared and closed by the caller. */
+
 		PFFFT_Setup *fftSetup; /**< The FFT struct that is reused. */
 
 		float *fft_in; /**< Input buffer for FFT data. */
 		float *fft_out; /**< Output buffer for FFT data. */
 
+		Olaf_EP_Extractor *ep_extractor; /**< The event point extractor, reset for each stream processor. */
+		Olaf_FP_Extractor *fp_extractor; /**< The fingerprint extractor, reset for each stream processor. */
+
 		FILE * fp_cache_file; /**< Cache file for printing fingerprints to if in PRINT or CACHE mode. */
 		FILE * fp_meta_file; /**< Meta data file for storing resource meta data. */
 	};
@@ -80,6 +93,31 @@
 	 */
 	Olaf_Runner * olaf_runner_new(int mode, Olaf_Config * config, FILE * fp_cache_file, FILE * fp_meta_file);
 
+	/**
+	 * @brief      Create a new runner for the store or delete mode which does not open the database 
+	 * itself but hands fingerprints to a shared writer queue. Several of these runners can extract 
+	 * fingerprints in parallel without taking the database writer lock.
+	 *
+	 * @param[in]  mode      The mode, OLAF_RUNNER_MODE_STORE or OLAF_RUNNER_MODE_DELETE
+	 * @param[in]  config    The configuration
+	 * @param      db_queue  The writer queue, owned by the caller
+	 *
+	 * @return     A new runner struct state of the runner
+	 */
+	Olaf_Runner * olaf_runner_new_queued(int mode, Olaf_Config * config, Olaf_FP_DB_Writer_Queue * db_queue);
+	/**
+	 * @brief      Create a new runner for the query mode which uses an already opened database. 
+	 * A long running process can keep a runner, with its FFT setup, for each thread and 
+	 * reuse it for many queries.
+	 *
+	 * @param[in]  mode    The mode, OLAF_RUNNER_MODE_QUERY
+	 * @param[in]  config  The configuration
+	 * @param      db      The database, e.g. a reader handle from olaf_db_new_reader, owned by the caller
+	 *
+	 * @return     A new runner struct state of the runner
+	 */
+	Olaf_Runner * olaf_runner_new_shared(int mode, Olaf_Config * config, Olaf_DB * db);
+
 	/**
 	 * @brief      Delete the resources related to the runner.
 	 *
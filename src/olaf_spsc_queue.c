@@ -0,0 +1,100 @@
+// Olaf: Overly Lightweight Acoustic Fingerprinting
+// Copyright (C) 2019-2025  Joren Six
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//nanosleep is POSIX
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include "olaf_spsc_queue.h"
+
+//Spin this many times before the waiting thread sleeps
+#define OLAF_SPSC_QUEUE_SPINS 256
+
+//How long a waiting thread sleeps, in nanoseconds
+#define OLAF_SPSC_QUEUE_SLEEP 100000
+
+//Keeps the positions written by the producer and the consumer on separate cache lines
+#define OLAF_SPSC_QUEUE_CACHE_LINE 64
+
+struct Olaf_SPSC_Queue{
+	char * slots; /**< capacity slots of slot_size bytes */
+	size_t capacity; /**< The number of slots */
+	size_t slot_size; /**< The size of a slot in bytes */
+
+	char head_padding[OLAF_SPSC_QUEUE_CACHE_LINE]; /**< Keeps the head off the cache line of the fields above */
+	atomic_size_t head; /**< The number of pushed slots, only written by the producer */
+	char tail_padding[OLAF_SPSC_QUEUE_CACHE_LINE]; /**< Keeps the tail off the cache line of the head */
+	atomic_size_t tail; /**< The number of popped slots, only written by the consumer */
+};
+
+Olaf_SPSC_Queue * olaf_spsc_queue_new(size_t capacity, size_t slot_size){
+	Olaf_SPSC_Queue * queue = (Olaf_SPSC_Queue *) malloc(sizeof(Olaf_SPSC_Queue));
+	queue->slots = (char *) calloc(capacity, slot_size);
+	queue->capacity = capacity;
+	queue->slot_size = slot_size;
+	atomic_init(&queue->head,0);
+	atomic_init(&queue->tail,0);
+	return queue;
+}
+
+static void olaf_spsc_queue_wait(size_t * spins){
+	(*spins)++;
+	if(*spins > OLAF_SPSC_QUEUE_SPINS){
+		struct timespec pause = {0, OLAF_SPSC_QUEUE_SLEEP};
+		nanosleep(&pause,NULL);
+	}
+}
+
+void * olaf_spsc_queue_slot(Olaf_SPSC_Queue * queue, size_t index){
+	return queue->slots + index * queue->slot_size;
+}
+
+void * olaf_spsc_queue_front(Olaf_SPSC_Queue * queue){
+	size_t head = atomic_load_explicit(&queue->head,memory_order_relaxed);
+	size_t spins = 0;
+	//the slot is free once the consumer popped it
+	while(head - atomic_load_explicit(&queue->tail,memory_order_acquire) == queue->capacity){
+		olaf_spsc_queue_wait(&spins);
+	}
+	return olaf_spsc_queue_slot(queue,head % queue->capacity);
+}
+
+void olaf_spsc_queue_push(Olaf_SPSC_Queue * queue){
+	size_t head = atomic_load_explicit(&queue->head,memory_order_relaxed);
+	atomic_store_explicit(&queue->head,head + 1,memory_order_release);
+}
+
+void * olaf_spsc_queue_back(Olaf_SPSC_Queue * queue){
+	size_t tail = atomic_load_explicit(&queue->tail,memory_order_relaxed);
+	size_t spins = 0;
+	while(atomic_load_explicit(&queue->head,memory_order_acquire) == tail){
+		olaf_spsc_queue_wait(&spins);
+	}
+	return olaf_spsc_queue_slot(queue,tail % queue->capacity);
+}
+
+void olaf_spsc_queue_pop(Olaf_SPSC_Queue * queue){
+	size_t tail = atomic_load_explicit(&queue->tail,memory_order_relaxed);
+	atomic_store_explicit(&queue->tail,tail + 1,memory_order_release);
+}
+
+void olaf_spsc_queue_destroy(Olaf_SPSC_Queue * queue){
+	free(queue->slots);
+	free(queue);
+}
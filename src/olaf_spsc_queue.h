@@ -0,0 +1,102 @@
+// Olaf: Overly Lightweight Acoustic Fingerprinting
+// Copyright (C) 2019-2025  Joren Six
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/**
+ * @file olaf_spsc_queue.h
+ *
+ * @brief A bounded, lock-free queue between exactly one producer and one consumer thread.
+ *
+ * The queue is a ring of fixed size slots which are filled and read in place: the producer 
+ * fills the slot returned by olaf_spsc_queue_front() and publishes it with 
+ * olaf_spsc_queue_push(), the consumer reads the slot returned by olaf_spsc_queue_back() 
+ * and hands it back with olaf_spsc_queue_pop(). Slots can own buffers, these are kept 
+ * when a slot is reused. A thread waiting on a full or empty queue first spins and then 
+ * sleeps shortly, so an idle live stream does not keep a core busy.
+ */
+
+#ifndef OLAF_SPSC_QUEUE_H
+#define OLAF_SPSC_QUEUE_H
+	#include <stdlib.h>
+
+	/**
+	 * @struct Olaf_SPSC_Queue
+	 * @brief An opaque struct with the slots and the read and write positions.
+	 */
+	/** @typedef Olaf_SPSC_Queue
+	 *  @brief Typedef for struct Olaf_SPSC_Queue.
+	 */
+	typedef struct Olaf_SPSC_Queue Olaf_SPSC_Queue;
+
+	/**
+	 * @brief      Create a new queue with zeroed slots.
+	 *
+	 * @param[in]  capacity   The number of slots.
+	 * @param[in]  slot_size  The size of a slot in bytes.
+	 *
+	 * @return     A new queue.
+	 */
+	Olaf_SPSC_Queue * olaf_spsc_queue_new(size_t capacity, size_t slot_size);
+
+	/**
+	 * @brief      A slot by index, e.g. to allocate buffers owned by slots before the queue is used.
+	 *
+	 * @param      queue  The queue.
+	 * @param[in]  index  The slot index, less than the capacity.
+	 *
+	 * @return     The slot.
+	 */
+	void * olaf_spsc_queue_slot(Olaf_SPSC_Queue * queue, size_t index);
+
+	/**
+	 * @brief      Wait for a free slot, only called by the producer.
+	 *
+	 * @param      queue  The queue.
+	 *
+	 * @return     The slot to fill.
+	 */
+	void * olaf_spsc_queue_front(Olaf_SPSC_Queue * queue);
+
+	/**
+	 * @brief      Publish the slot returned by olaf_spsc_queue_front() to the consumer.
+	 *
+	 * @param      queue  The queue.
+	 */
+	void olaf_spsc_queue_push(Olaf_SPSC_Queue * queue);
+
+	/**
+	 * @brief      Wait for a published slot, only called by the consumer.
+	 *
+	 * @param      queue  The queue.
+	 *
+	 * @return     The oldest published slot.
+	 */
+	void * olaf_spsc_queue_back(Olaf_SPSC_Queue * queue);
+
+	/**
+	 * @brief      Hand the slot returned by olaf_spsc_queue_back() back to the producer.
+	 *
+	 * @param      queue  The queue.
+	 */
+	void olaf_spsc_queue_pop(Olaf_SPSC_Queue * queue);
+
+	/**
+	 * @brief      Free the slots. Buffers owned by slots should be freed first.
+	 *
+	 * @param      queue  The queue.
+	 */
+	void olaf_spsc_queue_destroy(Olaf_SPSC_Queue * queue);
+
+#endif // OLAF_SPSC_QUEUE_H
@@ -0,0 +1,344 @@
+// Olaf: Overly Lightweight Acoustic Fingerprinting
+// Copyright (C) 2019-2025  Joren Six
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "pffft.h"
+
+#include "olaf_stream_pipeline.h"
+#include "olaf_spsc_queue.h"
+#include "olaf_window.h"
+#include "olaf_ep_extractor.h"
+#include "olaf_fp_extractor.h"
+
+//The number of audio blocks passed between stages at once, 64ms with the default configuration
+#define OLAF_PIPELINE_BATCH_BLOCKS 8
+
+//The number of batches in each queue
+#define OLAF_PIPELINE_QUEUE_SIZE 4
+
+//Audio blocks from the read stage to the FFT stage
+struct olaf_pipeline_audio{
+	float * audio; /**< The samples of the blocks, one block after the other */
+	size_t blocks; /**< The number of blocks */
+	bool end; /**< True for the last batch of the stream */
+};
+
+//The new event points of audio blocks from the FFT stage to the fingerprint stage
+struct olaf_pipeline_event_points{
+	struct eventpoint * event_points; /**< The new event points of the blocks, one block after the other */
+	size_t * ends; /**< For each block the end of its event points */
+	size_t first_block; /**< The audio block index of the first block */
+	size_t blocks; /**< The number of blocks */
+	bool end; /**< True for the last batch of the stream */
+};
+
+//Batches of fingerprints from the fingerprint stage to the caller
+struct olaf_pipeline_fingerprints{
+	uint64_t * hashes; /**< The hashes of the fingerprints */
+	uint32_t * time_indexes; /**< The t1 of the fingerprints */
+	struct fingerprint * details; /**< The details of the fingerprints, if they are kept */
+	size_t * batch_ends; /**< The end of each batch in the fingerprint arrays */
+	int * batch_last_time_indexes; /**< The last time index of each batch, see extracted_fingerprints */
+	size_t batches; /**< The number of batches */
+	bool end; /**< True for the last batch of the stream */
+};
+
+struct Olaf_Stream_Pipeline{
+	Olaf_Config * config; /**< The configuration */
+	Olaf_Reader * reader; /**< The audio reader, read by the read stage */
+	bool keep_details; /**< Keep the full fingerprint details */
+
+	Olaf_SPSC_Queue * audio_queue; /**< From the read stage to the FFT stage */
+	Olaf_SPSC_Queue * event_point_queue; /**< From the FFT stage to the fingerprint stage */
+	Olaf_SPSC_Queue * fingerprint_queue; /**< From the fingerprint stage to the caller */
+
+	pthread_t read_thread; /**< Reads audio blocks */
+	pthread_t fft_thread; /**< Transforms audio blocks and finds event points */
+	pthread_t fingerprint_thread; /**< Combines event points into fingerprints */
+
+	PFFFT_Setup * fft_setup; /**< FFT setup of the FFT stage */
+	float * fft_in; /**< FFT input buffer of the FFT stage */
+	float * fft_out; /**< FFT output buffer of the FFT stage */
+	Olaf_EP_Extractor * ep_detector; /**< Finds the new event points in the FFT stage */
+
+	Olaf_EP_Extractor * ep_extractor; /**< Collects the event points in the fingerprint stage */
+	Olaf_FP_Extractor * fp_extractor; /**< Combines the event points into fingerprints */
+	struct extracted_fingerprints * remaining; /**< The fingerprints of the remaining event points */
+
+	struct olaf_pipeline_fingerprints * current; /**< The fingerprints being consumed by the caller */
+	size_t current_batch; /**< The next batch of the current fingerprints */
+	struct extracted_fingerprints batch; /**< The batch returned by olaf_stream_pipeline_next */
+	bool finished; /**< True once the end of the stream is consumed and the threads are joined */
+};
+
+//Read the audio blocks, the same way as olaf_stream_processor_process
+static void * olaf_stream_pipeline_read(void * arg){
+	Olaf_Stream_Pipeline * pipeline = (Olaf_Stream_Pipeline *) arg;
+	size_t block_size = pipeline->config->audioBlockSize;
+	size_t samples_expected = pipeline->config->audioStepSize;
+
+	const float * audio_block;
+	size_t samples_read = olaf_reader_read_block(pipeline->reader,&audio_block);
+
+	bool end = false;
+	while(!end){
+		struct olaf_pipeline_audio * audio = (struct olaf_pipeline_audio *) olaf_spsc_queue_front(pipeline->audio_queue);
+		audio->blocks = 0;
+		while(audio->blocks < OLAF_PIPELINE_BATCH_BLOCKS && samples_read == samples_expected){
+			samples_read = olaf_reader_read_block(pipeline->reader,&audio_block);
+			memcpy(audio->audio + audio->blocks * block_size, audio_block, block_size * sizeof(float));
+			audio->blocks++;
+		}
+		end = samples_read != samples_expected;
+		audio->end = end;
+		olaf_spsc_queue_push(pipeline->audio_queue);
+	}
+	return NULL;
+}
+
+//Transform the audio blocks and find the new event points of each block
+static void * olaf_stream_pipeline_fft(void * arg){
+	Olaf_Stream_Pipeline * pipeline = (Olaf_Stream_Pipeline *) arg;
+	Olaf_Config * config = pipeline->config;
+	const float * window = olaf_fft_window(config->audioBlockSize);
+	size_t block_index = 0;
+
+	bool end = false;
+	while(!end){
+		struct olaf_pipeline_audio * audio = (struct olaf_pipeline_audio *) olaf_spsc_queue_back(pipeline->audio_queue);
+		struct olaf_pipeline_event_points * event_points = (struct olaf_pipeline_event_points *) olaf_spsc_queue_front(pipeline->event_point_queue);
+
+		size_t size = 0;
+		event_points->first_block = block_index;
+		for(size_t i = 0 ; i < audio->blocks ; i++){
+			olaf_fft_window_apply(pipeline->fft_in,audio->audio + i * config->audioBlockSize,window,config->audioBlockSize);
+			pffft_transform_ordered(pipeline->fft_setup, pipeline->fft_in, pipeline->fft_out, 0, PFFFT_FORWARD);
+
+			//the detector is emptied after each block: at most maxEventPoints new ones
+			struct extracted_event_points * found = olaf_ep_extractor_extract(pipeline->ep_detector,pipeline->fft_out,(int) block_index);
+			size_t count = (size_t) found->eventPointIndex;
+			memcpy(event_points->event_points + size, found->eventPoints, count * sizeof(struct eventpoint));
+			size += count;
+			event_points->ends[i] = size;
+			olaf_ep_extractor_expire(found,INT_MAX,config->maxEventPointUsages);
+
+			block_index++;
+		}
+		event_points->blocks = audio->blocks;
+		end = audio->end;
+		event_points->end = end;
+
+		olaf_spsc_queue_pop(pipeline->audio_queue);
+		olaf_spsc_queue_push(pipeline->event_point_queue);
+	}
+	return NULL;
+}
+
+static void olaf_stream_pipeline_add_batch(Olaf_Stream_Pipeline * pipeline, struct olaf_pipeline_fingerprints * fingerprints, struct extracted_fingerprints * batch){
+	size_t count = batch->fingerprintIndex;
+	//consumers ignore empty batches
+	if(count == 0) return;
+
+	size_t start = fingerprints->batches == 0 ? 0 : fingerprints->batch_ends[fingerprints->batches - 1];
+	memcpy(fingerprints->hashes + start, batch->hashes, count * sizeof(uint64_t));
+	memcpy(fingerprints->time_indexes + start, batch->timeIndexes, count * sizeof(uint32_t));
+	if(pipeline->keep_details){
+		memcpy(fingerprints->details + start, batch->fingerprints, count * sizeof(struct fingerprint));
+	}
+	fingerprints->batch_ends[fingerprints->batches] = start + count;
+	fingerprints->batch_last_time_indexes[fingerprints->batches] = batch->lastTimeIndex;
+	fingerprints->batches++;
+}
+
+//Combine the event points into fingerprints, in order
+static void * olaf_stream_pipeline_fingerprint(void * arg){
+	Olaf_Stream_Pipeline * pipeline = (Olaf_Stream_Pipeline *) arg;
+	Olaf_Config * config = pipeline->config;
+	struct extracted_event_points * eps = NULL;
+	size_t block_index = 0;
+
+	bool end = false;
+	while(!end){
+		struct olaf_pipeline_event_points * event_points = (struct olaf_pipeline_event_points *) olaf_spsc_queue_back(pipeline->event_point_queue);
+		struct olaf_pipeline_fingerprints * fingerprints = (struct olaf_pipeline_fingerprints *) olaf_spsc_queue_front(pipeline->fingerprint_queue);
+
+		fingerprints->batches = 0;
+		for(size_t i = 0 ; i < event_points->blocks ; i++){
+			size_t start = i == 0 ? 0 : event_points->ends[i - 1];
+			eps = olaf_ep_extractor_append(pipeline->ep_extractor,event_points->event_points + start,event_points->ends[i] - start,(int) block_index);
+
+			if(eps->eventPointIndex > config->eventPointThreshold){
+				struct extracted_fingerprints * batch = olaf_fp_extractor_extract(pipeline->fp_extractor,eps,(int) block_index);
+				olaf_stream_pipeline_add_batch(pipeline,fingerprints,batch);
+				batch->fingerprintIndex = 0;
+			}
+			block_index++;
+		}
+		end = event_points->end;
+		fingerprints->end = end;
+
+		//the event points left after the last block, read by the caller after the threads are joined
+		if(end && eps != NULL && eps->eventPointIndex > 0){
+			pipeline->remaining = olaf_fp_extractor_extract(pipeline->fp_extractor,eps,(int) block_index);
+		}
+
+		olaf_spsc_queue_pop(pipeline->event_point_queue);
+		olaf_spsc_queue_push(pipeline->fingerprint_queue);
+	}
+	return NULL;
+}
+
+static void olaf_stream_pipeline_start(pthread_t * thread, void *(*stage)(void *), Olaf_Stream_Pipeline * pipeline){
+	if(pthread_create(thread,NULL,stage,pipeline) != 0){
+		fprintf(stderr,"Error: could not start a stream pipeline thread\n");
+		exit(-42);
+	}
+}
+
+Olaf_Stream_Pipeline * olaf_stream_pipeline_new(Olaf_Config * config, Olaf_Reader * reader, bool keep_details){
+	size_t batch_blocks = OLAF_PIPELINE_BATCH_BLOCKS;
+	size_t max_event_points = config->maxEventPoints;
+	size_t max_fingerprints = batch_blocks * config->maxFingerprints;
+
+	Olaf_Stream_Pipeline * pipeline = (Olaf_Stream_Pipeline *) malloc(sizeof(Olaf_Stream_Pipeline));
+	pipeline->config = config;
+	pipeline->reader = reader;
+	pipeline->keep_details = keep_details;
+
+	pipeline->audio_queue = olaf_spsc_queue_new(OLAF_PIPELINE_QUEUE_SIZE,sizeof(struct olaf_pipeline_audio));
+	pipeline->event_point_queue = olaf_spsc_queue_new(OLAF_PIPELINE_QUEUE_SIZE,sizeof(struct olaf_pipeline_event_points));
+	pipeline->fingerprint_queue = olaf_spsc_queue_new(OLAF_PIPELINE_QUEUE_SIZE,sizeof(struct olaf_pipeline_fingerprints));
+	for(size_t i = 0 ; i < OLAF_PIPELINE_QUEUE_SIZE ; i++){
+		struct olaf_pipeline_audio * audio = (struct olaf_pipeline_audio *) olaf_spsc_queue_slot(pipeline->audio_queue,i);
+		audio->audio = (float *) malloc(batch_blocks * config->audioBlockSize * sizeof(float));
+
+		struct olaf_pipeline_event_points * event_points = (struct olaf_pipeline_event_points *) olaf_spsc_queue_slot(pipeline->event_point_queue,i);
+		event_points->event_points = (struct eventpoint *) malloc(batch_blocks * max_event_points * sizeof(struct eventpoint));
+		event_points->ends = (size_t *) malloc(batch_blocks * sizeof(size_t));
+
+		struct olaf_pipeline_fingerprints * fingerprints = (struct olaf_pipeline_fingerprints *) olaf_spsc_queue_slot(pipeline->fingerprint_queue,i);
+		fingerprints->hashes = (uint64_t *) malloc(max_fingerprints * sizeof(uint64_t));
+		fingerprints->time_indexes = (uint32_t *) malloc(max_fingerprints * sizeof(uint32_t));
+		fingerprints->details = keep_details ? (struct fingerprint *) malloc(max_fingerprints * sizeof(struct fingerprint)) : NULL;
+		fingerprints->batch_ends = (size_t *) malloc(batch_blocks * sizeof(size_t));
+		fingerprints->batch_last_time_indexes = (int *) malloc(batch_blocks * sizeof(int));
+	}
+
+	pipeline->fft_setup = pffft_new_setup(config->audioBlockSize,PFFFT_REAL);
+	pipeline->fft_in = (float *) pffft_aligned_malloc(config->audioBlockSize * sizeof(float));
+	pipeline->fft_out = (float *) pffft_aligned_malloc(config->audioBlockSize * sizeof(float));
+	pipeline->ep_detector = olaf_ep_extractor_new(config);
+
+	pipeline->ep_extractor = olaf_ep_extractor_new(config);
+	pipeline->fp_extractor = olaf_fp_extractor_new(config);
+	olaf_fp_extractor_keep_details(pipeline->fp_extractor,keep_details);
+	pipeline->remaining = NULL;
+
+	pipeline->current = NULL;
+	pipeline->current_batch = 0;
+	pipeline->finished = false;
+
+	olaf_stream_pipeline_start(&pipeline->read_thread,olaf_stream_pipeline_read,pipeline);
+	olaf_stream_pipeline_start(&pipeline->fft_thread,olaf_stream_pipeline_fft,pipeline);
+	olaf_stream_pipeline_start(&pipeline->fingerprint_thread,olaf_stream_pipeline_fingerprint,pipeline);
+
+	return pipeline;
+}
+
+struct extracted_fingerprints * olaf_stream_pipeline_next(Olaf_Stream_Pipeline * pipeline){
+	while(!pipeline->finished){
+		struct olaf_pipeline_fingerprints * fingerprints = pipeline->current;
+
+		if(fingerprints != NULL && pipeline->current_batch < fingerprints->batches){
+			size_t i = pipeline->current_batch++;
+			size_t start = i == 0 ? 0 : fingerprints->batch_ends[i - 1];
+
+			struct extracted_fingerprints * batch = &pipeline->batch;
+			batch->fingerprints = pipeline->keep_details ? fingerprints->details + start : NULL;
+			batch->fingerprintIndex = fingerprints->batch_ends[i] - start;
+			batch->hashes = fingerprints->hashes + start;
+			batch->timeIndexes = fingerprints->time_indexes + start;
+			batch->lastTimeIndex = fingerprints->batch_last_time_indexes[i];
+			return batch;
+		}
+
+		if(fingerprints != NULL){
+			//all batches are consumed: hand the slot back
+			pipeline->current = NULL;
+			olaf_spsc_queue_pop(pipeline->fingerprint_queue);
+
+			if(fingerprints->end){
+				pthread_join(pipeline->read_thread,NULL);
+				pthread_join(pipeline->fft_thread,NULL);
+				pthread_join(pipeline->fingerprint_thread,NULL);
+				pipeline->finished = true;
+			}
+		}else{
+			pipeline->current = (struct olaf_pipeline_fingerprints *) olaf_spsc_queue_back(pipeline->fingerprint_queue);
+			pipeline->current_batch = 0;
+		}
+	}
+	return NULL;
+}
+
+struct extracted_fingerprints * olaf_stream_pipeline_remaining(Olaf_Stream_Pipeline * pipeline){
+	assert(pipeline->finished);
+	return pipeline->remaining;
+}
+
+size_t olaf_stream_pipeline_total(Olaf_Stream_Pipeline * pipeline){
+	assert(pipeline->finished);
+	return olaf_fp_extractor_total(pipeline->fp_extractor);
+}
+
+void olaf_stream_pipeline_destroy(Olaf_Stream_Pipeline * pipeline){
+	assert(pipeline->finished);
+
+	for(size_t i = 0 ; i < OLAF_PIPELINE_QUEUE_SIZE ; i++){
+		struct olaf_pipeline_audio * audio = (struct olaf_pipeline_audio *) olaf_spsc_queue_slot(pipeline->audio_queue,i);
+		free(audio->audio);
+
+		struct olaf_pipeline_event_points * event_points = (struct olaf_pipeline_event_points *) olaf_spsc_queue_slot(pipeline->event_point_queue,i);
+		free(event_points->event_points);
+		free(event_points->ends);
+
+		struct olaf_pipeline_fingerprints * fingerprints = (struct olaf_pipeline_fingerprints *) olaf_spsc_queue_slot(pipeline->fingerprint_queue,i);
+		free(fingerprints->hashes);
+		free(fingerprints->time_indexes);
+		free(fingerprints->details);
+		free(fingerprints->batch_ends);
+		free(fingerprints->batch_last_time_indexes);
+	}
+	olaf_spsc_queue_destroy(pipeline->audio_queue);
+	olaf_spsc_queue_destroy(pipeline->event_point_queue);
+	olaf_spsc_queue_destroy(pipeline->fingerprint_queue);
+
+	pffft_aligned_free(pipeline->fft_in);
+	pffft_aligned_free(pipeline->fft_out);
+	pffft_destroy_setup(pipeline->fft_setup);
+	olaf_ep_extractor_destroy(pipeline->ep_detector);
+	olaf_ep_extractor_destroy(pipeline->ep_extractor);
+	olaf_fp_extractor_destroy(pipeline->fp_extractor);
+
+	free(pipeline);
+}
@@ -0,0 +1,87 @@
+// Olaf: Overly Lightweight Acoustic Fingerprinting
+// Copyright (C) 2019-2025  Joren Six
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/**
+ * @file olaf_stream_pipeline.h
+ *
+ * @brief Extracts the fingerprints of an audio stream in a pipeline of threads.
+ *
+ * A stream can not be split in chunks, but the steps for each audio block can run on
+ * separate threads: reading, FFT and event point detection, and combining event points
+ * into fingerprints. The caller consumes the fingerprints, e.g. to match or store them,
+ * on its own thread. The stages are connected by bounded single-producer/single-consumer
+ * queues of small batches of audio blocks, which bounds the latency to a few batches.
+ * The fingerprints are the same as the ones of a sequential run, batch per batch.
+ */
+#ifndef OLAF_STREAM_PIPELINE_H
+#define OLAF_STREAM_PIPELINE_H
+
+	#include <stdbool.h>
+
+	#include "olaf_config.h"
+	#include "olaf_reader.h"
+	#include "olaf_fp_extractor.h"
+
+	/**
+	 * @struct Olaf_Stream_Pipeline
+	 *
+	 * @brief The stage threads and the queues between them.
+	 */
+	/** @typedef Olaf_Stream_Pipeline
+	 *  @brief Typedef for struct Olaf_Stream_Pipeline.
+	 */
+	typedef struct Olaf_Stream_Pipeline Olaf_Stream_Pipeline;
+
+	/**
+	 * Start the pipeline threads. The reader is read on the first stage thread until the
+	 * end of the stream is reached.
+	 * @param config The configuration.
+	 * @param reader The audio reader.
+	 * @param keep_details Keep the full fingerprint details, see olaf_fp_extractor_keep_details().
+	 * @return The running pipeline.
+	 */
+	Olaf_Stream_Pipeline * olaf_stream_pipeline_new(Olaf_Config * config, Olaf_Reader * reader, bool keep_details);
+
+	/**
+	 * Wait for the next batch of fingerprints. A sequential run extracts a batch for each
+	 * audio block with enough event points, batches without fingerprints are left out.
+	 * @param pipeline The pipeline.
+	 * @return The next batch, valid until the next call, or NULL at the end of the stream.
+	 * Once NULL is returned all pipeline threads are stopped and the reader can be used again.
+	 */
+	struct extracted_fingerprints * olaf_stream_pipeline_next(Olaf_Stream_Pipeline * pipeline);
+
+	/**
+	 * The fingerprints of the event points left at the end of the stream, as extracted
+	 * after the last block of a sequential run.
+	 * @param pipeline A pipeline at the end of the stream.
+	 * @return The remaining fingerprints or NULL if no audio block was processed.
+	 */
+	struct extracted_fingerprints * olaf_stream_pipeline_remaining(Olaf_Stream_Pipeline * pipeline);
+
+	/**
+	 * @param pipeline A pipeline at the end of the stream.
+	 * @return The total number of extracted fingerprints, see olaf_fp_extractor_total().
+	 */
+	size_t olaf_stream_pipeline_total(Olaf_Stream_Pipeline * pipeline);
+
+	/**
+	 * Free memory, the pipeline needs to be at the end of the stream.
+	 * @param pipeline The pipeline.
+	 */
+	void olaf_stream_pipeline_destroy(Olaf_Stream_Pipeline * pipeline);
+
+#endif // OLAF_STREAM_PIPELINE_H
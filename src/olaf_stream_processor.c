@@ -12,6 +12,8 @@
 #include "olaf_reader.h"
 #include "olaf_ep_extractor.h"
 #include "olaf_fp_extractor.h"
+#include "olaf_chunked_extractor.h"
+#include "olaf_stream_pipeline.h"
 #include "olaf_db.h"
 #include "olaf_fp_matcher.h"
 #include "olaf_fp_db_writer.h"
@@ -21,8 +23,8 @@ struct Olaf_Stream_Processor{
 	Olaf_Runner *runner; /**< Reference to the runner managing this processor */
 	Olaf_Config *config; /**< Reference to the Olaf configuration */
 	Olaf_Reader *reader; /**< Audio reader for the input stream */
-	Olaf_EP_Extractor *ep_extractor; /**< Event point extractor instance */
-	Olaf_FP_Extractor *fp_extractor; /**< Fingerprint extractor instance */
+	Olaf_EP_Extractor *ep_extractor; /**< Event point extractor of the runner */
+	Olaf_FP_Extractor *fp_extractor; /**< Fingerprint extractor of the runner */
 
 	uint32_t audio_identifier; /**< Hash identifier for the audio file */
 	const char* orig_path; /**< Original file path of the audio source */
@@ -31,7 +33,6 @@ struct Olaf_Stream_Processor{
 	Olaf_FP_Matcher_Result_Callback result_callback; /**< Callback invoked for each match result */
 
 	//Input audio samples
-	float *audio_data; /**< Buffer holding input audio samples */
 
 	//Stats captured at end of process(); accessible via accessors below.
 	double last_audio_duration; /**< Total audio duration in seconds. */
@@ -40,16 +41,7 @@ struct Olaf_Stream_Processor{
 	bool suppress_summary_print; /**< If true, skip the summary line on stderr. */
 };
 
-
-Olaf_Stream_Processor * olaf_stream_processor_new(Olaf_Runner * runner,const char* raw_path,const char* orig_path){
-
-	//Open the audio reader first; if it fails (e.g. missing/unreadable file)
-	//bail out before allocating anything else so a single bad input cannot
-	//take down the entire process from a worker thread.
-	Olaf_Reader * reader = olaf_reader_new(runner->config, raw_path);
-	if(reader == NULL){
-		return NULL;
-	}
+static Olaf_Stream_Processor * olaf_stream_processor_new_reader(Olaf_Runner * runner,Olaf_Reader * reader,const char* orig_path){
 
 	Olaf_Stream_Processor * processor = (Olaf_Stream_Processor *) malloc(sizeof(Olaf_Stream_Processor));
 
@@ -67,20 +59,37 @@ Olaf_Stream_Processor * olaf_stream_processor_new(Olaf_Runner * runner,const cha
 
 	processor->runner = runner;
 	processor->config = runner->config;
-	processor->ep_extractor = olaf_ep_extractor_new(processor->config);
-	processor->fp_extractor = olaf_fp_extractor_new(processor->config);
+	//the extractors of the runner are reused, without allocations, for each audio file
+	processor->ep_extractor = runner->ep_extractor;
+	processor->fp_extractor = runner->fp_extractor;
+	olaf_ep_extractor_reset(processor->ep_extractor);
+	olaf_fp_extractor_reset(processor->fp_extractor);
 	processor->reader = reader;
-	processor->audio_data = (float *) calloc(processor->config->audioBlockSize , sizeof(float)); //Input audio samples
 
 	return processor;
 }
 
+Olaf_Stream_Processor * olaf_stream_processor_new(Olaf_Runner * runner,const char* raw_path,const char* orig_path){
+
+	//Open the audio reader first; if it fails (e.g. missing/unreadable file)
+	//bail out before allocating anything else so a single bad input cannot
+	//take down the entire process from a worker thread.
+	Olaf_Reader * reader = olaf_reader_new(runner->config, raw_path);
+	if(reader == NULL){
+		return NULL;
+	}
+
+	return olaf_stream_processor_new_reader(runner,reader,orig_path);
+}
+
+Olaf_Stream_Processor * olaf_stream_processor_new_file(Olaf_Runner * runner,FILE * audio_file,const char* orig_path){
+	return olaf_stream_processor_new_reader(runner,olaf_reader_new_file(runner->config,audio_file),orig_path);
+}
+
 void olaf_stream_processor_destroy(Olaf_Stream_Processor * processor){
+	//the extractors belong to the runner
 	olaf_reader_destroy(processor->reader);
-	olaf_fp_extractor_destroy(processor->fp_extractor);
-	olaf_ep_extractor_destroy(processor->ep_extractor);
-	
-	free(processor->audio_data);
+
 	free(processor);
 }
 
@@ -92,6 +101,22 @@ void olaf_stream_processor_set_result_header(Olaf_Stream_Processor * processor,c
 	processor->result_header = result_header;
 }
 
+//Hand a batch of fingerprints extracted from an audio block to the sink of the mode
+static void olaf_stream_processor_handle(Olaf_Stream_Processor * processor,struct extracted_fingerprints * fingerprints,Olaf_FP_Matcher *fp_matcher,Olaf_FP_DB_Writer *fp_db_writer,Olaf_FP_File_Writer *fp_file_writer){
+	if(processor->runner->mode == OLAF_RUNNER_MODE_QUERY){
+		//use the fingerprints to match with the reference database
+		//report matches if found
+		olaf_fp_matcher_match(fp_matcher,fingerprints);
+	}else if(processor->runner->mode == OLAF_RUNNER_MODE_STORE){
+		//use the fp's to store in the db
+		olaf_fp_db_writer_store(fp_db_writer,fingerprints);
+	} else if(processor->runner->mode == OLAF_RUNNER_MODE_DELETE){
+		olaf_fp_db_writer_delete(fp_db_writer,fingerprints);
+	} else if(processor->runner->mode == OLAF_RUNNER_MODE_PRINT || processor->runner->mode == OLAF_RUNNER_MODE_CACHE){
+		olaf_fp_file_writer_write(fp_file_writer,fingerprints);
+	}
+}
+
 void olaf_stream_processor_process(Olaf_Stream_Processor * processor){
 	
 	int audioBlockIndex = 0;
@@ -108,87 +133,112 @@ void olaf_stream_processor_process(Olaf_Stream_Processor * processor){
 			olaf_fp_matcher_set_header(fp_matcher, processor->result_header);
 		}
 	} else if(processor->runner->mode == OLAF_RUNNER_MODE_STORE || processor->runner->mode == OLAF_RUNNER_MODE_DELETE){
-		fp_db_writer = olaf_fp_db_writer_new(processor->runner->db,processor->audio_identifier);
+		if(processor->runner->db_queue != NULL){
+			fp_db_writer = olaf_fp_db_writer_new_queued(processor->runner->db_queue,processor->audio_identifier);
+		}else{
+			fp_db_writer = olaf_fp_db_writer_new(processor->runner->db,processor->audio_identifier);
+		}
 	}else if(processor->runner->mode == OLAF_RUNNER_MODE_PRINT ){
 		fp_file_writer = olaf_fp_file_writer_new(stdout);
 		olaf_fp_file_writer_write_header(fp_file_writer);
 	} else if(processor->runner->mode == OLAF_RUNNER_MODE_CACHE ){
-		//create a cache file writer
-		fp_file_writer = olaf_fp_file_writer_new(processor->runner->fp_cache_file);
-		olaf_fp_file_writer_write_header(fp_file_writer);
+		//create a cache file writer, the binary cache is written when the writer is destroyed
+		fp_file_writer = olaf_fp_file_writer_new_binary(processor->runner->fp_cache_file,processor->config,processor->audio_identifier);
 	}
 
 	struct extracted_event_points * eventPoints = NULL;
 	struct extracted_fingerprints * fingerprints = NULL;
-
-	size_t samples_read = olaf_reader_read(processor->reader,processor->audio_data);
-	size_t samples_expected = processor->config->audioStepSize;
+	size_t total_fingerprints = 0;
+	double audioDuration = 0;
 
 	clock_t start, end;
     double cpu_time_used;
     start = clock();
 
-    //The fft struct is reused
-	PFFFT_Setup *fftSetup = processor->runner->fftSetup;
-	float *fft_in= processor->runner->fft_in;
-	float *fft_out= processor->runner->fft_out;
-
-	const float* window = olaf_fft_window(processor->config->audioBlockSize);
-	while(samples_read==samples_expected){
-		samples_read = olaf_reader_read(processor->reader,processor->audio_data);
-		
-		// windowing + copy to fft input
-		for(int j = 0 ; j <  processor->config->audioBlockSize ; j++){
-			fft_in[j] = processor->audio_data[j] * window[j];
+	//a long memory mapped file can be split over several threads, else the steps of a 
+	//stream run on separate threads
+	Olaf_Chunked_Extractor * chunked_extractor = NULL;
+	Olaf_Stream_Pipeline * pipeline = NULL;
+	if(processor->config->extractionThreads > 1 && !processor->config->verbose){
+		bool keep_details = processor->runner->mode == OLAF_RUNNER_MODE_PRINT;
+		chunked_extractor = olaf_chunked_extractor_new(processor->config,processor->reader,(size_t) processor->config->extractionThreads,keep_details);
+		if(chunked_extractor == NULL){
+			pipeline = olaf_stream_pipeline_new(processor->config,processor->reader,keep_details);
 		}
+	}
 
-		//do the transform
-		pffft_transform_ordered(fftSetup, fft_in, fft_out, 0, PFFFT_FORWARD);
-
-		//extract event points
-		eventPoints = olaf_ep_extractor_extract(processor->ep_extractor,fft_out,audioBlockIndex);
-
-		//if there are enough event points
-		if(eventPoints->eventPointIndex > processor->config->eventPointThreshold){
-			//combine the event points into fingerprints
-			fingerprints = olaf_fp_extractor_extract(processor->fp_extractor,eventPoints,audioBlockIndex);
-
-			if(processor->runner->mode == OLAF_RUNNER_MODE_QUERY){
-				//use the fingerprints to match with the reference database
-				//report matches if found
-				olaf_fp_matcher_match(fp_matcher,fingerprints);
-			}else if(processor->runner->mode == OLAF_RUNNER_MODE_STORE){
-				//use the fp's to store in the db
-				olaf_fp_db_writer_store(fp_db_writer,fingerprints);
-			} else if(processor->runner->mode == OLAF_RUNNER_MODE_DELETE){
-				olaf_fp_db_writer_delete(fp_db_writer,fingerprints);
-			} else if(processor->runner->mode == OLAF_RUNNER_MODE_PRINT || processor->runner->mode == OLAF_RUNNER_MODE_CACHE){
-				olaf_fp_file_writer_write(fp_file_writer,fingerprints);
+	if(chunked_extractor != NULL){
+		//the batches are handled in the order of a sequential run
+		for(size_t i = 0 ; i < olaf_chunked_extractor_batches(chunked_extractor) ; i++){
+			olaf_stream_processor_handle(processor,olaf_chunked_extractor_batch(chunked_extractor,i),fp_matcher,fp_db_writer,fp_file_writer);
+		}
+		fingerprints = olaf_chunked_extractor_remaining(chunked_extractor);
+		total_fingerprints = olaf_chunked_extractor_total(chunked_extractor);
+		audioDuration = (double) olaf_reader_length(processor->reader) / (double) processor->config->audioSampleRate;
+	}else if(pipeline != NULL){
+		//matching or storing is the last step of the pipeline
+		while((fingerprints = olaf_stream_pipeline_next(pipeline)) != NULL){
+			olaf_stream_processor_handle(processor,fingerprints,fp_matcher,fp_db_writer,fp_file_writer);
+		}
+		fingerprints = olaf_stream_pipeline_remaining(pipeline);
+		total_fingerprints = olaf_stream_pipeline_total(pipeline);
+		audioDuration = (double) olaf_reader_total_samples_read(processor->reader) / (double) processor->config->audioSampleRate;
+	}else{
+		//a view into the reader, the current block of samples
+		const float* audio_block;
+		size_t samples_read = olaf_reader_read_block(processor->reader,&audio_block);
+		size_t samples_expected = processor->config->audioStepSize;
+
+		//The fft struct is reused
+		PFFFT_Setup *fftSetup = processor->runner->fftSetup;
+		float *fft_in= processor->runner->fft_in;
+		float *fft_out= processor->runner->fft_out;
+
+		const float* window = olaf_fft_window(processor->config->audioBlockSize);
+		while(samples_read==samples_expected){
+			samples_read = olaf_reader_read_block(processor->reader,&audio_block);
+			
+			// windowing + copy to fft input
+			olaf_fft_window_apply(fft_in,audio_block,window,processor->config->audioBlockSize);
+
+			//do the transform
+			pffft_transform_ordered(fftSetup, fft_in, fft_out, 0, PFFFT_FORWARD);
+
+			//extract event points
+			eventPoints = olaf_ep_extractor_extract(processor->ep_extractor,fft_out,audioBlockIndex);
+
+			//if there are enough event points
+			if(eventPoints->eventPointIndex > processor->config->eventPointThreshold){
+				//combine the event points into fingerprints
+				fingerprints = olaf_fp_extractor_extract(processor->fp_extractor,eventPoints,audioBlockIndex);
+
+				olaf_stream_processor_handle(processor,fingerprints,fp_matcher,fp_db_writer,fp_file_writer);
+
+				//handled all fingerprints set index back to zero
+
+				fingerprints->fingerprintIndex = 0;
 			}
+			//increase the audio buffer counter
+			audioBlockIndex++;
 
-			//handled all fingerprints set index back to zero
-
-			fingerprints->fingerprintIndex = 0;
+			//report some info for the streaming case
+			if(audioBlockIndex % 100 == 0 && strcmp(processor->orig_path , "stdin") == 0){
+				double streamDuration = (double) olaf_reader_total_samples_read(processor->reader) / (double) processor->config->audioSampleRate;
+				fprintf(stderr,"Time: %.3fs  fps: %zu \n",streamDuration,olaf_fp_extractor_total(processor->fp_extractor));
+			}
 		}
-		//increase the audio buffer counter
-		audioBlockIndex++;
-
-		//report some info for the streaming case
-		if(audioBlockIndex % 100 == 0 && strcmp(processor->orig_path , "stdin") == 0){
-			double audioDuration = (double) olaf_reader_total_samples_read(processor->reader) / (double) processor->config->audioSampleRate;
-			fprintf(stderr,"Time: %.3fs  fps: %zu \n",audioDuration,olaf_fp_extractor_total(processor->fp_extractor));
+		
+		//handle the last event points
+		//If the main loop never ran (e.g. truncated/empty raw audio file from a
+		//racy temp path or just a very short input), eventPoints is still NULL.
+		//Skip the final extract in that case to avoid a NULL deref. The empty
+		//fingerprints buffer below is fine for the metadata-only paths.
+		if(eventPoints != NULL && eventPoints->eventPointIndex > 0){
+			fingerprints = olaf_fp_extractor_extract(processor->fp_extractor,eventPoints,audioBlockIndex);
 		}
+		total_fingerprints = olaf_fp_extractor_total(processor->fp_extractor);
+		audioDuration = (double) olaf_reader_total_samples_read(processor->reader) / (double) processor->config->audioSampleRate;
 	}
-	
-	//handle the last event points
-	//If the main loop never ran (e.g. truncated/empty raw audio file from a
-	//racy temp path or just a very short input), eventPoints is still NULL.
-	//Skip the final extract in that case to avoid a NULL deref. The empty
-	//fingerprints buffer below is fine for the metadata-only paths.
-	if(eventPoints != NULL && eventPoints->eventPointIndex > 0){
-		fingerprints = olaf_fp_extractor_extract(processor->fp_extractor,eventPoints,audioBlockIndex);
-	}
-	double audioDuration = (double) olaf_reader_total_samples_read(processor->reader) / (double) processor->config->audioSampleRate;
 
 	if(processor->runner->mode == OLAF_RUNNER_MODE_QUERY){
 		//use the fingerprints to match with the reference database
@@ -212,14 +262,22 @@ void olaf_stream_processor_process(Olaf_Stream_Processor * processor){
 		}else{
 			strcpy(meta_data.path,processor->orig_path);
 		}
-		meta_data.fingerprints = olaf_fp_extractor_total(processor->fp_extractor);
-		olaf_db_store_meta_data(processor->runner->db,&processor->audio_identifier,&meta_data);
+		meta_data.fingerprints = total_fingerprints;
+		if(processor->runner->db_queue != NULL){
+			olaf_fp_db_writer_queue_store_meta_data(processor->runner->db_queue,processor->audio_identifier,&meta_data);
+		}else{
+			olaf_db_store_meta_data(processor->runner->db,&processor->audio_identifier,&meta_data);
+		}
 	} else if(processor->runner->mode == OLAF_RUNNER_MODE_DELETE){
 		if(fingerprints != NULL){
 			olaf_fp_db_writer_delete(fp_db_writer,fingerprints);
 		}
 		olaf_fp_db_writer_destroy(fp_db_writer,false);
-		olaf_db_delete_meta_data(processor->runner->db,&processor->audio_identifier);
+		if(processor->runner->db_queue != NULL){
+			olaf_fp_db_writer_queue_delete_meta_data(processor->runner->db_queue,processor->audio_identifier);
+		}else{
+			olaf_db_delete_meta_data(processor->runner->db,&processor->audio_identifier);
+		}
 	} else if(processor->runner->mode == OLAF_RUNNER_MODE_PRINT || processor->runner->mode == OLAF_RUNNER_MODE_CACHE){
 
 		Olaf_Resource_Meta_data meta_data;
@@ -229,10 +287,17 @@ void olaf_stream_processor_process(Olaf_Stream_Processor * processor){
 		}else{
 			strcpy(meta_data.path,processor->orig_path);
 		}
-		meta_data.fingerprints = olaf_fp_extractor_total(processor->fp_extractor);
+		meta_data.fingerprints = total_fingerprints;
 		olaf_fp_file_writer_destroy(fp_file_writer,&meta_data,processor->runner->fp_meta_file);
 	}
 
+	if(chunked_extractor != NULL){
+		olaf_chunked_extractor_destroy(chunked_extractor);
+	}
+	if(pipeline != NULL){
+		olaf_stream_pipeline_destroy(pipeline);
+	}
+
 	//for timing statistics
 	end = clock();
     cpu_time_used = ((double) (end - start)) / CLOCKS_PER_SEC;
@@ -250,12 +315,12 @@ void olaf_stream_processor_process(Olaf_Stream_Processor * processor){
 	}else if(processor->runner->mode == OLAF_RUNNER_MODE_CACHE){
 		verb = "Cached";
 	}
-	double fingerprintspersecond = olaf_fp_extractor_total(processor->fp_extractor) / audioDuration;
+	double fingerprintspersecond = total_fingerprints / audioDuration;
 	processor->last_audio_duration = audioDuration;
 	processor->last_cpu_time_used = cpu_time_used;
-	processor->last_total_fingerprints = olaf_fp_extractor_total(processor->fp_extractor);
+	processor->last_total_fingerprints = total_fingerprints;
 	if(!processor->suppress_summary_print){
-		fprintf(stderr,"%s %lu fp's from %.1fs (%.0f fp/s) in %.3fs (%.0f times realtime)\n",verb,olaf_fp_extractor_total(processor->fp_extractor), audioDuration,fingerprintspersecond,cpu_time_used,ratio);
+		fprintf(stderr,"%s %lu fp's from %.1fs (%.0f fp/s) in %.3fs (%.0f times realtime)\n",verb,total_fingerprints, audioDuration,fingerprintspersecond,cpu_time_used,ratio);
 	}
 }
 
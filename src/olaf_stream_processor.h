@@ -51,6 +51,17 @@
      */
     Olaf_Stream_Processor * olaf_stream_processor_new(Olaf_Runner * runner,const char* raw_path,const char* orig_path);
 
+    /**
+     * @brief      Initialize a new stream processor which reads raw audio samples from an open stream.
+     *
+     * @param      runner      The runner which determines the type of processing to take place (query, match, print,... )
+     * @param      audio_file  The stream with raw audio samples, closed when the processor is destroyed.
+     * @param[in]  orig_path   The original audio path to store in meta-data.
+     *
+     * @return     Newly created state information related to the processor.
+     */
+    Olaf_Stream_Processor * olaf_stream_processor_new_file(Olaf_Runner * runner,FILE * audio_file,const char* orig_path);
+
     /**
      * @brief      Process a file from the first to last audio sample.
      *
@@ -24,6 +24,7 @@
 
 #include "olaf_window.h"
 #include "olaf_config.h"
+#include "olaf_audio_buffer.h"
 #include "olaf_ep_extractor.h"
 #include "olaf_fp_extractor.h"
 #include "olaf_fp_matcher.h"
@@ -32,11 +33,13 @@
  * @brief Holds the complete processing state for the WASM-based Olaf instance.
  */
 struct Olaf_State{
-	float * audio; /**< Buffer for incoming audio samples */
+	Olaf_Audio_Buffer * audio_buffer; /**< Overlapping blocks of incoming audio samples */
+
+	float * audio_step; /**< Where the new samples of the next block go */
 
 	size_t audio_block_index; /**< Index of the current audio block */
 
-	size_t audio_sample_index; /**< Index of the current audio sample within the block */
+	size_t audio_sample_index; /**< Index of the current audio sample within the step */
 
 	PFFFT_Setup *fftSetup; /**< FFT configuration and twiddle factors */
 	float *fft_in; /**< FFT input buffer */
@@ -65,11 +68,6 @@ void olaf_fp_matcher_callback_js(int matchCount, float queryStart, float querySt
 
 int EMSCRIPTEN_KEEPALIVE olaf_fingerprint_match(float * audio_buffer, size_t audio_buffer_size, uint32_t * fingerprints, size_t fingerprints_size ){
 
-	//Expect a step size of 128
-	size_t step_size = state.config->audioStepSize;
-	size_t block_size = state.config->audioBlockSize;
-	size_t overlap_size = block_size - step_size;
-
 	if(state.fftSetup == NULL){
 		//Get the default configuration
 		state.config = olaf_config_esp_32();
@@ -78,16 +76,21 @@ int EMSCRIPTEN_KEEPALIVE olaf_fingerprint_match(float * audio_buffer, size_t aud
 		state.fft_in = (float*) pffft_aligned_malloc(state.config->audioBlockSize*4);//fft input
 		state.fft_out= (float*) pffft_aligned_malloc(state.config->audioBlockSize*4);//fft output
 
-		state.audio = calloc(sizeof(float),state.config->audioBlockSize);
+		state.audio_buffer = olaf_audio_buffer_new(state.config);
 		state.db = olaf_db_new(NULL,true);
 		state.ep_extractor = olaf_ep_extractor_new(state.config);
 		state.fp_extractor = olaf_fp_extractor_new(state.config);
+		olaf_fp_extractor_keep_details(state.fp_extractor,false);
 		state.fp_matcher = olaf_fp_matcher_new(state.config,state.db,olaf_fp_matcher_callback_js);
 
-		state.audio_sample_index = overlap_size;
+		state.audio_step = olaf_audio_buffer_step(state.audio_buffer);
+		state.audio_sample_index = 0;
 		state.audio_block_index = 0;
 	}
 
+	//Expect a step size of 128
+	size_t step_size = state.config->audioStepSize;
+
 	const float* window = olaf_fft_window(state.config->audioBlockSize);
 
 
@@ -95,15 +98,16 @@ int EMSCRIPTEN_KEEPALIVE olaf_fingerprint_match(float * audio_buffer, size_t aud
 
 	//add the new samples
 	for(size_t i = 0 ; i < audio_buffer_size;i++){
-		state.audio[state.audio_sample_index] = audio_buffer[i];
+		state.audio_step[state.audio_sample_index] = audio_buffer[i];
 		state.audio_sample_index++;
 
-		if(state.audio_sample_index == (size_t) block_size){
+		if(state.audio_sample_index == step_size){
 			//block is full, process the full audio block
+			const float * audio_block = olaf_audio_buffer_block(state.audio_buffer);
 			
 			//Store in the fft in array while applying the window 
 			for(int i = 0 ; i <  state.config->audioBlockSize ; i++){
-				state.fft_in[i] = state.audio[i] * window[i];
+				state.fft_in[i] = audio_block[i] * window[i];
 			}
 
 			//do the transform
@@ -132,12 +136,9 @@ int EMSCRIPTEN_KEEPALIVE olaf_fingerprint_match(float * audio_buffer, size_t aud
 			//Prepare for the next audio samples
 			state.audio_block_index++;
 			
-			// make room for the new samples: shift the samples to the beginning
-			for(size_t i = 0 ; i < overlap_size;i++){
-				state.audio[i] = state.audio[i+step_size];
-			}
-			//next sample should be at overlap_size index
-			state.audio_sample_index = overlap_size;
+			//the buffer keeps the overlap, the next samples go after it
+			state.audio_step = olaf_audio_buffer_step(state.audio_buffer);
+			state.audio_sample_index = 0;
 		}
 	}
 
@@ -149,7 +150,7 @@ void cleanup(){
 	//pffft_aligned_free(state.fft_in);
 	//pffft_aligned_free(state.fft_out);
 	//pffft_destroy_setup(state.fftSetup);
-	free(state.audio);
+	olaf_audio_buffer_destroy(state.audio_buffer);
 }
 
 
@@ -18,6 +18,7 @@
 #define OLAF_WINDOW_H
 
 #include <stdbool.h> //bool 
+#include <stddef.h> //size_t
 
 /**
  * @file olaf_window.h
@@ -1194,4 +1195,53 @@ inline static const float * olaf_fft_window(int audioBlockSize){
    return NULL;
 }
 
+/**
+ * @brief      Multiply an audio block with a window and store the result as FFT input.
+ *
+ * @param      fft_in      The FFT input, size samples.
+ * @param[in]  audio_data  The audio block.
+ * @param[in]  window      The window, see olaf_fft_window().
+ * @param[in]  size        The audio block size.
+ */
+#if defined(__ARM_NEON)
+
+	#include <arm_neon.h>
+
+	//Multiply a block of audio with the window, four samples at a time
+	inline static void olaf_fft_window_apply(float* fft_in, const float* audio_data, const float* window, size_t size){
+		size_t j = 0;
+		for(; j + 4 <= size ; j += 4){
+			vst1q_f32(fft_in + j, vmulq_f32(vld1q_f32(audio_data + j), vld1q_f32(window + j)));
+		}
+		for(; j < size ; j++){
+			fft_in[j] = audio_data[j] * window[j];
+		}
+	}
+
+#elif defined(__SSE__)
+
+	#include <xmmintrin.h>
+
+	//Multiply a block of audio with the window, four samples at a time
+	inline static void olaf_fft_window_apply(float* fft_in, const float* audio_data, const float* window, size_t size){
+		size_t j = 0;
+		for(; j + 4 <= size ; j += 4){
+			_mm_storeu_ps(fft_in + j, _mm_mul_ps(_mm_loadu_ps(audio_data + j), _mm_loadu_ps(window + j)));
+		}
+		for(; j < size ; j++){
+			fft_in[j] = audio_data[j] * window[j];
+		}
+	}
+
+#else
+
+	//Multiply a block of audio with the window
+	inline static void olaf_fft_window_apply(float* fft_in, const float* audio_data, const float* window, size_t size){
+		for(size_t j = 0 ; j < size ; j++){
+			fft_in[j] = audio_data[j] * window[j];
+		}
+	}
+
+#endif
+
 #endif // OLAF_WINDOW_H
@@ -1,12 +1,27 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
 
 #include "olaf_config.h"
 #include "olaf_reader.h"
+#include "olaf_audio_buffer.h"
 #include "olaf_db.h"
+#include "olaf_db_remote.h"
+#include "olaf_db_flat.h"
+#include "olaf_fp_db_writer_queue.h"
+#include "olaf_fp_file_writer.h"
+#include "olaf_fp_db_writer_cache.h"
 #include "olaf_deque.h"
 #include "olaf_max_filter.h"
+#include "olaf_ep_extractor.h"
+#include "olaf_fp_extractor.h"
+#include "olaf_chunked_extractor.h"
+#include "olaf_stream_pipeline.h"
+#include "olaf_window.h"
+#include "pffft.h"
 
 void olaf_db_mem_unpack(uint64_t packed, uint64_t * hash, uint32_t * t){
 	*hash = (packed >> 16);
@@ -21,6 +36,185 @@ uint64_t olaf_db_mem_pack(uint64_t hash, uint32_t t){
 }
 
 
+void olaf_audio_buffer_tests(void){
+	printf("%s\n","Start audio buffer tests.");
+	Olaf_Config *config = olaf_config_test();
+	Olaf_Audio_Buffer * audio_buffer = olaf_audio_buffer_new(config);
+
+	long block_size = config->audioBlockSize;
+	long step_size = config->audioStepSize;
+
+	//enough steps to move the overlap to the start of the buffer a few times
+	for(long step = 1 ; step <= 1000 ; step++){
+		float * new_samples = olaf_audio_buffer_step(audio_buffer);
+		for(long i = 0 ; i < step_size ; i++){
+			new_samples[i] = (float) ((step - 1) * step_size + i);
+		}
+
+		//the block ends with the new samples, before the first sample it is silent
+		const float * block = olaf_audio_buffer_block(audio_buffer);
+		for(long i = 0 ; i < block_size ; i++){
+			long sample_index = step * step_size - block_size + i;
+			assert(block[i] == (sample_index < 0 ? 0 : (float) sample_index));
+		}
+	}
+
+	olaf_audio_buffer_destroy(audio_buffer);
+	olaf_config_destroy(config);
+}
+
+void olaf_ep_expire_tests(void){
+	printf("%s\n","Start event point expire tests.");
+	struct eventpoint buffer[8];
+	struct extracted_event_points eps;
+	eps.buffer = buffer;
+	eps.bufferSize = 8;
+	eps.eventPoints = buffer;
+	eps.eventPointIndex = 6;
+
+	//time ordered, the second to last one is used up
+	int times[6] = {1,2,2,5,6,7};
+	for(int i = 0 ; i < 6 ; i++){
+		buffer[i].timeIndex = times[i];
+		buffer[i].frequencyBin = 10 + i;
+		buffer[i].magnitude = 1;
+		buffer[i].usages = i == 4 ? 2 : 1;
+	}
+
+	olaf_ep_extractor_expire(&eps,2,2);
+
+	//the expired ones are removed from the head, the used up one in place
+	assert(eps.eventPoints == buffer + 3);
+	assert(eps.eventPointIndex == 2);
+	assert(eps.eventPoints[0].frequencyBin == 13);
+	assert(eps.eventPoints[1].frequencyBin == 15);
+
+	olaf_ep_extractor_expire(&eps,100,2);
+	assert(eps.eventPointIndex == 0);
+}
+
+//A sequential run over a part of the chunked run: the same batches in the same order.
+//The extractors are reset first, as a runner does for each audio file.
+static size_t olaf_chunked_extractor_compare(Olaf_Config * config, const char * audio_file_name, Olaf_Chunked_Extractor * chunked_extractor, Olaf_EP_Extractor *ep_extractor, Olaf_FP_Extractor *fp_extractor){
+	Olaf_Reader *reader = olaf_reader_new(config,audio_file_name);
+	olaf_ep_extractor_reset(ep_extractor);
+	olaf_fp_extractor_reset(fp_extractor);
+	PFFFT_Setup *fft_setup = pffft_new_setup(config->audioBlockSize,PFFFT_REAL);
+	float *fft_in = (float *) pffft_aligned_malloc(config->audioBlockSize * sizeof(float));
+	float *fft_out = (float *) pffft_aligned_malloc(config->audioBlockSize * sizeof(float));
+	const float *window = olaf_fft_window(config->audioBlockSize);
+
+	struct extracted_event_points * event_points = NULL;
+	struct extracted_fingerprints * fingerprints = NULL;
+	size_t batch_index = 0;
+	int audio_block_index = 0;
+
+	const float * audio_block;
+	size_t samples_expected = config->audioStepSize;
+	size_t samples_read = olaf_reader_read_block(reader,&audio_block);
+	while(samples_read == samples_expected){
+		samples_read = olaf_reader_read_block(reader,&audio_block);
+		olaf_fft_window_apply(fft_in,audio_block,window,config->audioBlockSize);
+		pffft_transform_ordered(fft_setup, fft_in, fft_out, 0, PFFFT_FORWARD);
+		event_points = olaf_ep_extractor_extract(ep_extractor,fft_out,audio_block_index);
+		if(event_points->eventPointIndex > config->eventPointThreshold){
+			fingerprints = olaf_fp_extractor_extract(fp_extractor,event_points,audio_block_index);
+			if(fingerprints->fingerprintIndex > 0){
+				struct extracted_fingerprints * batch = olaf_chunked_extractor_batch(chunked_extractor,batch_index++);
+				assert(batch->fingerprintIndex == fingerprints->fingerprintIndex);
+				assert(batch->lastTimeIndex == fingerprints->lastTimeIndex);
+				assert(memcmp(batch->hashes,fingerprints->hashes,batch->fingerprintIndex * sizeof(uint64_t)) == 0);
+				assert(memcmp(batch->timeIndexes,fingerprints->timeIndexes,batch->fingerprintIndex * sizeof(uint32_t)) == 0);
+			}
+			fingerprints->fingerprintIndex = 0;
+		}
+		audio_block_index++;
+	}
+	assert(batch_index == olaf_chunked_extractor_batches(chunked_extractor));
+
+	fingerprints = olaf_fp_extractor_extract(fp_extractor,event_points,audio_block_index);
+	struct extracted_fingerprints * remaining = olaf_chunked_extractor_remaining(chunked_extractor);
+	assert(remaining->fingerprintIndex == fingerprints->fingerprintIndex);
+	assert(memcmp(remaining->hashes,fingerprints->hashes,remaining->fingerprintIndex * sizeof(uint64_t)) == 0);
+	assert(olaf_chunked_extractor_total(chunked_extractor) == olaf_fp_extractor_total(fp_extractor));
+
+	pffft_aligned_free(fft_in);
+	pffft_aligned_free(fft_out);
+	pffft_destroy_setup(fft_setup);
+	olaf_reader_destroy(reader);
+	return batch_index;
+}
+
+void olaf_chunked_extractor_tests(void){
+	printf("%s\n","Start chunked extractor and stream pipeline tests.");
+	const char* audio_file_name = "tests/olaf_chunked_test.raw";
+
+	//40s of short random tones with a bit of noise
+	Olaf_Config *config = olaf_config_default();
+	size_t length = 40 * config->audioSampleRate;
+	float * audio = (float *) malloc(length * sizeof(float));
+	uint32_t random = 1234;
+	float frequency = 440;
+	for(size_t i = 0 ; i < length ; i++){
+		random = random * 1664525 + 1013904223;
+		if(i % 3000 == 0) frequency = 200 + (random >> 20);
+		audio[i] = 0.5f * sinf(2 * 3.1415926f * frequency * i / config->audioSampleRate) + (random >> 8) / 167772160.0f;
+	}
+	FILE * audio_file = fopen(audio_file_name,"wb");
+	fwrite(audio,sizeof(float),length,audio_file);
+	fclose(audio_file);
+	free(audio);
+
+	//a stream can not be split
+	FILE * stream = fopen(audio_file_name,"rb");
+	Olaf_Reader *reader = olaf_reader_new_file(config,stream);
+	Olaf_Chunked_Extractor * stream_extractor = olaf_chunked_extractor_new(config,reader,4,false);
+	assert(stream_extractor == NULL);
+	const float * audio_block;
+	while(olaf_reader_read_block(reader,&audio_block) == (size_t) config->audioStepSize);
+	olaf_reader_destroy(reader);
+
+	//the same extractors are reused for each sequential run
+	Olaf_EP_Extractor *ep_extractor = olaf_ep_extractor_new(config);
+	Olaf_FP_Extractor *fp_extractor = olaf_fp_extractor_new(config);
+	for(size_t threads = 2 ; threads <= 4 ; threads++){
+		reader = olaf_reader_new(config,audio_file_name);
+		Olaf_Chunked_Extractor * chunked_extractor = olaf_chunked_extractor_new(config,reader,threads,threads == 4);
+		assert(chunked_extractor != NULL);
+		size_t compared = olaf_chunked_extractor_compare(config,audio_file_name,chunked_extractor,ep_extractor,fp_extractor);
+		assert(compared > 0);
+		olaf_chunked_extractor_destroy(chunked_extractor);
+		olaf_reader_destroy(reader);
+	}
+	olaf_fp_extractor_destroy(fp_extractor);
+	olaf_ep_extractor_destroy(ep_extractor);
+
+	//the pipeline of a stream gives the same batches
+	reader = olaf_reader_new(config,audio_file_name);
+	Olaf_Chunked_Extractor * chunked_extractor = olaf_chunked_extractor_new(config,reader,2,false);
+	Olaf_Reader * stream_reader = olaf_reader_new_file(config,fopen(audio_file_name,"rb"));
+	Olaf_Stream_Pipeline * pipeline = olaf_stream_pipeline_new(config,stream_reader,false);
+	size_t batches = 0;
+	struct extracted_fingerprints * batch;
+	while((batch = olaf_stream_pipeline_next(pipeline)) != NULL){
+		struct extracted_fingerprints * expected = olaf_chunked_extractor_batch(chunked_extractor,batches++);
+		assert(batch->fingerprintIndex == expected->fingerprintIndex);
+		assert(batch->lastTimeIndex == expected->lastTimeIndex);
+		assert(memcmp(batch->hashes,expected->hashes,batch->fingerprintIndex * sizeof(uint64_t)) == 0);
+		assert(memcmp(batch->timeIndexes,expected->timeIndexes,batch->fingerprintIndex * sizeof(uint32_t)) == 0);
+	}
+	assert(batches == olaf_chunked_extractor_batches(chunked_extractor));
+	assert(olaf_stream_pipeline_remaining(pipeline)->fingerprintIndex == olaf_chunked_extractor_remaining(chunked_extractor)->fingerprintIndex);
+	assert(olaf_stream_pipeline_total(pipeline) == olaf_chunked_extractor_total(chunked_extractor));
+	olaf_stream_pipeline_destroy(pipeline);
+	olaf_reader_destroy(stream_reader);
+	olaf_chunked_extractor_destroy(chunked_extractor);
+	olaf_reader_destroy(reader);
+
+	remove(audio_file_name);
+	olaf_config_destroy(config);
+}
+
 void olaf_reader_test(void){
 	const char* audio_file_name = "tests/16k_samples.raw";
 
@@ -51,6 +245,34 @@ void olaf_reader_test(void){
 	olaf_config_destroy(config);
 }
 
+void olaf_reader_block_test(void){
+	const char* audio_file_name = "tests/16k_samples.raw";
+
+	Olaf_Config *config = olaf_config_test();
+
+	//a regular file is memory mapped, an opened stream is read with stdio
+	Olaf_Reader *mapped_reader = olaf_reader_new(config,audio_file_name);
+	Olaf_Reader *stream_reader = olaf_reader_new_file(config,fopen(audio_file_name,"rb"));
+
+	size_t samples_expected = config->audioStepSize;
+	size_t samples_read = samples_expected;
+
+	while(samples_read==samples_expected){
+		const float * mapped_block;
+		const float * stream_block;
+		samples_read = olaf_reader_read_block(mapped_reader,&mapped_block);
+		size_t stream_samples_read = olaf_reader_read_block(stream_reader,&stream_block);
+		assert(samples_read == stream_samples_read);
+		assert(memcmp(mapped_block,stream_block,config->audioBlockSize * sizeof(float)) == 0);
+	}
+
+	assert(olaf_reader_total_samples_read(mapped_reader)==16000);
+
+	olaf_reader_destroy(mapped_reader);
+	olaf_reader_destroy(stream_reader);
+	olaf_config_destroy(config);
+}
+
 void olaf_deque_tests(void){
 	Olaf_Deque * deque = olaf_deque_new(100);
 	olaf_deque_push_back(deque,5);
@@ -147,9 +369,13 @@ void olaf_db_tests(void){
 	assert(! olaf_db_has_meta_data(db,&key));
 	olaf_db_stats_meta_data(db,true);
 
-	uint64_t keys[] = {12l,13l,15l};
-	uint64_t values[] = {112l,113l,115l};
-	olaf_db_store(db,keys,values,3);
+	//the fingerprint index is empty so a bulk load is possible
+	bool bulk_load = olaf_db_start_bulk_load(db);
+	assert(bulk_load);
+
+	uint64_t keys[] = {15l,12l,13l,12l};
+	uint64_t values[] = {115l,112l,113l,112l};
+	olaf_db_store(db,keys,values,4);
 
 	uint64_t results[50];
 	size_t number_of_results = olaf_db_find(db,11,12,results,50);;
@@ -160,11 +386,297 @@ void olaf_db_tests(void){
 	number_of_results = olaf_db_find(db,11,13,results,50);
 	assert(number_of_results==2);
 	assert(((uint32_t) results[1])==113l);
+
+	//after the find the bulk load is flushed, the index is no longer empty
+	bulk_load = olaf_db_start_bulk_load(db);
+	assert(!bulk_load);
 	
 	olaf_db_destroy(db);
 	olaf_config_destroy(config);
 }
 
+//Write fingerprints to a binary cache file in two batches
+static void olaf_fp_cache_test_write(Olaf_Config * config,const char * cache_filename,uint32_t audio_identifier,uint64_t * hashes,uint32_t * time_indexes){
+	struct extracted_fingerprints fingerprints;
+	fingerprints.fingerprints = NULL;
+	fingerprints.lastTimeIndex = 0;
+
+	FILE * cache_file = fopen(cache_filename,"wb");
+	Olaf_FP_File_Writer * file_writer = olaf_fp_file_writer_new_binary(cache_file,config,audio_identifier);
+	for(size_t batch = 0 ; batch < 2 ; batch++){
+		fingerprints.hashes = hashes + batch * 2;
+		fingerprints.timeIndexes = time_indexes + batch * 2;
+		fingerprints.fingerprintIndex = 2;
+		olaf_fp_file_writer_write(file_writer,&fingerprints);
+	}
+	Olaf_Resource_Meta_data cached_meta_data;
+	strcpy(cached_meta_data.path,"cached.mp3");
+	cached_meta_data.duration = 1;
+	cached_meta_data.fingerprints = 4;
+	olaf_fp_file_writer_destroy(file_writer,&cached_meta_data,tmpfile());
+}
+
+void olaf_fp_cache_tests(void){
+	printf("%s\n","Start fingerprint cache tests.");
+	Olaf_Config *config = olaf_config_test();
+	const char * cache_filename = "tests/olaf_test_db/fp_cache.bin";
+
+	//two unsorted batches of fingerprints
+	uint64_t hashes[] = {900007,900003,900005,900003};
+	uint32_t time_indexes[] = {40,10,30,20};
+	olaf_fp_cache_test_write(config,cache_filename,77,hashes,time_indexes);
+
+	Olaf_DB* db = olaf_db_new(config->dbFolder,false);
+	Olaf_FP_DB_Writer_Cache * cache_writer = olaf_fp_db_writer_cache_new(db,config,cache_filename);
+	olaf_fp_db_writer_cache_set_audio_file_info(cache_writer,"cached.mp3",78);
+	olaf_fp_db_writer_cache_store(cache_writer);
+	olaf_fp_db_writer_cache_destroy(cache_writer);
+
+	uint64_t results[50];
+	size_t number_of_results = olaf_db_find(db,900003,900003,results,50);
+	assert(number_of_results==2);
+	assert(((uint32_t) results[0])==78);
+	assert((results[0]>>32)==10 || (results[0]>>32)==20);
+	number_of_results = olaf_db_find(db,900000,900009,results,50);
+	assert(number_of_results==4);
+
+	uint32_t key = 78;
+	Olaf_Resource_Meta_data meta_data;
+	olaf_db_find_meta_data(db,&key,&meta_data);
+	assert(meta_data.fingerprints==4);
+	assert(strcmp(meta_data.path,"cached.mp3")==0);
+
+	//a cache extracted with another configuration is not stored
+	Olaf_Config *other_config = olaf_config_test();
+	other_config->maxTimeDistance++;
+	cache_writer = olaf_fp_db_writer_cache_new(db,other_config,cache_filename);
+	olaf_fp_db_writer_cache_set_audio_file_info(cache_writer,"other.mp3",79);
+	olaf_fp_db_writer_cache_store(cache_writer);
+	olaf_fp_db_writer_cache_destroy(cache_writer);
+	key = 79;
+	assert(!olaf_db_has_meta_data(db,&key));
+	number_of_results = olaf_db_find(db,900000,900009,results,50);
+	assert(number_of_results==4);
+
+	//many cache files are loaded by several threads and stored in order
+	char cache_filenames[9][64];
+	Olaf_FP_DB_Writer_Cache * cache_writers[9];
+	for(uint32_t f = 0 ; f < 9 ; f++){
+		uint64_t file_hashes[] = {910000 + f,910000 + f,910100,910200 + f};
+		uint32_t file_time_indexes[] = {f,f + 1,f + 2,f + 3};
+		sprintf(cache_filenames[f],"tests/olaf_test_db/fp_cache_%u.bin",f);
+		olaf_fp_cache_test_write(config,cache_filenames[f],f,file_hashes,file_time_indexes);
+
+		char audio_filename[64];
+		sprintf(audio_filename,"cached_%u.mp3",f);
+		cache_writers[f] = olaf_fp_db_writer_cache_new(db,config,cache_filenames[f]);
+		olaf_fp_db_writer_cache_set_audio_file_info(cache_writers[f],audio_filename,300 + f);
+	}
+	olaf_fp_db_writer_cache_store_all(cache_writers,9,3);
+	for(uint32_t f = 0 ; f < 9 ; f++){
+		olaf_fp_db_writer_cache_destroy(cache_writers[f]);
+		key = 300 + f;
+		olaf_db_find_meta_data(db,&key,&meta_data);
+		assert(meta_data.fingerprints==4);
+
+		number_of_results = olaf_db_find(db,910000 + f,910000 + f,results,50);
+		assert(number_of_results==2);
+		assert(((uint32_t) results[0])==300 + f);
+	}
+	number_of_results = olaf_db_find(db,910100,910100,results,50);
+	assert(number_of_results==9);
+
+	olaf_db_destroy(db);
+	olaf_config_destroy(other_config);
+	olaf_config_destroy(config);
+}
+
+static void * olaf_db_writer_queue_producer(void * arg){
+	Olaf_FP_DB_Writer_Queue * queue = (Olaf_FP_DB_Writer_Queue *) arg;
+	static uint32_t next_id = 1;
+	uint32_t id = __atomic_fetch_add(&next_id,1,__ATOMIC_SEQ_CST);
+
+	uint64_t keys[100];
+	uint64_t values[100];
+	//ten batches of 100 fingerprints each
+	for(uint64_t batch = 0 ; batch < 10 ; batch++){
+		for(uint64_t i = 0 ; i < 100 ; i++){
+			keys[i] = 1000 + batch * 100 + i;
+			values[i] = ((batch * 100 + i) << 32) + id;
+		}
+		olaf_fp_db_writer_queue_store(queue,keys,values,100);
+	}
+
+	Olaf_Resource_Meta_data meta_data;
+	meta_data.duration = 10;
+	meta_data.fingerprints = 1000;
+	strcpy(meta_data.path,"queued.mp3");
+	olaf_fp_db_writer_queue_store_meta_data(queue,id + 200,&meta_data);
+	return NULL;
+}
+
+void olaf_db_writer_queue_tests(void){
+	printf("%s\n","Start DB writer queue tests.");
+	Olaf_Config *config = olaf_config_test();
+
+	//a small capacity forces the producers to block
+	Olaf_FP_DB_Writer_Queue * queue = olaf_fp_db_writer_queue_new(config->dbFolder,2,false);
+
+	pthread_t producers[4];
+	for(int i = 0 ; i < 4 ; i++){
+		pthread_create(&producers[i],NULL,olaf_db_writer_queue_producer,queue);
+	}
+	for(int i = 0 ; i < 4 ; i++){
+		pthread_join(producers[i],NULL);
+	}
+	olaf_fp_db_writer_queue_destroy(queue);
+
+	//everything should be committed
+	Olaf_DB* db = olaf_db_new(config->dbFolder,true);
+	uint64_t results[5000];
+	size_t number_of_results = olaf_db_find(db,1000,1999,results,5000);
+	assert(number_of_results==4000);
+
+	number_of_results = olaf_db_find(db,1500,1500,results,5000);
+	assert(number_of_results==4);
+
+	for(uint32_t key = 201 ; key <= 204 ; key++){
+		assert(olaf_db_has_meta_data(db,&key));
+	}
+
+	olaf_db_destroy(db);
+	olaf_config_destroy(config);
+}
+
+void olaf_db_find_batch_tests(void){
+	printf("%s\n","Start DB find batch tests.");
+	Olaf_Config *config = olaf_config_test();
+	Olaf_DB* db = olaf_db_new(config->dbFolder,true);
+
+	//unsorted, duplicate and overlapping keys, a key without results
+	uint64_t keys[] = {1500,12,1502,5000,1000,1500,1998};
+	size_t keys_size = 7;
+	uint64_t range = 2;
+
+	uint64_t results[1000];
+	size_t result_counts[7];
+	size_t total = olaf_db_find_batch(db,keys,keys_size,range,results,1000,50,result_counts);
+
+	uint64_t expected[50];
+	size_t offset = 0;
+	for(size_t i = 0 ; i < keys_size ; i++){
+		size_t number_of_expected = olaf_db_find(db,keys[i]-range,keys[i]+range,expected,50);
+		assert(result_counts[i] == number_of_expected);
+		assert(memcmp(results + offset,expected,number_of_expected * sizeof(uint64_t)) == 0);
+		offset += result_counts[i];
+	}
+	assert(total == offset);
+	assert(result_counts[3] == 0);
+	assert(result_counts[0] == 20);
+
+	//the maximum number of results per key is respected
+	total = olaf_db_find_batch(db,keys,keys_size,range,results,1000,3,result_counts);
+	assert(result_counts[0] == 3);
+
+	olaf_db_destroy(db);
+	olaf_config_destroy(config);
+}
+
+void olaf_db_resource_index_tests(void){
+	printf("%s\n","Start DB resource index tests.");
+	Olaf_Config *config = olaf_config_test();
+	Olaf_DB* db = olaf_db_new(config->dbFolder,false);
+	bool resource_index = olaf_db_enable_resource_index(db);
+	assert(resource_index);
+
+	//100 fingerprints for audio id 7, 10 colliding ones for audio id 8
+	uint64_t keys[110];
+	uint64_t values[110];
+	for(uint64_t i = 0 ; i < 110 ; i++){
+		keys[i] = 3000 + (i % 100);
+		values[i] = (i << 32) + (i < 100 ? 7 : 8);
+	}
+	olaf_db_store(db,keys,values,110);
+	olaf_db_destroy(db);
+
+	//the resource index is maintained after reopening
+	db = olaf_db_new(config->dbFolder,false);
+	size_t deleted = olaf_db_delete_resource(db,7);
+	assert(deleted == 100);
+	deleted = olaf_db_delete_resource(db,7);
+	assert(deleted == 0);
+	//stored before the resource index was created
+	deleted = olaf_db_delete_resource(db,1);
+	assert(deleted == 0);
+
+	uint64_t results[200];
+	size_t number_of_results = olaf_db_find(db,3000,3099,results,200);
+	assert(number_of_results == 10);
+	for(size_t i = 0 ; i < number_of_results ; i++){
+		assert(((uint32_t) results[i]) == 8);
+	}
+
+	//a regular delete also removes the postings
+	olaf_db_delete(db,keys + 100,values + 100,4);
+	deleted = olaf_db_delete_resource(db,8);
+	assert(deleted == 6);
+	number_of_results = olaf_db_find(db,3000,3099,results,200);
+	assert(number_of_results == 0);
+
+	olaf_db_destroy(db);
+	olaf_config_destroy(config);
+}
+
+void olaf_db_reader_tests(void){
+	printf("%s\n","Start DB reader tests.");
+	Olaf_Config *config = olaf_config_test();
+	Olaf_DB* db = olaf_db_new(config->dbFolder,true);
+
+	//readers share the environment but have their own transaction
+	Olaf_DB* reader = olaf_db_new_reader(db);
+	assert(reader != NULL);
+	Olaf_DB* reader_of_reader = olaf_db_new_reader(reader);
+	assert(reader_of_reader == NULL);
+
+	uint64_t results[5000];
+	uint64_t reader_results[5000];
+	size_t number_of_results = olaf_db_find(db,1000,1999,results,5000);
+	olaf_db_renew(reader);
+	size_t number_of_reader_results = olaf_db_find(reader,1000,1999,reader_results,5000);
+	assert(number_of_results == 4000);
+	assert(number_of_reader_results == number_of_results);
+	assert(memcmp(results,reader_results,number_of_results * sizeof(uint64_t)) == 0);
+
+	uint32_t key = 201;
+	assert(olaf_db_has_meta_data(reader,&key));
+
+	olaf_db_destroy(reader);
+	olaf_db_destroy(db);
+
+	//a live database sees fingerprints stored after a renew
+	Olaf_DB* live = olaf_db_new_live(config->dbFolder);
+	reader = olaf_db_new_reader(live);
+	assert(reader != NULL);
+	uint64_t live_key = 777777;
+	uint64_t live_value = ((uint64_t) 12 << 32) + 301;
+	db = olaf_db_new(config->dbFolder,false);
+	olaf_db_store(db,&live_key,&live_value,1);
+	olaf_db_destroy(db);
+	number_of_results = olaf_db_find(reader,live_key,live_key,results,5000);
+	assert(number_of_results == 0);
+	olaf_db_renew(reader);
+	number_of_results = olaf_db_find(reader,live_key,live_key,results,5000);
+	assert(number_of_results == 1);
+	assert(results[0] == live_value);
+
+	db = olaf_db_new(config->dbFolder,false);
+	olaf_db_delete(db,&live_key,&live_value,1);
+	olaf_db_destroy(db);
+	olaf_db_destroy(reader);
+	olaf_db_destroy(live);
+	olaf_config_destroy(config);
+}
+
 void olaf_pack_test(void){
 	uint64_t hash = 1234567895647l;
 	uint32_t t = 7895;
@@ -181,12 +693,494 @@ void olaf_pack_test(void){
 	fprintf(stdout,"Passed pack test, %d %lld \n",unpacked_t , unpacked_hash);
 }
 
+static int olaf_test_compare_values(const void * a, const void * b){
+	uint64_t x = *(const uint64_t *) a;
+	uint64_t y = *(const uint64_t *) b;
+	return (x > y) - (x < y);
+}
+
+//A bulk load which does not fit in OLAF_DB_BULK_LOAD_MAX fingerprints is sorted in runs, which 
+//are spilled and merged. `make test_bulk_load` runs the tests with runs of a few thousand.
+void olaf_db_bulk_load_tests(void){
+	printf("%s\n","Start DB bulk load tests.");
+	const char * bulk_folder = "tests/olaf_test_shards/bulk";
+	const char * plain_folder = "tests/olaf_test_shards/bulk_plain";
+
+	//many values per hash, spread over the runs
+	size_t size = 30000;
+	uint64_t * keys = (uint64_t *) malloc(size * sizeof(uint64_t));
+	uint64_t * values = (uint64_t *) malloc(size * sizeof(uint64_t));
+	srand(7);
+	for(size_t i = 0 ; i < size ; i++){
+		keys[i] = (uint64_t) (rand() % (1 << 12));
+		values[i] = ((uint64_t) i << 32) + 1 + (uint64_t) (i % 5);
+	}
+
+	Olaf_DB * db = olaf_db_new(bulk_folder,false);
+	bool resource_index = olaf_db_enable_resource_index(db);
+	bool bulk_load = olaf_db_start_bulk_load(db);
+	assert(resource_index && bulk_load);
+	for(size_t i = 0 ; i < size ; i += 1000){
+		olaf_db_store(db,keys + i,values + i,1000);
+	}
+	olaf_db_destroy(db);
+
+	db = olaf_db_new(plain_folder,false);
+	resource_index = olaf_db_enable_resource_index(db);
+	assert(resource_index);
+	olaf_db_store(db,keys,values,size);
+	olaf_db_destroy(db);
+
+	Olaf_DB * bulk = olaf_db_new(bulk_folder,true);
+	Olaf_DB * plain = olaf_db_new(plain_folder,true);
+	uint64_t * bulk_results = (uint64_t *) malloc((size + 1) * sizeof(uint64_t));
+	uint64_t * plain_results = (uint64_t *) malloc((size + 1) * sizeof(uint64_t));
+	size_t found = olaf_db_find(bulk,0,1 << 12,bulk_results,size + 1);
+	size_t plain_found = olaf_db_find(plain,0,1 << 12,plain_results,size + 1);
+	assert(found == size);
+	assert(found == plain_found);
+	assert(memcmp(bulk_results,plain_results,found * sizeof(uint64_t)) == 0);
+	olaf_db_destroy(bulk);
+	olaf_db_destroy(plain);
+
+	//the resource index is built from the runs as well
+	db = olaf_db_new(bulk_folder,false);
+	size_t deleted = olaf_db_delete_resource(db,3);
+	assert(deleted == size / 5);
+	found = olaf_db_find(db,0,1 << 12,bulk_results,size + 1);
+	assert(found == size - size / 5);
+	olaf_db_destroy(db);
+
+	free(bulk_results);
+	free(plain_results);
+	free(keys);
+	free(values);
+}
+
+//Stores the same fingerprints in a sharded and a plain database, both should find the same
+void olaf_db_shard_tests(void){
+	printf("%s\n","Start DB shard tests.");
+	const char * sharded_folder = "tests/olaf_test_shards/db";
+	const char * plain_folder = "tests/olaf_test_shards/plain";
+	const char * shard_folders[] = {"tests/olaf_test_shards/0","tests/olaf_test_shards/1","tests/olaf_test_shards/2"};
+
+	bool created = olaf_db_create_shards(sharded_folder,shard_folders,0);
+	assert(!created);
+	created = olaf_db_create_shards(sharded_folder,shard_folders,3);
+	assert(created);
+	//the same layout is accepted again, another one is refused
+	created = olaf_db_create_shards(sharded_folder,shard_folders,3);
+	assert(created);
+	created = olaf_db_create_shards(sharded_folder,shard_folders,2);
+	assert(!created);
+
+	//enough fingerprints to store the shards in parallel
+	size_t size = 20000;
+	uint64_t * keys = (uint64_t *) malloc(size * sizeof(uint64_t));
+	uint64_t * values = (uint64_t *) malloc(size * sizeof(uint64_t));
+	srand(42);
+	for(size_t i = 0 ; i < size ; i++){
+		keys[i] = (uint64_t) (rand() % (1 << 20));
+		values[i] = ((uint64_t) i << 32) + 1 + (uint64_t) (i % 3);
+	}
+
+	const char * folders[] = {sharded_folder,plain_folder};
+	for(size_t f = 0 ; f < 2 ; f++){
+		Olaf_DB * db = olaf_db_new(folders[f],false);
+		bool resource_index = olaf_db_enable_resource_index(db);
+		assert(resource_index);
+		olaf_db_store(db,keys,values,size / 2);
+		//a few small stores, routed one by one
+		for(size_t i = size / 2 ; i < size ; i += 100){
+			olaf_db_store(db,keys + i,values + i,100);
+		}
+		olaf_db_delete(db,keys,values,10);
+		//a large delete, from the shards in parallel
+		olaf_db_delete(db,keys + 5000,values + 5000,4000);
+		olaf_db_destroy(db);
+	}
+
+	Olaf_DB * sharded = olaf_db_new(sharded_folder,true);
+	Olaf_DB * plain = olaf_db_new(plain_folder,true);
+
+	size_t max_results = 2000;
+	uint64_t * sharded_results = (uint64_t *) malloc(max_results * sizeof(uint64_t));
+	uint64_t * plain_results = (uint64_t *) malloc(max_results * sizeof(uint64_t));
+
+	//narrow ranges are found in key order
+	for(size_t i = 0 ; i < size ; i += 97){
+		uint64_t start = keys[i] < 70 ? 0 : keys[i] - 70;
+		size_t found = olaf_db_find(sharded,start,keys[i] + 70,sharded_results,max_results);
+		size_t plain_found = olaf_db_find(plain,start,keys[i] + 70,plain_results,max_results);
+		assert(found == plain_found);
+		assert(memcmp(sharded_results,plain_results,found * sizeof(uint64_t)) == 0);
+	}
+
+	//a wide range is collected shard by shard
+	size_t found = olaf_db_find(sharded,1000,21000,sharded_results,max_results);
+	size_t plain_found = olaf_db_find(plain,1000,21000,plain_results,max_results);
+	assert(found > 0 && found == plain_found);
+	qsort(sharded_results,found,sizeof(uint64_t),olaf_test_compare_values);
+	qsort(plain_results,found,sizeof(uint64_t),olaf_test_compare_values);
+	assert(memcmp(sharded_results,plain_results,found * sizeof(uint64_t)) == 0);
+
+	size_t keys_size = 200;
+	size_t sharded_counts[200];
+	size_t plain_counts[200];
+	size_t total = olaf_db_find_batch(sharded,keys + 1000,keys_size,5,sharded_results,max_results,20,sharded_counts);
+	size_t plain_total = olaf_db_find_batch(plain,keys + 1000,keys_size,5,plain_results,max_results,20,plain_counts);
+	assert(total == plain_total);
+	assert(memcmp(sharded_counts,plain_counts,keys_size * sizeof(size_t)) == 0);
+	assert(memcmp(sharded_results,plain_results,total * sizeof(uint64_t)) == 0);
+
+	//results which do not fit are reported as full
+	total = olaf_db_find_batch(sharded,keys + 1000,keys_size,5,sharded_results,50,20,sharded_counts);
+	plain_total = olaf_db_find_batch(plain,keys + 1000,keys_size,5,plain_results,50,20,plain_counts);
+	assert(total == 50);
+	assert(plain_total == 50);
+
+	//every shard has its own reader
+	Olaf_DB * reader = olaf_db_new_reader(sharded);
+	found = olaf_db_find(reader,keys[500],keys[500],sharded_results,max_results);
+	assert(found > 0);
+	olaf_db_destroy(reader);
+
+	olaf_db_destroy(sharded);
+	olaf_db_destroy(plain);
+
+	size_t deleted[2];
+	for(size_t f = 0 ; f < 2 ; f++){
+		Olaf_DB * db = olaf_db_new(folders[f],false);
+		deleted[f] = olaf_db_delete_resource(db,2);
+		olaf_db_destroy(db);
+	}
+	assert(deleted[0] > 0 && deleted[0] == deleted[1]);
+
+	//two of the shards are moved to worker processes, here served by threads
+	const char * remote_folder = "tests/olaf_test_shards/remote";
+	const char * remote_shards[] = {"unix:tests/olaf_test_shards/0.sock","unix:tests/olaf_test_shards/1.sock","tests/olaf_test_shards/2"};
+	created = olaf_db_create_shards(remote_folder,shard_folders,3);
+	assert(created);
+	created = olaf_db_create_shards(remote_folder,remote_shards,3);
+	assert(created);
+
+	Olaf_DB * worker_dbs[2];
+	Olaf_DB_Remote_Server * workers[2];
+	for(size_t w = 0 ; w < 2 ; w++){
+		worker_dbs[w] = olaf_db_new_live(shard_folders[w]);
+		workers[w] = olaf_db_remote_server_new(worker_dbs[w],remote_shards[w]);
+		assert(workers[w] != NULL);
+	}
+
+	//the meta data of the coordinator is created by the live database
+	Olaf_DB * coordinator = olaf_db_new_live(remote_folder);
+	plain = olaf_db_new(plain_folder,true);
+
+	size_t queried = 0;
+	for(size_t i = 0 ; i < size ; i += 97){
+		found = olaf_db_find(coordinator,keys[i],keys[i] + 70,sharded_results,max_results);
+		plain_found = olaf_db_find(plain,keys[i],keys[i] + 70,plain_results,max_results);
+		assert(found == plain_found);
+		assert(memcmp(sharded_results,plain_results,found * sizeof(uint64_t)) == 0);
+		queried += found;
+	}
+	assert(queried > 0);
+
+	//the batches of the workers are gathered per key, each reader has its own connections
+	reader = olaf_db_new_reader(coordinator);
+	for(size_t i = 0 ; i < size ; i += keys_size){
+		total = olaf_db_find_batch(reader,keys + i,keys_size,5,sharded_results,max_results,20,sharded_counts);
+		plain_total = olaf_db_find_batch(plain,keys + i,keys_size,5,plain_results,max_results,20,plain_counts);
+		assert(total == plain_total);
+		assert(memcmp(sharded_counts,plain_counts,keys_size * sizeof(size_t)) == 0);
+		assert(memcmp(sharded_results,plain_results,total * sizeof(uint64_t)) == 0);
+	}
+	olaf_db_destroy(reader);
+
+	//without a worker only the other shards answer
+	olaf_db_remote_server_destroy(workers[0]);
+	olaf_db_destroy(worker_dbs[0]);
+	size_t partial = olaf_db_find_batch(coordinator,keys,keys_size,5,sharded_results,max_results,20,sharded_counts);
+	size_t complete = olaf_db_find_batch(plain,keys,keys_size,5,plain_results,max_results,20,plain_counts);
+	assert(partial < complete);
+
+	olaf_db_destroy(coordinator);
+	olaf_db_destroy(plain);
+	olaf_db_remote_server_destroy(workers[1]);
+	olaf_db_destroy(worker_dbs[1]);
+
+	free(sharded_results);
+	free(plain_results);
+	free(keys);
+	free(values);
+}
+
+//A flat index finds the same fingerprints as the B-tree it is a copy of
+void olaf_db_flat_tests(void){
+	printf("%s\n","Start DB flat index tests.");
+	const char * folder = "tests/olaf_test_shards/plain";
+	const char * flat_path = "tests/olaf_test_shards/flat";
+
+	//wide hashes, keys in order and the values of a key in order
+	Olaf_DB_Flat_Writer * writer = olaf_db_flat_writer_new(flat_path,100,(uint64_t) 99 << 40,1);
+	bool appended = true;
+	for(uint64_t i = 0 ; i < 100 ; i += 2){
+		appended = olaf_db_flat_writer_append(writer,i << 40,i) && appended;
+		appended = olaf_db_flat_writer_append(writer,i << 40,i + 1) && appended;
+	}
+	assert(appended);
+	appended = olaf_db_flat_writer_append(writer,0,0);
+	assert(!appended);
+	bool written = olaf_db_flat_writer_destroy(writer,true);
+	assert(!written);
+	Olaf_DB_Flat * flat = olaf_db_flat_open(flat_path);
+	assert(flat == NULL);
+
+	writer = olaf_db_flat_writer_new(flat_path,100,(uint64_t) 99 << 40,1);
+	for(uint64_t i = 0 ; i < 100 ; i += 2){
+		olaf_db_flat_writer_append(writer,i << 40,i);
+		olaf_db_flat_writer_append(writer,i << 40,i + 1);
+	}
+	written = olaf_db_flat_writer_destroy(writer,true);
+	assert(written);
+
+	flat = olaf_db_flat_open(flat_path);
+	assert(flat != NULL && olaf_db_flat_txn_id(flat) == 1);
+	Olaf_DB_Flat_Cursor flat_cursor;
+	uint64_t found_key, found_value;
+	bool found = olaf_db_flat_seek(flat,&flat_cursor,((uint64_t) 41 << 40) + 1,&found_key,&found_value);
+	assert(found && found_key == (uint64_t) 42 << 40 && found_value == 42);
+	found = olaf_db_flat_next(flat,&flat_cursor,&found_key,&found_value);
+	assert(found && found_key == (uint64_t) 42 << 40 && found_value == 43);
+	found = olaf_db_flat_next(flat,&flat_cursor,&found_key,&found_value);
+	assert(found && found_key == (uint64_t) 44 << 40 && found_value == 44);
+	found = olaf_db_flat_seek(flat,&flat_cursor,((uint64_t) 98 << 40) + 1,&found_key,&found_value);
+	assert(!found);
+	olaf_db_flat_destroy(flat);
+	remove(flat_path);
+
+	size_t keys_size = 200;
+	size_t max_results = 4000;
+	uint64_t keys[200];
+	srand(7);
+	for(size_t i = 0 ; i < keys_size ; i++){
+		keys[i] = (uint64_t) (rand() % (1 << 20));
+	}
+
+	uint64_t * tree_results = (uint64_t *) malloc(max_results * sizeof(uint64_t));
+	uint64_t * flat_results = (uint64_t *) malloc(max_results * sizeof(uint64_t));
+	size_t tree_counts[200];
+	size_t flat_counts[200];
+
+	//only a read only database is exported
+	Olaf_DB * db = olaf_db_new(folder,false);
+	bool exported = olaf_db_export_flat(db);
+	assert(!exported);
+	olaf_db_destroy(db);
+
+	//narrow ranges and a batch, looked up in the B-tree
+	db = olaf_db_new(folder,true);
+	size_t tree_found = 0;
+	for(size_t i = 0 ; i < keys_size ; i++){
+		tree_found += olaf_db_find(db,keys[i],keys[i] + 100,tree_results + tree_found,10);
+	}
+	size_t tree_total = olaf_db_find_batch(db,keys,keys_size,5,tree_results + tree_found,max_results - tree_found,10,tree_counts);
+	assert(tree_found > 0 && tree_total > 0);
+	exported = olaf_db_export_flat(db);
+	assert(exported);
+	olaf_db_destroy(db);
+
+	db = olaf_db_new(folder,true);
+	Olaf_DB * reader = olaf_db_new_reader(db);
+	size_t flat_found = 0;
+	for(size_t i = 0 ; i < keys_size ; i++){
+		flat_found += olaf_db_find(reader,keys[i],keys[i] + 100,flat_results + flat_found,10);
+	}
+	size_t flat_total = olaf_db_find_batch(db,keys,keys_size,5,flat_results + flat_found,max_results - flat_found,10,flat_counts);
+	assert(flat_found == tree_found);
+	assert(flat_total == tree_total);
+	assert(memcmp(tree_counts,flat_counts,keys_size * sizeof(size_t)) == 0);
+	assert(memcmp(tree_results,flat_results,(tree_found + tree_total) * sizeof(uint64_t)) == 0);
+	flat_found = olaf_db_find(db,1 << 21,1 << 22,flat_results,max_results);
+	assert(flat_found == 0);
+	olaf_db_destroy(reader);
+	olaf_db_destroy(db);
+
+	//a change makes the flat index out of date, the B-tree is used again
+	uint64_t key = 1 << 21;
+	uint64_t value = ((uint64_t) 99 << 32) + 1;
+	db = olaf_db_new(folder,false);
+	olaf_db_store(db,&key,&value,1);
+	olaf_db_destroy(db);
+	db = olaf_db_new(folder,true);
+	flat_found = olaf_db_find(db,key,key,flat_results,max_results);
+	assert(flat_found == 1 && flat_results[0] == value);
+	olaf_db_destroy(db);
+
+	//each local shard has a flat index of its own
+	const char * sharded_folder = "tests/olaf_test_shards/db";
+	db = olaf_db_new(sharded_folder,true);
+	tree_total = olaf_db_find_batch(db,keys,keys_size,5,tree_results,max_results,20,tree_counts);
+	exported = olaf_db_export_flat(db);
+	assert(exported);
+	olaf_db_destroy(db);
+	db = olaf_db_new(sharded_folder,true);
+	flat_total = olaf_db_find_batch(db,keys,keys_size,5,flat_results,max_results,20,flat_counts);
+	assert(flat_total == tree_total);
+	assert(memcmp(tree_counts,flat_counts,keys_size * sizeof(size_t)) == 0);
+	assert(memcmp(tree_results,flat_results,tree_total * sizeof(uint64_t)) == 0);
+	olaf_db_destroy(db);
+
+	free(tree_results);
+	free(flat_results);
+}
+
+//The same values are found for each key, in the same order. With a few results per key
+//the look-up is cut short: the same values should be kept.
+static void olaf_test_compare_per_key(Olaf_DB * a,Olaf_DB * b,const uint64_t * keys,size_t keys_size){
+	size_t max_results = 100000;
+	uint64_t * a_results = (uint64_t *) malloc(max_results * sizeof(uint64_t));
+	uint64_t * b_results = (uint64_t *) malloc(max_results * sizeof(uint64_t));
+	size_t * a_counts = (size_t *) malloc(keys_size * sizeof(size_t));
+	size_t * b_counts = (size_t *) malloc(keys_size * sizeof(size_t));
+	size_t max_results_per_key[] = {1000,5};
+
+	for(size_t m = 0 ; m < 2 ; m++){
+		size_t total = olaf_db_find_batch(a,keys,keys_size,2,a_results,max_results,max_results_per_key[m],a_counts);
+		size_t b_total = olaf_db_find_batch(b,keys,keys_size,2,b_results,max_results,max_results_per_key[m],b_counts);
+		assert(total > 0 && total < max_results);
+		assert(total == b_total);
+		assert(memcmp(a_counts,b_counts,keys_size * sizeof(size_t)) == 0);
+		assert(memcmp(a_results,b_results,total * sizeof(uint64_t)) == 0);
+	}
+	//the cap is reached
+	assert(a_counts[0] == max_results_per_key[1]);
+
+	size_t found = olaf_db_find(a,keys[0],keys[0] + 10,a_results,max_results);
+	size_t b_found = olaf_db_find(b,keys[0],keys[0] + 10,b_results,max_results);
+	assert(found == b_found);
+	assert(memcmp(a_results,b_results,found * sizeof(uint64_t)) == 0);
+
+	free(a_results);
+	free(b_results);
+	free(a_counts);
+	free(b_counts);
+}
+
+//Stores the same fingerprints with and without posting blocks, both should find the same
+void olaf_db_blocks_tests(void){
+	printf("%s\n","Start DB posting blocks tests.");
+	const char * blocks_folder = "tests/olaf_test_shards/blocks";
+	const char * tree_folder = "tests/olaf_test_shards/tree";
+	const char * folders[] = {blocks_folder,tree_folder};
+
+	//many collisions: about 20 values for each hash, of 3 audio identifiers
+	size_t size = 20000;
+	uint64_t * keys = (uint64_t *) malloc(size * sizeof(uint64_t));
+	uint64_t * values = (uint64_t *) malloc(size * sizeof(uint64_t));
+	srand(25);
+	for(size_t i = 0 ; i < size ; i++){
+		keys[i] = 5000 + (uint64_t) (rand() % 1000);
+		values[i] = ((uint64_t) (i * 7) << 32) + 1 + (uint64_t) (rand() % 3);
+	}
+	size_t keys_size = 300;
+	uint64_t * query_keys = keys + 1000;
+
+	//a bulk load of an empty database with posting blocks fills the posting blocks directly
+	for(size_t f = 0 ; f < 2 ; f++){
+		Olaf_DB * db = olaf_db_new(folders[f],false);
+		bool resource_index = olaf_db_enable_resource_index(db);
+		assert(resource_index);
+		if(f == 0){
+			bool merged = olaf_db_merge_blocks(db);
+			bool bulk_load = olaf_db_start_bulk_load(db);
+			assert(merged && bulk_load);
+		}
+		olaf_db_store(db,keys,values,size / 2);
+		olaf_db_destroy(db);
+	}
+
+	//only a writable database is merged
+	Olaf_DB * db = olaf_db_new(blocks_folder,true);
+	bool merged = olaf_db_merge_blocks(db);
+	assert(!merged);
+	olaf_db_destroy(db);
+	db = olaf_db_new(blocks_folder,false);
+	merged = olaf_db_merge_blocks(db);
+	assert(merged);
+	olaf_db_destroy(db);
+
+	Olaf_DB * blocks = olaf_db_new(blocks_folder,true);
+	Olaf_DB * tree = olaf_db_new(tree_folder,true);
+	olaf_test_compare_per_key(blocks,tree,query_keys,keys_size);
+	olaf_db_destroy(blocks);
+	olaf_db_destroy(tree);
+
+	//new fingerprints are searched next to the posting blocks, deletes reach both
+	for(size_t f = 0 ; f < 2 ; f++){
+		db = olaf_db_new(folders[f],false);
+		olaf_db_store(db,keys + size / 2,values + size / 2,size / 2);
+		olaf_db_delete(db,keys + 100,values + 100,50);
+		olaf_db_delete(db,keys + size - 100,values + size - 100,50);
+		olaf_db_destroy(db);
+	}
+
+	blocks = olaf_db_new(blocks_folder,true);
+	tree = olaf_db_new(tree_folder,true);
+	olaf_test_compare_per_key(blocks,tree,query_keys,keys_size);
+	olaf_db_destroy(blocks);
+	olaf_db_destroy(tree);
+
+	size_t deleted[2];
+	for(size_t f = 0 ; f < 2 ; f++){
+		db = olaf_db_new(folders[f],false);
+		deleted[f] = olaf_db_delete_resource(db,2);
+		if(f == 0){
+			merged = olaf_db_merge_blocks(db);
+			assert(merged);
+		}
+		olaf_db_destroy(db);
+	}
+	assert(deleted[0] > 0 && deleted[0] == deleted[1]);
+
+	blocks = olaf_db_new(blocks_folder,true);
+	tree = olaf_db_new(tree_folder,true);
+	olaf_test_compare_per_key(blocks,tree,query_keys,keys_size);
+	olaf_db_destroy(tree);
+
+	//the flat index is a copy of the posting blocks
+	bool exported = olaf_db_export_flat(blocks);
+	assert(exported);
+	olaf_db_destroy(blocks);
+	blocks = olaf_db_new(blocks_folder,true);
+	tree = olaf_db_new(tree_folder,true);
+	olaf_test_compare_per_key(blocks,tree,query_keys,keys_size);
+	olaf_db_destroy(blocks);
+	olaf_db_destroy(tree);
+
+	free(keys);
+	free(values);
+}
+
 int main(int argc, const char* argv[]){
 	(void)(argc);
 	(void)(argv);
 	//olaf_max_filter_test();
 	olaf_deque_tests();
 	olaf_db_tests();
+	olaf_db_writer_queue_tests();
+	olaf_db_find_batch_tests();
+	olaf_db_reader_tests();
+	olaf_fp_cache_tests();
+	olaf_db_resource_index_tests();
+	olaf_db_bulk_load_tests();
+	olaf_db_shard_tests();
+	olaf_db_flat_tests();
+	olaf_db_blocks_tests();
+	olaf_audio_buffer_tests();
+	olaf_ep_expire_tests();
+	olaf_chunked_extractor_tests();
 	olaf_reader_test();
+	olaf_reader_block_test();
 	olaf_pack_test();
 }